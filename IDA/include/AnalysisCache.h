@@ -0,0 +1,78 @@
+#ifndef IDA_ANALYSIS_CACHE_H
+#define IDA_ANALYSIS_CACHE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "llvm/IR/ModuleSlotTracker.h"
+
+#include "utils.h"
+
+
+namespace ida {
+
+    // An on-disk cache for per-function analysis summaries.
+    //
+    // Each function is fingerprinted by its own IR (instructions, operands, CFG and debug
+    // locations) plus the declarations of the callees, globals and struct types it touches,
+    // and by the IR of all functions reachable from it through direct calls. A summary is stored as "<cache dir>/<fingerprint>.<kind>", so a changed function
+    // simply misses the cache and its stale summary is never looked up again.
+    //
+    // Values inside a summary are referenced relative to the function they belong to:
+    //   -        null
+    //   i<n>     the n-th instruction of the function
+    //   a<n>     the n-th argument of the function
+    //   o<n>.<k> the k-th operand of the n-th instruction (globals, constant expressions)
+    // and types by the order in which the fingerprint meets them:
+    //   t<n>     the n-th type used by the function
+    class AnalysisCache {
+        public:
+            static AnalysisCache &get();
+
+            // the cache is used only if a cache directory is given by -ida-cache-dir
+            bool isEnabled();
+
+            // forget the numbering of the previously analysed module, if any
+            void reset();
+
+            bool load(llvm::Function *F, const std::string &kind, std::vector<std::string> &lines);
+            void store(llvm::Function *F, const std::string &kind, const std::vector<std::string> &lines);
+
+            std::string encodeValue(llvm::Function *F, llvm::Value *V);
+            llvm::Value *decodeValue(llvm::Function *F, const std::string &ref);
+
+            std::string encodeType(llvm::Function *F, llvm::Type *T);
+            llvm::Type *decodeType(llvm::Function *F, const std::string &ref);
+
+            // deterministic numbering of functions and instructions in the module
+            unsigned getFunctionIndex(llvm::Function *F);
+            unsigned getInstructionIndex(llvm::Instruction *I);
+            llvm::Instruction *getInstruction(llvm::Function *F, unsigned index);
+
+            // true if I1 appears before I2 in the module
+            bool isBefore(llvm::Instruction *I1, llvm::Instruction *I2);
+
+        private:
+            AnalysisCache() {}
+
+            std::string getFingerprint(llvm::Function *F);
+            std::string getLocalFingerprint(llvm::Function *F);
+            std::string getCachePath(llvm::Function *F, const std::string &kind);
+            void numberInstructions(llvm::Function *F);
+
+            std::unique_ptr<llvm::ModuleSlotTracker> _MST;
+            std::unordered_map<llvm::Function *, std::string> _fingerprints;
+            std::unordered_map<llvm::Function *, std::string> _localFingerprints;
+            std::unordered_map<llvm::Function *, std::vector<llvm::Function *>> _callees;
+            std::unordered_map<llvm::Function *, std::vector<llvm::Type *>> _funcTypes;
+            std::unordered_map<llvm::Function *, unsigned> _funcIndex;
+            std::unordered_map<llvm::Function *, std::vector<llvm::Instruction *>> _funcInsts;
+            std::unordered_map<llvm::Instruction *, unsigned> _instIndex;
+            std::unordered_map<llvm::Function *, std::unordered_map<llvm::Value *, std::string>> _operandRefs;
+    };
+
+} // namespace ida
+
+#endif
@@ -6,6 +6,7 @@
 
 
 #include "utils.h"
+#include "AnalysisCache.h"
 
 
 #define BB_THRESHOLD	32
@@ -20,6 +21,7 @@ namespace ida {
 	typedef struct struct_pointer {
 		llvm::Type *type;
 		int offset;		// in bits
+		llvm::Instruction *inst;	// GEP that derives this pointer
 
 		bool operator==(struct_pointer& other) const {
 			return ((type == other.type) && (offset == other.offset));
@@ -62,6 +64,10 @@ namespace ida {
 
 		    BranchDependencyAnalysis(): llvm::ModulePass(ID) {};
 
+		    // run inside another tool (e.g. KLEE), see InterproceduralDependencyAnalysis
+		    explicit BranchDependencyAnalysis(const std::string &stats_path):
+		    	llvm::ModulePass(ID), _inProcess(true), _statsPath(stats_path) {};
+
 		    virtual bool runOnModule(llvm::Module &M);
 		    virtual void getAnalysisUsage(llvm::AnalysisUsage &AU) const;
 
@@ -75,12 +81,25 @@ namespace ida {
             void outputBranchDep(BranchDep *BD);
             void showDataDependency(DataDep *data_dep);
 
+			// (de)serialization of data dependency for the per-function summary cache
+			std::string encodeDataDep(llvm::Function *F, DataDep *data_dep);
+			DataDep *decodeDataDep(llvm::Function *F, const std::string &str);
+			std::vector<DataDep *> getOrderedDataDeps(llvm::Function *F, DataDepSet &data_dep_set);
+
 		private:
 
+			bool _inProcess = false;
+			std::string _statsPath;
+
 			std::unordered_map<llvm::Function *, BranchDepSet> FuncBranchDeps;
 			
 			int getBBLabel(llvm::BasicBlock * BB);
 
+			bool loadBranchDeps(llvm::Function *F, unsigned &branch_num, \
+								unsigned &total_branch_num, unsigned &switch_num);
+			void storeBranchDeps(llvm::Function *F, unsigned branch_num, \
+								unsigned total_branch_num, unsigned switch_num);
+
 			llvm::StoreInst *selectStoreInst(std::vector<llvm::StoreInst *> Froms, \
 											llvm::Instruction *To, \
 											llvm::DominatorTree* DT, llvm::LoopInfo* LI);
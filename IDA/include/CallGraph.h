@@ -1,5 +1,6 @@
 #include <set>
 #include <string>
+#include <unordered_map>
 
 #include "LLVMEssentials.h"
 
@@ -49,5 +50,6 @@ namespace ida {
 			NodeSet getIndirectCallCandidates(llvm::Module &M, llvm::CallInst *CI);
 
 			NodeSet _CG;
+			std::unordered_map<llvm::Function *, Node *> _nodes;	// node of each function in _CG
 	};
 }
\ No newline at end of file
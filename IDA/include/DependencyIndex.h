@@ -0,0 +1,61 @@
+#ifndef IDA_DEPENDENCY_INDEX_H
+#define IDA_DEPENDENCY_INDEX_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "LLVMEssentials.h"
+
+
+namespace ida {
+
+    // The store-branch dependencies found by IDA, i.e. what KLEE's concrete constraint searcher needs.
+    // It is either kept in memory (IDA running inside KLEE) or encoded as instruction metadata:
+    //   bid = [bid]                            branch id
+    //   sid = [sid]                            store id
+    //   v_num = [var_num]                      number of branch variables with stores
+    //   v_[vid]_t = [type]                     0x1 global, 0x2 local, 0x3 struct-pointer parameter
+    //   v_[vid]_s_num = [store_num]
+    //   s_[vid]_[s_idx] = [sid]
+    //   s_[vid]_[s_idx]_side = [side]          side of the br that the stored constant satisfies
+    // and, for br, the condition "icmp pred V, C" with the branch variable V on the left:
+    //   var_op = [operand index of V], pred = [pred], const = [C], arith_op = [and/or], arith_var = [mask]
+    // where C and the mask are zero-extended to 64 bits
+    enum StoreSide {
+        ss_false, ss_true, ss_unknown
+    };
+
+    struct VariableIndex {
+        unsigned id;
+        unsigned type;
+        std::vector<unsigned> stores;
+        std::vector<unsigned> sides;    // StoreSide of each store
+    };
+
+    struct BranchIndex {
+        unsigned id;
+        llvm::Instruction *inst;
+        std::vector<VariableIndex> vars;
+
+        unsigned var_op = 0;
+        unsigned pred = 0;
+        uint64_t constant = 0;
+        std::string arith_op;           // "and", "or" or empty
+        uint64_t arith_var = 0;
+    };
+
+    struct DependencyIndex {
+        std::map<unsigned, llvm::StoreInst *> stores;
+        std::vector<BranchIndex> branches;   // in module order
+    };
+
+    // whether "icmp pred V, C" holds for V and C of the given bit width, both zero-extended
+    bool isConditionTrue(unsigned pred, unsigned width, uint64_t var, uint64_t constant);
+
+    void writeDependencyMetaData(const DependencyIndex &index);
+    void readDependencyMetaData(llvm::Module &M, DependencyIndex &index);
+
+} // namespace ida
+
+#endif
@@ -6,8 +6,10 @@
 #include <unordered_map>
 
 #include "utils.h"
+#include "AnalysisCache.h"
 #include "CallGraph.h"
 #include "BranchDependencyAnalysis.h"
+#include "DependencyIndex.h"
 
 
 namespace ida {
@@ -17,6 +19,17 @@ namespace ida {
 
             InterproceduralDependencyAnalysis(): llvm::ModulePass(ID) {}
 
+            // IDA may also run inside another tool (e.g. KLEE) on a module that is already loaded.
+            // In that case the results are kept in memory instead of writing a new module, nothing
+            // is printed to stdout, and global statistics go to stats_path.
+            explicit InterproceduralDependencyAnalysis(const std::string &stats_path):
+                llvm::ModulePass(ID), _inProcess(true), _statsPath(stats_path) {}
+
+            // add the in-process analysis and the branch dependency analysis it requires to pm,
+            // which owns both passes
+            static InterproceduralDependencyAnalysis *addInProcess(llvm::legacy::PassManager &pm,
+                                                                   const std::string &stats_path);
+
             virtual bool runOnModule(llvm::Module &M);
             virtual void getAnalysisUsage(llvm::AnalysisUsage& AU) const;
 
@@ -42,7 +55,7 @@ namespace ida {
                 StoreDepSet storeDeps;  
             }VD2SDDep;
 
-            typedef std::unordered_set<VD2SDDep *> VariableDepSet; 
+            typedef std::vector<VD2SDDep *> VariableDepSet; 
 
             // single branch -> multiple source variables
             typedef struct branch_store_dependency {
@@ -67,18 +80,44 @@ namespace ida {
             void findStoreDependencyFromSI(llvm::Function *F, llvm::DominatorTree* DT, llvm::LoopInfo* LI);
             void findStoreDependencyFromRI(llvm::Function *F);
 
+            // store-branch dependency of the analysed module
+            const DependencyIndex &getDependencyIndex() { return _index; }
+
         private:     
 
+            bool _inProcess = false;
+            std::string _statsPath;
+
             void showStructPointersInfo(llvm::Module &M);
-            bool isContainStructPointerList(StructPointers splist_1, StructPointers splist_2);
+            bool isContainStructPointerList(const StructPointers &splist_1, const StructPointers &splist_2);
+
+            // index the store dependencies by their root variable, so that matching a branch variable
+            // does not scan all the stores of the module
+            void indexStoreDeps();
+
+            bool loadStoreDeps(llvm::Function *F);
+            void storeStoreDeps(llvm::Function *F);
+
+            // deterministic orders, so that the same module is always annotated the same way
+            std::vector<StoreDep *> getOrderedStoreDeps(StoreDepSet &SDSet);
+            std::vector<Edge *> getOrderedEdges(EdgeSet &edges);
+
+            void buildDependencyIndex(llvm::Module &M);
 
-            void setInstMetaData();  
+            // precompute the branch condition and which side each constant store leads to
+            bool setBranchPredicate(BranchIndex &branch);
+            unsigned getStoreSide(BranchIndex &branch, llvm::StoreInst *SI);
 
             void outputBD2SDsMap();
             void outputStoreDep(StoreDep *SD);
             
             std::unordered_map<llvm::Function *, StoreDepSet> _SDMap;
-            std::unordered_set<BD2VDDep *> _BD2VDMap;
+            std::unordered_map<llvm::AllocaInst *, StoreDepSet> _localSDs;
+            std::unordered_map<llvm::Value *, StoreDepSet> _globalSDs;
+            std::map<std::pair<llvm::Type *, int>, StoreDepSet> _structSDs;   // by the top struct pointer
+            StoreDepSet _allStructSDs;
+            std::vector<BD2VDDep *> _BD2VDMap;
+            DependencyIndex _index;
 
             CallGraph *_CG;
             BranchDependencyAnalysis *_BDA;
@@ -0,0 +1,48 @@
+#ifndef IDA_PHASE_STATS_H
+#define IDA_PHASE_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace ida {
+
+    // Wall time, peak memory and result counts of the analysis phases (call graph, BDA, store
+    // dependency, matching, ...), in the order they finish. Nothing is recorded unless enabled,
+    // e.g. by ida-bench, since measuring the peak memory resets the peak of the process.
+    class PhaseStats {
+        public:
+            typedef std::vector<std::pair<std::string, uint64_t>> Counts;
+
+            typedef struct phase {
+                std::string name;
+                double seconds;
+                uint64_t peak_rss_kb;
+                Counts counts;
+            }Phase;
+
+            static PhaseStats &get();
+
+            void setEnabled(bool enabled) { _enabled = enabled; }
+            bool isEnabled() { return _enabled; }
+
+            void start(const std::string &name);
+            void stop(const Counts &counts);
+
+            const std::vector<Phase> &getPhases() { return _phases; }
+            void clear() { _phases.clear(); }
+
+        private:
+            PhaseStats() {}
+
+            bool _enabled = false;
+            std::string _name;
+            std::chrono::steady_clock::time_point _start;
+            std::vector<Phase> _phases;
+    };
+
+} // namespace ida
+
+#endif
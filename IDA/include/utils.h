@@ -7,6 +7,7 @@ std::string getSourceFilePath(llvm::Instruction *I);
 unsigned getSourceFileLineNumber(llvm::Instruction *I);
 
 std::string getModuleName(llvm::Module &M);
-bool initGlobalStats(std::ofstream &globalStats, std::string name, bool app); 
+// statistics go to stats_path if given, otherwise to $SOURCE_DIR/stat/<name>.txt
+bool initGlobalStats(std::ofstream &globalStats, std::string name, bool app, const std::string &stats_path);
 
 bool outputNewModule(llvm::Module &M, std::string name);
\ No newline at end of file
@@ -0,0 +1,465 @@
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <tuple>
+#include <unordered_set>
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+
+#include "AnalysisCache.h"
+
+
+using namespace llvm;
+
+
+// bump this if the format of the summaries or the analysis itself changes
+#define CACHE_VERSION   "ida-cache-2"
+
+
+static cl::opt<std::string> CacheDir("ida-cache-dir",
+    cl::desc("Directory to cache per-function dependency summaries (default: no cache)"),
+    cl::init(""));
+
+
+ida::AnalysisCache &ida::AnalysisCache::get() {
+    static AnalysisCache cache;
+    return cache;
+}
+
+
+bool ida::AnalysisCache::isEnabled() {
+    return !CacheDir.empty();
+}
+
+
+void ida::AnalysisCache::reset() {
+    _MST.reset();
+    _fingerprints.clear();
+    _localFingerprints.clear();
+    _callees.clear();
+    _funcTypes.clear();
+    _funcIndex.clear();
+    _funcInsts.clear();
+    _instIndex.clear();
+    _operandRefs.clear();
+}
+
+
+bool ida::AnalysisCache::load(Function *F, const std::string &kind, std::vector<std::string> &lines) {
+    std::ifstream file(getCachePath(F, kind));
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+
+    // a summary is always terminated by "end", otherwise it is truncated
+    if (lines.empty() || (lines.back() != "end")) {
+        lines.clear();
+        return false;
+    }
+
+    lines.pop_back();
+    return true;
+}
+
+
+void ida::AnalysisCache::store(Function *F, const std::string &kind, const std::vector<std::string> &lines) {
+    if (sys::fs::create_directories(CacheDir)) {
+        return;
+    }
+
+    // write to a temporary file first, so that concurrent runs never see a partial summary
+    std::string path = getCachePath(F, kind);
+    std::string tmp_path = path + ".tmp" + std::to_string(sys::Process::getProcessId());
+
+    std::ofstream file(tmp_path);
+    if (!file.is_open()) {
+        return;
+    }
+
+    for (auto &line: lines) {
+        file << line << "\n";
+    }
+    file << "end\n";
+    file.close();
+
+    if (sys::fs::rename(tmp_path, path)) {
+        sys::fs::remove(tmp_path);
+    }
+}
+
+
+std::string ida::AnalysisCache::getCachePath(Function *F, const std::string &kind) {
+    SmallString<128> path(CacheDir);
+    sys::path::append(path, getFingerprint(F) + "." + kind);
+    return path.str().str();
+}
+
+
+std::string ida::AnalysisCache::getFingerprint(Function *F) {
+    auto it = _fingerprints.find(F);
+    if (it != _fingerprints.end()) {
+        return it->second;
+    }
+
+    // the interprocedural results of a function also depend on the bodies of the functions it
+    // may call, so hash those of all functions reachable from it through direct calls
+    MD5 hash;
+    hash.update(getLocalFingerprint(F));
+
+    std::vector<Function *> reachable = _callees[F];
+    std::unordered_set<Function *> visited = {F};
+    for (unsigned i = 0; i < reachable.size(); i++) {
+        Function *callee = reachable[i];
+        if (!visited.insert(callee).second) {
+            continue;
+        }
+
+        hash.update("\nR ");
+        hash.update(callee->getName());
+        hash.update(" ");
+        hash.update(getLocalFingerprint(callee));
+
+        const std::vector<Function *> &callees = _callees[callee];
+        reachable.insert(reachable.end(), callees.begin(), callees.end());
+    }
+
+    MD5::MD5Result result;
+    hash.final(result);
+
+    std::string fingerprint = result.digest().str().str();
+    _fingerprints[F] = fingerprint;
+    return fingerprint;
+}
+
+
+std::string ida::AnalysisCache::getLocalFingerprint(Function *F) {
+    auto it = _localFingerprints.find(F);
+    if (it != _localFingerprints.end()) {
+        return it->second;
+    }
+
+    Module *M = F->getParent();
+    if (!_MST) {
+        _MST.reset(new ModuleSlotTracker(M, false));
+    }
+
+    numberInstructions(F);
+
+    std::unordered_map<BasicBlock *, unsigned> bb_index;
+    for (auto &BB: *F) {
+        unsigned index = bb_index.size();
+        bb_index[&BB] = index;
+    }
+
+    // declarations the function depends on, in the order they are met
+    std::vector<GlobalValue *> globals;
+    std::unordered_set<GlobalValue *> seen_globals;
+    std::vector<StructType *> structs;
+    std::unordered_set<Type *> seen_types;
+    std::vector<Type *> &types = _funcTypes[F];
+    std::vector<Function *> &callees = _callees[F];
+    std::unordered_set<Function *> seen_callees;
+
+    std::function<void(Type *)> addType = [&](Type *T) {
+        if (!seen_types.insert(T).second) {
+            return;
+        }
+        types.push_back(T);
+        if (auto *ST = dyn_cast<StructType>(T)) {
+            structs.push_back(ST);
+        }
+        for (Type *sub: T->subtypes()) {
+            addType(sub);
+        }
+    };
+
+    std::function<void(Value *)> addGlobals = [&](Value *V) {
+        if (auto *GV = dyn_cast<GlobalValue>(V)) {
+            if (seen_globals.insert(GV).second) {
+                globals.push_back(GV);
+                addType(GV->getValueType());
+            }
+        }
+        else if (auto *CE = dyn_cast<ConstantExpr>(V)) {
+            for (Use &U: CE->operands()) {
+                addGlobals(U.get());
+            }
+        }
+    };
+
+    std::string str;
+    raw_string_ostream OS(str);
+
+    OS << CACHE_VERSION << " " << F->getName() << " ";
+    F->getFunctionType()->print(OS);
+    addType(F->getFunctionType());
+
+    // instructions, local operands are numbered so that the text is independent of value names
+    for (auto &BB: *F) {
+        OS << "\nbb" << bb_index[&BB];
+
+        for (auto &I: BB) {
+            OS << "\n  " << I.getOpcodeName() << " ";
+            I.getType()->print(OS);
+            addType(I.getType());
+
+            if (auto *CI = dyn_cast<CmpInst>(&I)) {
+                OS << " p" << CI->getPredicate();
+            }
+            if (auto *GEP = dyn_cast<GetElementPtrInst>(&I)) {
+                OS << " s:";
+                GEP->getSourceElementType()->print(OS);
+                addType(GEP->getSourceElementType());
+            }
+            if (auto *AI = dyn_cast<AllocaInst>(&I)) {
+                OS << " a:";
+                AI->getAllocatedType()->print(OS);
+                addType(AI->getAllocatedType());
+            }
+
+            for (Use &U: I.operands()) {
+                Value *V = U.get();
+
+                OS << ", ";
+                if (auto *OI = dyn_cast<Instruction>(V)) {
+                    OS << "i" << _instIndex[OI];
+                }
+                else if (auto *A = dyn_cast<Argument>(V)) {
+                    OS << "a" << A->getArgNo();
+                }
+                else if (auto *B = dyn_cast<BasicBlock>(V)) {
+                    OS << "b" << bb_index[B];
+                }
+                else if (isa<MetadataAsValue>(V)) {
+                    OS << "md";
+                }
+                else {
+                    V->printAsOperand(OS, true, *_MST);
+                    addGlobals(V);
+                }
+                addType(V->getType());
+            }
+
+            // direct callees, as in the call graph of IDA
+            if (auto *CI = dyn_cast<CallInst>(&I)) {
+                Function *callee = CI->getCalledFunction();
+                if (callee && !callee->isDeclaration() && !callee->isIntrinsic() && \
+                    seen_callees.insert(callee).second) {
+                    callees.push_back(callee);
+                }
+            }
+
+            const DebugLoc &debugInfo = I.getDebugLoc();
+            if (debugInfo) {
+                OS << " !" << debugInfo->getFilename() << ":" << debugInfo.getLine();
+            }
+        }
+    }
+
+    // callees and globals
+    for (auto *GV: globals) {
+        OS << "\nG " << GV->getName() << " ";
+        GV->getValueType()->print(OS);
+    }
+
+    // struct bodies, e.g. BDA only keeps integer struct elements
+    for (auto *ST: structs) {
+        OS << "\nS ";
+        ST->print(OS, false, true);
+        if (ST->isOpaque()) {
+            OS << " opaque";
+            continue;
+        }
+
+        OS << " {";
+        for (Type *T: ST->elements()) {
+            OS << " ";
+            T->print(OS, false, true);
+        }
+        OS << " }";
+    }
+
+    MD5 hash;
+    hash.update(OS.str());
+    MD5::MD5Result result;
+    hash.final(result);
+
+    std::string fingerprint = result.digest().str().str();
+    _localFingerprints[F] = fingerprint;
+    return fingerprint;
+}
+
+
+void ida::AnalysisCache::numberInstructions(Function *F) {
+    if (_funcInsts.find(F) != _funcInsts.end()) {
+        return;
+    }
+
+    std::vector<Instruction *> &insts = _funcInsts[F];
+    for (auto inst_iter = inst_begin(F); inst_iter != inst_end(F); inst_iter++) {
+        _instIndex[&(*inst_iter)] = insts.size();
+        insts.push_back(&(*inst_iter));
+    }
+}
+
+
+unsigned ida::AnalysisCache::getFunctionIndex(Function *F) {
+    if (_funcIndex.empty()) {
+        for (Function &_F: *F->getParent()) {
+            unsigned index = _funcIndex.size();
+            _funcIndex[&_F] = index;
+        }
+    }
+
+    return _funcIndex[F];
+}
+
+
+unsigned ida::AnalysisCache::getInstructionIndex(Instruction *I) {
+    numberInstructions(I->getParent()->getParent());
+    return _instIndex[I];
+}
+
+
+Instruction *ida::AnalysisCache::getInstruction(Function *F, unsigned index) {
+    numberInstructions(F);
+
+    std::vector<Instruction *> &insts = _funcInsts[F];
+    if (index >= insts.size()) {
+        return nullptr;
+    }
+    return insts[index];
+}
+
+
+bool ida::AnalysisCache::isBefore(Instruction *I1, Instruction *I2) {
+    unsigned f1 = getFunctionIndex(I1->getParent()->getParent());
+    unsigned f2 = getFunctionIndex(I2->getParent()->getParent());
+    if (f1 != f2) {
+        return f1 < f2;
+    }
+
+    return getInstructionIndex(I1) < getInstructionIndex(I2);
+}
+
+
+std::string ida::AnalysisCache::encodeValue(Function *F, Value *V) {
+    if (!V) {
+        return "-";
+    }
+
+    if (auto *I = dyn_cast<Instruction>(V)) {
+        if (I->getParent()->getParent() != F) {
+            return "";
+        }
+        return "i" + std::to_string(getInstructionIndex(I));
+    }
+
+    if (auto *A = dyn_cast<Argument>(V)) {
+        if (A->getParent() != F) {
+            return "";
+        }
+        return "a" + std::to_string(A->getArgNo());
+    }
+
+    // other values are referenced by their first use in the function
+    numberInstructions(F);
+    auto refs_it = _operandRefs.find(F);
+    if (refs_it == _operandRefs.end()) {
+        std::unordered_map<Value *, std::string> &refs = _operandRefs[F];
+        std::vector<Instruction *> &insts = _funcInsts[F];
+        for (unsigned n = 0; n < insts.size(); n++) {
+            for (unsigned k = 0; k < insts[n]->getNumOperands(); k++) {
+                Value *op = insts[n]->getOperand(k);
+                if (refs.find(op) == refs.end()) {
+                    refs[op] = "o" + std::to_string(n) + "." + std::to_string(k);
+                }
+            }
+        }
+        refs_it = _operandRefs.find(F);
+    }
+
+    auto it = refs_it->second.find(V);
+    if (it == refs_it->second.end()) {
+        return "";
+    }
+    return it->second;
+}
+
+
+Value *ida::AnalysisCache::decodeValue(Function *F, const std::string &ref) {
+    if (ref.empty() || (ref == "-")) {
+        return nullptr;
+    }
+
+    // a malformed reference is treated like a stale summary
+    StringRef number = StringRef(ref).drop_front();
+    unsigned index;
+
+    if (ref[0] == 'i') {
+        if (number.getAsInteger(10, index)) {
+            return nullptr;
+        }
+        return getInstruction(F, index);
+    }
+
+    if (ref[0] == 'a') {
+        if (number.getAsInteger(10, index) || (index >= F->arg_size())) {
+            return nullptr;
+        }
+        return F->getArg(index);
+    }
+
+    if (ref[0] == 'o') {
+        StringRef k_s;
+        unsigned k;
+        std::tie(number, k_s) = number.split('.');
+        if (number.getAsInteger(10, index) || k_s.getAsInteger(10, k)) {
+            return nullptr;
+        }
+
+        Instruction *I = getInstruction(F, index);
+        if (!I || (k >= I->getNumOperands())) {
+            return nullptr;
+        }
+        return I->getOperand(k);
+    }
+
+    return nullptr;
+}
+
+
+std::string ida::AnalysisCache::encodeType(Function *F, Type *T) {
+    getLocalFingerprint(F);
+
+    std::vector<Type *> &types = _funcTypes[F];
+    auto it = std::find(types.begin(), types.end(), T);
+    if (it == types.end()) {
+        return "";
+    }
+    return "t" + std::to_string(it - types.begin());
+}
+
+
+Type *ida::AnalysisCache::decodeType(Function *F, const std::string &ref) {
+    getLocalFingerprint(F);
+
+    unsigned index;
+    if (ref.empty() || (ref[0] != 't') || StringRef(ref).drop_front().getAsInteger(10, index)) {
+        return nullptr;
+    }
+
+    std::vector<Type *> &types = _funcTypes[F];
+    if (index >= types.size()) {
+        return nullptr;
+    }
+    return types[index];
+}
@@ -1,8 +1,11 @@
 #include <chrono>
 #include <fstream>
+#include <sstream>
 #include <iostream>
+#include <algorithm>
 
 #include "BranchDependencyAnalysis.h"
+#include "PhaseStats.h"
 
 
 using namespace llvm;
@@ -31,19 +34,35 @@ bool ida::BranchDependencyAnalysis::runOnModule(Module &M) {
 
     // get module name and configure global statistics file
     std::string module_name = getModuleName(M);
-    if (!initGlobalStats(globalStats1, module_name, false))
+    if (!initGlobalStats(globalStats1, module_name, false, _statsPath))
         return false;
 
     // init start time
     auto start = std::chrono::high_resolution_clock::now();
+    PhaseStats::get().start("bda");
 
     // find all branch dependency
     unsigned branch_num = 0, total_branch_num = 0;
     unsigned switch_num = 0;
+    unsigned cached_func_num = 0, total_func_num = 0;
+    AnalysisCache &cache = AnalysisCache::get();
+    cache.reset();
     for (Function &F: M) {
         if (F.isDeclaration() || F.empty())
             continue;
 
+        total_func_num += 1;
+
+        // reuse the summary if this function is unchanged since the last run
+        if (cache.isEnabled() && loadBranchDeps(&F, branch_num, total_branch_num, switch_num)) {
+            cached_func_num += 1;
+            continue;
+        }
+
+        unsigned func_branch_num = branch_num;
+        unsigned func_total_branch_num = total_branch_num;
+        unsigned func_switch_num = switch_num;
+
         // outs() << "[BDA] begin to analyse " << F.getName() << "\n";
 
         LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
@@ -89,13 +108,14 @@ bool ida::BranchDependencyAnalysis::runOnModule(Module &M) {
                 }
 
                 if (flag && cond) {
-                    if (BI) {
-                        outs() << "[BDA] Analyse BranchInst:" << *BI << "\n";
-                    }
-                    else if (SWI) {
-                        outs() << "[BDA] Analyse SwitchInst:" << *SWI << "\n";
+                    if (!_inProcess) {
+                        if (BI) {
+                            outs() << "[BDA] Analyse BranchInst:" << *BI << "\n";
+                        }
+                        else if (SWI) {
+                            outs() << "[BDA] Analyse SwitchInst:" << *SWI << "\n";
+                        }
                     }
-                    else;
                     
                     // backward data dependency analysis
                     DataDepSet data_dep_set = extractDataDependency(cond, &DT, &LI, false);
@@ -207,6 +227,11 @@ bool ida::BranchDependencyAnalysis::runOnModule(Module &M) {
                 }
             }
         }
+
+        if (cache.isEnabled()) {
+            storeBranchDeps(&F, branch_num - func_branch_num, \
+                            total_branch_num - func_total_branch_num, switch_num - func_switch_num);
+        }
     }
 
     // stats 
@@ -240,10 +265,20 @@ bool ida::BranchDependencyAnalysis::runOnModule(Module &M) {
                 << ", local_var: " << local_var << ", non_pointer_param: " << non_pointer_param 
                 << ", struct_pointer_param: " << struct_pointer_param << "\n";
   
+    if (cache.isEnabled()) {
+        globalStats1 << "[BDA] reuse " << cached_func_num << "/" << total_func_num 
+                    << " cached function summaries\n";
+    }
+
     auto stop = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
     globalStats1 << "[BDA] extract branch dependency takes: " <<  duration.count() << "\n";
 
+    PhaseStats::get().stop({{"functions", total_func_num}, {"cached_functions", cached_func_num}, 
+                            {"branches", total_branch_num}, {"target_branches", branch_num}, 
+                            {"switches", switch_num}, {"global_var", global_var}, {"local_var", local_var},
+                            {"non_pointer_param", non_pointer_param}, {"struct_pointer_param", struct_pointer_param}});
+
     globalStats1.close();
 
     return true;          
@@ -311,6 +346,7 @@ ida::DataDepSet ida::BranchDependencyAnalysis::extractDataDependency(
                 StructPointer *sp = new StructPointer();
                 sp->type = GEP->getOperand(0)->getType();
                 sp->offset = offset;
+                sp->inst = GEP;
 
                 sp_list.push_back(sp);
             }
@@ -635,6 +671,220 @@ llvm::StoreInst *ida::BranchDependencyAnalysis::selectStoreInst(
 }
 
 
+bool ida::BranchDependencyAnalysis::loadBranchDeps(Function *F, unsigned &branch_num, \
+    unsigned &total_branch_num, unsigned &switch_num) {
+
+    AnalysisCache &cache = AnalysisCache::get();
+
+    std::vector<std::string> lines;
+    if (!cache.load(F, "bda", lines)) {
+        return false;
+    }
+
+    // format:
+    // C [total_branch_num] [branch_num] [switch_num]
+    // B [inst] [data_dep_num], followed by one line for each data dependency
+    unsigned f_total_branch_num = 0, f_branch_num = 0, f_switch_num = 0;
+    BranchDepSet branch_deps;
+
+    for (unsigned idx = 0; idx < lines.size(); idx++) {
+        std::istringstream line(lines[idx]);
+        std::string tag;
+        line >> tag;
+
+        if (tag == "C") {
+            line >> f_total_branch_num >> f_branch_num >> f_switch_num;
+        }
+        else if (tag == "B") {
+            std::string inst_ref;
+            unsigned data_dep_num = 0;
+            line >> inst_ref >> data_dep_num;
+
+            Instruction *I = dyn_cast_or_null<Instruction>(cache.decodeValue(F, inst_ref));
+            if (!I || (idx + data_dep_num >= lines.size())) {
+                return false;
+            }
+
+            BranchDep *branch_dep = new BranchDep();
+            branch_dep->inst = I;
+            branch_dep->func = F;
+            branch_dep->file_path = getSourceFilePath(I);
+            branch_dep->line_number = getSourceFileLineNumber(I);
+
+            for (unsigned i = 0; i < data_dep_num; i++) {
+                DataDep *data_dep = decodeDataDep(F, lines[++idx]);
+                if (!data_dep) {
+                    return false;
+                }
+                branch_dep->data_dep_set.insert(data_dep);
+            }
+
+            branch_deps.insert(branch_dep);
+        }
+        else {
+            return false;
+        }
+    }
+
+    if (!branch_deps.empty()) {
+        FuncBranchDeps[F] = branch_deps;
+    }
+
+    for (auto branch_dep: branch_deps) {
+        if (output_branch_dependency) {
+            outputBranchDep(branch_dep);
+        }
+    }
+
+    total_branch_num += f_total_branch_num;
+    branch_num += f_branch_num;
+    switch_num += f_switch_num;
+
+    return true;
+}
+
+
+void ida::BranchDependencyAnalysis::storeBranchDeps(Function *F, unsigned branch_num, \
+    unsigned total_branch_num, unsigned switch_num) {
+
+    AnalysisCache &cache = AnalysisCache::get();
+    std::vector<std::string> lines;
+
+    lines.push_back("C " + std::to_string(total_branch_num) + " " + std::to_string(branch_num) + \
+                    " " + std::to_string(switch_num));
+
+    std::vector<BranchDep *> branch_deps;
+    auto it = FuncBranchDeps.find(F);
+    if (it != FuncBranchDeps.end()) {
+        branch_deps.assign(it->second.begin(), it->second.end());
+    }
+    std::sort(branch_deps.begin(), branch_deps.end(), [&](BranchDep *BD1, BranchDep *BD2) {
+        return cache.isBefore(BD1->inst, BD2->inst);
+    });
+
+    for (auto branch_dep: branch_deps) {
+        lines.push_back("B " + cache.encodeValue(F, branch_dep->inst) + " " + \
+                        std::to_string(branch_dep->data_dep_set.size()));
+
+        for (auto data_dep: getOrderedDataDeps(F, branch_dep->data_dep_set)) {
+            std::string str = encodeDataDep(F, data_dep);
+
+            // do not cache what can not be restored
+            if (str.empty()) {
+                return;
+            }
+            lines.push_back(str);
+        }
+    }
+
+    cache.store(F, "bda", lines);
+}
+
+
+std::string ida::BranchDependencyAnalysis::encodeDataDep(Function *F, DataDep *data_dep) {
+    AnalysisCache &cache = AnalysisCache::get();
+
+    // format: D [type] [local_var] [global_var] [op_param] [nsp_param] [sp_num] ([gep] [sp_type] [offset])*
+    std::vector<std::string> refs = {
+        cache.encodeValue(F, data_dep->local_var),
+        cache.encodeValue(F, data_dep->global_var),
+        cache.encodeValue(F, data_dep->op_param)
+    };
+
+    // the type is kept on its own, the GEP of a struct pointer may be null
+    for (auto sp: data_dep->sp_list) {
+        refs.push_back(cache.encodeValue(F, sp->inst));
+        refs.push_back(cache.encodeType(F, sp->type));
+    }
+
+    for (auto &ref: refs) {
+        if (ref.empty()) {
+            return "";
+        }
+    }
+
+    std::string str = "D " + std::to_string(data_dep->node_type) + " " + refs[0] + " " + refs[1] + \
+                    " " + refs[2] + " " + std::to_string(data_dep->nsp_param) + " " + \
+                    std::to_string(data_dep->sp_list.size());
+
+    unsigned idx = 3;
+    for (auto sp: data_dep->sp_list) {
+        str += " " + refs[idx] + " " + refs[idx + 1] + " " + std::to_string(sp->offset);
+        idx += 2;
+    }
+
+    return str;
+}
+
+
+ida::DataDep *ida::BranchDependencyAnalysis::decodeDataDep(Function *F, const std::string &str) {
+    AnalysisCache &cache = AnalysisCache::get();
+
+    std::istringstream line(str);
+    std::string tag, local_ref, global_ref, param_ref;
+    unsigned node_type = rn_null, sp_num = 0;
+
+    DataDep *data_dep = new DataDep();
+    line >> tag >> node_type >> local_ref >> global_ref >> param_ref >> data_dep->nsp_param >> sp_num;
+    if (!line || (tag != "D") || (node_type > rn_otherParam)) {
+        return nullptr;
+    }
+
+    data_dep->node_type = (rootNodeType)node_type;
+    data_dep->local_var = dyn_cast_or_null<AllocaInst>(cache.decodeValue(F, local_ref));
+    data_dep->global_var = cache.decodeValue(F, global_ref);
+    data_dep->op_param = dyn_cast_or_null<Argument>(cache.decodeValue(F, param_ref));
+
+    if ((!data_dep->local_var && (local_ref != "-")) || \
+        (!data_dep->global_var && (global_ref != "-")) || \
+        (!data_dep->op_param && (param_ref != "-"))) {
+        return nullptr;
+    }
+
+    for (unsigned i = 0; i < sp_num; i++) {
+        std::string gep_ref, type_ref;
+        int offset;
+        line >> gep_ref >> type_ref >> offset;
+
+        auto *GEP = dyn_cast_or_null<GetElementPtrInst>(cache.decodeValue(F, gep_ref));
+        Type *type = cache.decodeType(F, type_ref);
+        if (!line || (!GEP && (gep_ref != "-")) || !type) {
+            return nullptr;
+        }
+
+        StructPointer *sp = new StructPointer();
+        sp->type = type;
+        sp->offset = offset;
+        sp->inst = GEP;
+        data_dep->sp_list.push_back(sp);
+    }
+
+    return data_dep;
+}
+
+
+std::vector<ida::DataDep *> ida::BranchDependencyAnalysis::getOrderedDataDeps(
+    Function *F, DataDepSet &data_dep_set) {
+
+    // the order of pointers in the set differs from run to run
+    std::vector<std::pair<std::string, DataDep *>> keyed;
+    for (auto data_dep: data_dep_set) {
+        keyed.push_back(std::make_pair(encodeDataDep(F, data_dep), data_dep));
+    }
+
+    std::stable_sort(keyed.begin(), keyed.end(), [](const std::pair<std::string, DataDep *> &d1, \
+                                                    const std::pair<std::string, DataDep *> &d2) {
+        return d1.first < d2.first;
+    });
+
+    std::vector<DataDep *> data_deps;
+    for (auto &it: keyed) {
+        data_deps.push_back(it.second);
+    }
+    return data_deps;
+}
+
+
 bool ida::BranchDependencyAnalysis::isEqualStructPointerList(
     StructPointers splist_1, StructPointers splist_2) {
     if (splist_1.size() != splist_2.size())
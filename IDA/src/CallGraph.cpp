@@ -3,6 +3,7 @@
 
 
 #include "CallGraph.h"
+#include "PhaseStats.h"
 
 #define INDIRECT_CALL	0
 
@@ -20,6 +21,7 @@ static RegisterPass<ida::CallGraph> X("CallGraph", "Call Graph Pass", false, tru
 
 
 bool ida::CallGraph::runOnModule(Module &M) {
+	PhaseStats::get().start("callgraph");
 
 	// connect nodes
   	for (auto &F : M) {
@@ -56,6 +58,21 @@ bool ida::CallGraph::runOnModule(Module &M) {
 		}
 	}
 
+	if (PhaseStats::get().isEnabled()) {
+		uint64_t direct_edges = 0, indirect_edges = 0;
+		for (auto N: _CG) {
+			for (auto e: N->out_edges) {
+				if (e->type == DIRECT)
+					direct_edges += 1;
+				else
+					indirect_edges += 1;
+			}
+		}
+
+		PhaseStats::get().stop({{"nodes", _CG.size()}, {"direct_edges", direct_edges}, 
+			{"indirect_edges", indirect_edges}});
+	}
+
 	return true;
 }
 
@@ -65,14 +82,7 @@ ida::Node *ida::CallGraph::getNode(Function *F) {
 		return nullptr;
 	}
 
-	Node *N = nullptr;
-	for (auto node: _CG) {
-		if (node->func == F) {
-			N = node;
-			break;
-		}
-	}
-
+	Node *&N = _nodes[F];
 	if (!N) {
 		N = new Node();
 		N->func = F;
@@ -82,9 +92,9 @@ ida::Node *ida::CallGraph::getNode(Function *F) {
 		else {
 			N->type = INTERNAL;
 		}
-	}
 
-	_CG.insert(N);
+		_CG.insert(N);
+	}
 
 	return N;
 }
@@ -146,7 +156,7 @@ bool ida::CallGraph::isFuncSignatureMatch(CallInst *CI, llvm::Function *F) {
 	if (F->isVarArg())
 		return false;
 
-	unsigned true_arg_num = CI->getNumArgOperands();
+	unsigned true_arg_num = CI->arg_size();
 	unsigned arg_num = F->arg_size();
 	if (arg_num != true_arg_num)
 		return false;
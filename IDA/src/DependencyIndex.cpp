@@ -0,0 +1,153 @@
+#include <string>
+
+#include "DependencyIndex.h"
+
+
+using namespace llvm;
+
+
+static void setMetaData(Instruction *I, const std::string &label, const std::string &value) {
+    LLVMContext& ctx = I->getContext();
+    MDNode* N = MDNode::get(ctx, MDString::get(ctx, value));
+    I->setMetadata(label, N);
+}
+
+
+static void setMetaData(Instruction *I, const std::string &label, uint64_t value) {
+    setMetaData(I, label, std::to_string(value));
+}
+
+
+static bool getMetaData(Instruction *I, const std::string &label, std::string &value) {
+    MDNode* N = I->getMetadata(label);
+    if (!N)
+        return false;
+
+    value = cast<MDString>(N->getOperand(0))->getString().str();
+    return true;
+}
+
+
+static bool getMetaData(Instruction *I, const std::string &label, unsigned &value) {
+    std::string value_s;
+    if (!getMetaData(I, label, value_s))
+        return false;
+
+    // a malformed value is treated like missing metadata
+    return !StringRef(value_s).getAsInteger(10, value);
+}
+
+
+static bool getMetaData(Instruction *I, const std::string &label, uint64_t &value) {
+    std::string value_s;
+    if (!getMetaData(I, label, value_s))
+        return false;
+
+    // a malformed value is treated like missing metadata
+    return !StringRef(value_s).getAsInteger(10, value);
+}
+
+
+bool ida::isConditionTrue(unsigned pred, unsigned width, uint64_t var, uint64_t constant) {
+    return ICmpInst::compare(APInt(64, var).zextOrTrunc(width), APInt(64, constant).zextOrTrunc(width),
+                             (CmpInst::Predicate)pred);
+}
+
+
+void ida::writeDependencyMetaData(const DependencyIndex &index) {
+    for (auto &branch: index.branches) {
+        setMetaData(branch.inst, "bid", branch.id);
+    }
+
+    for (auto &it: index.stores) {
+        setMetaData(it.second, "sid", it.first);
+    }
+
+    for (auto &branch: index.branches) {
+        Instruction *BI = branch.inst;
+
+        for (auto &var: branch.vars) {
+            std::string vid = std::to_string(var.id);
+            setMetaData(BI, "v_" + vid + "_t", var.type);
+            setMetaData(BI, "v_" + vid + "_s_num", var.stores.size());
+
+            for (unsigned s_idx = 0; s_idx < var.stores.size(); s_idx++) {
+                std::string label = "s_" + vid + "_" + std::to_string(s_idx);
+                setMetaData(BI, label, var.stores[s_idx]);
+                if (var.sides[s_idx] != ss_unknown)
+                    setMetaData(BI, label + "_side", var.sides[s_idx]);
+            }
+        }
+
+        setMetaData(BI, "v_num", branch.vars.size());
+
+        if (isa<BranchInst>(BI)) {
+            setMetaData(BI, "var_op", branch.var_op);
+            setMetaData(BI, "pred", branch.pred);
+            setMetaData(BI, "const", branch.constant);
+            if (!branch.arith_op.empty()) {
+                setMetaData(BI, "arith_op", branch.arith_op);
+                setMetaData(BI, "arith_var", branch.arith_var);
+            }
+        }
+    }
+}
+
+
+void ida::readDependencyMetaData(Module &M, DependencyIndex &index) {
+    for (Function &F: M) {
+        for (auto inst_iter = inst_begin(&F); inst_iter != inst_end(&F); inst_iter++) {
+            Instruction *I = &(*inst_iter);
+
+            unsigned sid;
+            auto *SI = dyn_cast<StoreInst>(I);
+            if (SI && getMetaData(SI, "sid", sid)) {
+                index.stores[sid] = SI;
+                continue;
+            }
+
+            BranchIndex branch;
+            unsigned var_num;
+            if (!getMetaData(I, "bid", branch.id) || !getMetaData(I, "v_num", var_num))
+                continue;
+
+            branch.inst = I;
+
+            // the variable ids are not contiguous if some variables do not contain stores
+            for (unsigned vid = 0; vid < var_num; vid++) {
+                VariableIndex var;
+                unsigned store_num;
+                std::string label = "v_" + std::to_string(vid);
+                if (!getMetaData(I, label + "_s_num", store_num))
+                    continue;
+
+                var.id = vid;
+                if (!getMetaData(I, label + "_t", var.type))
+                    var.type = 0;
+
+                for (unsigned s_idx = 0; s_idx < store_num; s_idx++) {
+                    std::string label = "s_" + std::to_string(vid) + "_" + std::to_string(s_idx);
+                    if (!getMetaData(I, label, sid))
+                        continue;
+
+                    unsigned side;
+                    if (!getMetaData(I, label + "_side", side))
+                        side = ss_unknown;
+
+                    var.stores.push_back(sid);
+                    var.sides.push_back(side);
+                }
+                branch.vars.push_back(var);
+            }
+
+            // a br without a predicate is not supported by the searcher
+            getMetaData(I, "var_op", branch.var_op);
+            getMetaData(I, "pred", branch.pred);
+            getMetaData(I, "const", branch.constant);
+            getMetaData(I, "arith_op", branch.arith_op);
+            getMetaData(I, "arith_var", branch.arith_var);
+
+            index.branches.push_back(branch);
+        }
+    }
+}
@@ -1,9 +1,14 @@
 #include <chrono>
 #include <fstream>
+#include <sstream>
 #include <iostream>
+#include <algorithm>
 
 
+#include "llvm/IR/ConstantRange.h"
+
 #include "InterproceduralDependencyAnalysis.h"
+#include "PhaseStats.h"
 
 using namespace llvm;
 
@@ -29,6 +34,18 @@ static RegisterPass<ida::InterproceduralDependencyAnalysis> IDA("ida",
 std::ofstream globalStats;
 
 
+ida::InterproceduralDependencyAnalysis *ida::InterproceduralDependencyAnalysis::addInProcess(
+    legacy::PassManager &pm, const std::string &stats_path) {
+
+    // the pass manager satisfies the requirement of IDA with the BDA added before it
+    pm.add(new BranchDependencyAnalysis(stats_path));
+
+    auto *analysis = new InterproceduralDependencyAnalysis(stats_path);
+    pm.add(analysis);
+    return analysis;
+}
+
+
 bool ida::InterproceduralDependencyAnalysis::runOnModule(Module &M) {
 
     // I forget why not to use existed llvm pass :)
@@ -40,13 +57,15 @@ bool ida::InterproceduralDependencyAnalysis::runOnModule(Module &M) {
     
     // get module name and configure global statistics file
     std::string module_name = getModuleName(M);
-    if (!initGlobalStats(globalStats, module_name, true)) {
+    if (!initGlobalStats(globalStats, module_name, true, _statsPath)) {
         std::cout << "Create global statistics fails\n";
 
         return false;
     }
 
     auto start = std::chrono::high_resolution_clock::now();
+    PhaseStats &phases = PhaseStats::get();
+    phases.start("store_dependency");
 
     // candidate StoreInsts and RetInsts
     unsigned store_num = 0, ret_num = 0;
@@ -95,10 +114,20 @@ bool ida::InterproceduralDependencyAnalysis::runOnModule(Module &M) {
 
 
     // find all data dependency for above candidatas
+    AnalysisCache &cache = AnalysisCache::get();
+    unsigned cached_func_num = 0, total_func_num = 0;
     for (Function &F: M) {
         if (F.isDeclaration() || F.empty())
             continue;
 
+        total_func_num += 1;
+
+        // reuse the summary if this function is unchanged since the last run
+        if (cache.isEnabled() && loadStoreDeps(&F)) {
+            cached_func_num += 1;
+            continue;
+        }
+
         LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
         DominatorTree &DT = getAnalysis<DominatorTreeWrapperPass>(F).getDomTree();
 
@@ -109,31 +138,59 @@ bool ida::InterproceduralDependencyAnalysis::runOnModule(Module &M) {
         if (RetFuncs.find(&F) != RetFuncs.end()) {
             findStoreDependencyFromRI(&F);
         }
+
+        if (cache.isEnabled()) {
+            storeStoreDeps(&F);
+        }
+    }
+
+    if (cache.isEnabled()) {
+        globalStats << "[IDA] reuse " << cached_func_num << "/" << total_func_num \
+                    << " cached function summaries\n";
     }
 
     auto mid = std::chrono::high_resolution_clock::now();
     auto duration1 = std::chrono::duration_cast<std::chrono::milliseconds>(mid - start);
     globalStats << "[IDA] Find useful store instructions takes: " <<  duration1.count() << "\n";
 
+    if (phases.isEnabled()) {
+        uint64_t store_dep_num = 0;
+        for (auto &it: _SDMap) {
+            store_dep_num += it.second.size();
+        }
+
+        phases.stop({{"stores", all_store_num}, {"candidate_stores", store_num}, {"returns", all_ret_num}, 
+                     {"candidate_returns", ret_num}, {"store_deps", store_dep_num}, 
+                     {"functions", total_func_num}, {"cached_functions", cached_func_num}});
+    }
+    phases.start("matching");
+
+    indexStoreDeps();
+
     // match store instructions and branch instructions
     unsigned branch_num = 0;
     
-    for(auto it: _FBD) {
-        Function &F = *(it.first);
-        if (F.isDeclaration() || F.empty())
+    for (Function &F: M) {
+        auto it = _FBD.find(&F);
+        if ((it == _FBD.end()) || F.isDeclaration() || F.empty())
             continue;
 
         LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
         DominatorTree &DT = getAnalysis<DominatorTreeWrapperPass>(F).getDomTree();
 
-        BranchDepSet BDSet = it.second;
-        for (auto BD: BDSet) {
+        // branch ids follow the order of branches in the module
+        std::vector<BranchDep *> BDs(it->second.begin(), it->second.end());
+        std::sort(BDs.begin(), BDs.end(), [&](BranchDep *BD1, BranchDep *BD2) {
+            return cache.isBefore(BD1->inst, BD2->inst);
+        });
+
+        for (auto BD: BDs) {
             BD2VDDep *bvDep = new BD2VDDep();
    
             unsigned BD_var_idx = 0;
 
             // for limitations, there is only one data_dep
-            for (auto data_dep: BD->data_dep_set) {   
+            for (auto data_dep: _BDA->getOrderedDataDeps(&F, BD->data_dep_set)) {   
                 
                 // directly find stores
                 if (data_dep->node_type != rn_nonPointerParam) {
@@ -142,7 +199,7 @@ bool ida::InterproceduralDependencyAnalysis::runOnModule(Module &M) {
                     vsDep->data_dep = data_dep;
 
                     findStoresForBranch(BD, data_dep, vsDep, &DT, &LI);
-                    bvDep->varDeps.insert(vsDep);
+                    bvDep->varDeps.push_back(vsDep);
 
                     BD_var_idx++;
                 }
@@ -162,10 +219,21 @@ bool ida::InterproceduralDependencyAnalysis::runOnModule(Module &M) {
                 bvDep->store_num += varDep->storeDeps.size();
             }
 
-            outs() << "[IDA] Find " << bvDep->store_num << " StoreInsts for" << *BD->inst << "\n";
+            if (!_inProcess) {
+                outs() << "[IDA] Find " << bvDep->store_num << " StoreInsts for" << *BD->inst << "\n";
+            }
+
+            _BD2VDMap.push_back(bvDep);   
+        }
+    }
 
-            _BD2VDMap.insert(bvDep);   
+    if (phases.isEnabled()) {
+        uint64_t pair_num = 0;
+        for (auto bvDep: _BD2VDMap) {
+            pair_num += bvDep->store_num;
         }
+
+        phases.stop({{"branches", _BD2VDMap.size()}, {"branch_store_pairs", pair_num}});
     }
 
     // branch dependency stats
@@ -176,8 +244,9 @@ bool ida::InterproceduralDependencyAnalysis::runOnModule(Module &M) {
         outputBD2SDsMap();
     }
 
-    // set store-branch inter-procedural dependency to above instructions
-    setInstMetaData();
+    // collect store-branch inter-procedural dependency
+    phases.start("index");
+    buildDependencyIndex(M);
 
     auto stop = std::chrono::high_resolution_clock::now();
     auto duration2 = std::chrono::duration_cast<std::chrono::milliseconds>(stop - mid);
@@ -185,6 +254,14 @@ bool ida::InterproceduralDependencyAnalysis::runOnModule(Module &M) {
 
     globalStats.close();
 
+    // keep the dependency in memory when running inside KLEE
+    if (_inProcess) {
+        return false;
+    }
+
+    // set store-branch inter-procedural dependency to above instructions
+    writeDependencyMetaData(_index);
+
     // output new .bc with our metadata
     if (!outputNewModule(M, module_name)) {
         std::cout << "Output new module fails\n";
@@ -196,121 +273,256 @@ bool ida::InterproceduralDependencyAnalysis::runOnModule(Module &M) {
 }
 
 
-void ida::InterproceduralDependencyAnalysis::setInstMetaData() {
-    std::map<StoreInst *, unsigned> store_id;
+// the constant of "and V, C" or "or V, C"
+static ConstantInt *getMaskOperand(Instruction *I) {
+    if ((I->getOpcode() != Instruction::And) && (I->getOpcode() != Instruction::Or))
+        return nullptr;
 
-    // set id for each BranchInst
-    unsigned valid_branch = 0;
-    for(auto bvDep: _BD2VDMap) {
-        if (!bvDep->store_num) {
-            continue;
+    if (auto *CI = dyn_cast<ConstantInt>(I->getOperand(1)))
+        return CI;
+    return dyn_cast<ConstantInt>(I->getOperand(0));
+}
+
+
+// V in "icmp pred V, C" is usually a loaded variable, which may be casted and masked by and/or.
+// Return the variable, and the operations from V back to it
+static Value *getBranchVariable(Value *V, std::vector<Instruction *> &ops) {
+    while (auto *I = dyn_cast<Instruction>(V)) {
+        if (isa<ZExtInst>(I) || isa<SExtInst>(I) || isa<TruncInst>(I)) {
+            V = I->getOperand(0);
         }
-        
-        valid_branch += 1;
+        else if (auto *CI = getMaskOperand(I)) {
+            V = (I->getOperand(1) == CI) ? I->getOperand(0) : I->getOperand(1);
+        }
+        else {
+            break;
+        }
+        ops.push_back(I);
+    }
 
-        Instruction *BI = bvDep->branch_dep->inst;
-        Function *F = BI->getParent()->getParent();
-        LLVMContext& ctx = F->getContext();
-    
-        MDNode* B_N = MDNode::get(ctx, MDString::get(ctx, std::to_string(bvDep->id)));
-        (*BI).setMetadata("bid", B_N);
+    return V;
+}
+
+
+// the possible values of V for the given values of the variable
+static ConstantRange applyBranchOps(ConstantRange CR, std::vector<Instruction *> &ops) {
+    for (auto it = ops.rbegin(); it != ops.rend(); it++) {
+        Instruction *I = *it;
+        unsigned width = I->getType()->getIntegerBitWidth();
+
+        switch (I->getOpcode()) {
+            case Instruction::ZExt:
+                CR = CR.zeroExtend(width);
+                break;
+            case Instruction::SExt:
+                CR = CR.signExtend(width);
+                break;
+            case Instruction::Trunc:
+                CR = CR.truncate(width);
+                break;
+            case Instruction::And:
+                CR = CR.binaryAnd(ConstantRange(getMaskOperand(I)->getValue()));
+                break;
+            case Instruction::Or:
+                CR = CR.binaryOr(ConstantRange(getMaskOperand(I)->getValue()));
+                break;
+        }
+    }
+
+    return CR;
+}
+
+
+// the side of "icmp pred V, C" taken by all values in CR
+static unsigned getBranchSide(unsigned pred, const APInt &C, const ConstantRange &CR) {
+    ConstantRange region = ConstantRange::makeExactICmpRegion((CmpInst::Predicate)pred, C);
+    if (region.contains(CR)) {
+        return ida::ss_true;
+    }
+    if (region.intersectWith(CR).isEmptySet()) {
+        return ida::ss_false;
     }
+    return ida::ss_unknown;
+}
+
+
+bool ida::InterproceduralDependencyAnalysis::setBranchPredicate(BranchIndex &branch) {
+    auto *BI = dyn_cast<BranchInst>(branch.inst);
+
+    // for switch, the case values are enough
+    if (!BI) {
+        return true;
+    }
+
+    auto *cond = dyn_cast<ICmpInst>(BI->getCondition());
+    if (!cond) {
+        return false;
+    }
+
+    // normalize to "icmp pred V, C"
+    auto *C0 = dyn_cast<ConstantInt>(cond->getOperand(0));
+    auto *C1 = dyn_cast<ConstantInt>(cond->getOperand(1));
+    if ((C0 && C1) || (!C0 && !C1)) {
+        return false;
+    }
+
+    ConstantInt *C = C0 ? C0 : C1;
+    if (C->getBitWidth() > 64) {
+        return false;
+    }
+
+    branch.var_op = C0 ? 1 : 0;
+    branch.pred = C0 ? cond->getSwappedPredicate() : cond->getPredicate();
+    branch.constant = C->getZExtValue();
+
+    // the nearest and/or mask
+    std::vector<Instruction *> ops;
+    Value *var = getBranchVariable(cond->getOperand(branch.var_op), ops);
+    for (auto *I: ops) {
+        if (auto *mask = getMaskOperand(I)) {
+            if (mask->getBitWidth() <= 64) {
+                branch.arith_op = I->getOpcodeName();
+                branch.arith_var = mask->getZExtValue();
+            }
+            break;
+        }
+    }
+
+    // no store can flip a condition that is always true or always false
+    ConstantRange CR = applyBranchOps(ConstantRange::getFull(var->getType()->getIntegerBitWidth()), ops);
+    return getBranchSide(branch.pred, C->getValue(), CR) == ss_unknown;
+}
+
+
+unsigned ida::InterproceduralDependencyAnalysis::getStoreSide(BranchIndex &branch, StoreInst *SI) {
+    auto *BI = dyn_cast<BranchInst>(branch.inst);
+    auto *CI = dyn_cast<ConstantInt>(SI->getValueOperand());
+    if (!BI || !CI) {
+        return ss_unknown;
+    }
+
+    auto *cond = cast<ICmpInst>(BI->getCondition());
+    auto *C = cast<ConstantInt>(cond->getOperand(1 - branch.var_op));
+
+    // the stored constant reaches the condition by a load of the same type
+    std::vector<Instruction *> ops;
+    Value *var = getBranchVariable(cond->getOperand(branch.var_op), ops);
+    if (!isa<LoadInst>(var) || (var->getType() != CI->getType())) {
+        return ss_unknown;
+    }
+
+    ConstantRange CR = applyBranchOps(ConstantRange(CI->getValue()), ops);
+    return getBranchSide(branch.pred, C->getValue(), CR);
+}
+
+
+void ida::InterproceduralDependencyAnalysis::buildDependencyIndex(Module &M) {
+    std::unordered_map<StoreInst *, unsigned> store_id;
 
     // set id for each StoreInst
     unsigned store_num = 0;
-    for(auto it: _SDMap) {
-        Function *F = it.first;
-        StoreDepSet SDSet = it.second;
+    for (Function &_F: M) {
+        auto it = _SDMap.find(&_F);
+        if (it == _SDMap.end())
+            continue;
 
-        for (auto SD: SDSet) {
+        for (auto SD: getOrderedStoreDeps(it->second)) {
             StoreInst *SI = SD->inst;
-            LLVMContext& ctx = F->getContext();
 
             store_num += 1;
-            MDNode* S_N = MDNode::get(ctx, MDString::get(ctx, std::to_string(store_num)));
-            (*SI).setMetadata("sid", S_N);
+            _index.stores[store_num] = SI;
             store_id[SI] = store_num;
         }     
     }
 
     // set BI->SI relation
     std::set<unsigned> added_store;
+    unsigned dropped_branch = 0, classified_store = 0;
     for(auto bvDep: _BD2VDMap) {
         if (!bvDep->store_num) {
             continue;
         }
 
-        Instruction *BI = bvDep->branch_dep->inst;
-        Function *F = BI->getParent()->getParent();
-        LLVMContext& ctx = F->getContext();
-        
-        // Note that some variables do not contain stores
-        unsigned var_num = bvDep->varDeps.size();
+        BranchIndex branch;
+        branch.id = bvDep->id;
+        branch.inst = bvDep->branch_dep->inst;
+
+        if (!setBranchPredicate(branch)) {
+            dropped_branch += 1;
+            continue;
+        }
+
+        // side of the br for each stored constant
+        std::unordered_map<Value *, unsigned> sides;
 
         // For each variable, save stores
         // In fact, there is only one branch variable due to the limitations of later analysis,
         // If there is more than one, it must be a local variable that is equal to the former one.
+        // Note that some variables do not contain stores
         for (auto varDep: bvDep->varDeps) {
-            StoreDepSet SDSet = varDep->storeDeps;
+            StoreDepSet &SDSet = varDep->storeDeps;
             if (SDSet.empty()) {
-                var_num -= 1;
                 continue;
             }
 
-            unsigned type;
+            VariableIndex var;
             rootNodeType v_type = varDep->data_dep->node_type;
             if (v_type == rn_globalVariable) {
-                type = 0x1;
+                var.type = 0x1;
             }
             else if (v_type == rn_localVariable) {
-                type = 0x2;
+                var.type = 0x2;
             }
             else if (v_type == rn_structPointerParam) {
-                type = 0x3;
+                var.type = 0x3;
             }
             else {
                 assert(0 && "invalid variable type");
                 continue;
             };
 
-            unsigned vid = varDep->id;
-
-            // format: v_[vid]_t = [type]
-            std::string label_t = "v_" + std::to_string(vid) + "_t";
-            std::string value_t = std::to_string(type);
-            MDNode* VT_N = MDNode::get(ctx, MDString::get(ctx, value_t));
-            (*BI).setMetadata(label_t, VT_N); 
-
-            // format: v_[vid]_s_num = [store_num]
-            unsigned store_num = SDSet.size();
-            std::string label_s_n = "v_" + std::to_string(vid) + "_s_num";
-            MDNode* VSN_N = MDNode::get(ctx, MDString::get(ctx, std::to_string(store_num)));
-            (*BI).setMetadata(label_s_n, VSN_N);
-
-            unsigned s_idx = 0;
+            // store ids follow the module order, as getOrderedStoreDeps() does
+            std::vector<StoreInst *> SIs;
             for (auto *SD: SDSet) {
-                StoreInst *SI = SD->inst;
+                SIs.push_back(SD->inst);
+            }
+            std::sort(SIs.begin(), SIs.end(), [&](StoreInst *SI1, StoreInst *SI2) {
+                return store_id[SI1] < store_id[SI2];
+            });
 
-                // format: s_[vid]_[s_idx] = [sid]
-                std::string label_id = "s_" + std::to_string(vid) + "_" + std::to_string(s_idx);
-                std::string value_id = std::to_string(store_id[SI]);
-                MDNode* VSID_N = MDNode::get(ctx, MDString::get(ctx, value_id));
-                (*BI).setMetadata(label_id, VSID_N); 
+            var.id = varDep->id;
+            for (auto *SI: SIs) {
+                var.stores.push_back(store_id[SI]);
+                added_store.insert(store_id[SI]);       
 
-                s_idx += 1;
+                // for constant stores, it is known which side of the br they lead to, the same
+                // constant is often stored many times
+                Value *stored = SI->getValueOperand();
+                auto side_it = sides.find(stored);
+                if (side_it == sides.end()) {
+                    side_it = sides.emplace(stored, getStoreSide(branch, SI)).first;
+                }
 
-                added_store.insert(store_id[SI]);       
+                var.sides.push_back(side_it->second);
+                if (var.sides.back() != ss_unknown) {
+                    classified_store += 1;
+                }
             }
+
+            branch.vars.push_back(var);
         }
 
-        // format: v_num = [var_num]
-        MDNode* V_N = MDNode::get(ctx, MDString::get(ctx, std::to_string(var_num)));
-        (*BI).setMetadata("v_num", V_N);
+        _index.branches.push_back(branch);
     }
 
     globalStats << "[IDA] Find " << added_store.size() << " branch-related store instructions for " \
-                << valid_branch << " branches\n";
+                << _index.branches.size() << " branches\n";
+    globalStats << "[IDA] Drop " << dropped_branch << " branches whose condition no store can flip, " \
+                << "classify " << classified_store << " constant stores\n";
 
+    PhaseStats::get().stop({{"branches", _index.branches.size()}, {"stores", _index.stores.size()}, 
+                            {"branch_related_stores", added_store.size()}, {"dropped_branches", dropped_branch}, 
+                            {"classified_stores", classified_store}});
     
     // test for setting metadata
     /*
@@ -333,18 +545,16 @@ void ida::InterproceduralDependencyAnalysis::setInstMetaData() {
 
 
 bool ida::InterproceduralDependencyAnalysis::isContainStructPointerList(
-    StructPointers splist_1, StructPointers splist_2) {
+    const StructPointers &splist_1, const StructPointers &splist_2) {
     // make sure splist_1 contains splist_2
     if (splist_1.size() < splist_2.size())
         return false;
 
     // Data in splist are in reverse order. That is, the top struct pointer is at the end
-    splist_1.reverse();
-    splist_2.reverse();
-    auto it1b = splist_1.begin();
-    auto it2b = splist_2.begin();
-    auto it1e = splist_1.end();
-    auto it2e = splist_2.end();
+    auto it1b = splist_1.rbegin();
+    auto it2b = splist_2.rbegin();
+    auto it1e = splist_1.rend();
+    auto it2e = splist_2.rend();
     for (auto it1 = it1b, it2 = it2b; (it1 != it1e) && (it2 != it2e); ++it1, ++it2) {
         StructPointer *sp1 = *it1;
         StructPointer *sp2 = *it2; 
@@ -357,21 +567,50 @@ bool ida::InterproceduralDependencyAnalysis::isContainStructPointerList(
 }
 
 
+void ida::InterproceduralDependencyAnalysis::indexStoreDeps() {
+    _localSDs.clear();
+    _globalSDs.clear();
+    _structSDs.clear();
+    _allStructSDs.clear();
+
+    for (auto &it: _SDMap) {
+        for (auto SD: it.second) {
+            DataDep *data_dep = SD->data_dep;
+
+            if (data_dep->node_type == rn_localVariable) {
+                _localSDs[data_dep->local_var].insert(SD);
+            }
+            else if (data_dep->node_type == rn_globalVariable) {
+                _globalSDs[data_dep->global_var].insert(SD);
+            }
+            else if (data_dep->node_type == rn_structPointerParam) {
+                _allStructSDs.insert(SD);
+
+                if (!data_dep->sp_list.empty()) {
+                    StructPointer *top = data_dep->sp_list.back();
+                    _structSDs[std::make_pair(top->type, top->offset)].insert(SD);
+                }
+            }
+        }
+    }
+}
+
+
 void ida::InterproceduralDependencyAnalysis::findStoresForBranch(BranchDep *BD, DataDep *data_dep, \
     ida::InterproceduralDependencyAnalysis::VD2SDDep *vsDep, llvm::DominatorTree* DT, llvm::LoopInfo* LI) {
 
     // local variable: intra-procedure type matching
-    Function *BD_F = BD->func; 
     if (data_dep->node_type == rn_localVariable) {
-        for (auto SD: _SDMap[BD_F]) {
-            DataDep *_data_dep = SD->data_dep;
+        auto it = _localSDs.find(data_dep->local_var);
+        if (it == _localSDs.end()) {
+            return;
+        }
+
+        for (auto SD: it->second) {
             SmallPtrSet<BasicBlock*, BB_THRESHOLD> ExclusionSet;
 
-            // node type & local variable & reachability
-            if ((_data_dep->node_type == rn_localVariable) && \
-                (data_dep->local_var == _data_dep->local_var) && \
-                (isPotentiallyReachable(SD->inst, BD->inst, &ExclusionSet, DT, LI))) {
-                
+            // reachability
+            if (isPotentiallyReachable(SD->inst, BD->inst, &ExclusionSet, DT, LI)) {
                 vsDep->storeDeps.insert(SD);
                 // outputStoreDep(SD); 
             }
@@ -380,37 +619,31 @@ void ida::InterproceduralDependencyAnalysis::findStoresForBranch(BranchDep *BD,
 
     // global variable: inter-procedure type matching
     else if (data_dep->node_type == rn_globalVariable) {
-        for(auto it: _SDMap) {
-            StoreDepSet SDSet = it.second;
-            for (auto SD: SDSet) {
-                DataDep *_data_dep = SD->data_dep;
-
-                // node type & global variable 
-                if ((_data_dep->node_type == rn_globalVariable) && \
-                    (data_dep->global_var == _data_dep->global_var)) { 
-                    
-                    vsDep->storeDeps.insert(SD);
-                    // outputStoreDep(SD); 
-                }
-            }
+        auto it = _globalSDs.find(data_dep->global_var);
+        if (it != _globalSDs.end()) {
+            vsDep->storeDeps.insert(it->second.begin(), it->second.end());
         }
     }   
 
     // struct pointer: inter-procedure type matching
     else if (data_dep->node_type == rn_structPointerParam) {
-        // inter-procedure type matching
-        for(auto it: _SDMap) {
-            StoreDepSet SDSet = it.second;
-            for (auto SD: SDSet) {
-                DataDep *_data_dep = SD->data_dep;
+        // only the stores with the same top struct pointer can contain the type chain
+        const StoreDepSet *SDSet = &_allStructSDs;
+        if (!data_dep->sp_list.empty()) {
+            StructPointer *top = data_dep->sp_list.back();
+            auto it = _structSDs.find(std::make_pair(top->type, top->offset));
+            if (it == _structSDs.end()) {
+                return;
+            }
 
-                // node type & type chain (SD contains BD)
-                if ((_data_dep->node_type == rn_structPointerParam) && \
-                    isContainStructPointerList(_data_dep->sp_list, data_dep->sp_list)) {
+            SDSet = &it->second;
+        }
 
-                    vsDep->storeDeps.insert(SD);
-                    // outputStoreDep(SD); 
-                }
+        for (auto SD: *SDSet) {
+            // type chain (SD contains BD)
+            if (isContainStructPointerList(SD->data_dep->sp_list, data_dep->sp_list)) {
+                vsDep->storeDeps.insert(SD);
+                // outputStoreDep(SD); 
             }
         }
     }   
@@ -439,7 +672,7 @@ void ida::InterproceduralDependencyAnalysis::findStoresForBranchOnCG(BranchDep *
     traced_funcs.insert(BD_F);
     
     Node *NF = _CG->getNode(BD_F);
-    for (auto edge: NF->in_edges) {
+    for (auto edge: getOrderedEdges(NF->in_edges)) {
         CallInst *ci = edge->inst;
         Function *cf = edge->src;
         if (traced_funcs.find(cf) == traced_funcs.end()) {
@@ -476,7 +709,7 @@ void ida::InterproceduralDependencyAnalysis::findStoresForBranchOnCG(BranchDep *
                 param_index = data_dep->nsp_param;
 
                 Node *NF = _CG->getNode(cur_func);
-                for (auto edge: NF->in_edges) {
+                for (auto edge: getOrderedEdges(NF->in_edges)) {
                     CallInst *ci = edge->inst;
                     Function *cf = edge->src;
             
@@ -497,17 +730,9 @@ void ida::InterproceduralDependencyAnalysis::findStoresForBranchOnCG(BranchDep *
 
                 // find definitions in the local variables in other functions
                 if (data_dep->node_type == rn_localVariable) {
-                    for (auto SD: _SDMap[cur_func]) {
-                        DataDep *_data_dep = SD->data_dep;
-                        SmallPtrSet<BasicBlock*, BB_THRESHOLD> ExclusionSet;
-
-                        // node type & local variable & reachability
-                        if ((_data_dep->node_type == rn_localVariable) && \
-                            (data_dep->local_var == _data_dep->local_var)) {
-
-                            vsDep->storeDeps.insert(SD);
-                            // outputStoreDep(SD); 
-                        }
+                    auto it = _localSDs.find(data_dep->local_var);
+                    if (it != _localSDs.end()) {
+                        vsDep->storeDeps.insert(it->second.begin(), it->second.end());
                     }
                 }
 
@@ -522,7 +747,7 @@ void ida::InterproceduralDependencyAnalysis::findStoresForBranchOnCG(BranchDep *
     }
 
     if (!vsDep->storeDeps.empty()) {
-        bvDep->varDeps.insert(vsDep);
+        bvDep->varDeps.push_back(vsDep);
     }
 }
 
@@ -613,6 +838,97 @@ void ida::InterproceduralDependencyAnalysis::findStoreDependencyFromRI(Function
 }
 
 
+bool ida::InterproceduralDependencyAnalysis::loadStoreDeps(Function *F) {
+    AnalysisCache &cache = AnalysisCache::get();
+
+    std::vector<std::string> lines;
+    if (!cache.load(F, "sd", lines)) {
+        return false;
+    }
+
+    // format: S [inst], followed by one line for its data dependency
+    StoreDepSet SDSet;
+    for (unsigned idx = 0; idx < lines.size(); idx += 2) {
+        std::istringstream line(lines[idx]);
+        std::string tag, inst_ref;
+        line >> tag >> inst_ref;
+
+        auto *SI = dyn_cast_or_null<StoreInst>(cache.decodeValue(F, inst_ref));
+        if ((tag != "S") || !SI || (idx + 1 >= lines.size())) {
+            return false;
+        }
+
+        DataDep *data_dep = _BDA->decodeDataDep(F, lines[idx + 1]);
+        if (!data_dep) {
+            return false;
+        }
+
+        StoreDep *store_dep = new StoreDep();
+        store_dep->inst = SI;
+        store_dep->func = F;
+        store_dep->file_path = getSourceFilePath(SI);
+        store_dep->line_number = getSourceFileLineNumber(SI);
+        store_dep->data_dep = data_dep;
+
+        SDSet.insert(store_dep);
+    }
+
+    if (!SDSet.empty()) {
+        _SDMap[F] = SDSet;
+    }
+
+    return true;
+}
+
+
+void ida::InterproceduralDependencyAnalysis::storeStoreDeps(Function *F) {
+    AnalysisCache &cache = AnalysisCache::get();
+    std::vector<std::string> lines;
+
+    auto it = _SDMap.find(F);
+    if (it != _SDMap.end()) {
+        for (auto SD: getOrderedStoreDeps(it->second)) {
+            std::string str = _BDA->encodeDataDep(F, SD->data_dep);
+
+            // do not cache what can not be restored
+            if (str.empty()) {
+                return;
+            }
+
+            lines.push_back("S " + cache.encodeValue(F, SD->inst));
+            lines.push_back(str);
+        }
+    }
+
+    cache.store(F, "sd", lines);
+}
+
+
+std::vector<ida::InterproceduralDependencyAnalysis::StoreDep *> 
+ida::InterproceduralDependencyAnalysis::getOrderedStoreDeps(StoreDepSet &SDSet) {
+    AnalysisCache &cache = AnalysisCache::get();
+
+    std::vector<StoreDep *> SDs(SDSet.begin(), SDSet.end());
+    std::sort(SDs.begin(), SDs.end(), [&](StoreDep *SD1, StoreDep *SD2) {
+        return cache.isBefore(SD1->inst, SD2->inst);
+    });
+
+    return SDs;
+}
+
+
+std::vector<ida::Edge *> ida::InterproceduralDependencyAnalysis::getOrderedEdges(EdgeSet &edges) {
+    AnalysisCache &cache = AnalysisCache::get();
+
+    std::vector<Edge *> ordered_edges(edges.begin(), edges.end());
+    std::sort(ordered_edges.begin(), ordered_edges.end(), [&](Edge *E1, Edge *E2) {
+        return cache.isBefore(E1->inst, E2->inst);
+    });
+
+    return ordered_edges;
+}
+
+
 void ida::InterproceduralDependencyAnalysis::showStructPointersInfo(Module &M) {
     std::set<StructPointers> SPSet;
     std::map<llvm::Type *, std::set<StructPointers>> SPMap;
@@ -683,7 +999,7 @@ void ida::InterproceduralDependencyAnalysis::outputBD2SDsMap() {
 
         // output each variable
         for (auto varDep: bvDep->varDeps) {
-            StoreDepSet SDSet = varDep->storeDeps;
+            StoreDepSet &SDSet = varDep->storeDeps;
             if (SDSet.empty()) {
                 continue;
             }
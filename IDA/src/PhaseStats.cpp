@@ -0,0 +1,63 @@
+#include <fstream>
+#include <sys/resource.h>
+
+#include "PhaseStats.h"
+
+
+ida::PhaseStats &ida::PhaseStats::get() {
+    static PhaseStats stats;
+    return stats;
+}
+
+
+// reset the peak resident memory of the process (linux only)
+static void resetPeakMemory() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if (clear_refs.is_open()) {
+        clear_refs << "5";
+    }
+}
+
+
+// peak resident memory in KB since the last reset
+static uint64_t getPeakMemory() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::stoull(line.substr(6));
+        }
+    }
+
+    // peak of the whole process
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+
+void ida::PhaseStats::start(const std::string &name) {
+    if (!_enabled) {
+        return;
+    }
+
+    _name = name;
+    resetPeakMemory();
+    _start = std::chrono::steady_clock::now();
+}
+
+
+void ida::PhaseStats::stop(const Counts &counts) {
+    if (!_enabled) {
+        return;
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+
+    Phase phase;
+    phase.name = _name;
+    phase.seconds = std::chrono::duration<double>(stop - _start).count();
+    phase.peak_rss_kb = getPeakMemory();
+    phase.counts = counts;
+    _phases.push_back(phase);
+}
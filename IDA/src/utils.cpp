@@ -36,11 +36,17 @@ std::string getModuleName(Module &M) {
 }
 
 
-bool initGlobalStats(std::ofstream &globalStats, std::string name, bool app) {
+bool initGlobalStats(std::ofstream &globalStats, std::string name, bool app, const std::string &stats_path) {
     
     // create file for global statistics
-    std::string source_dir = getenv("SOURCE_DIR");
-    std::string filename = source_dir + "/stat/" + name + ".txt";
+    std::string filename;
+    if (!stats_path.empty()) {
+        filename = stats_path;
+    }
+    else {
+        std::string source_dir = getenv("SOURCE_DIR");
+        filename = source_dir + "/stat/" + name + ".txt";
+    }
     if (app)
         globalStats.open(filename, std::ios_base::app);
     else
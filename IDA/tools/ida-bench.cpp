@@ -0,0 +1,200 @@
+// ida-bench: run the IDA phases on a list of bitcode files and report, for each phase, the wall
+// time, the peak memory and the result counts as JSON.
+//
+//   ida-bench [-config <benchmark/config.txt>] [-repeat <n>] [-o <file.json>] [<program.bc> ...]
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ToolOutputFile.h"
+
+#include "InterproceduralDependencyAnalysis.h"
+#include "PhaseStats.h"
+
+
+using namespace llvm;
+
+
+static cl::list<std::string> InputFiles(cl::Positional, cl::desc("<program.bc> ..."));
+
+static cl::opt<std::string> ConfigFile("config",
+    cl::desc("Benchmark list in the format of benchmark/config.txt (name##llvm_bc##...)"),
+    cl::init(""));
+
+static cl::opt<unsigned> Repeat("repeat",
+    cl::desc("Number of runs of each module (default=1)"),
+    cl::init(1));
+
+static cl::opt<std::string> OutputFile("o",
+    cl::desc("Output JSON file (default: stdout)"),
+    cl::init("-"));
+
+static cl::opt<std::string> StatsFile("ida-stats",
+    cl::desc("File for the global statistics of IDA (default: none)"),
+    cl::init("/dev/null"));
+
+
+typedef struct bench_input {
+    std::string name;
+    std::string path;
+}BenchInput;
+
+
+// expand ${VAR} in the paths of config.txt
+static std::string expandEnv(std::string path) {
+    size_t begin;
+    while ((begin = path.find("${")) != std::string::npos) {
+        size_t end = path.find("}", begin);
+        if (end == std::string::npos) {
+            break;
+        }
+
+        const char *value = getenv(path.substr(begin + 2, end - begin - 2).c_str());
+        path.replace(begin, end - begin + 1, value ? value : "");
+    }
+
+    return path;
+}
+
+
+static bool readConfig(const std::string &config, std::vector<BenchInput> &inputs) {
+    std::ifstream file(config);
+    if (!file.is_open()) {
+        errs() << "ida-bench: failed to open " << config << "\n";
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t sep = line.find("##");
+        if (line.empty() || (sep == std::string::npos)) {
+            continue;
+        }
+
+        size_t end = line.find("##", sep + 2);
+        BenchInput input;
+        input.name = line.substr(0, sep);
+        input.path = expandEnv(line.substr(sep + 2, end - sep - 2));
+        inputs.push_back(input);
+    }
+
+    return true;
+}
+
+
+static json::Object runOnce(Module &M) {
+    ida::PhaseStats &phases = ida::PhaseStats::get();
+    phases.clear();
+
+    auto start = std::chrono::steady_clock::now();
+
+    legacy::PassManager pm;
+    auto *analysis = ida::InterproceduralDependencyAnalysis::addInProcess(pm, StatsFile);
+    pm.run(M);
+
+    const ida::DependencyIndex &index = analysis->getDependencyIndex();
+    json::Object run{
+        {"seconds", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()},
+        {"branches", (int64_t)index.branches.size()},
+        {"stores", (int64_t)index.stores.size()},
+    };
+
+    json::Array phase_array;
+    for (auto &phase: phases.getPhases()) {
+        json::Object counts;
+        for (auto &count: phase.counts) {
+            counts[count.first] = (int64_t)count.second;
+        }
+
+        phase_array.push_back(json::Object{
+            {"name", phase.name},
+            {"seconds", phase.seconds},
+            {"peak_rss_kb", (int64_t)phase.peak_rss_kb},
+            {"counts", std::move(counts)},
+        });
+    }
+    run["phases"] = std::move(phase_array);
+
+    return run;
+}
+
+
+int main(int argc, char **argv) {
+    cl::ParseCommandLineOptions(argc, argv, "IDA benchmark harness\n");
+
+    std::vector<BenchInput> inputs;
+    if (!ConfigFile.empty() && !readConfig(ConfigFile, inputs)) {
+        return 1;
+    }
+    for (auto &path: InputFiles) {
+        inputs.push_back({sys::path::stem(path).str(), path});
+    }
+
+    if (inputs.empty()) {
+        errs() << "ida-bench: no input, see -help\n";
+        return 1;
+    }
+
+    PassRegistry &registry = *PassRegistry::getPassRegistry();
+    initializeCore(registry);
+    initializeAnalysis(registry);
+
+    ida::PhaseStats::get().setEnabled(true);
+
+    json::Array modules;
+    for (auto &input: inputs) {
+        LLVMContext ctx;
+        SMDiagnostic err;
+
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<Module> M = parseIRFile(input.path, err, ctx);
+        if (!M) {
+            err.print("ida-bench", errs());
+            modules.push_back(json::Object{{"name", input.name}, {"path", input.path}, {"error", "failed to load"}});
+            continue;
+        }
+        double load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        int64_t func_num = 0, inst_num = 0;
+        for (Function &F: *M) {
+            if (F.isDeclaration())
+                continue;
+
+            func_num += 1;
+            inst_num += F.getInstructionCount();
+        }
+
+        json::Array runs;
+        for (unsigned i = 0; i < Repeat; i++) {
+            runs.push_back(runOnce(*M));
+        }
+
+        modules.push_back(json::Object{
+            {"name", input.name},
+            {"path", input.path},
+            {"functions", func_num},
+            {"instructions", inst_num},
+            {"load_seconds", load_seconds},
+            {"runs", std::move(runs)},
+        });
+    }
+
+    std::error_code ec;
+    ToolOutputFile out(OutputFile, ec, sys::fs::OF_Text);
+    if (ec) {
+        errs() << "ida-bench: " << ec.message() << "\n";
+        return 1;
+    }
+
+    out.os() << formatv("{0:2}", json::Value(json::Object{{"modules", std::move(modules)}})) << "\n";
+    out.keep();
+
+    return 0;
+}
@@ -0,0 +1,389 @@
+// ida-gen: generate a synthetic module with controllable numbers of functions, globals, struct
+// types, concrete branches, branch-related stores and indirect calls, to stress IDA (ida-bench)
+// and the concrete constraint searcher of KLEE at sizes the GNU programs do not reach.
+//
+//   ida-gen [-functions <n>] [-globals <n>] [-structs <n>] [-branches <n>] [-stores <n>]
+//           [-indirect-calls <n>] [-input-size <n>] [-scale <n>] [-seed <n>] [-klee] [-S] -o <file>
+//
+// Every function f_i takes a pointer to the struct type s_(i % structs) and calls f_(2i+1) and
+// f_(2i+2), so the call graph is a tree rooted at main. The branches of a function compare a
+// global, a field of its struct parameter or a local variable (optionally masked) with a constant.
+// The branch-related stores write constants into the same variables under conditions on the input
+// bytes, so that only some paths reach the values that flip a branch.
+
+#include <random>
+
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/ToolOutputFile.h"
+
+#include "LLVMEssentials.h"
+
+
+using namespace llvm;
+
+
+static cl::opt<unsigned> FunctionNum("functions",
+    cl::desc("Number of functions (default=20)"),
+    cl::init(20));
+
+static cl::opt<unsigned> GlobalNum("globals",
+    cl::desc("Number of global variables (default=16)"),
+    cl::init(16));
+
+static cl::opt<unsigned> StructNum("structs",
+    cl::desc("Number of struct types (default=4)"),
+    cl::init(4));
+
+static cl::opt<unsigned> BranchNum("branches",
+    cl::desc("Number of concrete branches (default=100)"),
+    cl::init(100));
+
+static cl::opt<unsigned> StoreNum("stores",
+    cl::desc("Number of branch-related constant stores (default=200)"),
+    cl::init(200));
+
+static cl::opt<unsigned> IndirectCallNum("indirect-calls",
+    cl::desc("Number of indirect calls through a handler table (default=10)"),
+    cl::init(10));
+
+static cl::opt<unsigned> InputSize("input-size",
+    cl::desc("Number of input bytes (default=16)"),
+    cl::init(16));
+
+static cl::opt<unsigned> Scale("scale",
+    cl::desc("Multiply the numbers of functions, globals, branches, stores and indirect calls (default=1)"),
+    cl::init(1));
+
+static cl::opt<unsigned> Seed("seed",
+    cl::desc("Random seed (default=0)"),
+    cl::init(0));
+
+static cl::opt<bool> ForKLEE("klee",
+    cl::desc("Make the input symbolic with klee_make_symbolic instead of reading it from stdin"),
+    cl::init(false));
+
+static cl::opt<bool> OutputAssembly("S",
+    cl::desc("Write LLVM assembly instead of bitcode"),
+    cl::init(false));
+
+static cl::opt<std::string> OutputFile("o",
+    cl::desc("Output file"),
+    cl::Required);
+
+
+#define FIELD_NUM       4
+#define CONSTANT_RANGE  16
+
+
+// distribute n items over m slots as evenly as possible
+static unsigned getShare(unsigned n, unsigned m, unsigned idx) {
+    return n / m + ((idx < n % m) ? 1 : 0);
+}
+
+
+class SyntheticModule {
+    public:
+        SyntheticModule(LLVMContext &ctx): _M(new Module("synthetic", ctx)), _ctx(ctx),
+            _builder(ctx), _rng(Seed) {}
+
+        std::unique_ptr<Module> generate();
+
+    private:
+        unsigned random(unsigned n) { return std::uniform_int_distribution<unsigned>(0, n - 1)(_rng); }
+
+        void createGlobals();
+        void createHandlers();
+        void createFunctions();
+        void createMain();
+
+        void fillFunction(unsigned idx);
+
+        // the address of a branch variable: a global, a field of the struct parameter or a local variable
+        Value *getVariable(unsigned kind, Function *F);
+        Value *getInputCondition();
+
+        BasicBlock *emitStore(Function *F);
+        BasicBlock *emitBranch(Function *F);
+        BasicBlock *emitIndirectCall(Function *F);
+
+        std::unique_ptr<Module> _M;
+        LLVMContext &_ctx;
+        IRBuilder<> _builder;
+        std::mt19937 _rng;
+
+        GlobalVariable *_input;
+        GlobalVariable *_sink;
+        GlobalVariable *_handlerTable;
+        std::vector<GlobalVariable *> _globals;
+        std::vector<StructType *> _structs;
+        std::vector<GlobalVariable *> _structObjs;
+        std::vector<Function *> _funcs;
+
+        // of the function being filled, the parameter is spilled like clang -O0 does, which is
+        // the form the branch dependency analysis follows to struct-pointer parameters
+        AllocaInst *_local;
+        AllocaInst *_paramAddr;
+};
+
+
+std::unique_ptr<Module> SyntheticModule::generate() {
+    createGlobals();
+    createHandlers();
+    createFunctions();
+    createMain();
+
+    return std::move(_M);
+}
+
+
+void SyntheticModule::createGlobals() {
+    Type *i8 = _builder.getInt8Ty();
+    Type *i32 = _builder.getInt32Ty();
+
+    ArrayType *input_type = ArrayType::get(i8, InputSize);
+    _input = new GlobalVariable(*_M, input_type, false, GlobalValue::InternalLinkage,
+                                ConstantAggregateZero::get(input_type), "input");
+
+    // the then-blocks of the branches write here, no branch reads it
+    _sink = new GlobalVariable(*_M, i32, false, GlobalValue::InternalLinkage,
+                               _builder.getInt32(0), "sink");
+
+    for (unsigned i = 0; i < GlobalNum; i++) {
+        _globals.push_back(new GlobalVariable(*_M, i32, false, GlobalValue::InternalLinkage,
+                                              _builder.getInt32(0), "g" + std::to_string(i)));
+    }
+
+    for (unsigned i = 0; i < StructNum; i++) {
+        std::vector<Type *> fields(FIELD_NUM, i32);
+        StructType *ST = StructType::create(_ctx, fields, "struct.s" + std::to_string(i));
+        _structs.push_back(ST);
+        _structObjs.push_back(new GlobalVariable(*_M, ST, false, GlobalValue::InternalLinkage,
+                                                 ConstantAggregateZero::get(ST), "s" + std::to_string(i) + "_obj"));
+    }
+}
+
+
+// handlers that store constants into globals, called through a table
+void SyntheticModule::createHandlers() {
+    FunctionType *FT = FunctionType::get(_builder.getVoidTy(), {_builder.getInt32Ty()}, false);
+    unsigned handler_num = std::max(1u, std::min(8u, (unsigned)IndirectCallNum));
+
+    std::vector<Constant *> handlers;
+    for (unsigned i = 0; i < handler_num; i++) {
+        Function *F = Function::Create(FT, GlobalValue::InternalLinkage, "handler" + std::to_string(i), *_M);
+        _builder.SetInsertPoint(BasicBlock::Create(_ctx, "entry", F));
+        _builder.CreateStore(_builder.getInt32(random(CONSTANT_RANGE)), _globals[random(GlobalNum)]);
+        _builder.CreateRetVoid();
+        handlers.push_back(F);
+    }
+
+    ArrayType *table_type = ArrayType::get(FT->getPointerTo(), handler_num);
+    _handlerTable = new GlobalVariable(*_M, table_type, true, GlobalValue::InternalLinkage,
+                                       ConstantArray::get(table_type, handlers), "handlers");
+}
+
+
+void SyntheticModule::createFunctions() {
+    for (unsigned i = 0; i < FunctionNum; i++) {
+        StructType *ST = _structs[i % StructNum];
+        FunctionType *FT = FunctionType::get(_builder.getVoidTy(), {ST->getPointerTo()}, false);
+        _funcs.push_back(Function::Create(FT, GlobalValue::InternalLinkage, "f" + std::to_string(i), *_M));
+    }
+
+    for (unsigned i = 0; i < FunctionNum; i++) {
+        fillFunction(i);
+    }
+}
+
+
+void SyntheticModule::fillFunction(unsigned idx) {
+    Function *F = _funcs[idx];
+    BasicBlock *entry = BasicBlock::Create(_ctx, "entry", F);
+    _builder.SetInsertPoint(entry);
+
+    Argument *param = F->getArg(0);
+    _paramAddr = _builder.CreateAlloca(param->getType(), nullptr, "p.addr");
+    _local = _builder.CreateAlloca(_builder.getInt32Ty(), nullptr, "l");
+    _builder.CreateStore(param, _paramAddr);
+    _builder.CreateStore(_builder.getInt32(0), _local);
+
+    // the stores come first, so that they reach the branches of the same function
+    for (unsigned i = 0; i < getShare(StoreNum, FunctionNum, idx); i++) {
+        _builder.SetInsertPoint(emitStore(F));
+    }
+
+    for (unsigned i = 0; i < getShare(IndirectCallNum, FunctionNum, idx); i++) {
+        _builder.SetInsertPoint(emitIndirectCall(F));
+    }
+
+    for (unsigned callee = 2 * idx + 1; callee <= 2 * idx + 2; callee++) {
+        if (callee >= FunctionNum) {
+            break;
+        }
+
+        // pass our parameter on if the callee takes the same struct type
+        Value *arg = _structObjs[callee % StructNum];
+        if ((callee % StructNum) == (idx % StructNum)) {
+            arg = _builder.CreateLoad(param->getType(), _paramAddr);
+        }
+        _builder.CreateCall(_funcs[callee], {arg});
+    }
+
+    for (unsigned i = 0; i < getShare(BranchNum, FunctionNum, idx); i++) {
+        _builder.SetInsertPoint(emitBranch(F));
+    }
+
+    _builder.CreateRetVoid();
+}
+
+
+Value *SyntheticModule::getVariable(unsigned kind, Function *F) {
+    if (kind == 0) {
+        return _globals[random(GlobalNum)];
+    }
+    else if (kind == 1) {
+        Type *T = F->getArg(0)->getType();
+        Value *p = _builder.CreateLoad(T, _paramAddr);
+        return _builder.CreateStructGEP(T->getPointerElementType(), p, random(FIELD_NUM));
+    }
+    else {
+        return _local;
+    }
+}
+
+
+Value *SyntheticModule::getInputCondition() {
+    Value *byte_ptr = _builder.CreateConstInBoundsGEP2_32(_input->getValueType(), _input, 0, random(InputSize));
+    Value *byte = _builder.CreateLoad(_builder.getInt8Ty(), byte_ptr);
+    return _builder.CreateICmpEQ(byte, _builder.getInt8(random(256)));
+}
+
+
+// if (input[k] == c) var = constant;
+BasicBlock *SyntheticModule::emitStore(Function *F) {
+    BasicBlock *then_bb = BasicBlock::Create(_ctx, "store", F);
+    BasicBlock *next_bb = BasicBlock::Create(_ctx, "next", F);
+    _builder.CreateCondBr(getInputCondition(), then_bb, next_bb);
+
+    _builder.SetInsertPoint(then_bb);
+    Value *ptr = getVariable(random(3), F);
+    _builder.CreateStore(_builder.getInt32(random(CONSTANT_RANGE)), ptr);
+    _builder.CreateBr(next_bb);
+
+    return next_bb;
+}
+
+
+// if ((var [& mask]) pred constant) sink = 1;
+BasicBlock *SyntheticModule::emitBranch(Function *F) {
+    static const CmpInst::Predicate preds[] = {
+        CmpInst::ICMP_EQ, CmpInst::ICMP_NE, CmpInst::ICMP_SGT, CmpInst::ICMP_SLT,
+        CmpInst::ICMP_UGT, CmpInst::ICMP_ULE,
+    };
+
+    Value *ptr = getVariable(random(3), F);
+    Value *var = _builder.CreateLoad(_builder.getInt32Ty(), ptr);
+    if (random(4) == 0) {
+        var = _builder.CreateAnd(var, _builder.getInt32(CONSTANT_RANGE - 1));
+    }
+
+    CmpInst::Predicate pred = preds[random(sizeof(preds) / sizeof(preds[0]))];
+    Value *cond = _builder.CreateICmp(pred, var, _builder.getInt32(random(CONSTANT_RANGE)));
+
+    BasicBlock *then_bb = BasicBlock::Create(_ctx, "then", F);
+    BasicBlock *next_bb = BasicBlock::Create(_ctx, "next", F);
+    _builder.CreateCondBr(cond, then_bb, next_bb);
+
+    _builder.SetInsertPoint(then_bb);
+    _builder.CreateStore(_builder.getInt32(1), _sink);
+    _builder.CreateBr(next_bb);
+
+    return next_bb;
+}
+
+
+// handlers[input[k] % n](c);
+BasicBlock *SyntheticModule::emitIndirectCall(Function *F) {
+    ArrayType *table_type = cast<ArrayType>(_handlerTable->getValueType());
+    Value *byte_ptr = _builder.CreateConstInBoundsGEP2_32(_input->getValueType(), _input, 0, random(InputSize));
+    Value *byte = _builder.CreateZExt(_builder.CreateLoad(_builder.getInt8Ty(), byte_ptr), _builder.getInt64Ty());
+    Value *idx = _builder.CreateURem(byte, _builder.getInt64(table_type->getNumElements()));
+
+    Value *handler_ptr = _builder.CreateInBoundsGEP(table_type, _handlerTable, {_builder.getInt64(0), idx});
+    FunctionType *FT = FunctionType::get(_builder.getVoidTy(), {_builder.getInt32Ty()}, false);
+    Value *handler = _builder.CreateLoad(table_type->getElementType(), handler_ptr);
+    _builder.CreateCall(FT, handler, {_builder.getInt32(random(CONSTANT_RANGE))});
+
+    return _builder.GetInsertBlock();
+}
+
+
+void SyntheticModule::createMain() {
+    Type *i8_ptr = _builder.getInt8PtrTy();
+    Type *i32 = _builder.getInt32Ty();
+    Type *i64 = _builder.getInt64Ty();
+
+    FunctionType *FT = FunctionType::get(i32, {i32, i8_ptr->getPointerTo()}, false);
+    Function *main = Function::Create(FT, GlobalValue::ExternalLinkage, "main", *_M);
+    _builder.SetInsertPoint(BasicBlock::Create(_ctx, "entry", main));
+
+    Value *input = _builder.CreateBitCast(_input, i8_ptr);
+    if (ForKLEE) {
+        FunctionCallee make_symbolic = _M->getOrInsertFunction("klee_make_symbolic",
+            FunctionType::get(_builder.getVoidTy(), {i8_ptr, i64, i8_ptr}, false));
+        _builder.CreateCall(make_symbolic, {input, _builder.getInt64(InputSize),
+                                            _builder.CreateGlobalStringPtr("input")});
+    }
+    else {
+        FunctionCallee read = _M->getOrInsertFunction("read", FunctionType::get(i64, {i32, i8_ptr, i64}, false));
+        _builder.CreateCall(read, {_builder.getInt32(0), input, _builder.getInt64(InputSize)});
+    }
+
+    if (!_funcs.empty()) {
+        _builder.CreateCall(_funcs[0], {_structObjs[0]});
+    }
+    _builder.CreateRet(_builder.getInt32(0));
+}
+
+
+int main(int argc, char **argv) {
+    cl::ParseCommandLineOptions(argc, argv, "Synthetic module generator for IDA and KLEE\n");
+
+    if (!FunctionNum || !GlobalNum || !StructNum || !InputSize) {
+        errs() << "ida-gen: -functions, -globals, -structs and -input-size must be positive\n";
+        return 1;
+    }
+
+    FunctionNum = FunctionNum * Scale;
+    GlobalNum = GlobalNum * Scale;
+    BranchNum = BranchNum * Scale;
+    StoreNum = StoreNum * Scale;
+    IndirectCallNum = IndirectCallNum * Scale;
+
+    LLVMContext ctx;
+    std::unique_ptr<Module> M = SyntheticModule(ctx).generate();
+
+    if (verifyModule(*M, &errs())) {
+        errs() << "ida-gen: generated an invalid module\n";
+        return 1;
+    }
+
+    std::error_code ec;
+    ToolOutputFile out(OutputFile, ec, OutputAssembly ? sys::fs::OF_Text : sys::fs::OF_None);
+    if (ec) {
+        errs() << "ida-gen: " << ec.message() << "\n";
+        return 1;
+    }
+
+    if (OutputAssembly) {
+        M->print(out.os(), nullptr);
+    }
+    else {
+        WriteBitcodeToFile(*M, out.os());
+    }
+    out.keep();
+
+    return 0;
+}
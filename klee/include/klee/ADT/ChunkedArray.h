@@ -0,0 +1,239 @@
+//===-- ChunkedArray.h ------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_CHUNKEDARRAY_H
+#define KLEE_CHUNKEDARRAY_H
+
+#include "klee/ADT/Ref.h"
+
+#include "llvm/ADT/SmallVector.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+namespace klee {
+
+namespace chunked_array {
+/// Elements are compared by identity for ref<>, whose operator== compares
+/// the referenced objects and does not allow null references.
+template <typename T> bool isSame(const T &a, const T &b) { return a == b; }
+template <typename T> bool isSame(const ref<T> &a, const ref<T> &b) {
+  return a.get() == b.get();
+}
+} // namespace chunked_array
+
+/// A fixed-size array split into chunks of ChunkSize elements. Copies of the
+/// array share its chunks, which are reference counted, and a chunk is only
+/// copied on the first write to it through a shared array. Chunks that were
+/// never written hold the fill value and are not allocated.
+template <typename T, unsigned ChunkSize> class ChunkedArray {
+  static_assert((ChunkSize & (ChunkSize - 1)) == 0,
+                "chunk size must be a power of two");
+
+  struct Chunk {
+    /// @brief Required by klee::ref-managed objects
+    class ReferenceCounter _refCount;
+    std::unique_ptr<T[]> data;
+
+    explicit Chunk(unsigned n) : data(new T[n]) {}
+  };
+
+  unsigned size;
+  T fillValue;
+  // objects smaller than a chunk do not need another allocation
+  llvm::SmallVector<ref<Chunk>, 1> chunks;
+
+  unsigned getChunkLength(unsigned c) const {
+    return std::min(ChunkSize, size - c * ChunkSize);
+  }
+
+  /// Returns the data of chunk c, allocating or unsharing it first.
+  T *getWriteableChunk(unsigned c) {
+    ref<Chunk> &chunk = chunks[c];
+    unsigned n = getChunkLength(c);
+
+    if (chunk.isNull()) {
+      chunk = new Chunk(n);
+      std::fill(chunk->data.get(), chunk->data.get() + n, fillValue);
+    } else if (chunk->_refCount.getCount() > 1) {
+      ref<Chunk> copy(new Chunk(n));
+      std::copy(chunk->data.get(), chunk->data.get() + n, copy->data.get());
+      chunk = copy;
+    }
+
+    return chunk->data.get();
+  }
+
+public:
+  ChunkedArray(unsigned size, const T &value = T())
+      : size(size), fillValue(value),
+        chunks((size + ChunkSize - 1) / ChunkSize) {}
+
+  ChunkedArray(const ChunkedArray &) = default;
+  ChunkedArray &operator=(const ChunkedArray &) = default;
+
+  unsigned getSize() const { return size; }
+
+  const T &get(unsigned idx) const {
+    const ref<Chunk> &chunk = chunks[idx / ChunkSize];
+    return chunk.isNull() ? fillValue : chunk->data[idx & (ChunkSize - 1)];
+  }
+
+  void set(unsigned idx, const T &value) {
+    unsigned c = idx / ChunkSize;
+    if (chunks[c].isNull() && chunked_array::isSame(value, fillValue))
+      return;
+    getWriteableChunk(c)[idx & (ChunkSize - 1)] = value;
+  }
+
+  /// Sets all elements to value, dropping all chunks.
+  void fill(const T &value) {
+    fillValue = value;
+    for (auto &chunk : chunks)
+      chunk = ref<Chunk>();
+  }
+
+  /// Copies the elements [idx, idx+n) to dst[0..n).
+  void read(unsigned idx, T *dst, unsigned n) const {
+    while (n) {
+      unsigned c = idx / ChunkSize, begin = idx & (ChunkSize - 1);
+      unsigned len = std::min(n, getChunkLength(c) - begin);
+      if (chunks[c].isNull())
+        std::fill(dst, dst + len, fillValue);
+      else
+        std::copy(chunks[c]->data.get() + begin,
+                  chunks[c]->data.get() + begin + len, dst);
+      idx += len, dst += len, n -= len;
+    }
+  }
+
+  /// Copies src[0..n) to the elements [idx, idx+n).
+  void write(unsigned idx, const T *src, unsigned n) {
+    while (n) {
+      unsigned c = idx / ChunkSize, begin = idx & (ChunkSize - 1);
+      unsigned len = std::min(n, getChunkLength(c) - begin);
+      std::copy(src, src + len, getWriteableChunk(c) + begin);
+      idx += len, src += len, n -= len;
+    }
+  }
+
+  /// Sets the elements [idx, idx+n) to value.
+  void fill(unsigned idx, unsigned n, const T &value) {
+    while (n) {
+      unsigned c = idx / ChunkSize, begin = idx & (ChunkSize - 1);
+      unsigned len = std::min(n, getChunkLength(c) - begin);
+      if (!(chunks[c].isNull() && chunked_array::isSame(value, fillValue))) {
+        T *data = getWriteableChunk(c);
+        std::fill(data + begin, data + begin + len, value);
+      }
+      idx += len, n -= len;
+    }
+  }
+
+  /// Copies the elements to dst[0..size).
+  void copyTo(T *dst) const {
+    for (unsigned c = 0; c < chunks.size(); c++, dst += ChunkSize) {
+      unsigned n = getChunkLength(c);
+      if (chunks[c].isNull())
+        std::fill(dst, dst + n, fillValue);
+      else
+        std::copy(chunks[c]->data.get(), chunks[c]->data.get() + n, dst);
+    }
+  }
+
+  /// Returns true if the elements equal src[0..size).
+  bool equals(const T *src) const {
+    for (unsigned c = 0; c < chunks.size(); c++, src += ChunkSize) {
+      if (!equalsChunk(c, src))
+        return false;
+    }
+    return true;
+  }
+
+  /// Copies src[0..size) into the array. Chunks that already hold the same
+  /// elements stay shared.
+  void copyFrom(const T *src) {
+    for (unsigned c = 0; c < chunks.size(); c++, src += ChunkSize) {
+      if (!equalsChunk(c, src))
+        std::copy(src, src + getChunkLength(c), getWriteableChunk(c));
+    }
+  }
+
+  /// Returns the number of allocated chunks that are shared with a copy.
+  unsigned getSharedChunkCount() const {
+    unsigned count = 0;
+    for (auto &chunk : chunks) {
+      if (!chunk.isNull() && chunk->_refCount.getCount() > 1)
+        count++;
+    }
+    return count;
+  }
+
+  /// Returns the number of allocated chunks.
+  unsigned getAllocatedChunkCount() const {
+    unsigned count = 0;
+    for (auto &chunk : chunks) {
+      if (!chunk.isNull())
+        count++;
+    }
+    return count;
+  }
+
+private:
+  bool equalsChunk(unsigned c, const T *src) const {
+    unsigned n = getChunkLength(c);
+    if (chunks[c].isNull())
+      return std::all_of(src, src + n, [this](const T &v) {
+        return chunked_array::isSame(v, fillValue);
+      });
+    return std::equal(src, src + n, chunks[c]->data.get(),
+                      [](const T &a, const T &b) {
+                        return chunked_array::isSame(a, b);
+                      });
+  }
+};
+
+/// A bit array with the copy-on-write chunks of ChunkedArray, with the
+/// interface of BitArray.
+template <unsigned ChunkSize> class ChunkedBitArray {
+  static_assert(ChunkSize % 32 == 0, "chunk size must be a multiple of 32");
+
+  ChunkedArray<uint32_t, ChunkSize / 32> words;
+
+public:
+  ChunkedBitArray(unsigned size, bool value = false)
+      : words((size + 31) / 32, value ? 0xFFFFFFFF : 0) {}
+
+  bool get(unsigned idx) const {
+    return (words.get(idx / 32) >> (idx & 0x1F)) & 1;
+  }
+  void set(unsigned idx) {
+    uint32_t word = words.get(idx / 32);
+    if (!(word & (1u << (idx & 0x1F))))
+      words.set(idx / 32, word | (1u << (idx & 0x1F)));
+  }
+  void unset(unsigned idx) {
+    uint32_t word = words.get(idx / 32);
+    if (word & (1u << (idx & 0x1F)))
+      words.set(idx / 32, word & ~(1u << (idx & 0x1F)));
+  }
+  void set(unsigned idx, bool value) {
+    if (value)
+      set(idx);
+    else
+      unset(idx);
+  }
+
+  unsigned getSharedChunkCount() const { return words.getSharedChunkCount(); }
+};
+
+} // End klee namespace
+
+#endif /* KLEE_CHUNKEDARRAY_H */
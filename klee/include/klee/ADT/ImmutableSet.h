@@ -41,6 +41,7 @@ namespace klee {
     ~ImmutableSet() {}
 
     ImmutableSet &operator=(const ImmutableSet &b) { elts = b.elts; return *this; }
+    ImmutableSet &operator=(ImmutableSet &&b) { elts = std::move(b.elts); return *this; }
     
     bool empty() const { 
       return elts.empty(); 
@@ -11,6 +11,8 @@
 #define KLEE_IMMUTABLETREE_H
 
 #include <cassert>
+#include <cstddef>
+#include <utility>
 #include <vector>
 
 namespace klee {
@@ -31,6 +33,7 @@ namespace klee {
     ~ImmutableTree();
 
     ImmutableTree &operator=(const ImmutableTree &s);
+    ImmutableTree &operator=(ImmutableTree &&s);
 
     bool empty() const;
 
@@ -448,6 +451,13 @@ namespace klee {
     return *this;
   }
 
+  template<class K, class V, class KOV, class CMP>
+  ImmutableTree<K,V,KOV,CMP> &ImmutableTree<K,V,KOV,CMP>::operator=(ImmutableTree &&s) {
+    // s releases the old node
+    std::swap(node, s.node);
+    return *this;
+  }
+
   template<class K, class V, class KOV, class CMP>
   bool ImmutableTree<K,V,KOV,CMP>::empty() const {
     return node->isTerminator();
@@ -0,0 +1,385 @@
+//===-- SetIndex.h ----------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_SETINDEX_H
+#define KLEE_SETINDEX_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace klee {
+
+/// Maps sets of keys to values, with lookups of the exact set, of a stored
+/// subset and of a stored superset of a given set. Rather than walking a trie
+/// that grows with the number of sets, the lookups only visit the sets that
+/// can possibly match:
+///
+/// - keys are numbered in the order they are first seen, and each set is
+///   stored as its sorted key numbers and a 64-bit signature (a one-hash
+///   Bloom filter) that rejects most candidates without comparing keys;
+/// - a subset of a given set must contain its own largest key number, so
+///   each set is listed once under that key and subset lookups only visit
+///   the lists of the given keys;
+/// - a superset of a given set contains all of its keys, so superset lookups
+///   only visit the posting list of its rarest key.
+///
+/// The index estimates its own memory use and, when given a limit, evicts the
+/// least recently used sets until it fits. Evicted values are handed to the
+/// eviction handler, so that the owner can release them.
+template <class K, class V, class Hash = std::hash<K>,
+          class Equal = std::equal_to<K>>
+class SetIndex {
+public:
+  typedef std::function<void(const V &)> EvictionHandler;
+
+  /// \param maxBytes - The memory the index may use, or 0 for no limit.
+  explicit SetIndex(std::size_t maxBytes = 0,
+                    EvictionHandler onEvict = EvictionHandler())
+      : maxBytes(maxBytes), onEvict(std::move(onEvict)) {}
+
+  SetIndex(const SetIndex &) = delete;
+  SetIndex &operator=(const SetIndex &) = delete;
+
+  /// Returns the value of exactly the set of keys, or null.
+  template <class Keys> V *lookup(const Keys &keys);
+
+  /// Stores value for the set of keys, replacing (and evicting) the value
+  /// stored for it before. valueBytes is the memory the value holds.
+  template <class Keys>
+  void insert(const Keys &keys, const V &value, std::size_t valueBytes = 0);
+
+  /// Returns the value of a stored subset of keys for which p holds, or null.
+  template <class Keys, class Predicate>
+  V *findSubset(const Keys &keys, const Predicate &p);
+
+  /// Returns the value of a stored superset of keys for which p holds, or
+  /// null.
+  template <class Keys, class Predicate>
+  V *findSuperset(const Keys &keys, const Predicate &p);
+
+  /// Removes all sets, handing their values to the eviction handler. The
+  /// keys are not hashed or compared, so they may refer to data that is
+  /// already gone, e.g. when the owner is destroyed.
+  void clear();
+
+  std::size_t size() const { return entries.size(); }
+  std::size_t getMemoryUsage() const { return memoryUsage; }
+  std::uint64_t getNumEvictions() const { return numEvictions; }
+
+private:
+  typedef std::uint32_t Id;
+
+  struct Term {
+    Id id;
+    /// The number of stored sets holding the key
+    std::uint32_t uses;
+  };
+
+  struct Entry {
+    std::vector<Id> terms;
+    std::uint64_t signature;
+    V value;
+    std::size_t bytes;
+    typename std::list<Id>::iterator lru;
+  };
+
+  /// A list of sets that skips the removed ones and is compacted once they
+  /// make up half of it
+  struct Postings {
+    std::vector<Id> entries;
+    std::uint32_t removed = 0;
+  };
+
+  typedef std::unordered_map<K, Term, Hash, Equal> TermMap;
+
+  // rough sizes of the nodes of the standard containers
+  static constexpr std::size_t NodeOverhead = 4 * sizeof(void *);
+  static constexpr std::size_t TermBytes =
+      sizeof(typename TermMap::value_type) + 2 * NodeOverhead;
+
+  std::size_t maxBytes;
+  EvictionHandler onEvict;
+
+  TermMap terms;
+  /// The keys by their numbers (the nodes of terms do not move)
+  std::unordered_map<Id, typename TermMap::value_type *> termKeys;
+  std::unordered_map<Id, Entry> entries;
+  std::map<std::vector<Id>, Id> exact;
+  /// The sets holding each key
+  std::unordered_map<Id, Postings> postings;
+  /// The sets by their largest key, and the empty set
+  std::unordered_map<Id, Postings> pivots;
+  Postings emptySets;
+  /// Most recently used sets first
+  std::list<Id> lru;
+
+  Id nextTerm = 0;
+  Id nextEntry = 0;
+  std::size_t memoryUsage = 0;
+  std::uint64_t numEvictions = 0;
+
+  static std::uint64_t getSignature(const std::vector<Id> &ids) {
+    std::uint64_t signature = 0;
+    for (Id id : ids)
+      signature |= std::uint64_t(1) << (id % 64);
+    return signature;
+  }
+
+  static std::size_t getEntryBytes(std::size_t numTerms) {
+    // the entry, its slot in exact, postings and pivots and its LRU node
+    return sizeof(Entry) + 3 * NodeOverhead + sizeof(std::vector<Id>) +
+           (3 * numTerms + 1) * sizeof(Id);
+  }
+
+  /// Collects the numbers of keys, sorted. Returns false if some key is not
+  /// in any stored set.
+  template <class Keys> bool getIds(const Keys &keys, std::vector<Id> &ids);
+
+  void touch(Entry &entry) { lru.splice(lru.begin(), lru, entry.lru); }
+
+  Entry *getEntry(Id id) {
+    auto it = entries.find(id);
+    return it == entries.end() ? nullptr : &it->second;
+  }
+
+  void removeFrom(Postings &list) {
+    if (++list.removed * 2 < list.entries.size())
+      return;
+    list.entries.erase(std::remove_if(list.entries.begin(), list.entries.end(),
+                                      [this](Id id) {
+                                        return !entries.count(id);
+                                      }),
+                       list.entries.end());
+    list.removed = 0;
+  }
+
+  void evict(Id id);
+};
+
+template <class K, class V, class Hash, class Equal>
+template <class Keys>
+bool SetIndex<K, V, Hash, Equal>::getIds(const Keys &keys,
+                                         std::vector<Id> &ids) {
+  bool allKnown = true;
+  for (const auto &key : keys) {
+    auto it = terms.find(key);
+    if (it != terms.end())
+      ids.push_back(it->second.id);
+    else
+      allKnown = false;
+  }
+  std::sort(ids.begin(), ids.end());
+  return allKnown;
+}
+
+template <class K, class V, class Hash, class Equal>
+template <class Keys>
+V *SetIndex<K, V, Hash, Equal>::lookup(const Keys &keys) {
+  std::vector<Id> ids;
+  if (!getIds(keys, ids))
+    return nullptr;
+
+  auto it = exact.find(ids);
+  if (it == exact.end())
+    return nullptr;
+  Entry &entry = entries.find(it->second)->second;
+  touch(entry);
+  return &entry.value;
+}
+
+template <class K, class V, class Hash, class Equal>
+template <class Keys>
+void SetIndex<K, V, Hash, Equal>::insert(const Keys &keys, const V &value,
+                                         std::size_t valueBytes) {
+  std::vector<Id> ids;
+  if (getIds(keys, ids)) {
+    auto it = exact.find(ids);
+    if (it != exact.end())
+      evict(it->second);
+  }
+
+  ids.clear();
+  for (const auto &key : keys) {
+    auto res = terms.emplace(key, Term{nextTerm, 0});
+    if (res.second) {
+      termKeys.emplace(nextTerm++, &*res.first);
+      memoryUsage += TermBytes;
+    }
+    ++res.first->second.uses;
+    ids.push_back(res.first->second.id);
+  }
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+  Id id = nextEntry++;
+  lru.push_front(id);
+  Entry &entry = entries[id];
+  entry.terms = ids;
+  entry.signature = getSignature(ids);
+  entry.value = value;
+  entry.bytes = getEntryBytes(ids.size()) + valueBytes;
+  entry.lru = lru.begin();
+  memoryUsage += entry.bytes;
+
+  exact.emplace(std::move(ids), id);
+  for (Id term : entry.terms)
+    postings[term].entries.push_back(id);
+  if (entry.terms.empty())
+    emptySets.entries.push_back(id);
+  else
+    pivots[entry.terms.back()].entries.push_back(id);
+
+  // the set just added stays, even if it does not fit on its own
+  while (maxBytes && memoryUsage > maxBytes && entries.size() > 1)
+    evict(lru.back());
+}
+
+template <class K, class V, class Hash, class Equal>
+void SetIndex<K, V, Hash, Equal>::evict(Id id) {
+  auto it = entries.find(id);
+  assert(it != entries.end() && "evicting a missing set");
+  Entry entry = std::move(it->second);
+  entries.erase(it);
+
+  exact.erase(entry.terms);
+  lru.erase(entry.lru);
+  memoryUsage -= entry.bytes;
+  ++numEvictions;
+
+  if (entry.terms.empty())
+    removeFrom(emptySets);
+  else
+    removeFrom(pivots[entry.terms.back()]);
+  for (Id term : entry.terms)
+    removeFrom(postings[term]);
+
+  // forget the keys no stored set holds anymore
+  for (Id term : entry.terms) {
+    auto keyIt = termKeys.find(term);
+    if (--keyIt->second->second.uses)
+      continue;
+    postings.erase(term);
+    pivots.erase(term);
+    terms.erase(terms.find(keyIt->second->first));
+    termKeys.erase(keyIt);
+    memoryUsage -= TermBytes;
+  }
+
+  if (onEvict)
+    onEvict(entry.value);
+}
+
+template <class K, class V, class Hash, class Equal>
+template <class Keys, class Predicate>
+V *SetIndex<K, V, Hash, Equal>::findSubset(const Keys &keys,
+                                           const Predicate &p) {
+  std::vector<Id> ids;
+  getIds(keys, ids);
+  std::uint64_t signature = getSignature(ids);
+
+  auto check = [&](Postings &list) -> V * {
+    for (Id id : list.entries) {
+      Entry *entry = getEntry(id);
+      if (!entry || entry->terms.size() > ids.size() ||
+          (entry->signature & ~signature) ||
+          !std::includes(ids.begin(), ids.end(), entry->terms.begin(),
+                         entry->terms.end()) ||
+          !p(entry->value))
+        continue;
+      touch(*entry);
+      return &entry->value;
+    }
+    return nullptr;
+  };
+
+  if (V *value = check(emptySets))
+    return value;
+  for (Id term : ids) {
+    auto it = pivots.find(term);
+    if (it == pivots.end())
+      continue;
+    if (V *value = check(it->second))
+      return value;
+  }
+  return nullptr;
+}
+
+template <class K, class V, class Hash, class Equal>
+template <class Keys, class Predicate>
+V *SetIndex<K, V, Hash, Equal>::findSuperset(const Keys &keys,
+                                             const Predicate &p) {
+  std::vector<Id> ids;
+  if (!getIds(keys, ids))
+    return nullptr;
+  std::uint64_t signature = getSignature(ids);
+
+  auto candidates = [&](Entry &entry) {
+    return entry.terms.size() >= ids.size() &&
+           !(signature & ~entry.signature) &&
+           std::includes(entry.terms.begin(), entry.terms.end(), ids.begin(),
+                         ids.end()) &&
+           p(entry.value);
+  };
+
+  if (ids.empty()) {
+    for (Id id : lru) {
+      Entry &entry = entries.find(id)->second;
+      if (p(entry.value)) {
+        touch(entry);
+        return &entry.value;
+      }
+    }
+    return nullptr;
+  }
+
+  // the rarest key has the fewest candidates
+  Postings *rarest = nullptr;
+  for (Id term : ids) {
+    Postings &list = postings[term];
+    if (!rarest || list.entries.size() < rarest->entries.size())
+      rarest = &list;
+  }
+
+  for (Id id : rarest->entries) {
+    Entry *entry = getEntry(id);
+    if (entry && candidates(*entry)) {
+      touch(*entry);
+      return &entry->value;
+    }
+  }
+  return nullptr;
+}
+
+template <class K, class V, class Hash, class Equal>
+void SetIndex<K, V, Hash, Equal>::clear() {
+  if (onEvict)
+    for (auto it = lru.rbegin(), ie = lru.rend(); it != ie; ++it)
+      onEvict(entries.find(*it)->second.value);
+
+  terms.clear();
+  termKeys.clear();
+  entries.clear();
+  exact.clear();
+  postings.clear();
+  pivots.clear();
+  emptySets = Postings();
+  lru.clear();
+  memoryUsage = 0;
+  numEvictions = 0;
+}
+
+} // namespace klee
+
+#endif /* KLEE_SETINDEX_H */
@@ -0,0 +1,83 @@
+//===-- ConstraintPartitions.h ----------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_CONSTRAINTPARTITIONS_H
+#define KLEE_CONSTRAINTPARTITIONS_H
+
+#include "klee/ADT/ImmutableMap.h"
+#include "klee/ADT/ImmutableSet.h"
+#include "klee/Expr/Expr.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace klee {
+
+/// Partitions the constraints of a constraint set into independent factors:
+/// two constraints are in the same partition iff they read a common byte of
+/// an array, directly or through other constraints. A read at a symbolic
+/// index reads every byte of its array.
+///
+/// The partitions are a union-find over the array bytes read by the
+/// constraints, which is updated as constraints are added. It is built from
+/// persistent maps, so copies (e.g. of a forked state) share it and cost
+/// constant time.
+class ConstraintPartitions {
+public:
+  /// The index of the element standing for all bytes of an array
+  static constexpr std::uint64_t WholeArray = ~(std::uint64_t)0;
+
+  /// A byte of an array, or the whole array
+  typedef std::pair<const Array *, std::uint64_t> Element;
+
+  // Defined out of line: when the reference counting of the maps is inlined
+  // into users (e.g. ConstraintManager::rewriteConstraints), GCC 12 cannot
+  // tell that the shared terminator node is never freed and warns with
+  // -Wfree-nonheap-object and -Wuse-after-free.
+  ConstraintPartitions();
+  ConstraintPartitions(const ConstraintPartitions &);
+  ConstraintPartitions &operator=(const ConstraintPartitions &);
+  ~ConstraintPartitions();
+
+  /// Adds the constraint at position in its constraint set.
+  void add(std::size_t position, const ref<Expr> &constraint);
+
+  /// Appends the positions of the constraints that share an element with
+  /// expr, directly or through other constraints, to positions, in
+  /// increasing order.
+  void getPartition(const ref<Expr> &expr,
+                    std::vector<std::size_t> &positions) const;
+
+  /// Returns the number of partitions.
+  std::size_t getNumPartitions() const { return weights.size(); }
+
+  /// Collects the elements read by e. Reads of constant arrays without
+  /// updates are left out, they do not depend on any constraint.
+  static void getElements(const ref<Expr> &e, std::vector<Element> &elements);
+
+private:
+  ImmutableMap<Element, unsigned> nodes;
+  /// The parents of the nodes that are not the root of their tree
+  ImmutableMap<unsigned, unsigned> parents;
+  /// The number of elements and constraints of each partition, by the root
+  /// of its tree. The lighter partition is merged into the heavier one.
+  ImmutableMap<unsigned, std::size_t> weights;
+  /// The positions of the constraints of each partition, after its root
+  ImmutableSet<std::pair<unsigned, std::size_t>> members;
+  unsigned numNodes = 0;
+
+  unsigned find(unsigned node) const;
+  unsigned unite(unsigned a, unsigned b);
+  unsigned getNode(const Element &element);
+};
+
+} // namespace klee
+
+#endif /* KLEE_CONSTRAINTPARTITIONS_H */
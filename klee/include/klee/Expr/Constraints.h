@@ -10,20 +10,81 @@
 #ifndef KLEE_CONSTRAINTS_H
 #define KLEE_CONSTRAINTS_H
 
+#include "klee/Expr/ConstraintPartitions.h"
 #include "klee/Expr/Expr.h"
 
+#include <iterator>
+#include <vector>
+
 namespace klee {
 
 /// Resembles a set of constraints that can be passed around
 ///
+/// Constraint sets are persistent: copies share the constraints they have in
+/// common, so copying a set (e.g. when a state forks) and appending to the
+/// copy take constant time. The constraints are stored in blocks of
+/// BlockSize that are only copied when two copies of a set both append to a
+/// shared, partially filled block.
+///
+/// Once a set was asked for the constraints a query depends on, it keeps the
+/// partitions of its constraints up to date as constraints are appended, and
+/// shares them with its copies.
 class ConstraintSet {
   friend class ConstraintManager;
 
+  static constexpr unsigned BlockSize = 32;
+
+  struct Block {
+    /// @brief Required by klee::ref-managed objects
+    class ReferenceCounter _refCount;
+    /// The block holding the constraints before this one, always full
+    ref<Block> parent;
+    /// The number of constraints stored in the block, which may be more than
+    /// a set using it sees when a copy appended to it
+    unsigned count = 0;
+    ref<Expr> exprs[BlockSize];
+
+    explicit Block(const ref<Block> &parent) : parent(parent) {}
+  };
+
 public:
   using constraints_ty = std::vector<ref<Expr>>;
-  using iterator = constraints_ty::iterator;
-  using const_iterator = constraints_ty::const_iterator;
 
+  /// Iterates over the constraints in the order they were added
+  class const_iterator {
+    friend class ConstraintSet;
+
+    const Block *const *blocks;
+    size_t index;
+
+    const_iterator(const Block *const *blocks, size_t index)
+        : blocks(blocks), index(index) {}
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = ref<Expr>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const ref<Expr> *;
+    using reference = const ref<Expr> &;
+
+    reference operator*() const {
+      return blocks[index / BlockSize]->exprs[index % BlockSize];
+    }
+    pointer operator->() const { return &**this; }
+    const_iterator &operator++() {
+      ++index;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator it = *this;
+      ++index;
+      return it;
+    }
+    bool operator==(const const_iterator &b) const { return index == b.index; }
+    bool operator!=(const const_iterator &b) const { return index != b.index; }
+  };
+
+  using iterator = const_iterator;
   using constraint_iterator = const_iterator;
 
   bool empty() const;
@@ -31,17 +92,42 @@ public:
   constraint_iterator end() const;
   size_t size() const noexcept;
 
-  explicit ConstraintSet(constraints_ty cs) : constraints(std::move(cs)) {}
+  explicit ConstraintSet(const constraints_ty &cs);
   ConstraintSet() = default;
 
+  ConstraintSet(const ConstraintSet &b)
+      : tail(b.tail), count(b.count), partitions(b.partitions),
+        hasPartitions(b.hasPartitions) {}
+  ConstraintSet &operator=(const ConstraintSet &b) {
+    tail = b.tail;
+    count = b.count;
+    blocks.clear();
+    partitions = b.partitions;
+    hasPartitions = b.hasPartitions;
+    return *this;
+  }
+
   void push_back(const ref<Expr> &e);
 
-  bool operator==(const ConstraintSet &b) const {
-    return constraints == b.constraints;
-  }
+  /// Appends the constraints that read an array byte expr reads, directly or
+  /// through other constraints, to result, in the order they were added.
+  void getIndependentConstraints(const ref<Expr> &expr,
+                                 std::vector<ref<Expr>> &result) const;
+
+  bool operator==(const ConstraintSet &b) const;
 
 private:
-  constraints_ty constraints;
+  /// The last block, holding the most recently added constraints
+  ref<Block> tail;
+  /// The number of constraints in the set
+  size_t count = 0;
+  /// The blocks from the first to tail, built on the first iteration
+  mutable std::vector<const Block *> blocks;
+  /// The partitions of the constraints, built on first use
+  mutable ConstraintPartitions partitions;
+  mutable bool hasPartitions = false;
+
+  void updateBlocks() const;
 };
 
 class ExprVisitor;
@@ -1009,6 +1009,17 @@ private:
 
   ConstantExpr(const llvm::APInt &v) : value(v) {}
 
+  /// Values below this limit of width Bool, Int8, Int16, Int32 and Int64
+  /// are interned: alloc returns a shared instance instead of allocating.
+  static const uint64_t InternedLimit = 256;
+
+  /// Return the interned constant for value v (< InternedLimit) of width w,
+  /// or null if constants of width w are not interned.
+  static ConstantExpr *getInterned(uint64_t v, Width w);
+
+  /// Allocate a constant that is not interned.
+  static ref<ConstantExpr> allocNew(const llvm::APInt &v);
+
 public:
   ~ConstantExpr() {}
 
@@ -1069,9 +1080,12 @@ public:
   void toMemory(void *address);
 
   static ref<ConstantExpr> alloc(const llvm::APInt &v) {
-    ref<ConstantExpr> r(new ConstantExpr(v));
-    r->computeHash();
-    return r;
+    if (v.getBitWidth() <= 64 && v.getZExtValue() < InternedLimit) {
+      if (ConstantExpr *c = getInterned(v.getZExtValue(), v.getBitWidth()))
+        return c;
+    }
+
+    return allocNew(v);
   }
 
   static ref<ConstantExpr> alloc(const llvm::APFloat &f) {
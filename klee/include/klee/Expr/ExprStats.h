@@ -0,0 +1,26 @@
+//===-- ExprStats.h ---------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_EXPRSTATS_H
+#define KLEE_EXPRSTATS_H
+
+#include "klee/Statistics/Statistic.h"
+
+namespace klee {
+namespace stats {
+
+  /// Constant expressions allocated, and those taken from the table of
+  /// interned constants instead of being allocated
+  extern Statistic constantAllocations;
+  extern Statistic internedConstants;
+
+}
+}
+
+#endif /* KLEE_EXPRSTATS_H */
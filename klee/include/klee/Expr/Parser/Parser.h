@@ -20,6 +20,7 @@ namespace llvm {
 }
 
 namespace klee {
+  class ArrayCache;
   class ExprBuilder;
 
 namespace expr {
@@ -230,6 +231,12 @@ namespace expr {
     /// expressions.
     static Parser *Create(const std::string Name, const llvm::MemoryBuffer *MB,
                           ExprBuilder *Builder, bool ClearArrayAfterQuery);
+
+    /// Create a parser that creates its arrays in Cache, so that they
+    /// outlive the parser.
+    static Parser *Create(const std::string Name, const llvm::MemoryBuffer *MB,
+                          ExprBuilder *Builder, ArrayCache *Cache,
+                          bool ClearArrayAfterQuery);
   };
 }
 }
@@ -42,6 +42,14 @@ namespace klee {
     /// Destination register index.
     unsigned dest;
 
+    /// Properties of inst decoded by KModule::manifest, so that the
+    /// interpreter does not have to query the LLVM instruction: the opcode,
+    /// the predicate of comparisons and the size in bits of the result (0
+    /// if it has none).
+    unsigned opcode = 0;
+    unsigned predicate = 0;
+    unsigned width = 0;
+
   public:
     virtual ~KInstruction();
     std::string getSourceLocation() const;
@@ -14,6 +14,7 @@
 #include "klee/System/Time.h"
 #include "klee/Solver/SolverCmdLine.h"
 
+#include <functional>
 #include <vector>
 
 namespace klee {
@@ -21,6 +22,10 @@ namespace klee {
   class Expr;
   class SolverImpl;
 
+  namespace stats {
+  struct SolverLayerStats;
+  }
+
   /// Collection of meta data that a solver can have access to. This is
   /// independent of the actual constraints but can be used as a two-way
   /// communication between solver and context of query.
@@ -207,6 +212,11 @@ namespace klee {
     //
     // FIXME: This should go into a helper class, and should handle failure.
     virtual std::pair< ref<Expr>, ref<Expr> > getRange(const Query&);
+
+    /// speculate - Hint that the truth or validity of the given query, or
+    /// the initial values for it if its expression is false, will probably
+    /// be asked for soon. A solver may start working on it in the background.
+    void speculate(const Query&);
     
     virtual char *getConstraintLog(const Query& query);
     virtual void setCoreSolverTimeout(time::Span timeout);
@@ -243,6 +253,26 @@ namespace klee {
   /// \param s - The underlying solver to use.
   Solver *createCexCachingSolver(Solver *s);
 
+  /// createPersistentCachingSolver - Create a solver which caches the results
+  /// of queries in a file that outlives the process. Queries are looked up
+  /// independent of the names of their arrays and the order of their
+  /// constraints.
+  ///
+  /// \param s - The underlying solver to use.
+  /// \param path - The cache file, which is created if it does not exist.
+  /// \param shared - Whether other processes may use the file at the same
+  /// time, in which case every access locks it.
+  Solver *createPersistentCachingSolver(Solver *s, const std::string &path,
+                                        bool shared);
+
+  /// createCanonicalizingSolver - Create a solver which renames the arrays of
+  /// queries in the order of their first occurrence and sorts their
+  /// constraints by their structure, so that the caches below it see the same
+  /// query for equivalent queries over differently named arrays.
+  ///
+  /// \param s - The underlying solver to use.
+  Solver *createCanonicalizingSolver(Solver *s);
+
   /// createFastCexSolver - Create a "fast counterexample solver", which tries
   /// to quickly compute a satisfying assignment for a constraint set using
   /// value propogation and range analysis.
@@ -256,6 +286,28 @@ namespace klee {
   ///
   /// \param s - The underlying solver to use.
   Solver *createIndependentSolver(Solver *s);
+
+  /// createSpeculativeSolver - Create a solver which solves the queries it is
+  /// asked to speculate on in worker processes, while KLEE goes on, and
+  /// answers them from the results of the workers when they are asked for.
+  ///
+  /// \param s - The underlying solver to use in KLEE.
+  /// \param createWorkerSolver - Creates the underlying solver of a worker,
+  /// in the worker process, so that the workers do not share the memory of
+  /// a forked or pooled solver with KLEE.
+  /// \param numWorkers - The number of worker processes, forked when the
+  /// solver is created.
+  Solver *createSpeculativeSolver(Solver *s,
+                                  std::function<Solver *()> createWorkerSolver,
+                                  unsigned numWorkers);
+
+  /// createInstrumentingSolver - Create a solver which forwards all queries
+  /// to the underlying solver and records their latency, size and whether
+  /// the next instrumented layer below was asked in layer.
+  ///
+  /// \param s - The underlying solver to use.
+  /// \param layer - The statistics of the layer, see stats::addSolverLayer().
+  Solver *createInstrumentingSolver(Solver *s, stats::SolverLayerStats &layer);
   
   /// createKQueryLoggingSolver - Create a solver which will forward all queries
   /// after writing them to the given path in .kquery format.
@@ -274,6 +326,13 @@ namespace klee {
   /// fails.
   Solver *createDummySolver();
 
+  /// createPortfolioSolver - Create a solver that runs each query on all
+  /// the given solvers in parallel worker processes and returns the first
+  /// answer.
+  ///
+  /// \param backends - The solvers to use: "stp", "z3" or "z3:<tactic>".
+  Solver *createPortfolioSolver(const std::vector<std::string> &backends);
+
   // Create a solver based on the supplied ``CoreSolverType``.
   Solver *createCoreSolver(CoreSolverType cst);
 }
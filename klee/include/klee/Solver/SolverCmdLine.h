@@ -28,8 +28,18 @@ extern llvm::cl::opt<bool> UseCexCache;
 
 extern llvm::cl::opt<bool> UseBranchCache;
 
+extern llvm::cl::opt<std::string> PersistentQueryCache;
+
+extern llvm::cl::opt<bool> PersistentQueryCacheShared;
+
+extern llvm::cl::opt<bool> CanonicalizeQueries;
+
 extern llvm::cl::opt<bool> UseIndependentSolver;
 
+extern llvm::cl::opt<unsigned> SpeculativeSolverWorkers;
+
+extern llvm::cl::opt<bool> SolverChainStats;
+
 extern llvm::cl::opt<bool> DebugValidateSolver;
 
 extern llvm::cl::opt<std::string> MinQueryTimeToLog;
@@ -59,6 +69,7 @@ enum CoreSolverType {
   METASMT_SOLVER,
   DUMMY_SOLVER,
   Z3_SOLVER,
+  PORTFOLIO_SOLVER,
   NO_SOLVER
 };
 
@@ -66,6 +77,8 @@ extern llvm::cl::opt<CoreSolverType> CoreSolverToUse;
 
 extern llvm::cl::opt<CoreSolverType> DebugCrossCheckCoreSolverWith;
 
+extern llvm::cl::list<std::string> PortfolioSolvers;
+
 #ifdef ENABLE_METASMT
 
 enum MetaSMTBackendType {
@@ -107,6 +107,12 @@ namespace klee {
     }
 
     virtual void setCoreSolverTimeout(time::Span timeout) {};
+
+    /// \sa Solver::speculate()
+    ///
+    /// Solvers that transform queries forward the transformed query, caches
+    /// drop it if they hold the answer. SolverImpl ignores the hint.
+    virtual void speculate(const Query& query) {}
 };
 
 }
@@ -10,22 +10,73 @@
 #ifndef KLEE_SOLVERSTATS_H
 #define KLEE_SOLVERSTATS_H
 
+#include "klee/Statistics/LatencyHistogram.h"
 #include "klee/Statistics/Statistic.h"
 
+#include <cstdint>
+#include <deque>
+#include <string>
+
 namespace klee {
 namespace stats {
 
+  extern Statistic canonicalizationTime;
   extern Statistic cexCacheTime;
+  extern Statistic incrementalConstraintsAsserted;
+  extern Statistic incrementalConstraintsReused;
+  extern Statistic persistentCacheHits;
+  extern Statistic persistentCacheMisses;
+  extern Statistic portfolioWinsSTP;
+  extern Statistic portfolioWinsZ3;
+  extern Statistic portfolioWinsZ3Tactic;
   extern Statistic queries;
   extern Statistic queriesInvalid;
   extern Statistic queriesValid;
   extern Statistic queryCacheHits;
   extern Statistic queryCacheMisses;
+  extern Statistic queryCexCacheEvictions;
   extern Statistic queryCexCacheHits;
   extern Statistic queryCexCacheMisses;
   extern Statistic queryConstructs;
   extern Statistic queryCounterexamples;
   extern Statistic queryTime;
+  extern Statistic solverWorkerSpawns;
+  extern Statistic speculativeHits;
+  extern Statistic speculativeQueries;
+
+  /// The durations of counterexample cache lookups, in nanoseconds
+  extern LatencyHistogram cexCacheLookupTime;
+
+  /// The statistics of one layer of a solver chain built with
+  /// -solver-chain-stats, see createInstrumentingSolver()
+  struct SolverLayerStats {
+    std::string name;
+    /// The instrumented layer this one asks, or null for the core solver
+    const SolverLayerStats *next;
+    /// The number of instrumented layers below this one
+    unsigned depth;
+
+    std::uint64_t queries = 0;
+    /// The queries answered without asking the next layer
+    std::uint64_t hits = 0;
+    /// The time spent in this layer and the layers below it, in nanoseconds
+    std::uint64_t time = 0;
+    /// The expression nodes of the queries, each shared node counted once
+    std::uint64_t exprNodes = 0;
+    /// The latencies of the queries since the last clear(), in nanoseconds
+    LatencyHistogram latency;
+
+    SolverLayerStats(const std::string &name, const SolverLayerStats *next)
+        : name(name), next(next), depth(next ? next->depth + 1 : 0) {}
+  };
+
+  /// The layers of all instrumented solver chains, in the order they were
+  /// added
+  extern std::deque<SolverLayerStats> solverLayers;
+
+  /// Adds a layer on top of next, which is null for the core solver.
+  SolverLayerStats &addSolverLayer(const std::string &name,
+                                   const SolverLayerStats *next);
   
 #ifdef KLEE_ARRAY_DEBUG
   extern Statistic arrayHashTime;
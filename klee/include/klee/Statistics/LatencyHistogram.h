@@ -0,0 +1,74 @@
+//===-- LatencyHistogram.h --------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_LATENCYHISTOGRAM_H
+#define KLEE_LATENCYHISTOGRAM_H
+
+#include <array>
+#include <cstdint>
+
+namespace klee {
+
+/// Counts durations (or any other non-negative values) in log-scale buckets.
+/// Each power of two is split into SubBuckets linear buckets, so a percentile
+/// is accurate to within 1/SubBuckets of its value while the histogram has a
+/// fixed size that covers all 64-bit values.
+class LatencyHistogram {
+public:
+  static constexpr unsigned SubBucketBits = 3;
+  static constexpr unsigned SubBuckets = 1u << SubBucketBits;
+  static constexpr unsigned NumBuckets =
+      (64 - SubBucketBits + 1) * SubBuckets;
+
+  /// Adds value n times.
+  void add(std::uint64_t value, std::uint64_t n = 1) {
+    buckets[getBucket(value)] += n;
+    count += n;
+  }
+
+  /// Adds the values of other.
+  void merge(const LatencyHistogram &other) {
+    for (unsigned b = 0; b < NumBuckets; b++)
+      buckets[b] += other.buckets[b];
+    count += other.count;
+  }
+
+  /// Returns the number of values added since the last clear().
+  std::uint64_t getCount() const { return count; }
+
+  /// Returns the upper bound of the bucket holding the value that p percent
+  /// of the values are at most, or 0 for an empty histogram.
+  std::uint64_t getPercentile(double p) const;
+
+  void clear() {
+    buckets.fill(0);
+    count = 0;
+  }
+
+  std::uint64_t getBucketCount(unsigned bucket) const {
+    return buckets[bucket];
+  }
+
+  /// Returns the bucket of value.
+  static unsigned getBucket(std::uint64_t value);
+
+  /// Returns the smallest value of bucket.
+  static std::uint64_t getBucketLowerBound(unsigned bucket);
+
+  /// Returns the largest value of bucket.
+  static std::uint64_t getBucketUpperBound(unsigned bucket);
+
+private:
+  std::array<std::uint64_t, NumBuckets> buckets{};
+  std::uint64_t count = 0;
+};
+
+} // namespace klee
+
+#endif /* KLEE_LATENCYHISTOGRAM_H */
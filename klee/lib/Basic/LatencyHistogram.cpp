@@ -0,0 +1,59 @@
+//===-- LatencyHistogram.cpp ----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Statistics/LatencyHistogram.h"
+
+#include <cassert>
+#include <cmath>
+
+using namespace klee;
+
+// Values below 2 * SubBuckets have a bucket each. Above, the bucket is given
+// by the position of the highest set bit and the SubBucketBits bits after it.
+unsigned LatencyHistogram::getBucket(std::uint64_t value) {
+  if (value < 2 * SubBuckets)
+    return value;
+
+  unsigned exponent = 63 - __builtin_clzll(value);
+  unsigned sub = (value >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+  return (exponent - SubBucketBits + 1) * SubBuckets + sub;
+}
+
+std::uint64_t LatencyHistogram::getBucketLowerBound(unsigned bucket) {
+  assert(bucket < NumBuckets && "invalid bucket");
+  if (bucket < 2 * SubBuckets)
+    return bucket;
+
+  unsigned exponent = bucket / SubBuckets + SubBucketBits - 1;
+  std::uint64_t sub = bucket % SubBuckets;
+  return (SubBuckets + sub) << (exponent - SubBucketBits);
+}
+
+std::uint64_t LatencyHistogram::getBucketUpperBound(unsigned bucket) {
+  if (bucket + 1 == NumBuckets)
+    return UINT64_MAX;
+  return getBucketLowerBound(bucket + 1) - 1;
+}
+
+std::uint64_t LatencyHistogram::getPercentile(double p) const {
+  if (!count)
+    return 0;
+
+  auto rank = static_cast<std::uint64_t>(std::ceil(p / 100 * count));
+  if (rank == 0)
+    rank = 1;
+
+  std::uint64_t seen = 0;
+  for (unsigned b = 0; b < NumBuckets; b++) {
+    seen += buckets[b];
+    if (seen >= rank)
+      return getBucketUpperBound(b);
+  }
+  return getBucketUpperBound(NumBuckets - 1);
+}
@@ -15,21 +15,52 @@
 
 #include "klee/Expr/Expr.h"
 #include "klee/Statistics/TimerStatIncrementer.h"
+#include "klee/Support/OptionCategories.h"
 
 #include "CoreStats.h"
 
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+
+using namespace llvm;
 using namespace klee;
 
+namespace {
+cl::opt<bool> UseResolutionCache(
+    "use-resolution-cache", cl::init(true),
+    cl::desc("Cache the objects that concrete addresses resolve to in each "
+             "state (default=true)"),
+    cl::cat(MiscCat));
+}
+
 ///
 
+void AddressSpace::updateResolutionCache(const MemoryObject *mo,
+                                         const ObjectState *os) {
+  for (auto &entry : resolutionCache) {
+    if (entry.mo == mo) {
+      if (os) {
+        entry.os = os;
+      } else {
+        entry = ResolutionCacheEntry();
+      }
+    }
+  }
+}
+
 void AddressSpace::bindObject(const MemoryObject *mo, ObjectState *os) {
   assert(os->copyOnWriteOwner==0 && "object already has owner");
   os->copyOnWriteOwner = cowKey;
   objects = objects.replace(std::make_pair(mo, os));
+  updateResolutionCache(mo, os);
 }
 
 void AddressSpace::unbindObject(const MemoryObject *mo) {
   objects = objects.remove(mo);
+  updateResolutionCache(mo, nullptr);
 }
 
 const ObjectState *AddressSpace::findObject(const MemoryObject *mo) const {
@@ -49,6 +80,7 @@ ObjectState *AddressSpace::getWriteable(const MemoryObject *mo,
   ref<ObjectState> newObjectState(new ObjectState(*os));
   newObjectState->copyOnWriteOwner = cowKey;
   objects = objects.replace(std::make_pair(mo, newObjectState));
+  updateResolutionCache(mo, newObjectState.get());
   return newObjectState.get();
 }
 
@@ -57,6 +89,19 @@ ObjectState *AddressSpace::getWriteable(const MemoryObject *mo,
 bool AddressSpace::resolveOne(const ref<ConstantExpr> &addr, 
                               ObjectPair &result) const {
   uint64_t address = addr->getZExtValue();
+
+  ResolutionCacheEntry *entry = nullptr;
+  if (UseResolutionCache) {
+    entry = &resolutionCache[resolutionCacheIndex(address)];
+    if (entry->mo && address - entry->mo->address < entry->mo->size) {
+      ++stats::resolutionCacheHits;
+      result.first = entry->mo;
+      result.second = entry->os;
+      return true;
+    }
+    ++stats::resolutionCacheMisses;
+  }
+
   MemoryObject hack(address);
 
   if (const auto res = objects.lookup_previous(&hack)) {
@@ -67,6 +112,9 @@ bool AddressSpace::resolveOne(const ref<ConstantExpr> &addr,
         (address - mo->address < mo->size)) {
       result.first = res->first;
       result.second = res->second.get();
+      // 0-sized objects are never found in the cache, do not evict for them
+      if (entry && mo->size)
+        *entry = {result.first, result.second};
       return true;
     }
   }
@@ -297,19 +345,41 @@ bool AddressSpace::resolve(ExecutionState &state, TimingSolver *solver,
 // transparently avoid screwing up symbolics (if the byte is symbolic
 // then its concrete cache byte isn't being used) but is just a hack.
 
+/// Fixed objects (errno, stdio, ...) live in host memory that the host itself
+/// changes, so they are never assumed to hold a copy of their state.
+static bool isHostCopy(const MemoryObject *mo, const ObjectState *os) {
+  return !mo->isFixed && mo->hostVersion == os->getVersion();
+}
+
+static void setHostCopy(const MemoryObject *mo, const ObjectState *os) {
+  mo->hostVersion = os->getVersion();
+}
+
+void AddressSpace::copyOutConcrete(const MemoryObject *mo,
+                                   const ObjectState *os) const {
+  if (!mo->isUserSpecified && !os->readOnly && !isHostCopy(mo, os)) {
+    auto address = reinterpret_cast<std::uint8_t*>(mo->address);
+    os->concreteStore.copyTo(address);
+    setHostCopy(mo, os);
+  }
+}
+
 void AddressSpace::copyOutConcretes() {
-  for (MemoryMap::iterator it = objects.begin(), ie = objects.end(); 
-       it != ie; ++it) {
-    const MemoryObject *mo = it->first;
+  for (auto &obj : objects)
+    copyOutConcrete(obj.first, obj.second.get());
+}
 
-    if (!mo->isUserSpecified) {
-      const auto &os = it->second;
-      auto address = reinterpret_cast<std::uint8_t*>(mo->address);
+void AddressSpace::copyOutConcretes(const ResolutionList &rl) const {
+  for (auto &op : rl)
+    copyOutConcrete(op.first, op.second);
+}
 
-      if (!os->readOnly)
-        memcpy(address, os->concreteStore, mo->size);
-    }
+bool AddressSpace::isAllConcrete() const {
+  for (auto &obj : objects) {
+    if (!obj.second->isAllConcrete())
+      return false;
   }
+  return true;
 }
 
 bool AddressSpace::copyInConcretes() {
@@ -327,17 +397,88 @@ bool AddressSpace::copyInConcretes() {
   return true;
 }
 
+bool AddressSpace::copyInConcretes(const ResolutionList &rl) {
+  for (auto &op : rl) {
+    if (!op.first->isUserSpecified &&
+        !copyInConcrete(op.first, op.second, op.first->address))
+      return false;
+  }
+
+  return true;
+}
+
+void AddressSpace::invalidateHostCopies() {
+  for (auto &obj : objects)
+    obj.first->hostVersion = 0;
+}
+
+void AddressSpace::invalidateHostCopies(const ResolutionList &rl) const {
+  for (auto &op : rl)
+    op.first->hostVersion = 0;
+}
+
+bool AddressSpace::getReachableObjects(const std::vector<uint64_t> &roots,
+                                       ResolutionList &rl) const {
+  std::set<const MemoryObject *> reached;
+  std::size_t scanned = rl.size();
+
+  auto reach = [&](uint64_t address) {
+    for (uint64_t a : {address, address - 1}) {
+      MemoryObject hack(a);
+      const auto res = objects.lookup_previous(&hack);
+      if (!res || a - res->first->address >= res->first->size)
+        continue;
+      if (reached.insert(res->first).second)
+        rl.emplace_back(res->first, res->second.get());
+      return;
+    }
+  };
+
+  for (uint64_t address : roots)
+    reach(address);
+
+  std::array<std::uint8_t, 4096> buffer;
+  for (; scanned < rl.size(); ++scanned) {
+    const MemoryObject *mo = rl[scanned].first;
+    const ObjectState *os = rl[scanned].second;
+    if (!os->isAllConcrete())
+      return false;
+
+    // the words are aligned in host memory
+    unsigned offset = -mo->address % sizeof(uintptr_t);
+    while (offset + sizeof(uintptr_t) <= os->size) {
+      unsigned n = std::min<unsigned>(buffer.size(), os->size - offset);
+      n -= n % sizeof(uintptr_t);
+      os->concreteStore.read(offset, buffer.data(), n);
+      for (unsigned i = 0; i < n; i += sizeof(uintptr_t)) {
+        uintptr_t word;
+        std::memcpy(&word, &buffer[i], sizeof(word));
+        reach(word);
+      }
+      offset += n;
+    }
+  }
+
+  return true;
+}
+
 bool AddressSpace::copyInConcrete(const MemoryObject *mo, const ObjectState *os,
                                   uint64_t src_address) {
   auto address = reinterpret_cast<std::uint8_t*>(src_address);
-  if (memcmp(address, os->concreteStore, mo->size) != 0) {
+  if (!os->concreteStore.equals(address)) {
     if (os->readOnly) {
       return false;
     } else {
+      // only the chunks that differ stop being shared
       ObjectState *wos = getWriteable(mo, os);
-      memcpy(wos->concreteStore, address, mo->size);
+      wos->concreteStore.copyFrom(address);
+      wos->updateVersion();
+      os = wos;
     }
   }
+
+  if (src_address == mo->address)
+    setHostCopy(mo, os);
   return true;
 }
 
@@ -16,6 +16,8 @@
 #include "klee/ADT/ImmutableMap.h"
 #include "klee/System/Time.h"
 
+#include <array>
+
 namespace klee {
   class ExecutionState;
   class MemoryObject;
@@ -43,6 +45,36 @@ namespace klee {
     /// Unsupported, use copy constructor
     AddressSpace &operator=(const AddressSpace &);
 
+    /// An entry of the resolution cache: a bound object and its state.
+    struct ResolutionCacheEntry {
+      const MemoryObject *mo = nullptr;
+      const ObjectState *os = nullptr;
+    };
+
+    static constexpr unsigned ResolutionCacheIndexBits = 6;
+    static constexpr unsigned ResolutionCacheSize =
+        1u << ResolutionCacheIndexBits;
+    static constexpr unsigned ResolutionCacheLineBits = 6;
+
+    /// Direct-mapped cache of the objects found by resolveOne for
+    /// concrete addresses, indexed by the 64-byte line of the address.
+    /// Entries are updated whenever the binding of their object changes.
+    mutable std::array<ResolutionCacheEntry, ResolutionCacheSize>
+        resolutionCache;
+
+    /// The resolution cache entry of `address`.  The line is hashed
+    /// multiplicatively, so that buffers which are accessed at the same
+    /// offset, like the source and destination of a copy, do not evict
+    /// each other on every access when they are a power of two apart.
+    static unsigned resolutionCacheIndex(uint64_t address) {
+      uint64_t line = address >> ResolutionCacheLineBits;
+      return (line * 0x9e3779b97f4a7c15ULL) >> (64 - ResolutionCacheIndexBits);
+    }
+
+    /// Update the cached entries of `mo` to `os`, or drop them if `os`
+    /// is null.
+    void updateResolutionCache(const MemoryObject *mo, const ObjectState *os);
+
     /// Check if pointer `p` can point to the memory object in the
     /// given object pair.  If so, add it to the given resolution list.
     ///
@@ -54,6 +86,10 @@ namespace klee {
                              ref<Expr> p, const ObjectPair &op,
                              ResolutionList &rl, unsigned maxResolutions) const;
 
+    /// Copy the concrete values of `os` to the memory of `mo`, unless it
+    /// already holds them.
+    void copyOutConcrete(const MemoryObject *mo, const ObjectState *os) const;
+
   public:
     /// The MemoryObject -> ObjectState map that constitutes the
     /// address space.
@@ -65,7 +101,9 @@ namespace klee {
     MemoryMap objects;
 
     AddressSpace() : cowKey(1) {}
-    AddressSpace(const AddressSpace &b) : cowKey(++b.cowKey), objects(b.objects) { }
+    AddressSpace(const AddressSpace &b)
+        : cowKey(++b.cowKey), resolutionCache(b.resolutionCache),
+          objects(b.objects) {}
     ~AddressSpace() {}
 
     /// Resolve address to an ObjectPair in result.
@@ -125,9 +163,15 @@ namespace klee {
     ObjectState *getWriteable(const MemoryObject *mo, const ObjectState *os);
 
     /// Copy the concrete values of all managed ObjectStates into the
-    /// actual system memory location they were allocated at.
+    /// actual system memory location they were allocated at. Objects
+    /// whose host memory already holds the same version of the
+    /// ObjectState are skipped.
     void copyOutConcretes();
 
+    /// Copy the concrete values of the given objects out, as
+    /// copyOutConcretes does for all of them.
+    void copyOutConcretes(const ResolutionList &rl) const;
+
     /// Copy the concrete values of all managed ObjectStates back from
     /// the actual system memory location they were allocated
     /// at. ObjectStates will only be written to (and thus,
@@ -138,6 +182,33 @@ namespace klee {
     /// \retval false The copy failed because a read-only object was modified.
     bool copyInConcretes();
 
+    /// Copy the concrete values of the given objects back in, as
+    /// copyInConcretes does for all of them.
+    bool copyInConcretes(const ResolutionList &rl);
+
+    /// Check if no managed object has a symbolic byte.
+    bool isAllConcrete() const;
+
+    /// Forget which ObjectStates the host memory of the managed objects
+    /// holds, e.g. after an external call that did not return normally.
+    void invalidateHostCopies();
+    void invalidateHostCopies(const ResolutionList &rl) const;
+
+    /// Collect in `rl` the objects that host code can reach from the
+    /// addresses in `roots`: the objects holding them and, in turn, the
+    /// objects that the pointer-sized words of those objects point into.
+    /// A pointer just past the end of an object reaches the object.
+    ///
+    /// Only words at pointer-aligned host addresses are read as pointers, so
+    /// objects are missed when the only pointer to them is stored unaligned
+    /// (e.g. in a packed struct), or is kept in another form, e.g. as an
+    /// offset or with tag bits. Callers must copy all objects out when the
+    /// code may follow such pointers.
+    ///
+    /// \return false if one of the reached objects has a symbolic byte.
+    bool getReachableObjects(const std::vector<uint64_t> &roots,
+                             ResolutionList &rl) const;
+
     /// Updates the memory object with the raw memory from the address
     ///
     /// @param mo The MemoryObject to update
@@ -19,9 +19,16 @@ Statistic stats::forks("Forks", "Forks");
 Statistic stats::instructionRealTime("InstructionRealTimes", "Ireal");
 Statistic stats::instructionTime("InstructionTimes", "Itime");
 Statistic stats::instructions("Instructions", "I");
+Statistic stats::nativeCalls("NativeCalls", "Ncalls");
+Statistic stats::libcFastPaths("LibcFastPaths", "Lfast");
 Statistic stats::minDistToReturn("MinDistToReturn", "Rdist");
 Statistic stats::minDistToUncovered("MinDistToUncovered", "UCdist");
+Statistic stats::registerAllocations("RegisterAllocations", "Ralloc");
+Statistic stats::reusedRegisterAllocations("ReusedRegisterAllocations",
+                                           "Rreused");
 Statistic stats::resolveTime("ResolveTime", "Rtime");
+Statistic stats::resolutionCacheHits("ResolutionCacheHits", "RChits");
+Statistic stats::resolutionCacheMisses("ResolutionCacheMisses", "RCmisses");
 Statistic stats::solverTime("SolverTime", "Stime");
 Statistic stats::states("States", "States");
 Statistic stats::trueBranches("TrueBranches", "Bt");
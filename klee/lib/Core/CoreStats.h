@@ -17,7 +17,16 @@ namespace stats {
 
   extern Statistic allocations;
   extern Statistic resolveTime;
+  extern Statistic resolutionCacheHits;
+  extern Statistic resolutionCacheMisses;
   extern Statistic instructions;
+  extern Statistic libcFastPaths;
+  extern Statistic nativeCalls;
+
+  /// Allocations of register files and their registers, and how many of them
+  /// reused freed storage.
+  extern Statistic registerAllocations;
+  extern Statistic reusedRegisterAllocations;
   extern Statistic instructionTime;
   extern Statistic instructionRealTime;
   extern Statistic coveredInstructions;
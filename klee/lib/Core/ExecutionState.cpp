@@ -9,6 +9,8 @@
 
 #include "ExecutionState.h"
 
+#include "CoreStats.h"
+
 #include "Memory.h"
 
 #include "klee/Expr/Expr.h"
@@ -23,9 +25,11 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iomanip>
 #include <map>
+#include <memory>
 #include <set>
 #include <sstream>
 #include <stdarg.h>
@@ -46,31 +50,97 @@ std::uint32_t ExecutionState::nextID = 1;
 
 /***/
 
-StackFrame::StackFrame(KInstIterator _caller, KFunction *_kf)
-  : caller(_caller), kf(_kf), callPathNode(0), 
-    minDistToUncoveredOnReturn(0),
-    varargs(0) {
-  locals = new Cell[kf->numRegisters];
+namespace {
+/// A free list of memory blocks of one size. Blocks are returned to the
+/// system allocator only at exit.
+class FreeList {
+  struct Block {
+    Block *next;
+  };
+  Block *head = nullptr;
+
+public:
+  ~FreeList() {
+    while (head) {
+      Block *block = head;
+      head = block->next;
+      ::operator delete(block);
+    }
+  }
+
+  void *allocate(std::size_t size) {
+    ++stats::registerAllocations;
+    if (!head)
+      return ::operator new(std::max(size, sizeof(Block)));
+
+    ++stats::reusedRegisterAllocations;
+    Block *block = head;
+    head = block->next;
+    return block;
+  }
+
+  void deallocate(void *p) {
+    Block *block = static_cast<Block *>(p);
+    block->next = head;
+    head = block;
+  }
+};
+
+// register files and their cells are shared between states, so the free
+// lists are global rather than per state
+FreeList registerFileList;
+// cell arrays by size class, class c holding at most 2^c cells
+FreeList cellLists[32];
+
+unsigned getSizeClass(unsigned size) {
+  unsigned sizeClass = 3;
+  while ((1u << sizeClass) < size)
+    sizeClass++;
+  return sizeClass;
+}
+
+Cell *allocateCells(unsigned size) {
+  unsigned sizeClass = getSizeClass(size);
+  return static_cast<Cell *>(
+      cellLists[sizeClass].allocate(sizeof(Cell) << sizeClass));
 }
+} // namespace
 
-StackFrame::StackFrame(const StackFrame &s) 
-  : caller(s.caller),
-    kf(s.kf),
-    callPathNode(s.callPathNode),
-    allocas(s.allocas),
-    minDistToUncoveredOnReturn(s.minDistToUncoveredOnReturn),
-    varargs(s.varargs) {
-  locals = new Cell[s.kf->numRegisters];
-  for (unsigned i=0; i<s.kf->numRegisters; i++)
-    locals[i] = s.locals[i];
+RegisterFile::RegisterFile(unsigned size)
+    : size(size), cells(allocateCells(size)) {
+  std::uninitialized_fill(cells, cells + size, Cell());
 }
 
-StackFrame::~StackFrame() { 
-  delete[] locals; 
+RegisterFile::RegisterFile(const RegisterFile &rf)
+    : size(rf.size), cells(allocateCells(rf.size)) {
+  std::uninitialized_copy(rf.cells, rf.cells + size, cells);
+}
+
+RegisterFile::~RegisterFile() {
+  for (unsigned i = 0; i < size; i++)
+    cells[i].~Cell();
+  cellLists[getSizeClass(size)].deallocate(cells);
+}
+
+void *RegisterFile::operator new(std::size_t size) {
+  assert(size == sizeof(RegisterFile));
+  return registerFileList.allocate(size);
+}
+
+void RegisterFile::operator delete(void *p) {
+  registerFileList.deallocate(p);
 }
 
 /***/
 
+StackFrame::StackFrame(KInstIterator _caller, KFunction *_kf)
+  : caller(_caller), kf(_kf), callPathNode(0), 
+    locals(new RegisterFile(kf->numRegisters)),
+    minDistToUncoveredOnReturn(0),
+    varargs(0) {}
+
+/***/
+
 ExecutionState::ExecutionState(KFunction *kf)
     : pc(kf->instructions), prevPC(pc) {
   pushFrame(nullptr, kf);
@@ -118,10 +188,14 @@ ExecutionState::ExecutionState(const ExecutionState& state):
 ExecutionState *ExecutionState::branch() {
   depth++;
 
+  // the new state starts without covered lines, so do not copy them
+  std::map<const std::string *, std::set<std::uint32_t>> covered;
+  std::swap(covered, coveredLines);
   auto *falseState = new ExecutionState(*this);
+  std::swap(covered, coveredLines);
+
   falseState->setID();
   falseState->coveredNew = false;
-  falseState->coveredLines.clear();
 
   return falseState;
 }
@@ -281,13 +355,14 @@ bool ExecutionState::merge(const ExecutionState &b) {
     StackFrame &af = *itA;
     const StackFrame &bf = *itB;
     for (unsigned i=0; i<af.kf->numRegisters; i++) {
-      ref<Expr> &av = af.locals[i].value;
-      const ref<Expr> &bv = bf.locals[i].value;
+      const ref<Expr> &av = af.getLocal(i).value;
+      const ref<Expr> &bv = bf.getLocal(i).value;
       if (!av || !bv) {
         // if one is null then by implication (we are at same pc)
         // we cannot reuse this local, so just ignore
       } else {
-        av = SelectExpr::create(inA, av, bv);
+        ref<Expr> select = SelectExpr::create(inA, av, bv);
+        af.getWriteableLocal(i).value = select;
       }
     }
   }
@@ -342,7 +417,7 @@ void ExecutionState::dumpStack(llvm::raw_ostream &out) const {
       if (ai->hasName())
         out << ai->getName().str() << "=";
 
-      ref<Expr> value = sf.locals[sf.kf->getArgRegister(index++)].value;
+      ref<Expr> value = sf.getLocal(sf.kf->getArgRegister(index++)).value;
       if (isa_and_nonnull<ConstantExpr>(value)) {
         out << value;
       } else {
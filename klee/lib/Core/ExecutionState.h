@@ -17,10 +17,12 @@
 #include "klee/ADT/TreeStream.h"
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
+#include "klee/Module/Cell.h"
 #include "klee/Module/KInstIterator.h"
 #include "klee/Solver/Solver.h"
 #include "klee/System/Time.h"
 
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/Function.h"
 
 #include <map>
@@ -33,7 +35,6 @@
 namespace klee {
 class Array;
 class CallPathNode;
-struct Cell;
 struct KFunction;
 struct KInstruction;
 class MemoryObject;
@@ -42,13 +43,33 @@ struct InstructionInfo;
 
 llvm::raw_ostream &operator<<(llvm::raw_ostream &os, const MemoryMap &mm);
 
+/// The registers of a stack frame. Copies of a frame share them until one of
+/// the copies writes to a register.
+struct RegisterFile {
+  /// @brief Required by klee::ref-managed objects
+  class ReferenceCounter _refCount;
+
+  const unsigned size;
+  /// Taken from free lists by size class, as register files are created and
+  /// destroyed on every call and return
+  Cell *const cells;
+
+  explicit RegisterFile(unsigned size);
+  RegisterFile(const RegisterFile &rf);
+  RegisterFile &operator=(const RegisterFile &) = delete;
+  ~RegisterFile();
+
+  static void *operator new(std::size_t size);
+  static void operator delete(void *p);
+};
+
 struct StackFrame {
   KInstIterator caller;
   KFunction *kf;
   CallPathNode *callPathNode;
 
-  std::vector<const MemoryObject *> allocas;
-  Cell *locals;
+  llvm::SmallVector<const MemoryObject *, 4> allocas;
+  ref<RegisterFile> locals;
 
   /// Minimum distance to an uncovered instruction once the function
   /// returns. This is not a good place for this but is used to
@@ -65,8 +86,16 @@ struct StackFrame {
   MemoryObject *varargs;
 
   StackFrame(KInstIterator caller, KFunction *kf);
-  StackFrame(const StackFrame &s);
-  ~StackFrame();
+
+  const Cell &getLocal(unsigned index) const { return locals->cells[index]; }
+
+  /// Returns the register for writing, copying the registers of the frame
+  /// first if they are shared with another copy of it.
+  Cell &getWriteableLocal(unsigned index) {
+    if (locals->_refCount.getCount() > 1)
+      locals = new RegisterFile(*locals);
+    return locals->cells[index];
+  }
 };
 
 /// Contains information related to unwinding (Itanium ABI/2-Phase unwinding)
@@ -184,7 +213,8 @@ public:
   /// @brief Address space used by this state (e.g. Global and Heap)
   AddressSpace addressSpace;
 
-  /// @brief Constraints collected so far
+  /// @brief Constraints collected so far, with their independent partitions
+  /// kept up to date by addConstraint and shared with forked states
   ConstraintSet constraints;
 
   /// Statistics and information
@@ -201,6 +231,7 @@ public:
   TreeOStream symPathOS;
 
   /// @brief Set containing which lines in which files are covered by this state
+  /// (a state created by branch() starts with an empty set)
   std::map<const std::string *, std::set<std::uint32_t>> coveredLines;
 
   /// @brief Pointer to the process tree of the current state
@@ -217,7 +248,7 @@ public:
   ImmutableSet<ref<Expr>> cexPreferences;
 
   /// @brief Set of used array names for this state.  Used to avoid collisions.
-  std::set<std::string> arrayNames;
+  ImmutableSet<std::string> arrayNames;
 
   /// @brief The objects handling the klee_open_merge calls this state ran through
   std::vector<ref<MergeHandler>> openMergeStack;
@@ -261,7 +292,7 @@ public:
   std::vector<branchInfo *> branchInfos;
   
   // runtime values (instID to values )
-  std::unordered_map<unsigned, unsigned> storeValues;
+  std::unordered_map<unsigned, uint64_t> storeValues;
 
 // ------------------------------------------------------------------------------------------------
 
@@ -25,6 +25,9 @@
 #include "TimingSolver.h"
 #include "UserSearcher.h"
 
+#include "DependencyIndex.h"
+#include "InterproceduralDependencyAnalysis.h"
+
 #include "klee/ADT/KTest.h"
 #include "klee/ADT/RNG.h"
 #include "klee/Config/Version.h"
@@ -65,7 +68,9 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/InitializePasses.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
@@ -145,6 +150,14 @@ cl::opt<bool> EmitAllErrors(
     cl::cat(TestGenCat));
 
 
+cl::opt<bool> ConcreteFastPath(
+    "concrete-fast-path", cl::init(true),
+    cl::desc("Execute integer arithmetic, comparisons, casts and GEPs on "
+             "concrete operands without building expressions "
+             "(default=true)"),
+    cl::cat(MiscCat));
+
+
 /* Constraint solving options */
 
 cl::opt<unsigned> MaxSymArraySize(
@@ -208,6 +221,16 @@ cl::opt<bool> AllExternalWarnings(
              "as opposed to once per function (default=false)"),
     cl::cat(ExtCallsCat));
 
+cl::opt<bool> NativeCalls(
+    "native-calls",
+    cl::init(false),
+    cl::desc("Run calls to defined functions natively when their arguments "
+             "and the memory they can reach are concrete and they only "
+             "call other defined functions. The native code is neither "
+             "checked for memory errors nor counted for coverage, and cannot "
+             "be interrupted (default=false)"),
+    cl::cat(ExtCallsCat));
+
 
 /*** Seeding options ***/
 
@@ -382,6 +405,12 @@ cl::opt<bool> covStats(
     cl::desc("Conduct coverage analysis on symbolic/concrete branches"));
 
 // for cgs searcher
+cl::opt<bool> RunIDA(
+    "cgs-run-ida",
+    cl::desc("Run the inter-procedural dependency analysis on the loaded module, "
+             "instead of reading its results from metadata (default=true)"),
+    cl::init(true));
+
 cl::opt<unsigned> TargetBranchNum(
     "target-branch-num",
     cl::desc("The number of target branches (default=10)"),
@@ -525,6 +554,8 @@ Executor::setModule(std::vector<std::unique_ptr<llvm::Module>> &modules,
          "can only register one module"); // XXX gross
 
   kmodule = std::unique_ptr<KModule>(new KModule());
+  specialFunctionHandler = new SpecialFunctionHandler(*this);
+  specialFunctionHandler->recordProgramDefinitions(*modules[0]);
 
   // Preparing the final module happens in multiple stages
 
@@ -548,7 +579,6 @@ Executor::setModule(std::vector<std::unique_ptr<llvm::Module>> &modules,
 
   // Create a list of functions that should be preserved if used
   std::vector<const char *> preservedFunctions;
-  specialFunctionHandler = new SpecialFunctionHandler(*this);
   specialFunctionHandler->prepare(preservedFunctions);
 
   preservedFunctions.push_back(opts.EntryPoint.c_str());
@@ -562,6 +592,15 @@ Executor::setModule(std::vector<std::unique_ptr<llvm::Module>> &modules,
   kmodule->optimiseAndPrepare(opts, preservedFunctions);
   kmodule->checkModule();
 
+  // Find branch-related StoreInsts on the final module, before manifesting it
+  ida::DependencyIndex dependencyIndex;
+  if (!covStats && userSearcherRequiresCGS()) {
+    if (RunIDA)
+      runDependencyAnalysis(dependencyIndex);
+    else
+      ida::readDependencyMetaData(*kmodule->module, dependencyIndex);
+  }
+
   // 4.) Manifest the module
   kmodule->manifest(interpreterHandler, StatsTracker::useStatistics());
 
@@ -590,156 +629,131 @@ Executor::setModule(std::vector<std::unique_ptr<llvm::Module>> &modules,
   targetBranchNum = TargetBranchNum;
 
   // 5.) Load branch-related StoreInsts
-  for (auto &F: *kmodule->module) {
-    SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
-    F.getAllMetadata(MDs);
-
-    // get StoreInst ID
-    for (auto inst_iter = inst_begin(&F); inst_iter != inst_end(&F); inst_iter++) {
-      Instruction *I = &(*inst_iter);
-      if (auto *SI = dyn_cast<StoreInst>(I)) {
-        MDNode* N_SID = (*SI).getMetadata("sid");
-        if (!N_SID)
-          continue;
+  loadBranchDependencies(dependencyIndex);
 
-        std::string sid_s = cast<MDString>(N_SID->getOperand(0))->getString().str();
-        unsigned sid = stoi(sid_s);
-        ID2SI[sid] = SI;
-        SI2ID[SI] = sid;
+  klee_message("Fing %lu branches", _BDDep.size());
+  klee_message("Find %lu branch-related StoreInsts", storetTobranches.size());
+  
+// ------------------------------------------------------------------------------------------------
+
+  return kmodule->module.get();
+}
+
+void Executor::runDependencyAnalysis(ida::DependencyIndex &index) {
+  PassRegistry &registry = *PassRegistry::getPassRegistry();
+  initializeCore(registry);
+  initializeAnalysis(registry);
+
+  auto start = time::getWallTime();
+  legacy::PassManager pm;
+  auto *analysis = ida::InterproceduralDependencyAnalysis::addInProcess(
+      pm, interpreterHandler->getOutputFilename("ida.txt"));
+  pm.run(*kmodule->module);
+
+  // the pass manager owns the analysis
+  index = analysis->getDependencyIndex();
+  klee_message("Inter-procedural dependency analysis takes %.2fs",
+               (time::getWallTime() - start).toSeconds());
+}
 
-        // outs() << "sid: " << sid << *SI << "\n";
-      }  
+void Executor::loadBranchDependencies(const ida::DependencyIndex &index) {
+  // load StoreInst IDs
+  for (auto &it: index.stores) {
+    ID2SI[it.first] = it.second;
+    SI2ID[it.second] = it.first;
+  }
+
+  // KInstructions of branch conditions
+  std::unordered_map<Instruction *, KInstruction *> kconds;
+  for (auto &branch: index.branches) {
+    if (auto *BI = dyn_cast<BranchInst>(branch.inst)) {
+      if (auto *cond = dyn_cast<Instruction>(BI->getCondition()))
+        kconds[cond] = nullptr;
+    }
+  }
+  for (auto &kf: kmodule->functions) {
+    for (unsigned i = 0; i < kf->numInstructions; ++i) {
+      auto it = kconds.find(kf->instructions[i]->inst);
+      if (it != kconds.end())
+        it->second = kf->instructions[i];
     }
   }
 
   // load BI to SI dependencies
-  for (auto &F: *kmodule->module) {
-    std::unordered_set<unsigned> validStores;
-    for (auto inst_iter = inst_begin(&F); inst_iter != inst_end(&F); inst_iter++) {
-      Instruction *I = &(*inst_iter);
-      auto *BI = dyn_cast<BranchInst>(I);
-      auto *SWI = dyn_cast<SwitchInst>(I);
-      if (BI || SWI) {
-        MDNode* N_BID = (*I).getMetadata("bid");
-        if (!N_BID)
-          continue;
+  for (auto &branch: index.branches) {
+    Instruction *I = branch.inst;
+    auto *BI = dyn_cast<BranchInst>(I);
+    auto *SWI = dyn_cast<SwitchInst>(I);
+    if (!BI && !SWI)
+      continue;
 
-        BDDep *bdDep = new BDDep();
+    BDDep *bdDep = new BDDep();
+
+    // 1. load branch id
+    unsigned bid = branch.id;
+
+    // record branch condition, which is normalized by IDA
+    if (BI) {
+      bdDep->type = 0;
+      bdDep->cond = dyn_cast<ICmpInst>(BI->getCondition());
+      if (bdDep->cond && branch.pred && kconds[bdDep->cond]) {
+        bdDep->kcond = kconds[bdDep->cond];
+        bdDep->pred = branch.pred;
+        bdDep->var_op = branch.var_op;
+        bdDep->width = bdDep->cond->getOperand(branch.var_op)->getType()->getIntegerBitWidth();
+        bdDep->constant = branch.constant;
+        bdDep->arith_op = branch.arith_op;
+        bdDep->arith_var = branch.arith_var;
+      }
 
-        // 1. load branch id
-        std::string bid_s = cast<MDString>(N_BID->getOperand(0))->getString().str();
-        unsigned bid = stoi(bid_s);
+      else {
+        // outs() << *cond << " is not an ICMP instruction for br instruction" << "\n";
+        delete bdDep;
+        continue;
+      }
+    }
+    else {
+      bdDep->type = 1;
 
-        // record branch condition
-        Value *cond;
-        if (BI) {
-          bdDep->type = 0;
-          cond = BI->getCondition();
-          bdDep->cond = dyn_cast<ICmpInst>(cond);
-          if (bdDep->cond) {
-            bdDep->pred = bdDep->cond->getUnsignedPredicate();
-          }
+      // fetch all values of cases
+      for (auto c_handler: SWI->cases()) {
+        ConstantInt *CI = c_handler.getCaseValue();
+        bdDep->unCoveredValues.insert(CI->getZExtValue());
+      }
+    }
 
-          else {
-            // outs() << *cond << " is not an ICMP instruction for br instruction" << "\n";
-            continue;
-          }
-        }
-        else {
-          bdDep->type = 1;
+    bdDep->inst = I;
 
-          // fetch all values of cases
-          for (auto c_handler: SWI->cases()) {
-            ConstantInt *CI = c_handler.getCaseValue();
-            signed unCoveredValue = CI->getSExtValue();
-            bdDep->unCoveredValues.insert(unCoveredValue);
-          }
-        }
+    ID2BI[bid] = I;
+    BI2ID[I] = bid;
+    bdDep->id = bid;
 
-        bdDep->inst = I;
+    // 2. load the number of variable
+    bdDep->var_num = branch.vars.size();
 
-        ID2BI[bid] = I;
-        BI2ID[I] = bid;
-        bdDep->id = bid;
+    // 3. load variables
+    Function *F = I->getParent()->getParent();
+    for (auto &var: branch.vars) {
+      for (unsigned sidx = 0; sidx < var.stores.size(); sidx++) {
+        unsigned sid = var.stores[sidx];
+        if (ID2SI.find(sid) != ID2SI.end()) {  // optimize..
+          bdDep->stores.insert(sid);
+          if (var.sides[sidx] != ida::ss_unknown)
+            bdDep->storeSides[sid] = var.sides[sidx];
 
-        /*
-        std::string filePath = "";
-        int lineNumber = -1;
-        const llvm::DebugLoc &debugInfo = I->getDebugLoc();
-        if (debugInfo) {
-          filePath = debugInfo->getFilename().str();
-          lineNumber = debugInfo->getLine();
+          storetTobranches[sid].insert(bid);
+          funcStores[F].insert(ID2SI[sid]);
         }
-        outs() << "[IDA] BD File path: " << filePath << ", line: " << lineNumber << "\n";
-        */
-
-        // 2. load the number of variable
-        MDNode* V_N = (*I).getMetadata("v_num");
-        std::string v_num_s = cast<MDString>(V_N->getOperand(0))->getString().str();
-        unsigned v_num = stoi(v_num_s);
-
-        bdDep->var_num = v_num;
-
-        // 3. load variables
-        // Note that some variables do not contain stores
-        for (unsigned vid = 0; vid < v_num; vid++) {
-
-          // 3.1 load the number of stores. format: v_[vid] = [store_num]
-          std::string label_s_n = "v_" + std::to_string(vid) + "_s_num";
-          MDNode* VSN_N = (*I).getMetadata(label_s_n);
-          if (!VSN_N) {
-            continue;
-          }
-          
-          std::string v_num_s = cast<MDString>(VSN_N->getOperand(0))->getString().str();
-          unsigned v_s_num = stoi(v_num_s);
-
-          // 3.2 for each variable, load stores
-          for (unsigned sidx = 0; sidx < v_s_num; sidx++) {
-
-            // format: s_[vid]_[s_idx] = [sid]
-            std::string label_id = "s_" + std::to_string(vid) + "_" + std::to_string(sidx);
-            MDNode* VSID_N = (*I).getMetadata(label_id);
-            std::string sid_s = cast<MDString>(VSID_N->getOperand(0))->getString().str();
-            unsigned sid = stoi(sid_s);
-
-            if (ID2SI.find(sid) != ID2SI.end()) {  // optimize..
-              // bvsDep->stores.insert(sid);
-              bdDep->stores.insert(sid);
-              
-              storetTobranches[sid].insert(bid);
-              funcStores[&F].insert(ID2SI[sid]);
-
-              /*
-              std::string filePath = "";
-              int lineNumber = -1;
-              const llvm::DebugLoc &debugInfo = ID2SI[sid]->getDebugLoc();
-              if (debugInfo) {
-                filePath = debugInfo->getFilename().str();
-                lineNumber = debugInfo->getLine();
-              }
-              outs() << "[IDA] SD File path: " << filePath << ", line: " << lineNumber << "\n";
-              */
-            }
-          }
-          if (bdDep->stores.size() > 1) {
-            for (auto sid: bdDep->stores) {
-              storesWithSameVar[sid] = bdDep->stores;
-            }
-          }
+      }
+      if (bdDep->stores.size() > 1) {
+        for (auto sid: bdDep->stores) {
+          storesWithSameVar[sid] = bdDep->stores;
         }
-
-        _BDDep[bid] = bdDep;
       }
     }
-  }
-  
-  klee_message("Fing %lu branches", _BDDep.size());
-  klee_message("Find %lu branch-related StoreInsts", storetTobranches.size());
-  
-// ------------------------------------------------------------------------------------------------
 
-  return kmodule->module.get();
+    _BDDep[bid] = bdDep;
+  }
 }
 
 Executor::~Executor() {
@@ -1423,8 +1437,8 @@ const Cell& Executor::eval(KInstruction *ki, unsigned index,
     return kmodule->constantTable[index];
   } else {
     unsigned index = vnumber;
-    StackFrame &sf = state.stack.back();
-    return sf.locals[index];
+    const StackFrame &sf = state.stack.back();
+    return sf.getLocal(index);
   }
 }
 
@@ -1842,6 +1856,8 @@ void Executor::executeCall(ExecutionState &state, KInstruction *ki, Function *f,
   Instruction *i = ki->inst;
   if (isa_and_nonnull<DbgInfoIntrinsic>(i))
     return;
+  if (f && specialFunctionHandler->handleFastPath(state, f, ki, arguments))
+    return;
   if (f && f->isDeclaration()) {
     switch (f->getIntrinsicID()) {
     case Intrinsic::not_intrinsic: {
@@ -2061,6 +2077,9 @@ void Executor::executeCall(ExecutionState &state, KInstruction *ki, Function *f,
       transferToBasicBlock(ii->getNormalDest(), i->getParent(), state);
     }
   } else {
+    if (NativeCalls && executeNativeCall(state, ki, f, arguments))
+      return;
+
     // Check if maximum stack size was reached.
     // We currently only count the number of stack frames
     if (RuntimeMaxStackFrames && state.stack.size() > RuntimeMaxStackFrames) {
@@ -2248,9 +2267,183 @@ Function* Executor::getTargetFunction(Value *calledVal, ExecutionState &state) {
   }
 }
 
+namespace {
+uint64_t maskToWidth(uint64_t value, Expr::Width width) {
+  return width == 64 ? value : value & ((UINT64_C(1) << width) - 1);
+}
+
+int64_t signExtend(uint64_t value, Expr::Width width) {
+  return width == 64 ? (int64_t)value
+                     : (int64_t)(value << (64 - width)) >> (64 - width);
+}
+
+/// Evaluate a binary operator or comparison on concrete operands of the
+/// given width (at most 64 bits). Returns false for the cases the
+/// expression builders handle specially (division by zero, signed
+/// division overflow and oversized shifts).
+bool evaluateConcrete(unsigned opcode, unsigned predicate, uint64_t left,
+                      uint64_t right, Expr::Width width, uint64_t &result) {
+  switch (opcode) {
+  case Instruction::Add: result = left + right; break;
+  case Instruction::Sub: result = left - right; break;
+  case Instruction::Mul: result = left * right; break;
+  case Instruction::UDiv:
+    if (right == 0)
+      return false;
+    result = left / right;
+    break;
+  case Instruction::SDiv:
+    if (right == 0 || right == maskToWidth(~UINT64_C(0), width))
+      return false;
+    result = signExtend(left, width) / signExtend(right, width);
+    break;
+  case Instruction::URem:
+    if (right == 0)
+      return false;
+    result = left % right;
+    break;
+  case Instruction::SRem:
+    if (right == 0 || right == maskToWidth(~UINT64_C(0), width))
+      return false;
+    result = signExtend(left, width) % signExtend(right, width);
+    break;
+  case Instruction::And: result = left & right; break;
+  case Instruction::Or: result = left | right; break;
+  case Instruction::Xor: result = left ^ right; break;
+  case Instruction::Shl:
+    if (right >= width)
+      return false;
+    result = left << right;
+    break;
+  case Instruction::LShr:
+    if (right >= width)
+      return false;
+    result = left >> right;
+    break;
+  case Instruction::AShr:
+    if (right >= width)
+      return false;
+    result = signExtend(left, width) >> right;
+    break;
+  case Instruction::ICmp:
+    switch (predicate) {
+    case ICmpInst::ICMP_EQ: result = left == right; break;
+    case ICmpInst::ICMP_NE: result = left != right; break;
+    case ICmpInst::ICMP_UGT: result = left > right; break;
+    case ICmpInst::ICMP_UGE: result = left >= right; break;
+    case ICmpInst::ICMP_ULT: result = left < right; break;
+    case ICmpInst::ICMP_ULE: result = left <= right; break;
+    case ICmpInst::ICMP_SGT:
+      result = signExtend(left, width) > signExtend(right, width);
+      break;
+    case ICmpInst::ICMP_SGE:
+      result = signExtend(left, width) >= signExtend(right, width);
+      break;
+    case ICmpInst::ICMP_SLT:
+      result = signExtend(left, width) < signExtend(right, width);
+      break;
+    case ICmpInst::ICMP_SLE:
+      result = signExtend(left, width) <= signExtend(right, width);
+      break;
+    default:
+      return false;
+    }
+    return true;
+  default:
+    return false;
+  }
+
+  result = maskToWidth(result, width);
+  return true;
+}
+} // namespace
+
+bool Executor::executeConcreteFastPath(ExecutionState &state,
+                                       KInstruction *ki) {
+  switch (ki->opcode) {
+  case Instruction::Add:
+  case Instruction::Sub:
+  case Instruction::Mul:
+  case Instruction::UDiv:
+  case Instruction::SDiv:
+  case Instruction::URem:
+  case Instruction::SRem:
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+  case Instruction::Shl:
+  case Instruction::LShr:
+  case Instruction::AShr:
+  case Instruction::ICmp: {
+    ref<Expr> left = eval(ki, 0, state).value;
+    ref<Expr> right = eval(ki, 1, state).value;
+    auto *cl = dyn_cast<ConstantExpr>(left);
+    auto *cr = dyn_cast<ConstantExpr>(right);
+    if (!cl || !cr || cl->getWidth() > 64)
+      return false;
+
+    uint64_t result;
+    if (!evaluateConcrete(ki->opcode, ki->predicate, cl->getZExtValue(),
+                          cr->getZExtValue(), cl->getWidth(), result))
+      return false;
+    bindLocal(ki, state,
+              ConstantExpr::create(result, ki->opcode == Instruction::ICmp
+                                               ? Expr::Bool
+                                               : cl->getWidth()));
+    return true;
+  }
+
+  case Instruction::Trunc:
+  case Instruction::ZExt:
+  case Instruction::SExt:
+  case Instruction::IntToPtr:
+  case Instruction::PtrToInt: {
+    ref<Expr> arg = eval(ki, 0, state).value;
+    auto *ca = dyn_cast<ConstantExpr>(arg);
+    if (!ca || ca->getWidth() > 64 || ki->width > 64)
+      return false;
+
+    uint64_t value = ca->getZExtValue();
+    if (ki->opcode == Instruction::SExt)
+      value = signExtend(value, ca->getWidth());
+    bindLocal(ki, state,
+              ConstantExpr::create(maskToWidth(value, ki->width), ki->width));
+    return true;
+  }
+
+  case Instruction::GetElementPtr: {
+    KGEPInstruction *kgepi = static_cast<KGEPInstruction *>(ki);
+    ref<Expr> base = eval(ki, 0, state).value;
+    auto *cb = dyn_cast<ConstantExpr>(base);
+    if (!cb || cb->getWidth() > 64)
+      return false;
+
+    uint64_t address = cb->getZExtValue();
+    for (const auto &index : kgepi->indices) {
+      ref<Expr> value = eval(ki, index.first, state).value;
+      auto *ci = dyn_cast<ConstantExpr>(value);
+      if (!ci || ci->getWidth() > 64)
+        return false;
+      address += signExtend(ci->getZExtValue(), ci->getWidth()) * index.second;
+    }
+    address += kgepi->offset;
+    bindLocal(ki, state,
+              ConstantExpr::create(maskToWidth(address, cb->getWidth()),
+                                   cb->getWidth()));
+    return true;
+  }
+
+  default:
+    return false;
+  }
+}
+
 void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {  
+  if (ConcreteFastPath && executeConcreteFastPath(state, ki))
+    return;
+
   Instruction *i = ki->inst;
-  switch (i->getOpcode()) {
+  switch (ki->opcode) {
     // Control flow
   case Instruction::Ret: {
     ReturnInst *ri = cast<ReturnInst>(i);
@@ -2453,15 +2646,14 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
         unsigned id = theStatisticManager->getIndex();
         uint64_t isFullyCoveredBranch = theStatisticManager->getIndexedValue(stats::fullBranches, id);
-        auto i_it = std::find(invalidBranches.begin(), invalidBranches.end(), bid);
+        auto i_it = invalidBranches.find(bid);
     
         if (!isFullyCoveredBranch && (i_it == invalidBranches.end())) {
         
           // make sure this is the first time
           auto t_it = std::find(targetBranches.begin(), targetBranches.end(), bid);
-          auto p_it = std::find(partlyCoveredBranches.begin(), partlyCoveredBranches.end(), bid); 
 
-          if ((t_it == targetBranches.end()) && (p_it == partlyCoveredBranches.end())) {
+          if ((t_it == targetBranches.end()) && !partlyCoveredSet.count(bid)) {
             if (!_BDDep[bid]->stores.empty()) {
 
               // [RARE] this is a simple method to to avoid that this target branch is not fully covered 
@@ -2480,349 +2672,25 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
               // to record branchinformation for cgs searcher
               BDDep *bdDep = _BDDep[bid];
 
-              // 1. record uncover predicate and some operations
-
-              // 1) find KInstruction of branch condition
-              KInstruction *KCond = nullptr;
-              Value *v_cond = bi->getCondition();
-              Instruction *cond = dyn_cast<Instruction>(v_cond);
-
-              Function *F = bi->getParent()->getParent();
-              KFunction *KF = kmodule->functionMap[F];
-              for (unsigned i = 0; i < KF->numInstructions; ++i) {
-                KInstruction *ki = KF->instructions[i];
-                if (ki->inst == cond) {
-                  KCond = ki;
-                  break;
-                }
-              }
-
-              if (!KCond) {
-                outs() << "find no ICmpInst for this branch";
-                outs() << *bi << "\n";
-                assert(0);
-
-                break;
-              }
-
-              // 2) Obtain runtime value of branch condition
-              ref<Expr> v1 = eval(KCond, 0, state).value;
-              ref<Expr> v2 = eval(KCond, 1, state).value;
-              auto CE1 = dyn_cast<ConstantExpr>(v1);
-              auto CE2 = dyn_cast<ConstantExpr>(v2);
+              // 1. record uncover predicate. The predicate, constant and and/or mask of
+              // "ICMP V,C" are found by IDA, it is only left to see which side is taken
 
               // here we handle former case of symbolic branch identification
-              if (!CE1 || !CE2) {
+              ref<Expr> v = eval(bdDep->kcond, bdDep->var_op, state).value;
+              auto CE = dyn_cast<ConstantExpr>(v);
+              if (!CE) {
                 invalidBranches.insert(bid);
-                // outs() << "invalid branch condition runtime value for cmp:";
-                // outs() << *KCond->inst << "\n";
-                // CE1->dump();
-                // CE2->dump();
-                // assert(0);
-
                 break;
               }
-              
-              signed c1 = (signed)(CE1->getZExtValue());
-              signed c2 = (signed)(CE2->getZExtValue());
-        
-              // 3) determine which one is variable or constant, and record
-              Value *v = bi->getCondition();
-              auto bi_cond = dyn_cast<ICmpInst>(v);
-              assert(bi_cond && "no an icmp instruction ");
-
-              Value *op1 = bi_cond->getOperand(0);
-              Value *op2 = bi_cond->getOperand(1);
-
-              if (!isa<ConstantInt>(op1) && isa<ConstantInt>(op2)) {
-                bdDep->var = c1;
-                bdDep->constant = c2; 
-
-                unsigned pred = bdDep->pred;
-                switch (pred) {
-                  case llvm::CmpInst::ICMP_EQ: {
-                    if (c1 == c2) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_NE;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_EQ;
-                    }
-                    break;
-                  }
-                  case llvm::CmpInst::ICMP_NE: {
-                    if (c1 != c2) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_EQ;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_NE;
-                    }
-                    break;
-                  } 
-                  case llvm::CmpInst::ICMP_UGT: {
-                    if (c1 > c2) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_ULE;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_UGT;
-                    }
-                    break;
-                  } 
-                  case llvm::CmpInst::ICMP_ULT: {
-                    if (c1 < c2) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_UGE;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_ULT;
-                    }
-                    break;
-                    } 
-                  case llvm::CmpInst::ICMP_UGE: {
-                    if (c1 >= c2) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_ULT;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_UGE;
-                    }
-                    break;
-                  } 
-                  case llvm::CmpInst::ICMP_ULE: {
-                    if (c1 <= c2) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_UGT;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_ULE;
-                    }
-                    break;
-                  } 
-
-                  case llvm::CmpInst::ICMP_SGT: {
-                    if (c1 > c2) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SLE;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SGT;
-                    }
-                    break;
-                  } 
-                  case llvm::CmpInst::ICMP_SLT: {
-                    if (c1 < c2) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SGE;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SLT;
-                    }
-                    break;
-                    } 
-                  case llvm::CmpInst::ICMP_SGE: {
-                    if (c1 >= c2) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SLT;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SGE;
-                    }
-                    break;
-                  } 
-                  case llvm::CmpInst::ICMP_SLE: {
-                    if (c1 <= c2) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SGT;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SLE;
-                    }
-                    break;
-                  } 
-
-                  default: {
-                    outs() << "invalid predicate: " << pred << "\n";
-                    break;
-                  }
-                }
-              }
-              else if (isa<ConstantInt>(op1) && !isa<ConstantInt>(op2)) {
-                bdDep->var = c2;
-                bdDep->constant = c1;
-
-                unsigned pred = bdDep->pred;
-
-                // record covered and uncover predicate
-                /* reverse predicate:
-                if icmp 4 > a, change to a < 4
-                */
-                switch (pred) {
-                  case llvm::CmpInst::ICMP_EQ: {
-                    if (c2 == c1) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_NE;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_EQ;
-                    }
-                    bdDep->pred = llvm::CmpInst::ICMP_EQ;
-                    break;
-                  }
-                  case llvm::CmpInst::ICMP_NE: {
-                    if (c2 != c1) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_EQ;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_NE;
-                    }
-                    bdDep->pred = llvm::CmpInst::ICMP_NE;
-                    break;
-                  } 
-                  case llvm::CmpInst::ICMP_UGT: {
-                    if (c2 < c1) {    
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_UGE;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_ULT;
-                    }
-                    bdDep->pred = llvm::CmpInst::ICMP_ULT;
-                    break;
-                  } 
-                  case llvm::CmpInst::ICMP_ULT: {
-                    if (c2 > c1) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_ULE;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_UGT;
-                    }
-                    bdDep->pred = llvm::CmpInst::ICMP_UGT;
-                    break;
-                  } 
-                  case llvm::CmpInst::ICMP_UGE: {
-                    if (c2 <= c1) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_UGT;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_ULE;
-                    }
-                    bdDep->pred = llvm::CmpInst::ICMP_ULE;
-                    break;
-                  } 
-                  case llvm::CmpInst::ICMP_ULE: {
-                    if (c2 >= c1) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_ULT;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_UGE;
-                    }
-                    bdDep->pred = llvm::CmpInst::ICMP_UGE;
-                    break;
-                  } 
-                  case llvm::CmpInst::ICMP_SGT: {
-                    if (c2 < c1) {    
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SGE;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SLT;
-                    }
-                    bdDep->pred = llvm::CmpInst::ICMP_SLT;
-                    break;
-                  } 
-                  case llvm::CmpInst::ICMP_SLT: {
-                    if (c2 > c1) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SLE;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SGT;
-                    }
-                    bdDep->pred = llvm::CmpInst::ICMP_SGT;
-                    break;
-                  } 
-                  case llvm::CmpInst::ICMP_SGE: {
-                    if (c2 <= c1) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SGT;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SLE;
-                    }
-                    bdDep->pred = llvm::CmpInst::ICMP_SLE;
-                    break;
-                  } 
-                  case llvm::CmpInst::ICMP_SLE: {
-                    if (c2 >= c1) {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SLT;
-                    }
-                    else {
-                      bdDep->unCoveredPred = llvm::CmpInst::ICMP_SGE;
-                    }
-                    bdDep->pred = llvm::CmpInst::ICMP_SGE;
-                    break;
-                  } 
-
-                  default: {
-                    outs() << "invalid predicate: " << pred << "\n";
-                    break;
-                  }
-                }
+              bdDep->var = CE->getZExtValue();
+
+              if (current_state == branches.first) {
+                bdDep->unCoveredPred = CmpInst::getInversePredicate((CmpInst::Predicate)bdDep->pred);
+                bdDep->unCoveredSide = ida::ss_false;
               }
               else {
-                assert(0 && "invalid icmp instruction");
-              }
-
-              // 2. [TODO] record other arithmetic operations in this basic block
-              // based on def-use chain
-              BasicBlock *bb = bi->getParent();
-              std::unordered_set<std::string> allowed_ops = {"and", "or"};
-              std::vector<Instruction *> instVec;
-              std::unordered_set<Instruction *> usedInstSet;
-
-              instVec.push_back(bi);
-              while(!instVec.empty()) {
-                Instruction *curInst = instVec.back();
-                instVec.pop_back();
-
-                // handle loop
-                if (usedInstSet.find(curInst) != usedInstSet.end()) {
-                  continue;
-                }
-                else {
-                  usedInstSet.insert(curInst);
-                }
-
-                if (curInst->getParent() != bb) {
-                    break;
-                }
-
-                for (Use &U: curInst->operands()) {
-                  Instruction *I = dyn_cast<Instruction>(U);
-                  if (I) {
-                    instVec.push_back(I);
-                  }
-                }
-
-                std::string op = curInst->getOpcodeName();
-                if (allowed_ops.find(op) != allowed_ops.end()) {
-                  // outs() << "find arithmetic operations:" << *curInst << "\n";
-
-                  Value *op1 = curInst->getOperand(0);
-                  Value *op2 = curInst->getOperand(1);
-                  auto CI1 = dyn_cast<ConstantInt>(op1);
-                  auto CI2 = dyn_cast<ConstantInt>(op2);
-                
-                  if (!CI1 && CI2) {
-                    bdDep->arith_op = op;
-                    bdDep->arith_var = CI2->getSExtValue();
-                  }
-                  else if (CI1 && !CI2) {
-                    bdDep->arith_op = op;
-                    bdDep->arith_var = CI1->getSExtValue();;
-                  }
-                  else {
-                    /*
-                    const llvm::DebugLoc &debugInfo = curInst->getDebugLoc();
-                    if (debugInfo) {
-                      unsigned lineNumber = debugInfo->getLine();
-                      std::string filePath = debugInfo->getFilename().str();
-                      outs() << filePath << ": line " << lineNumber << "\n"; 
-                    }
-                    outs() << *curInst << "\n";
-                    assert(0);*/
-                  }
-            
-                  instVec.clear();
-                  break;
-                }
+                bdDep->unCoveredPred = bdDep->pred;
+                bdDep->unCoveredSide = ida::ss_true;
               }
 
               // optimization
@@ -2831,7 +2699,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
                 newPartlyCoveredBranch = true;
               }
               else {
-                partlyCoveredBranches.push_back(bid);  
+                partlyCoveredBranches.push_back(bid);
+                partlyCoveredSet.insert(bid);
               }
 
             }        
@@ -2840,8 +2709,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
         // "Step 3" in Algorithm 2 in our paper, when a concrete branch is fully covered
         if (isFullyCoveredBranch) {
-          auto f_it = std::find(fullyCoveredBranches.begin(), fullyCoveredBranches.end(), bid);
-          if (f_it == fullyCoveredBranches.end()) {
+          if (fullyCoveredSet.insert(bid).second) {
             fullyCoveredBranches.push_back(bid);
             
             // updates targetBranches
@@ -2854,6 +2722,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
                 // move one branch in partlyCoveredBranches to targetBranches in a dfs manner
                 unsigned bid = partlyCoveredBranches.back();
                 partlyCoveredBranches.pop_back();
+                partlyCoveredSet.erase(bid);
 
                 targetBranches.push_back(bid);
 
@@ -2864,8 +2733,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
             // sometimes, this branch has not been added to target branches 
             else {
-              auto p_it = std::find(partlyCoveredBranches.begin(), partlyCoveredBranches.end(), bid);
-              if (p_it != partlyCoveredBranches.end()) {
+              if (partlyCoveredSet.erase(bid)) {
+                auto p_it = std::find(partlyCoveredBranches.begin(), partlyCoveredBranches.end(), bid);
                 partlyCoveredBranches.erase(p_it);
               }
             }
@@ -2995,21 +2864,20 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       }
       
       // remove the covered case
-      signed coveredValue = (signed)(CE->getZExtValue());
-      std::unordered_set<signed> &uCVs = bdDep->unCoveredValues;
+      uint64_t coveredValue = CE->getZExtValue();
+      std::unordered_set<uint64_t> &uCVs = bdDep->unCoveredValues;
       if (uCVs.find(coveredValue) != uCVs.end()) {
         uCVs.erase(coveredValue);
       }
     
       // determine whether all cases are covered
       bool isCoveredSwitch = bdDep->unCoveredValues.empty();
-      auto i_it = std::find(invalidBranches.begin(), invalidBranches.end(), bid);
+      auto i_it = invalidBranches.find(bid);
 
       if (!isCoveredSwitch && (i_it == invalidBranches.end())) {
         auto t_it = std::find(targetBranches.begin(), targetBranches.end(), bid);
-        auto p_it = std::find(partlyCoveredBranches.begin(), partlyCoveredBranches.end(), bid);
 
-        if ((t_it == targetBranches.end()) && (p_it == partlyCoveredBranches.end())) {
+        if ((t_it == targetBranches.end()) && !partlyCoveredSet.count(bid)) {
           if (!_BDDep[bid]->stores.empty()) {
 
             // [RARE] this is a simple method to to avoid that this target branch is not fully covered 
@@ -3030,15 +2898,15 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
               newPartlyCoveredBranch = true;
             }
             else {
-              partlyCoveredBranches.push_back(bid);  
+              partlyCoveredBranches.push_back(bid);
+              partlyCoveredSet.insert(bid);
             }
           }
         }
       }
 
       if (isCoveredSwitch) {
-        auto f_it = std::find(fullyCoveredBranches.begin(), fullyCoveredBranches.end(), bid);
-        if (f_it == fullyCoveredBranches.end()) {
+        if (fullyCoveredSet.insert(bid).second) {
           fullyCoveredBranches.push_back(bid);
 
           // updates targetBranches
@@ -3052,6 +2920,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
               // in a dfs manner
               unsigned bid = partlyCoveredBranches.back();               
               partlyCoveredBranches.pop_back();
+              partlyCoveredSet.erase(bid);
 
               targetBranches.push_back(bid);
 
@@ -3062,8 +2931,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
           // this branch has not been added to target branches 
           else {
-            auto p_it = std::find(partlyCoveredBranches.begin(), partlyCoveredBranches.end(), bid);
-            if (p_it != partlyCoveredBranches.end()) {
+            if (partlyCoveredSet.erase(bid)) {
+              auto p_it = std::find(partlyCoveredBranches.begin(), partlyCoveredBranches.end(), bid);
               partlyCoveredBranches.erase(p_it);
             }
           }
@@ -3100,6 +2969,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       ref<Expr> defaultValue = ConstantExpr::alloc(1, Expr::Bool);
 
       // iterate through all non-default cases but in order of the expressions
+      std::vector<std::pair<ref<Expr>, BasicBlock *>> matches;
       for (std::map<ref<Expr>, BasicBlock *>::iterator
                it = expressionOrder.begin(),
                itE = expressionOrder.end();
@@ -3113,15 +2983,30 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         // Make sure that the default value does not contain this target's value
         defaultValue = AndExpr::create(defaultValue, Expr::createIsZero(match));
 
+        matches.push_back(
+            std::make_pair(optimizer.optimizeExpr(match, false), it->second));
+      }
+      defaultValue = optimizer.optimizeExpr(defaultValue, false);
+
+      // The cases are independent queries, the speculative solver works on
+      // the later ones while the first ones are checked.
+      if (SpeculativeSolverWorkers) {
+        for (const auto &m : matches)
+          solver->speculateMayBeTrue(state.constraints, m.first);
+        solver->speculateMayBeTrue(state.constraints, defaultValue);
+      }
+
+      for (const auto &m : matches) {
+        ref<Expr> match = m.first;
+
         // Check if control flow could take this case
         bool result;
-        match = optimizer.optimizeExpr(match, false);
         bool success = solver->mayBeTrue(state.constraints, match, result,
                                          state.queryMetaData);
         assert(success && "FIXME: Unhandled solver failure");
         (void) success;
         if (result) {
-          BasicBlock *caseSuccessor = it->second;
+          BasicBlock *caseSuccessor = m.second;
 
           // Handle the case that a basic block might be the target of multiple
           // switch cases.
@@ -3143,7 +3028,6 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       }
 
       // Check if control could take the default case
-      defaultValue = optimizer.optimizeExpr(defaultValue, false);
       bool res;
       bool success = solver->mayBeTrue(state.constraints, defaultValue, res,
                                        state.queryMetaData);
@@ -3426,10 +3310,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     // Compare
 
   case Instruction::ICmp: {
-    CmpInst *ci = cast<CmpInst>(i);
-    ICmpInst *ii = cast<ICmpInst>(ci);
-
-    switch(ii->getPredicate()) {
+    switch(ki->predicate) {
     case ICmpInst::ICMP_EQ: {
       ref<Expr> left = eval(ki, 0, state).value;
       ref<Expr> right = eval(ki, 1, state).value;
@@ -3556,12 +3437,12 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       auto CE = dyn_cast<ConstantExpr>(value);
 
       // we only consider non-pointer constant
-      if (!op_data->getType()->isPointerTy() && CE) {
-        unsigned value = CE->getZExtValue();
+      if (!op_data->getType()->isPointerTy() && CE && CE->getWidth() <= Expr::Int64) {
+        uint64_t value = CE->getZExtValue();
         // outs() << "find store value: " << value << " for state " << state.getID() << " at" << *SI << "\n";
         
         // get the store values for current state
-        std::unordered_map<unsigned, unsigned> &storeValues = state.storeValues;
+        std::unordered_map<unsigned, uint64_t> &storeValues = state.storeValues;
         
         // drop store data that defines the same branch variable (include itself)
         auto it = storesWithSameVar.find(sid);
@@ -3570,7 +3451,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
           std::unordered_set<unsigned> stores_related = storesWithSameVar[sid];
           for (auto s_it = storeValues.begin(); s_it != storeValues.end(); s_it++) {
             unsigned _SID = s_it->first;
-            unsigned _value = s_it->second;
+            uint64_t _value = s_it->second;
 
             // if former store has a new value on the same branch variable, drop it
             if ((stores_related.find(_SID) != stores_related.end()) && (_value != value)) {
@@ -3608,7 +3489,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
         for (auto bid: targetBranches) {
 
           // this value has been proved to be unable to fully cover this branch
-          if (invalidStoreValues[bid].find((signed)value) != invalidStoreValues[bid].end()) {
+          if (invalidStoreValues[bid].find(value) != invalidStoreValues[bid].end()) {
             continue;
           }       
           
@@ -3617,6 +3498,13 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
           if (_BDDep[bid]->stores.find(sid) != _BDDep[bid]->stores.end()) {
             // outs() << "state " << state.getID() << " finds value " << value 
             //     << " for branch " << bid << "\n";
+
+            // the constant of this store always leads to the covered side of this branch
+            auto side_it = _BDDep[bid]->storeSides.find(sid);
+            if ((side_it != _BDDep[bid]->storeSides.end()) && 
+                (side_it->second != _BDDep[bid]->unCoveredSide)) {
+              continue;
+            }
             
             state.reachStore = true;
             state.reachBranch = false;
@@ -3658,40 +3546,33 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     // Conversion
   case Instruction::Trunc: {
-    CastInst *ci = cast<CastInst>(i);
     ref<Expr> result = ExtractExpr::create(eval(ki, 0, state).value,
                                            0,
-                                           getWidthForLLVMType(ci->getType()));
+                                           ki->width);
     bindLocal(ki, state, result);
     break;
   }
   case Instruction::ZExt: {
-    CastInst *ci = cast<CastInst>(i);
     ref<Expr> result = ZExtExpr::create(eval(ki, 0, state).value,
-                                        getWidthForLLVMType(ci->getType()));
+                                        ki->width);
     bindLocal(ki, state, result);
     break;
   }
   case Instruction::SExt: {
-    CastInst *ci = cast<CastInst>(i);
     ref<Expr> result = SExtExpr::create(eval(ki, 0, state).value,
-                                        getWidthForLLVMType(ci->getType()));
+                                        ki->width);
     bindLocal(ki, state, result);
     break;
   }
 
   case Instruction::IntToPtr: {
-    CastInst *ci = cast<CastInst>(i);
-    Expr::Width pType = getWidthForLLVMType(ci->getType());
     ref<Expr> arg = eval(ki, 0, state).value;
-    bindLocal(ki, state, ZExtExpr::create(arg, pType));
+    bindLocal(ki, state, ZExtExpr::create(arg, ki->width));
     break;
   }
   case Instruction::PtrToInt: {
-    CastInst *ci = cast<CastInst>(i);
-    Expr::Width iType = getWidthForLLVMType(ci->getType());
     ref<Expr> arg = eval(ki, 0, state).value;
-    bindLocal(ki, state, ZExtExpr::create(arg, iType));
+    bindLocal(ki, state, ZExtExpr::create(arg, ki->width));
     break;
   }
 
@@ -4317,7 +4198,8 @@ bool Executor::checkMemoryUsage() {
 
   // randomly select states for early termination
   std::vector<ExecutionState *> arr(states.begin(), states.end()); // FIXME: expensive
-  for (unsigned i = 0, N = arr.size(); N && i < toKill; ++i, --N) {
+  unsigned N = arr.size();
+  for (unsigned i = 0; N && i < toKill; ++i, --N) {
     unsigned idx = theRNG.getInt32() % N;
     // Make two pulls to try and not hit a state that
     // covered new code.
@@ -4326,9 +4208,14 @@ bool Executor::checkMemoryUsage() {
       idx = theRNG.getInt32() % N;
 
     std::swap(arr[idx], arr[N - 1]);
-    terminateStateEarly(*arr[N - 1], "Memory limit exceeded.", StateTerminationType::OutOfMemory);
   }
 
+  // the selected states are at the end
+  for (unsigned i = N; i < arr.size(); ++i)
+    speculateTestCase(*arr[i]);
+  for (unsigned i = N; i < arr.size(); ++i)
+    terminateStateEarly(*arr[i], "Memory limit exceeded.", StateTerminationType::OutOfMemory);
+
   return false;
 }
 
@@ -4339,6 +4226,8 @@ void Executor::doDumpStates() {
   }
 
   klee_message("halting execution, dumping remaining states");
+  for (const auto &state : states)
+    speculateTestCase(*state);
   for (const auto &state : states)
     terminateStateEarly(*state, "Execution halting.", StateTerminationType::Interrupted);
   updateStates(nullptr);
@@ -4572,6 +4461,15 @@ void Executor::terminateStateEarly(ExecutionState &state, const Twine &message,
   terminateState(state);
 }
 
+void Executor::speculateTestCase(const ExecutionState &state) {
+  // with preferences, getSymbolicSolution() asks other queries first
+  if (!SpeculativeSolverWorkers || !shouldWriteTest(state) ||
+      !state.cexPreferences.empty() || state.symbolics.empty())
+    return;
+
+  solver->speculateInitialValues(state.constraints);
+}
+
 void Executor::terminateStateOnUserError(ExecutionState &state, const llvm::Twine &message) {
   terminateStateOnError(state, message, StateTerminationType::User, "");
 }
@@ -4798,12 +4696,15 @@ void Executor::callExternalFunction(ExecutionState &state,
 
   bool success = externalDispatcher->executeCall(callable, target->inst, args);
   if (!success) {
+    // the host memory may be partly written
+    state.addressSpace.invalidateHostCopies();
     terminateStateOnError(state, "failed external call: " + callable->getName(),
                           StateTerminationType::External);
     return;
   }
 
   if (!state.addressSpace.copyInConcretes()) {
+    state.addressSpace.invalidateHostCopies();
     terminateStateOnError(state, "external modified read-only object",
                           StateTerminationType::External);
     return;
@@ -4824,6 +4725,105 @@ void Executor::callExternalFunction(ExecutionState &state,
   }
 }
 
+bool Executor::executeNativeCall(ExecutionState &state, KInstruction *ki,
+                                 Function *f,
+                                 std::vector<ref<Expr>> &arguments) {
+  if (arguments.size() != f->arg_size() || !isa<CallInst>(ki->inst))
+    return false;
+
+  for (auto &arg : arguments) {
+    if (!isa<ConstantExpr>(arg))
+      return false;
+  }
+
+  Type *resultType = ki->inst->getType();
+  if (!resultType->isVoidTy() && !resultType->isIntOrPtrTy() &&
+      !resultType->isFloatingPointTy())
+    return false;
+
+  if (!externalDispatcher->canExecuteNatively(f))
+    return false;
+
+  // The native code can only reach the objects that the arguments and the
+  // globals of the closure point to, and those they point to in turn. Reads
+  // of symbolic bytes cannot be trapped, so none of them may hold one.
+  std::vector<uint64_t> roots;
+  for (auto &arg : arguments) {
+    if (arg->getWidth() <= Expr::Int64)
+      roots.push_back(cast<ConstantExpr>(arg)->getZExtValue());
+  }
+  for (auto *gv : externalDispatcher->getNativeGlobals(f)) {
+    auto it = globalAddresses.find(gv);
+    if (it == globalAddresses.end())
+      return false;
+    roots.push_back(it->second->getZExtValue());
+  }
+  ResolutionList reachable;
+  if (!state.addressSpace.getReachableObjects(roots, reachable))
+    return false;
+
+  // The scan misses pointers the closure makes from integers or keeps at
+  // unaligned addresses, so such code gets all objects, as external calls do.
+  // Then every object must be concrete.
+  bool copyAll = !externalDispatcher->hasTraceableNativePointers(f);
+  if (copyAll && !state.addressSpace.isAllConcrete())
+    return false;
+
+  size_t allocatedBytes = Expr::MaxWidth / 8 * (arguments.size() + 1);
+  uint64_t *args = (uint64_t*) alloca(allocatedBytes);
+  memset(args, 0, allocatedBytes);
+  unsigned wordIndex = 2;
+  for (auto &arg : arguments) {
+    ConstantExpr *ce = cast<ConstantExpr>(arg);
+    // fp80 must be aligned to 16 according to the System V AMD 64 ABI
+    if (ce->getWidth() == Expr::Fl80 && wordIndex & 0x01)
+      wordIndex++;
+    ce->toMemory(&args[wordIndex]);
+    wordIndex += (ce->getWidth()+63)/64;
+  }
+
+  if (copyAll)
+    state.addressSpace.copyOutConcretes();
+  else
+    state.addressSpace.copyOutConcretes(reachable);
+
+  auto invalidateHostCopies = [&]() {
+    if (copyAll)
+      state.addressSpace.invalidateHostCopies();
+    else
+      state.addressSpace.invalidateHostCopies(reachable);
+  };
+
+  // all globals of the closure were resolved above
+  auto globalAddress = [this](const GlobalValue *gv) {
+    auto it = globalAddresses.find(gv);
+    assert(it != globalAddresses.end() && "native global without address");
+    return it->second->getZExtValue();
+  };
+  if (!externalDispatcher->executeNativeCall(kmodule->functionMap[f],
+                                             ki->inst, args, globalAddress)) {
+    // the native code crashed, interpret the call instead
+    invalidateHostCopies();
+    return false;
+  }
+
+  if (copyAll ? !state.addressSpace.copyInConcretes()
+              : !state.addressSpace.copyInConcretes(reachable)) {
+    invalidateHostCopies();
+    terminateStateOnError(state, "native call modified read-only object",
+                          StateTerminationType::ReadOnly);
+    return true;
+  }
+
+  ++stats::nativeCalls;
+  if (!resultType->isVoidTy()) {
+    ref<Expr> e = ConstantExpr::fromMemory((void*) args,
+                                           getWidthForLLVMType(resultType));
+    bindLocal(ki, state, e);
+  }
+  return true;
+}
+
 /***/
 
 ref<Expr> Executor::replaceReadWithSymbolic(ExecutionState &state, 
@@ -5061,8 +5061,7 @@ void Executor::executeMemoryOperation(ExecutionState &state,
                                       ref<Expr> address,
                                       ref<Expr> value /* undef if read */,
                                       KInstruction *target /* undef if write */) {
-  Expr::Width type = (isWrite ? value->getWidth() : 
-                     getWidthForLLVMType(target->inst->getType()));
+  Expr::Width type = (isWrite ? value->getWidth() : target->width);
   unsigned bytes = Expr::getMinBytesForWidth(type);
 
   if (SimplifySymIndices) {
@@ -5192,9 +5191,10 @@ void Executor::executeMakeSymbolic(ExecutionState &state,
     // or if that fails try adding a unique identifier.
     unsigned id = 0;
     std::string uniqueName = name;
-    while (!state.arrayNames.insert(uniqueName).second) {
+    while (state.arrayNames.count(uniqueName)) {
       uniqueName = name + "_" + llvm::utostr(++id);
     }
+    state.arrayNames = state.arrayNames.insert(uniqueName);
     const Array *array = arrayCache.CreateArray(uniqueName, mo->size);
     bindObjectInState(state, mo, false, array);
     state.addSymbolic(mo, array);
@@ -61,6 +61,10 @@ namespace llvm {
   class Value;
 }
 
+namespace ida {
+  struct DependencyIndex;
+}
+
 namespace klee {  
   class Array;
   struct Cell;
@@ -114,7 +118,7 @@ public:
   Cell& getArgumentCell(ExecutionState &state,
                         KFunction *kf,
                         unsigned index) {
-    return state.stack.back().locals[kf->getArgRegister(index)];
+    return state.stack.back().getWriteableLocal(kf->getArgRegister(index));
   }
 
 // ------------------------------------------------------------------------------------------------
@@ -132,17 +136,23 @@ public:
     std::unordered_set<unsigned> stores;
 
     llvm::ICmpInst *cond;                             // branch condition
+    KInstruction *kcond;                              // branch condition, to evaluate V at runtime
 
+    // precomputed by IDA: the condition is normalized to "ICMP V,C"
     // https://llvm.org/doxygen/classllvm_1_1CmpInst.html#a2be3583dac92a031fa1458d4d992c78b
     unsigned pred;                                    // branch condition predicate
+    unsigned var_op;                                  // operand index of V in the original icmp
+    unsigned width;                                   // bit width of V and C
+    uint64_t constant;                                // C in "ICMP V,C", zero-extended
     std::string arith_op;                             // other arithmetic operations that affects branch
-    signed arith_var; 
+    uint64_t arith_var;                               // zero-extended and/or mask
+    std::unordered_map<unsigned, unsigned> storeSides; // constant stores -> side of br they lead to
 
     // runtime information
     unsigned unCoveredPred;                           // uncovered predicate
-    signed var;                                       // V in "ICMP V,C"
-    signed constant;                                  // C in "ICMP V,C"
-    std::unordered_set<signed> unCoveredValues;       // uncovered values of all of the switch cases
+    unsigned unCoveredSide;                           // uncovered side (ida::StoreSide)
+    uint64_t var;                                     // V in "ICMP V,C", zero-extended
+    std::unordered_set<uint64_t> unCoveredValues;     // uncovered values of all of the switch cases
 
   }BDDep;
 
@@ -177,6 +187,10 @@ public:
   std::vector<unsigned> partlyCoveredBranches;
   std::vector<unsigned> targetBranches;
 
+  // membership of the above vectors, which are looked up on every concrete branch
+  std::unordered_set<unsigned> fullyCoveredSet;
+  std::unordered_set<unsigned> partlyCoveredSet;
+
   // symbolic branches or over-hit concrete branches
   std::unordered_set<unsigned> invalidBranches;
   
@@ -184,8 +198,8 @@ public:
   std::unordered_map<unsigned, unsigned> reachBranchCount;
 
   // for cache
-  std::unordered_map<unsigned, std::unordered_set<signed>> validStoreValues; 
-  std::unordered_map<unsigned, std::unordered_set<signed>> invalidStoreValues;
+  std::unordered_map<unsigned, std::unordered_set<uint64_t>> validStoreValues; 
+  std::unordered_map<unsigned, std::unordered_set<uint64_t>> invalidStoreValues;
 
   // it is used to count the index in ExecutionState.branchInfos
   unsigned newBranchNumFromStore = 0;
@@ -193,6 +207,10 @@ public:
   // store instructions in each function
   std::unordered_map<llvm::Function *, std::unordered_set<llvm::StoreInst *>> funcStores;
 
+  // find branch-related stores with IDA on the loaded module
+  void runDependencyAnalysis(ida::DependencyIndex &index);
+  void loadBranchDependencies(const ida::DependencyIndex &index);
+
 private:
   
   InterpreterHandler *interpreterHandler;
@@ -306,6 +324,11 @@ private:
   
   void executeInstruction(ExecutionState &state, KInstruction *ki);
 
+  /// Execute ki if it is an integer operation (arithmetic, comparison,
+  /// cast or GEP) whose operands are all concrete, using the decoded
+  /// fields of ki only. Returns false if ki has to be executed normally.
+  bool executeConcreteFastPath(ExecutionState &state, KInstruction *ki);
+
   void run(ExecutionState &initialState);
 
   // Given a concrete object in our [klee's] address space, add it to 
@@ -328,6 +351,12 @@ private:
 			    llvm::BasicBlock *src,
 			    ExecutionState &state);
 
+  /// Runs a call to the defined function f natively, see -native-calls.
+  /// Returns false if the call has to be interpreted.
+  bool executeNativeCall(ExecutionState &state, KInstruction *ki,
+                         llvm::Function *f,
+                         std::vector<ref<Expr>> &arguments);
+
   void callExternalFunction(ExecutionState &state,
                             KInstruction *target,
                             KCallable *callable,
@@ -445,7 +474,7 @@ private:
 
   Cell& getDestCell(ExecutionState &state,
                     KInstruction *target) {
-    return state.stack.back().locals[target->dest];
+    return state.stack.back().getWriteableLocal(target->dest);
   }
 
   void bindLocal(KInstruction *target, 
@@ -506,6 +535,10 @@ private:
   void terminateStateEarly(ExecutionState &state, const llvm::Twine &message,
                            StateTerminationType terminationType);
 
+  /// Let the speculative solver work on the test case of a state that is
+  /// about to be terminated early, while other states are terminated.
+  void speculateTestCase(const ExecutionState &state);
+
   /// Call error handler and terminate state in case of program errors
   /// (e.g. free()ing globals, out-of-bound accesses)
   void terminateStateOnError(ExecutionState &state, const llvm::Twine &message,
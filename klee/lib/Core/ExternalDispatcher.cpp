@@ -21,12 +21,17 @@
 #include "llvm/IR/Module.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 
 #include <csetjmp>
 #include <csignal>
+#include <set>
 
 using namespace llvm;
 using namespace klee;
@@ -49,7 +54,29 @@ private:
   typedef std::map<const llvm::Instruction *, llvm::Function *> dispatchers_ty;
   dispatchers_ty dispatchers;
   llvm::Function *createDispatcher(KCallable *target, llvm::Instruction *i,
-                                   llvm::Module *module);
+                                   llvm::Module *module,
+                                   llvm::Function *native = nullptr);
+
+  /// A defined function with the functions it calls and the global variables
+  /// they refer to, compiled into a module of its own on the first call
+  struct NativeClosure {
+    bool supported = false;
+    std::vector<llvm::Function *> functions;
+    std::vector<llvm::Function *> intrinsics;
+    std::vector<llvm::GlobalValue *> globals;
+    bool traceablePointers = true;
+    llvm::Function *compiled = nullptr;
+  };
+  std::map<const llvm::Function *, NativeClosure> nativeClosures;
+  typedef std::map<std::pair<const llvm::Instruction *, const llvm::Function *>,
+                   llvm::Function *>
+      native_dispatchers_ty;
+  native_dispatchers_ty nativeDispatchers;
+  bool collectNativeClosure(llvm::Function *root, NativeClosure &closure);
+  llvm::Function *
+  compileNativeClosure(llvm::Function *root, NativeClosure &closure,
+                       const std::function<uint64_t(const llvm::GlobalValue *)>
+                           &globalAddress);
   llvm::ExecutionEngine *executionEngine;
   LLVMContext &ctx;
   std::map<std::string, void *> preboundFunctions;
@@ -64,6 +91,12 @@ public:
   ~ExternalDispatcherImpl();
   bool executeCall(KCallable *callable, llvm::Instruction *i,
                    uint64_t *args);
+  bool canExecuteNatively(llvm::Function *f);
+  const std::vector<llvm::GlobalValue *> &getNativeGlobals(llvm::Function *f);
+  bool hasTraceableNativePointers(llvm::Function *f);
+  bool executeNativeCall(
+      KFunction *kf, llvm::Instruction *i, uint64_t *args,
+      const std::function<uint64_t(const llvm::GlobalValue *)> &globalAddress);
   void *resolveSymbol(const std::string &name);
   int getLastErrno();
   void setLastErrno(int newErrno);
@@ -209,6 +242,244 @@ bool ExternalDispatcherImpl::executeCall(KCallable *callable, Instruction *i,
   return runProtectedCall(dispatcher, args);
 }
 
+/// Intrinsics that code generation lowers to plain instructions or to calls
+/// of the host C library that only touch the memory they are given
+static bool isNativeIntrinsic(const Function &f) {
+  switch (f.getIntrinsicID()) {
+  case Intrinsic::memcpy:
+  case Intrinsic::memmove:
+  case Intrinsic::memset:
+  case Intrinsic::dbg_declare:
+  case Intrinsic::dbg_value:
+  case Intrinsic::dbg_label:
+  case Intrinsic::lifetime_start:
+  case Intrinsic::lifetime_end:
+  case Intrinsic::expect:
+  case Intrinsic::bswap:
+  case Intrinsic::ctpop:
+  case Intrinsic::ctlz:
+  case Intrinsic::cttz:
+  case Intrinsic::fshl:
+  case Intrinsic::fshr:
+  case Intrinsic::fabs:
+  case Intrinsic::sadd_with_overflow:
+  case Intrinsic::ssub_with_overflow:
+  case Intrinsic::smul_with_overflow:
+  case Intrinsic::uadd_with_overflow:
+  case Intrinsic::usub_with_overflow:
+  case Intrinsic::umul_with_overflow:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// Adds the global variables that c refers to. Fails for references to
+/// functions, whose addresses differ between KLEE and the native code.
+static bool collectNativeGlobals(Value *v, std::set<const Value *> &visited,
+                                 std::vector<GlobalValue *> &globals) {
+  auto *c = dyn_cast<Constant>(v);
+  if (!c || !visited.insert(c).second)
+    return true;
+
+  if (auto *gv = dyn_cast<GlobalValue>(c)) {
+    if (isa<Function>(gv) || isa<GlobalIFunc>(gv) || gv->isThreadLocal())
+      return false;
+    if (auto *ga = dyn_cast<GlobalAlias>(gv))
+      if (isa<Function>(ga->getAliasee()->stripPointerCasts()))
+        return false;
+    globals.push_back(gv);
+    return true;
+  }
+
+  for (Use &op : c->operands())
+    if (!collectNativeGlobals(op.get(), visited, globals))
+      return false;
+  return true;
+}
+
+/// Whether i can make or use a pointer that a scan of the pointer-aligned
+/// words of memory does not see: one cast from an integer, or one loaded
+/// or stored at an address that need not be pointer-aligned.
+static bool hidesPointers(const Instruction &i) {
+  if (isa<IntToPtrInst>(i))
+    return true;
+
+  const DataLayout &dl = i.getModule()->getDataLayout();
+  if (const auto *li = dyn_cast<LoadInst>(&i))
+    return li->getType()->isPtrOrPtrVectorTy() &&
+           li->getAlign() < dl.getPointerABIAlignment(0);
+  if (const auto *si = dyn_cast<StoreInst>(&i))
+    return si->getValueOperand()->getType()->isPtrOrPtrVectorTy() &&
+           si->getAlign() < dl.getPointerABIAlignment(0);
+  return false;
+}
+
+bool ExternalDispatcherImpl::collectNativeClosure(Function *root,
+                                                  NativeClosure &closure) {
+  std::set<const Value *> visited{root};
+  std::vector<Function *> worklist{root};
+
+  while (!worklist.empty()) {
+    Function *f = worklist.back();
+    worklist.pop_back();
+
+    // exceptions and variadic arguments are handled by the interpreter
+    if (f->isVarArg() || f->hasPersonalityFn())
+      return false;
+    closure.functions.push_back(f);
+
+    for (auto &bb : *f) {
+      for (auto &i : bb) {
+        if (hidesPointers(i))
+          closure.traceablePointers = false;
+
+        const auto *cb = dyn_cast<CallBase>(&i);
+        if (cb) {
+          // indirect calls and inline assembly
+          auto *callee =
+              dyn_cast<Function>(cb->getCalledOperand()->stripPointerCasts());
+          if (!callee)
+            return false;
+
+          // external and special functions need the interpreter
+          if (callee->isDeclaration() && !isNativeIntrinsic(*callee))
+            return false;
+
+          if (visited.insert(callee).second) {
+            if (callee->isDeclaration())
+              closure.intrinsics.push_back(callee);
+            else
+              worklist.push_back(callee);
+          }
+        }
+
+        for (Use &op : i.operands()) {
+          if (cb && cb->isCallee(&op))
+            continue;
+          if (!collectNativeGlobals(op.get(), visited, closure.globals))
+            return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+Function *ExternalDispatcherImpl::compileNativeClosure(
+    Function *root, NativeClosure &closure,
+    const std::function<uint64_t(const GlobalValue *)> &globalAddress) {
+  Module *module = new Module(getFreshModuleID(), ctx);
+  module->setDataLayout(root->getParent()->getDataLayout());
+  module->setTargetTriple(root->getParent()->getTargetTriple());
+
+  ValueToValueMapTy vmap;
+
+  // Global variables become declarations that the JIT resolves to the
+  // addresses of their objects in KLEE, named after the address so that
+  // modules agree on them.
+  for (auto *gv : closure.globals) {
+    uint64_t address = globalAddress(gv);
+    std::string name = "klee_native_global_" + utohexstr(address);
+    Constant *decl = module->getOrInsertGlobal(name, gv->getValueType());
+    vmap[gv] = ConstantExpr::getPointerBitCastOrAddrSpaceCast(decl,
+                                                             gv->getType());
+    executionEngine->addGlobalMapping(name, address);
+  }
+
+  for (auto *f : closure.intrinsics)
+    vmap[f] = module->getOrInsertFunction(f->getName(), f->getFunctionType())
+                  .getCallee();
+
+  // MCJIT needs unique function names across all modules
+  for (auto *f : closure.functions) {
+    vmap[f] = Function::Create(
+        f->getFunctionType(),
+        f == root ? GlobalValue::ExternalLinkage : GlobalValue::InternalLinkage,
+        module->getModuleIdentifier() + "_" + f->getName(), module);
+  }
+
+  for (auto *f : closure.functions) {
+    auto *clone = cast<Function>(vmap[f]);
+    auto ai = clone->arg_begin();
+    for (auto &arg : f->args()) {
+      ai->setName(arg.getName());
+      vmap[&arg] = &*ai++;
+    }
+
+    SmallVector<ReturnInst *, 8> returns;
+#if LLVM_VERSION_CODE >= LLVM_VERSION(13, 0)
+    CloneFunctionInto(clone, f, vmap, CloneFunctionChangeType::DifferentModule,
+                      returns);
+#else
+    CloneFunctionInto(clone, f, vmap, true, returns);
+#endif
+  }
+  StripDebugInfo(*module);
+
+  auto *compiled = cast<Function>(vmap[root]);
+  executionEngine->addModule(std::unique_ptr<Module>(module));
+  uint64_t fnAddr = executionEngine->getFunctionAddress(compiled->getName().str());
+  executionEngine->finalizeObject();
+  assert(fnAddr && "failed to get function address");
+  (void)fnAddr;
+
+  return compiled;
+}
+
+bool ExternalDispatcherImpl::canExecuteNatively(Function *f) {
+  auto it = nativeClosures.find(f);
+  if (it == nativeClosures.end()) {
+    NativeClosure &closure = nativeClosures[f];
+    closure.supported = !f->isDeclaration() && collectNativeClosure(f, closure);
+    return closure.supported;
+  }
+  return it->second.supported;
+}
+
+const std::vector<GlobalValue *> &
+ExternalDispatcherImpl::getNativeGlobals(Function *f) {
+  canExecuteNatively(f);
+  return nativeClosures[f].globals;
+}
+
+bool ExternalDispatcherImpl::hasTraceableNativePointers(Function *f) {
+  canExecuteNatively(f);
+  return nativeClosures[f].traceablePointers;
+}
+
+bool ExternalDispatcherImpl::executeNativeCall(
+    KFunction *kf, Instruction *i, uint64_t *args,
+    const std::function<uint64_t(const GlobalValue *)> &globalAddress) {
+  Function *f = kf->function;
+  if (!canExecuteNatively(f))
+    return false;
+
+  auto key = std::make_pair(i, f);
+  auto it = nativeDispatchers.find(key);
+  if (it != nativeDispatchers.end())
+    return runProtectedCall(it->second, args);
+
+  NativeClosure &closure = nativeClosures[f];
+  if (!closure.compiled)
+    closure.compiled = compileNativeClosure(f, closure, globalAddress);
+
+  Module *dispatchModule = new Module(getFreshModuleID(), ctx);
+  Function *dispatcher =
+      createDispatcher(kf, i, dispatchModule, closure.compiled);
+  nativeDispatchers.insert(std::make_pair(key, dispatcher));
+
+  executionEngine->addModule(std::unique_ptr<Module>(dispatchModule));
+  uint64_t fnAddr =
+      executionEngine->getFunctionAddress(dispatcher->getName().str());
+  executionEngine->finalizeObject();
+  assert(fnAddr && "failed to get function address");
+  (void)fnAddr;
+
+  return runProtectedCall(dispatcher, args);
+}
+
 // FIXME: This is not reentrant.
 static uint64_t *gTheArgsP;
 bool ExternalDispatcherImpl::runProtectedCall(Function *f, uint64_t *args) {
@@ -252,10 +523,14 @@ bool ExternalDispatcherImpl::runProtectedCall(Function *f, uint64_t *args) {
 // the special cases that the JIT knows how to directly call. If this is not
 // done, then the jit will end up generating a nullary stub just to call our
 // stub, for every single function call.
+//
+// If native is given, the stub calls this JIT'ed copy of the target instead.
 Function *ExternalDispatcherImpl::createDispatcher(KCallable *target,
                                                    Instruction *inst,
-                                                   Module *module) {
-  if (isa<KFunction>(target) && !resolveSymbol(target->getName().str()))
+                                                   Module *module,
+                                                   Function *native) {
+  if (!native && isa<KFunction>(target) &&
+      !resolveSymbol(target->getName().str()))
     return 0;
 
   const CallBase &cb = cast<CallBase>(*inst);
@@ -314,8 +589,9 @@ Function *ExternalDispatcherImpl::createDispatcher(KCallable *target,
 
   llvm::CallInst *result;
   if (auto* func = dyn_cast<KFunction>(target)) {
-    auto dispatchTarget = module->getOrInsertFunction(target->getName(), FTy,
-                                                      func->function->getAttributes());
+    auto dispatchTarget = module->getOrInsertFunction(
+        native ? native->getName() : target->getName(), FTy,
+        func->function->getAttributes());
     result = Builder.CreateCall(dispatchTarget,
                                 llvm::ArrayRef<Value *>(args, args + i));
   } else if (auto* asmValue = dyn_cast<KInlineAsm>(target)) {
@@ -352,6 +628,25 @@ bool ExternalDispatcher::executeCall(KCallable *callable,
   return impl->executeCall(callable, i, args);
 }
 
+bool ExternalDispatcher::canExecuteNatively(llvm::Function *f) {
+  return impl->canExecuteNatively(f);
+}
+
+const std::vector<llvm::GlobalValue *> &
+ExternalDispatcher::getNativeGlobals(llvm::Function *f) {
+  return impl->getNativeGlobals(f);
+}
+
+bool ExternalDispatcher::hasTraceableNativePointers(llvm::Function *f) {
+  return impl->hasTraceableNativePointers(f);
+}
+
+bool ExternalDispatcher::executeNativeCall(
+    KFunction *kf, llvm::Instruction *i, uint64_t *args,
+    const std::function<uint64_t(const llvm::GlobalValue *)> &globalAddress) {
+  return impl->executeNativeCall(kf, i, args, globalAddress);
+}
+
 void *ExternalDispatcher::resolveSymbol(const std::string &name) {
   return impl->resolveSymbol(name);
 }
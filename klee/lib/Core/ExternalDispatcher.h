@@ -12,12 +12,16 @@
 
 #include "klee/Config/Version.h"
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 namespace llvm {
+class Function;
+class GlobalValue;
 class Instruction;
 class LLVMContext;
 }
@@ -25,6 +29,7 @@ class LLVMContext;
 namespace klee {
 class ExternalDispatcherImpl;
 class KCallable;
+struct KFunction;
 class ExternalDispatcher {
 private:
   ExternalDispatcherImpl *impl;
@@ -39,6 +44,32 @@ public:
    */
   bool executeCall(KCallable *callable, llvm::Instruction *i,
                    uint64_t *args);
+
+  /* Whether the defined function f can run natively: it and the functions
+   * it calls must not call external functions, call through pointers, take
+   * the address of functions or use exceptions.
+   */
+  bool canExecuteNatively(llvm::Function *f);
+
+  /* The global variables that f and the functions it calls refer to, if f
+   * can run natively.
+   */
+  const std::vector<llvm::GlobalValue *> &getNativeGlobals(llvm::Function *f);
+
+  /* Whether the pointers that f and the functions it calls follow are all
+   * stored in pointer-aligned words and none is made from an integer, so
+   * that AddressSpace::getReachableObjects finds the objects they reach.
+   */
+  bool hasTraceableNativePointers(llvm::Function *f);
+
+  /* Call the defined function kf natively, as executeCall does for external
+   * functions. It is JIT'ed on the first call together with the functions it
+   * calls, with the global variables it refers to placed at globalAddress.
+   */
+  bool executeNativeCall(
+      KFunction *kf, llvm::Instruction *i, uint64_t *args,
+      const std::function<uint64_t(const llvm::GlobalValue *)> &globalAddress);
+
   void *resolveSymbol(const std::string &name);
 
   int getLastErrno();
@@ -13,7 +13,6 @@
 #include "ExecutionState.h"
 #include "MemoryManager.h"
 
-#include "klee/ADT/BitArray.h"
 #include "klee/Expr/ArrayCache.h"
 #include "klee/Expr/Expr.h"
 #include "klee/Support/OptionCategories.h"
@@ -73,14 +72,18 @@ void MemoryObject::getAllocInfo(std::string &result) const {
 
 /***/
 
+uint64_t ObjectState::versionCounter = 0;
+
 ObjectState::ObjectState(const MemoryObject *mo)
   : copyOnWriteOwner(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
+    concreteStore(mo->size),
     concreteMask(nullptr),
+    symbolicBytes(0),
     knownSymbolics(nullptr),
     unflushedMask(nullptr),
     updates(nullptr, nullptr),
+    version(++versionCounter),
     size(mo->size),
     readOnly(false) {
   if (!UseConstantArrays) {
@@ -89,49 +92,43 @@ ObjectState::ObjectState(const MemoryObject *mo)
         getArrayCache()->CreateArray("tmp_arr" + llvm::utostr(++id), size);
     updates = UpdateList(array, 0);
   }
-  memset(concreteStore, 0, size);
 }
 
 
 ObjectState::ObjectState(const MemoryObject *mo, const Array *array)
   : copyOnWriteOwner(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
+    concreteStore(mo->size),
     concreteMask(nullptr),
+    symbolicBytes(0),
     knownSymbolics(nullptr),
     unflushedMask(nullptr),
     updates(array, nullptr),
+    version(++versionCounter),
     size(mo->size),
     readOnly(false) {
   makeSymbolic();
-  memset(concreteStore, 0, size);
 }
 
 ObjectState::ObjectState(const ObjectState &os) 
   : copyOnWriteOwner(0),
     object(os.object),
-    concreteStore(new uint8_t[os.size]),
-    concreteMask(os.concreteMask ? new BitArray(*os.concreteMask, os.size) : nullptr),
-    knownSymbolics(nullptr),
-    unflushedMask(os.unflushedMask ? new BitArray(*os.unflushedMask, os.size) : nullptr),
+    concreteStore(os.concreteStore),
+    concreteMask(os.concreteMask ? new ByteMask(*os.concreteMask) : nullptr),
+    symbolicBytes(os.symbolicBytes),
+    knownSymbolics(os.knownSymbolics ? new ByteExprs(*os.knownSymbolics) : nullptr),
+    unflushedMask(os.unflushedMask ? new ByteMask(*os.unflushedMask) : nullptr),
     updates(os.updates),
+    version(os.version),
     size(os.size),
     readOnly(false) {
   assert(!os.readOnly && "no need to copy read only object?");
-  if (os.knownSymbolics) {
-    knownSymbolics = new ref<Expr>[size];
-    for (unsigned i=0; i<size; i++)
-      knownSymbolics[i] = os.knownSymbolics[i];
-  }
-
-  memcpy(concreteStore, os.concreteStore, size*sizeof(*concreteStore));
 }
 
 ObjectState::~ObjectState() {
   delete concreteMask;
   delete unflushedMask;
-  delete[] knownSymbolics;
-  delete[] concreteStore;
+  delete knownSymbolics;
 }
 
 ArrayCache *ObjectState::getArrayCache() const {
@@ -196,6 +193,7 @@ void ObjectState::flushToConcreteStore(TimingSolver *solver,
                                        const ExecutionState &state) const {
   for (unsigned i = 0; i < size; i++) {
     if (isByteKnownSymbolic(i)) {
+      updateVersion();
       ref<ConstantExpr> ce;
       bool success = solver->getValue(state.constraints, read8(i), ce,
                                       state.queryMetaData);
@@ -203,8 +201,11 @@ void ObjectState::flushToConcreteStore(TimingSolver *solver,
         klee_warning("Solver timed out when getting a value for external call, "
                      "byte %p+%u will have random value",
                      (void *)object->address, i);
-      else
-        ce->toMemory(concreteStore + i);
+      else {
+        uint8_t byte;
+        ce->toMemory(&byte);
+        concreteStore.set(i, byte);
+      }
     }
   }
 }
@@ -212,8 +213,9 @@ void ObjectState::flushToConcreteStore(TimingSolver *solver,
 void ObjectState::makeConcrete() {
   delete concreteMask;
   delete unflushedMask;
-  delete[] knownSymbolics;
+  delete knownSymbolics;
   concreteMask = nullptr;
+  symbolicBytes = 0;
   unflushedMask = nullptr;
   knownSymbolics = nullptr;
 }
@@ -232,15 +234,15 @@ void ObjectState::makeSymbolic() {
 
 void ObjectState::initializeToZero() {
   makeConcrete();
-  memset(concreteStore, 0, size);
+  concreteStore.fill(0);
+  updateVersion();
 }
 
 void ObjectState::initializeToRandom() {  
   makeConcrete();
-  for (unsigned i=0; i<size; i++) {
-    // randomly selected by 256 sided die
-    concreteStore[i] = 0xAB;
-  }
+  updateVersion();
+  // randomly selected by 256 sided die
+  concreteStore.fill(0xAB);
 }
 
 /*
@@ -261,18 +263,18 @@ void ObjectState::fastRangeCheckOffset(ref<Expr> offset,
 void ObjectState::flushRangeForRead(unsigned rangeBase,
                                     unsigned rangeSize) const {
   if (!unflushedMask)
-    unflushedMask = new BitArray(size, true);
+    unflushedMask = new ByteMask(size, true);
 
   for (unsigned offset = rangeBase; offset < rangeBase + rangeSize; offset++) {
     if (isByteUnflushed(offset)) {
       if (isByteConcrete(offset)) {
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       ConstantExpr::create(concreteStore[offset], Expr::Int8));
+                       ConstantExpr::create(concreteStore.get(offset), Expr::Int8));
       } else {
         assert(isByteKnownSymbolic(offset) &&
                "invalid bit set in unflushedMask");
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       knownSymbolics[offset]);
+                       knownSymbolics->get(offset));
       }
 
       unflushedMask->unset(offset);
@@ -282,19 +284,19 @@ void ObjectState::flushRangeForRead(unsigned rangeBase,
 
 void ObjectState::flushRangeForWrite(unsigned rangeBase, unsigned rangeSize) {
   if (!unflushedMask)
-    unflushedMask = new BitArray(size, true);
+    unflushedMask = new ByteMask(size, true);
 
   for (unsigned offset = rangeBase; offset < rangeBase + rangeSize; offset++) {
     if (isByteUnflushed(offset)) {
       if (isByteConcrete(offset)) {
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       ConstantExpr::create(concreteStore[offset], Expr::Int8));
+                       ConstantExpr::create(concreteStore.get(offset), Expr::Int8));
         markByteSymbolic(offset);
       } else {
         assert(isByteKnownSymbolic(offset) &&
                "invalid bit set in unflushedMask");
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       knownSymbolics[offset]);
+                       knownSymbolics->get(offset));
         setKnownSymbolic(offset, 0);
       }
 
@@ -320,18 +322,23 @@ bool ObjectState::isByteUnflushed(unsigned offset) const {
 }
 
 bool ObjectState::isByteKnownSymbolic(unsigned offset) const {
-  return knownSymbolics && knownSymbolics[offset].get();
+  return knownSymbolics && knownSymbolics->get(offset).get();
 }
 
 void ObjectState::markByteConcrete(unsigned offset) {
-  if (concreteMask)
+  if (concreteMask && !concreteMask->get(offset)) {
     concreteMask->set(offset);
+    --symbolicBytes;
+  }
 }
 
 void ObjectState::markByteSymbolic(unsigned offset) {
   if (!concreteMask)
-    concreteMask = new BitArray(size, true);
-  concreteMask->unset(offset);
+    concreteMask = new ByteMask(size, true);
+  if (concreteMask->get(offset)) {
+    concreteMask->unset(offset);
+    ++symbolicBytes;
+  }
 }
 
 void ObjectState::markByteUnflushed(unsigned offset) {
@@ -341,7 +348,7 @@ void ObjectState::markByteUnflushed(unsigned offset) {
 
 void ObjectState::markByteFlushed(unsigned offset) {
   if (!unflushedMask) {
-    unflushedMask = new BitArray(size, false);
+    unflushedMask = new ByteMask(size, false);
   } else {
     unflushedMask->unset(offset);
   }
@@ -350,11 +357,11 @@ void ObjectState::markByteFlushed(unsigned offset) {
 void ObjectState::setKnownSymbolic(unsigned offset, 
                                    Expr *value /* can be null */) {
   if (knownSymbolics) {
-    knownSymbolics[offset] = value;
+    knownSymbolics->set(offset, value);
   } else {
     if (value) {
-      knownSymbolics = new ref<Expr>[size];
-      knownSymbolics[offset] = value;
+      knownSymbolics = new ByteExprs(size);
+      knownSymbolics->set(offset, value);
     }
   }
 }
@@ -363,9 +370,9 @@ void ObjectState::setKnownSymbolic(unsigned offset,
 
 ref<Expr> ObjectState::read8(unsigned offset) const {
   if (isByteConcrete(offset)) {
-    return ConstantExpr::create(concreteStore[offset], Expr::Int8);
+    return ConstantExpr::create(concreteStore.get(offset), Expr::Int8);
   } else if (isByteKnownSymbolic(offset)) {
-    return knownSymbolics[offset];
+    return knownSymbolics->get(offset);
   } else {
     assert(!isByteUnflushed(offset) && "unflushed byte without cache value");
     
@@ -393,13 +400,54 @@ ref<Expr> ObjectState::read8(ref<Expr> offset) const {
 
 void ObjectState::write8(unsigned offset, uint8_t value) {
   //assert(read_only == false && "writing to read-only object!");
-  concreteStore[offset] = value;
+  concreteStore.set(offset, value);
+  updateVersion();
   setKnownSymbolic(offset, 0);
 
   markByteConcrete(offset);
   markByteUnflushed(offset);
 }
 
+bool ObjectState::readConcrete(unsigned offset, uint8_t *dst,
+                               unsigned n) const {
+  if (concreteMask) {
+    for (unsigned i = offset; i < offset + n; i++) {
+      if (!concreteMask->get(i))
+        return false;
+    }
+  }
+  concreteStore.read(offset, dst, n);
+  return true;
+}
+
+void ObjectState::writeConcrete(unsigned offset, const uint8_t *src,
+                                unsigned n) {
+  concreteStore.write(offset, src, n);
+  updateVersion();
+
+  // the same as write8 for each byte, nothing to do for concrete objects
+  if (concreteMask || knownSymbolics || unflushedMask) {
+    for (unsigned i = offset; i < offset + n; i++) {
+      setKnownSymbolic(i, 0);
+      markByteConcrete(i);
+      markByteUnflushed(i);
+    }
+  }
+}
+
+void ObjectState::fillConcrete(unsigned offset, uint8_t value, unsigned n) {
+  concreteStore.fill(offset, n, value);
+  updateVersion();
+
+  if (concreteMask || knownSymbolics || unflushedMask) {
+    for (unsigned i = offset; i < offset + n; i++) {
+      setKnownSymbolic(i, 0);
+      markByteConcrete(i);
+      markByteUnflushed(i);
+    }
+  }
+}
+
 void ObjectState::write8(unsigned offset, ref<Expr> value) {
   // can happen when ExtractExpr special cases
   if (ConstantExpr *CE = dyn_cast<ConstantExpr>(value)) {
@@ -13,6 +13,7 @@
 #include "Context.h"
 #include "TimingSolver.h"
 
+#include "klee/ADT/ChunkedArray.h"
 #include "klee/Expr/Expr.h"
 
 #include "llvm/ADT/StringExtras.h"
@@ -27,7 +28,6 @@ namespace llvm {
 namespace klee {
 
 class ArrayCache;
-class BitArray;
 class ExecutionState;
 class MemoryManager;
 class Solver;
@@ -58,6 +58,11 @@ public:
 
   bool isUserSpecified;
 
+  /// Version of the object state whose concrete store was last copied to the
+  /// host memory at address (0 if unknown). External calls only copy out the
+  /// objects whose state has a different version.
+  mutable uint64_t hostVersion;
+
   MemoryManager *parent;
 
   /// "Location" for which this memory object was allocated. This
@@ -77,6 +82,7 @@ public:
       address(_address),
       size(0),
       isFixed(true),
+      hostVersion(0),
       parent(NULL),
       allocSite(0) {
   }
@@ -93,6 +99,7 @@ public:
       isGlobal(_isGlobal),
       isFixed(_isFixed),
       isUserSpecified(false),
+      hostVersion(0),
       parent(_parent), 
       allocSite(_allocSite) {
   }
@@ -172,23 +179,39 @@ private:
 
   ref<const MemoryObject> object;
 
+  /// The storage below is split into chunks of ChunkSize bytes, which copies
+  /// of the object state share until one of them writes to the chunk
+  static constexpr unsigned ChunkSize = 4096;
+  typedef ChunkedBitArray<ChunkSize> ByteMask;
+  typedef ChunkedArray<ref<Expr>, ChunkSize> ByteExprs;
+
   /// @brief Holds all known concrete bytes
-  uint8_t *concreteStore;
+  /// mutable because flushToConcreteStore writes it for a const
+  mutable ChunkedArray<uint8_t, ChunkSize> concreteStore;
 
   /// @brief concreteMask[byte] is set if byte is known to be concrete
-  BitArray *concreteMask;
+  ByteMask *concreteMask;
+
+  /// The number of bytes that are not set in concreteMask
+  unsigned symbolicBytes;
 
   /// knownSymbolics[byte] holds the symbolic expression for byte,
   /// if byte is known to be symbolic
-  ref<Expr> *knownSymbolics;
+  ByteExprs *knownSymbolics;
 
   /// unflushedMask[byte] is set if byte is unflushed
   /// mutable because may need flushed during read of const
-  mutable BitArray *unflushedMask;
+  mutable ByteMask *unflushedMask;
 
   // mutable because we may need flush during read of const
   mutable UpdateList updates;
 
+  /// Identifies the contents of concreteStore: a copy keeps the version of
+  /// its source, every change of the concrete store takes a new one.
+  /// mutable because flushToConcreteStore changes the store of a const
+  mutable uint64_t version;
+  static uint64_t versionCounter;
+
 public:
   unsigned size;
 
@@ -209,8 +232,18 @@ public:
 
   const MemoryObject *getObject() const { return object.get(); }
 
+  uint64_t getVersion() const { return version; }
+
+  /// Number of chunks of the concrete store that are shared with copies
+  unsigned getSharedChunkCount() const {
+    return concreteStore.getSharedChunkCount();
+  }
+
   void setReadOnly(bool ro) { readOnly = ro; }
 
+  /// Whether no byte of the object is symbolic
+  bool isAllConcrete() const { return symbolicBytes == 0; }
+
   /// Make contents all concrete and zero
   void initializeToZero();
 
@@ -225,6 +258,15 @@ public:
   void write(ref<Expr> offset, ref<Expr> value);
 
   void write8(unsigned offset, uint8_t value);
+
+  /// Copies the bytes [offset, offset+n) to dst. Returns false, and copies
+  /// nothing, if one of them is not concrete.
+  bool readConcrete(unsigned offset, uint8_t *dst, unsigned n) const;
+  /// Writes the concrete bytes src[0..n) at offset.
+  void writeConcrete(unsigned offset, const uint8_t *src, unsigned n);
+  /// Sets the bytes [offset, offset+n) to value.
+  void fillConcrete(unsigned offset, uint8_t value, unsigned n);
+
   void write16(unsigned offset, uint16_t value);
   void write32(unsigned offset, uint32_t value);
   void write64(unsigned offset, uint64_t value);
@@ -240,6 +282,8 @@ public:
 private:
   const UpdateList &getUpdates() const;
 
+  void updateVersion() const { version = ++versionCounter; }
+
   void makeConcrete();
 
   void makeSymbolic();
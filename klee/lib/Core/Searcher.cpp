@@ -16,6 +16,8 @@
 #include "PTree.h"
 #include "StatsTracker.h"
 
+#include "DependencyIndex.h"
+
 #include "klee/ADT/DiscretePDF.h"
 #include "klee/ADT/RNG.h"
 #include "klee/Statistics/Statistics.h"
@@ -562,6 +564,7 @@ CGSSearcher::CGSSearcher(Executor &_executor):
   TB{_executor.targetBranches},
   FCB{_executor.fullyCoveredBranches},
   PCB{_executor.partlyCoveredBranches},
+  PCBSet{_executor.partlyCoveredSet},
   targetBranchNum{_executor.targetBranchNum},
   updateTargetBranch{_executor.updateTargetBranch},
   newFullyCoveredBranch{_executor.newFullyCoveredBranch},
@@ -702,7 +705,7 @@ void CGSSearcher::update(ExecutionState *current,
         else {
           
           // remove branch information for this branch
-          bInfos->erase(it);
+          it = bInfos->erase(it);
         }
       }
 
@@ -730,7 +733,7 @@ void CGSSearcher::update(ExecutionState *current,
       state->branchInfos.clear();
       
       if (!state->coveredNew) {
-        branch_states.erase(it);
+        it = branch_states.erase(it);
         states.push_back(state);
       }
       else {
@@ -750,7 +753,8 @@ void CGSSearcher::update(ExecutionState *current,
 
       // move new target branches to TB in a dfs manner
       unsigned bid = PCB.back();
-      PCB.pop_back();    
+      PCB.pop_back();
+      PCBSet.erase(bid);
       TB.push_back(bid);
 
       handlePartlyCoveredBranch(current, bid); 
@@ -770,7 +774,7 @@ void CGSSearcher::update(ExecutionState *current,
   }
   else {
     Function *F = current->pc->inst->getParent()->getParent();
-    std::unordered_set<llvm::StoreInst *> func_stores = funcStores[F];
+    std::unordered_set<llvm::StoreInst *> &func_stores = funcStores[F];
 
     for (auto state: addedStates) {
       if (!state->branchInfos.empty()) {
@@ -835,7 +839,7 @@ void CGSSearcher::handlePartlyCoveredBranch(ExecutionState *current, unsigned ta
 
   // have covered stores
   // 1) from store instructions
-  std::unordered_set<unsigned> newStoreIDs = executor._BDDep[targetBID]->stores;
+  std::unordered_set<unsigned> &newStoreIDs = executor._BDDep[targetBID]->stores;
   
   for (auto sid: newStoreIDs) {
 
@@ -882,7 +886,7 @@ void CGSSearcher::handlePartlyCoveredBranch(ExecutionState *current, unsigned ta
 
         // outs() << "state " << state->getID() << " has new target branch " << targetBID << "\n";
           
-        states.erase(it);
+        it = states.erase(it);
         branch_states.push_back(state);
       }
       else {
@@ -944,7 +948,7 @@ void CGSSearcher::handleFullyCoveredBranch(ExecutionState *current, unsigned cov
     }
     
     if ((state != current) && branchInfos->empty()) {
-        branch_states.erase(it); 
+        it = branch_states.erase(it);
         states.push_back(state);
     }
     else {
@@ -958,7 +962,7 @@ bool CGSSearcher::isNewStoreValue(ExecutionState *state, unsigned bid, unsigned
   bool result = false;
   std::string cause;
 
-  signed value = state->storeValues[sid];
+  uint64_t value = state->storeValues[sid];
 
   // new branch (only for state that first cover this branch)
   if (invalidStoreValues.find(bid) == invalidStoreValues.end()) {
@@ -988,13 +992,18 @@ bool CGSSearcher::isNewStoreValue(ExecutionState *state, unsigned bid, unsigned
 
       // switch
       if (bdDep->type) {
-        std::unordered_set<signed> uCVs = bdDep->unCoveredValues;
+        std::unordered_set<uint64_t> &uCVs = bdDep->unCoveredValues;
         auto it = uCVs.find(value);
         if (it != uCVs.end()) {
           find_new = true;
         }
       }
 
+      // br, whose side is already known for constant stores
+      else if (bdDep->storeSides.find(sid) != bdDep->storeSides.end()) {
+        find_new = (bdDep->storeSides[sid] == bdDep->unCoveredSide);
+      }
+
       // br
       else {
 
@@ -1008,43 +1017,13 @@ bool CGSSearcher::isNewStoreValue(ExecutionState *state, unsigned bid, unsigned
           }
         }
 
-         // 2. compare value with constant
-        signed constant = bdDep->constant;
+         // 2. compare value with constant, at the width of the condition
         unsigned pred = bdDep->unCoveredPred;
-        switch(pred) {
-          case llvm::CmpInst::ICMP_EQ: {
-            find_new = (value == constant);
-            break;
-          }
-          case llvm::CmpInst::ICMP_NE: {
-            find_new = (value != constant);
-            break;
-          }
-          case llvm::CmpInst::ICMP_SGT:
-          case llvm::CmpInst::ICMP_UGT: {
-            find_new = (value > constant);
-            break;
-          }
-          case llvm::CmpInst::ICMP_SLT:
-          case llvm::CmpInst::ICMP_ULT: {
-            find_new = (value < constant);
-            break;
-          }
-          case llvm::CmpInst::ICMP_SGE:
-          case llvm::CmpInst::ICMP_UGE: {
-            find_new = (value >= constant);
-            break;
-          }
-          case llvm::CmpInst::ICMP_SLE:
-          case llvm::CmpInst::ICMP_ULE: {
-            find_new = (value <= constant);
-            break;
-          }
-
-          default: {
-            outs() << "invalid predicate: " << pred << "\n";
-            break;
-          }
+        if (llvm::CmpInst::isIntPredicate((llvm::CmpInst::Predicate)pred)) {
+          find_new = ida::isConditionTrue(pred, bdDep->width, value, bdDep->constant);
+        }
+        else {
+          outs() << "invalid predicate: " << pred << "\n";
         }
       }
     }
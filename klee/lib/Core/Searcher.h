@@ -326,15 +326,16 @@ namespace klee {
     std::vector<unsigned> &TB;
     std::vector<unsigned> &FCB;
     std::vector<unsigned> &PCB;
+    std::unordered_set<unsigned> &PCBSet;
     unsigned &targetBranchNum;
     bool &updateTargetBranch;
     bool &newFullyCoveredBranch;
     bool &newPartlyCoveredBranch;
     unsigned &newBranchNumFromStore;
-    std::unordered_map<unsigned, std::unordered_set<signed>> &invalidStoreValues; 
+    std::unordered_map<unsigned, std::unordered_set<uint64_t>> &invalidStoreValues; 
     std::unordered_map<llvm::Function *, std::unordered_set<llvm::StoreInst *>> &funcStores;
     
-    std::unordered_map<unsigned, std::unordered_set<signed>> validStoreValues; 
+    std::unordered_map<unsigned, std::unordered_set<uint64_t>> validStoreValues; 
 
     std::unordered_set<unsigned> branches;
 
@@ -9,6 +9,7 @@
 
 #include "SpecialFunctionHandler.h"
 
+#include "CoreStats.h"
 #include "ExecutionState.h"
 #include "Executor.h"
 #include "Memory.h"
@@ -33,6 +34,7 @@
 #include "llvm/IR/Module.h"
 
 #include <errno.h>
+#include <cstring>
 #include <sstream>
 
 using namespace llvm;
@@ -53,6 +55,15 @@ cl::opt<bool>
                               "condition given to klee_assume() rather than "
                               "emitting an error (default=false)"),
                      cl::cat(TerminationCat));
+
+cl::opt<bool> LibcFastPaths(
+    "libc-fast-paths", cl::init(false),
+    cl::desc("Run memcpy, memmove, memset and strlen directly on the memory "
+             "of the state when all bytes involved are concrete, instead of "
+             "executing the C library. The instructions of the C library "
+             "functions that are skipped are not counted for coverage "
+             "(default=false)"),
+    cl::cat(MiscCat));
 } // namespace
 
 /// \todo Almost all of the demands in this file should be replaced
@@ -150,6 +161,16 @@ static SpecialFunctionHandler::HandlerInfo handlerInfo[] = {
 #undef add
 };
 
+static const struct {
+  const char *name;
+  SpecialFunctionHandler::FastPath fastPath;
+} fastPathInfo[] = {
+  { "memcpy", &SpecialFunctionHandler::fastMemcpy },
+  { "memmove", &SpecialFunctionHandler::fastMemcpy },
+  { "memset", &SpecialFunctionHandler::fastMemset },
+  { "strlen", &SpecialFunctionHandler::fastStrlen },
+};
+
 SpecialFunctionHandler::const_iterator SpecialFunctionHandler::begin() {
   return SpecialFunctionHandler::const_iterator(handlerInfo);
 }
@@ -178,6 +199,15 @@ int SpecialFunctionHandler::size() {
 SpecialFunctionHandler::SpecialFunctionHandler(Executor &_executor) 
   : executor(_executor) {}
 
+void SpecialFunctionHandler::recordProgramDefinitions(
+    const llvm::Module &program) {
+  for (auto &fp : fastPathInfo) {
+    const Function *f = program.getFunction(fp.name);
+    if (f && !f->isDeclaration())
+      programDefinedFunctions.insert(fp.name);
+  }
+}
+
 void SpecialFunctionHandler::prepare(
     std::vector<const char *> &preservedFunctions) {
   unsigned N = size();
@@ -213,6 +243,15 @@ void SpecialFunctionHandler::bind() {
     if (f && (!hi.doNotOverride || f->isDeclaration()))
       handlers[f] = std::make_pair(hi.handler, hi.hasReturnValue);
   }
+
+  if (LibcFastPaths) {
+    for (auto &fp : fastPathInfo) {
+      // the program's own implementation may behave differently
+      Function *f = executor.kmodule->module->getFunction(fp.name);
+      if (f && (f->isDeclaration() || !programDefinedFunctions.count(fp.name)))
+        fastPaths[f] = fp.fastPath;
+    }
+  }
 }
 
 
@@ -237,6 +276,21 @@ bool SpecialFunctionHandler::handle(ExecutionState &state,
   }
 }
 
+bool SpecialFunctionHandler::handleFastPath(ExecutionState &state,
+                                            Function *f,
+                                            KInstruction *target,
+                                            std::vector<ref<Expr>> &arguments) {
+  fast_paths_ty::iterator it = fastPaths.find(f);
+  if (it == fastPaths.end() || !isa<CallInst>(target->inst))
+    return false;
+
+  if (!(this->*(it->second))(state, target, arguments))
+    return false;
+
+  ++stats::libcFastPaths;
+  return true;
+}
+
 /****/
 
 // reads a concrete string from memory
@@ -287,6 +341,27 @@ SpecialFunctionHandler::readStringAtAddress(ExecutionState &state,
   return buf.str();
 }
 
+// Out of bounds and symbolic ranges are left to the C library, which
+// reports them.
+bool SpecialFunctionHandler::resolveConcreteRange(ExecutionState &state,
+                                                  ref<Expr> address,
+                                                  uint64_t size,
+                                                  ObjectPair &op,
+                                                  unsigned &offset) {
+  ConstantExpr *ce = dyn_cast<ConstantExpr>(address);
+  if (!ce || !state.addressSpace.resolveOne(ce, op))
+    return false;
+
+  const MemoryObject *mo = op.first;
+  uint64_t addr = ce->getZExtValue();
+  if (addr < mo->address || addr - mo->address > mo->size ||
+      size > mo->size - (addr - mo->address))
+    return false;
+
+  offset = addr - mo->address;
+  return true;
+}
+
 /****/
 
 void SpecialFunctionHandler::handleAbort(ExecutionState &state,
@@ -906,3 +981,103 @@ void SpecialFunctionHandler::handleDivRemOverflow(
   executor.terminateStateOnError(state, "overflow on division or remainder",
                                  StateTerminationType::Overflow);
 }
+
+/* Fast paths */
+
+// memcpy and memmove
+bool SpecialFunctionHandler::fastMemcpy(ExecutionState &state,
+                                        KInstruction *target,
+                                        std::vector<ref<Expr>> &arguments) {
+  if (arguments.size() != 3 || !isa<ConstantExpr>(arguments[2]))
+    return false;
+
+  uint64_t size = cast<ConstantExpr>(arguments[2])->getZExtValue();
+  ObjectPair dst, src;
+  unsigned dstOffset, srcOffset;
+  if (!resolveConcreteRange(state, arguments[0], size, dst, dstOffset) ||
+      !resolveConcreteRange(state, arguments[1], size, src, srcOffset) ||
+      dst.second->readOnly)
+    return false;
+
+  // through a buffer, the ranges may overlap
+  std::vector<uint8_t> bytes(size);
+  if (!src.second->readConcrete(srcOffset, bytes.data(), size))
+    return false;
+
+  ObjectState *wos = state.addressSpace.getWriteable(dst.first, dst.second);
+  wos->writeConcrete(dstOffset, bytes.data(), size);
+  executor.bindLocal(target, state, arguments[0]);
+  return true;
+}
+
+bool SpecialFunctionHandler::fastMemset(ExecutionState &state,
+                                        KInstruction *target,
+                                        std::vector<ref<Expr>> &arguments) {
+  if (arguments.size() != 3 || !isa<ConstantExpr>(arguments[1]) ||
+      !isa<ConstantExpr>(arguments[2]))
+    return false;
+
+  uint8_t value = cast<ConstantExpr>(arguments[1])->getZExtValue() & 0xFF;
+  uint64_t size = cast<ConstantExpr>(arguments[2])->getZExtValue();
+  ObjectPair dst;
+  unsigned dstOffset;
+  if (!resolveConcreteRange(state, arguments[0], size, dst, dstOffset) ||
+      dst.second->readOnly)
+    return false;
+
+  ObjectState *wos = state.addressSpace.getWriteable(dst.first, dst.second);
+  wos->fillConcrete(dstOffset, value, size);
+  executor.bindLocal(target, state, arguments[0]);
+  return true;
+}
+
+bool SpecialFunctionHandler::fastStrlen(ExecutionState &state,
+                                        KInstruction *target,
+                                        std::vector<ref<Expr>> &arguments) {
+  if (arguments.size() != 1)
+    return false;
+
+  ObjectPair op;
+  unsigned offset;
+  if (!resolveConcreteRange(state, arguments[0], 1, op, offset))
+    return false;
+
+  const ObjectState *os = op.second;
+  unsigned size = op.first->size;
+  uint8_t block[64];
+  for (unsigned i = offset; i < size;) {
+    unsigned n = std::min<unsigned>(sizeof(block), size - i);
+    unsigned length = 0;
+    bool terminated = false;
+
+    if (os->readConcrete(i, block, n)) {
+      if (auto *end = (const uint8_t *)memchr(block, 0, n)) {
+        length = i + (end - block) - offset;
+        terminated = true;
+      }
+    } else {
+      // symbolic bytes after the terminator do not matter
+      for (unsigned j = i; j < i + n && !terminated; j++) {
+        ConstantExpr *ce = dyn_cast<ConstantExpr>(os->read8(j));
+        if (!ce)
+          return false;
+        if (ce->isZero()) {
+          length = j - offset;
+          terminated = true;
+        }
+      }
+    }
+
+    if (terminated) {
+      executor.bindLocal(
+          target, state,
+          ConstantExpr::create(length, executor.getWidthForLLVMType(
+                                           target->inst->getType())));
+      return true;
+    }
+    i += n;
+  }
+
+  // not terminated inside the object
+  return false;
+}
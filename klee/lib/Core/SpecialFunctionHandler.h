@@ -14,11 +14,13 @@
 
 #include <iterator>
 #include <map>
+#include <set>
 #include <vector>
 #include <string>
 
 namespace llvm {
   class Function;
+  class Module;
 }
 
 namespace klee {
@@ -26,6 +28,8 @@ namespace klee {
   class Expr;
   class ExecutionState;
   struct KInstruction;
+  class MemoryObject;
+  class ObjectState;
   template<typename T> class ref;
   
   class SpecialFunctionHandler {
@@ -40,6 +44,20 @@ namespace klee {
     handlers_ty handlers;
     class Executor &executor;
 
+    /// A fast path runs a call to a C library function directly on concrete
+    /// memory and returns false if the call has to be executed normally.
+    typedef bool (SpecialFunctionHandler::*FastPath)(ExecutionState &state,
+                                                     KInstruction *target,
+                                                     std::vector<ref<Expr> >
+                                                       &arguments);
+    typedef std::map<const llvm::Function*, FastPath> fast_paths_ty;
+
+    fast_paths_ty fastPaths;
+
+    /// The C library functions with a fast path that the program defines
+    /// itself, rather than a linked library.
+    std::set<std::string> programDefinedFunctions;
+
     struct HandlerInfo {
       const char *name;
       SpecialFunctionHandler::Handler handler;
@@ -75,6 +93,11 @@ namespace klee {
   public:
     SpecialFunctionHandler(Executor &_executor);
 
+    /// Record the C library functions with a fast path that the program
+    /// module defines, before the libraries are linked into it. Calls to
+    /// them are always executed normally.
+    void recordProgramDefinitions(const llvm::Module &program);
+
     /// Perform any modifications on the LLVM module before it is
     /// prepared for execution. At the moment this involves deleting
     /// unused function bodies and marking intrinsics with appropriate
@@ -93,9 +116,26 @@ namespace klee {
                 KInstruction *target,
                 std::vector< ref<Expr> > &arguments);
 
+    /// Runs a call to memcpy, memmove, memset or strlen on concrete memory,
+    /// if the function is only declared or defined by a linked library.
+    /// Returns false if the call has to be executed normally, e.g. because a
+    /// byte is symbolic.
+    bool handleFastPath(ExecutionState &state,
+                        llvm::Function *f,
+                        KInstruction *target,
+                        std::vector< ref<Expr> > &arguments);
+
     /* Convenience routines */
 
     std::string readStringAtAddress(ExecutionState &state, ref<Expr> address);
+
+    /// Resolves the size bytes at a concrete address to one object and the
+    /// offset of the bytes in it.
+    bool resolveConcreteRange(ExecutionState &state, ref<Expr> address,
+                              uint64_t size,
+                              std::pair<const MemoryObject *,
+                                        const ObjectState *> &op,
+                              unsigned &offset);
     
     /* Handlers */
 
@@ -149,6 +189,16 @@ namespace klee {
     HANDLER(handleSubOverflow);
     HANDLER(handleDivRemOverflow);
 #undef HANDLER
+
+    /* Fast paths */
+
+#define FAST_PATH(name) bool name(ExecutionState &state, \
+                                  KInstruction *target, \
+                                  std::vector< ref<Expr> > &arguments)
+    FAST_PATH(fastMemcpy);
+    FAST_PATH(fastMemset);
+    FAST_PATH(fastStrlen);
+#undef FAST_PATH
   };
 } // End klee namespace
 
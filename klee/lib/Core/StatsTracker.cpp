@@ -314,6 +314,7 @@ StatsTracker::~StatsTracker() {
     sqlite3_finalize(transactionBeginStmt);
     sqlite3_finalize(transactionEndStmt);
     sqlite3_finalize(insertStmt);
+    sqlite3_finalize(solverChainInsertStmt);
     sqlite3_close(statsFile);
   }
 }
@@ -472,7 +473,18 @@ void StatsTracker::writeStatsHeader() {
              << "symbolicConstrants INTEGER,"
              << "concreteConstrants INTEGER,"
              << "fullyCoveredSymbolicConstrants INTEGER,"
-             << "fullyCoveredConcreteConstrants INTEGER"
+             << "fullyCoveredConcreteConstrants INTEGER,"
+             << "ResolutionCacheHits INTEGER,"
+             << "ResolutionCacheMisses INTEGER,"
+             << "PersistentCacheHits INTEGER,"
+             << "PersistentCacheMisses INTEGER,"
+             << "CanonicalizationTime INTEGER,"
+             << "QueryCexCacheEvictions INTEGER,"
+             << "CexCacheLookupP50 INTEGER,"
+             << "CexCacheLookupP90 INTEGER,"
+             << "CexCacheLookupP99 INTEGER,"
+             << "SpeculativeQueries INTEGER,"
+             << "SpeculativeHits INTEGER"
          << ')';
   char *zErrMsg = nullptr;
   if(sqlite3_exec(statsFile, create.str().c_str(), nullptr, nullptr, &zErrMsg)) {
@@ -512,7 +524,18 @@ void StatsTracker::writeStatsHeader() {
              << "symbolicConstrants,"
              << "concreteConstrants,"
              << "fullyCoveredSymbolicConstrants,"
-             << "fullyCoveredConcreteConstrants" 
+             << "fullyCoveredConcreteConstrants,"
+             << "ResolutionCacheHits,"
+             << "ResolutionCacheMisses,"
+             << "PersistentCacheHits,"
+             << "PersistentCacheMisses,"
+             << "CanonicalizationTime,"
+             << "QueryCexCacheEvictions,"
+             << "CexCacheLookupP50,"
+             << "CexCacheLookupP90,"
+             << "CexCacheLookupP99,"
+             << "SpeculativeQueries,"
+             << "SpeculativeHits"
          << ") VALUES ("
              << "?,"
              << "?,"
@@ -540,12 +563,85 @@ void StatsTracker::writeStatsHeader() {
              << "?,"
              << "?,"
              << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
+             << "?,"
              << "?"
          << ')';
 
   if(sqlite3_prepare_v2(statsFile, insert.str().c_str(), -1, &insertStmt, nullptr) != SQLITE_OK) {
     klee_error("Cannot create prepared statement: %s", sqlite3_errmsg(statsFile));
   }
+
+  if (!stats::solverLayers.empty())
+    writeSolverChainHeader();
+}
+
+void StatsTracker::writeSolverChainHeader() {
+  // one row per layer of the solver chain (-solver-chain-stats) and row of
+  // the stats table; times are in microseconds, latencies in nanoseconds
+  std::ostringstream create, insert;
+  create << "CREATE TABLE solver_chain ("
+             << "StatsRow INTEGER,"
+             << "WallTime INTEGER,"
+             << "Layer TEXT,"
+             << "Depth INTEGER,"
+             << "Queries INTEGER,"
+             << "Hits INTEGER,"
+             << "Time INTEGER,"
+             << "SelfTime INTEGER,"
+             << "LatencyP50 INTEGER,"
+             << "LatencyP90 INTEGER,"
+             << "LatencyP99 INTEGER,"
+             << "ExprNodes INTEGER"
+         << ')';
+  char *zErrMsg = nullptr;
+  if (sqlite3_exec(statsFile, create.str().c_str(), nullptr, nullptr, &zErrMsg)) {
+    klee_error("%s", sqlite3ErrToStringAndFree("ERROR creating table: ", zErrMsg).c_str());
+  }
+
+  insert << "INSERT OR FAIL INTO solver_chain VALUES (?,?,?,?,?,?,?,?,?,?,?,?)";
+  if (sqlite3_prepare_v2(statsFile, insert.str().c_str(), -1, &solverChainInsertStmt, nullptr) != SQLITE_OK) {
+    klee_error("Cannot create prepared statement: %s", sqlite3_errmsg(statsFile));
+  }
+}
+
+void StatsTracker::writeSolverChainLines() {
+  sqlite3_int64 statsRow = sqlite3_last_insert_rowid(statsFile);
+  std::uint64_t wallTime = elapsed().toMicroseconds();
+
+  for (auto &layer : stats::solverLayers) {
+    std::uint64_t selfTime = layer.time;
+    if (layer.next)
+      selfTime -= std::min(selfTime, layer.next->time);
+
+    sqlite3_bind_int64(solverChainInsertStmt, 1, statsRow);
+    sqlite3_bind_int64(solverChainInsertStmt, 2, wallTime);
+    sqlite3_bind_text(solverChainInsertStmt, 3, layer.name.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(solverChainInsertStmt, 4, layer.depth);
+    sqlite3_bind_int64(solverChainInsertStmt, 5, layer.queries);
+    sqlite3_bind_int64(solverChainInsertStmt, 6, layer.hits);
+    sqlite3_bind_int64(solverChainInsertStmt, 7, layer.time / 1000);
+    sqlite3_bind_int64(solverChainInsertStmt, 8, selfTime / 1000);
+    // the queries since the previous row
+    sqlite3_bind_int64(solverChainInsertStmt, 9, layer.latency.getPercentile(50));
+    sqlite3_bind_int64(solverChainInsertStmt, 10, layer.latency.getPercentile(90));
+    sqlite3_bind_int64(solverChainInsertStmt, 11, layer.latency.getPercentile(99));
+    sqlite3_bind_int64(solverChainInsertStmt, 12, layer.exprNodes);
+    layer.latency.clear();
+
+    int errCode = sqlite3_step(solverChainInsertStmt);
+    if (errCode != SQLITE_DONE) klee_error("Error writing solver chain stats: %s", sqlite3_errmsg(statsFile));
+    sqlite3_reset(solverChainInsertStmt);
+  }
 }
 
 time::Span StatsTracker::elapsed() {
@@ -585,11 +681,27 @@ void StatsTracker::writeStatsLine() {
   sqlite3_bind_int64(insertStmt, 25, executor.concreteConstrants.size());
   sqlite3_bind_int64(insertStmt, 26, executor.fullyCoveredSymbolicConstrants.size());
   sqlite3_bind_int64(insertStmt, 27, executor.fullyCoveredConcreteConstrants.size());
+  sqlite3_bind_int64(insertStmt, 28, stats::resolutionCacheHits);
+  sqlite3_bind_int64(insertStmt, 29, stats::resolutionCacheMisses);
+  sqlite3_bind_int64(insertStmt, 30, stats::persistentCacheHits);
+  sqlite3_bind_int64(insertStmt, 31, stats::persistentCacheMisses);
+  sqlite3_bind_int64(insertStmt, 32, stats::canonicalizationTime);
+  sqlite3_bind_int64(insertStmt, 33, stats::queryCexCacheEvictions);
+  // the lookups since the previous row
+  sqlite3_bind_int64(insertStmt, 34, stats::cexCacheLookupTime.getPercentile(50));
+  sqlite3_bind_int64(insertStmt, 35, stats::cexCacheLookupTime.getPercentile(90));
+  sqlite3_bind_int64(insertStmt, 36, stats::cexCacheLookupTime.getPercentile(99));
+  stats::cexCacheLookupTime.clear();
+  sqlite3_bind_int64(insertStmt, 37, stats::speculativeQueries);
+  sqlite3_bind_int64(insertStmt, 38, stats::speculativeHits);
   
   int errCode = sqlite3_step(insertStmt);
   if(errCode != SQLITE_DONE) klee_error("Error writing stats data: %s", sqlite3_errmsg(statsFile));
   sqlite3_reset(insertStmt);
 
+  if (solverChainInsertStmt)
+    writeSolverChainLines();
+
   statsWriteCount++;
   if(statsWriteCount == statsCommitEvery) {
     errCode = sqlite3_step(transactionEndStmt);
@@ -44,6 +44,7 @@ namespace klee {
     ::sqlite3_stmt *transactionBeginStmt = nullptr;
     ::sqlite3_stmt *transactionEndStmt = nullptr;
     ::sqlite3_stmt *insertStmt = nullptr;
+    ::sqlite3_stmt *solverChainInsertStmt = nullptr;
     std::uint32_t statsCommitEvery;
     std::uint32_t statsWriteCount = 0;
     time::Point startWallTime;
@@ -63,6 +64,8 @@ namespace klee {
     void updateStateStatistics(uint64_t addend);
     void writeStatsHeader();
     void writeStatsLine();
+    void writeSolverChainHeader();
+    void writeSolverChainLines();
     void writeIStats();
 
   public:
@@ -125,6 +125,34 @@ bool TimingSolver::getInitialValues(
   return success;
 }
 
+void TimingSolver::speculate(const ConstraintSet &constraints,
+                             ref<Expr> expr) {
+  if (isa<ConstantExpr>(expr))
+    return;
+
+  TimerStatIncrementer timer(stats::solverTime);
+
+  // the same query as mustBeTrue() and evaluate() ask, which they answer
+  // without the solver if it simplifies to a constant
+  if (simplifyExprs)
+    expr = ConstraintManager::simplifyExpr(constraints, expr);
+  if (isa<ConstantExpr>(expr))
+    return;
+
+  solver->speculate(Query(constraints, expr));
+}
+
+void TimingSolver::speculateMayBeTrue(const ConstraintSet &constraints,
+                                      ref<Expr> expr) {
+  // mayBeTrue() asks mustBeFalse(), which asks mustBeTrue() for !expr
+  speculate(constraints, Expr::createIsZero(expr));
+}
+
+void TimingSolver::speculateInitialValues(const ConstraintSet &constraints) {
+  TimerStatIncrementer timer(stats::solverTime);
+  solver->speculate(Query(constraints, ConstantExpr::alloc(0, Expr::Bool)));
+}
+
 std::pair<ref<Expr>, ref<Expr>>
 TimingSolver::getRange(const ConstraintSet &constraints, ref<Expr> expr,
                        SolverQueryMetaData &metaData) {
@@ -70,6 +70,16 @@ public:
   std::pair<ref<Expr>, ref<Expr>> getRange(const ConstraintSet &,
                                            ref<Expr> query,
                                            SolverQueryMetaData &metaData);
+
+  /// Hints that mustBeTrue() or evaluate() will probably be asked for expr
+  /// soon, see Solver::speculate().
+  void speculate(const ConstraintSet &, ref<Expr> expr);
+
+  /// Hints that mayBeTrue() will probably be asked for expr soon.
+  void speculateMayBeTrue(const ConstraintSet &, ref<Expr> expr);
+
+  /// Hints that getInitialValues() will probably be asked soon.
+  void speculateInitialValues(const ConstraintSet &);
 };
 }
 
@@ -0,0 +1,151 @@
+//===-- ConstraintPartitions.cpp ------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Expr/ConstraintPartitions.h"
+
+#include "klee/Expr/ExprUtil.h"
+
+#include <algorithm>
+
+using namespace klee;
+
+constexpr std::uint64_t ConstraintPartitions::WholeArray;
+
+ConstraintPartitions::ConstraintPartitions() = default;
+ConstraintPartitions::ConstraintPartitions(const ConstraintPartitions &) =
+    default;
+ConstraintPartitions &
+ConstraintPartitions::operator=(const ConstraintPartitions &) = default;
+ConstraintPartitions::~ConstraintPartitions() = default;
+
+void ConstraintPartitions::getElements(const ref<Expr> &e,
+                                       std::vector<Element> &elements) {
+  std::vector<ref<ReadExpr>> reads;
+  findReads(e, /* visitUpdates= */ true, reads);
+  for (const auto &re : reads) {
+    const Array *array = re->updates.root;
+    if (array->isConstantArray() && !re->updates.head)
+      continue;
+
+    if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(re->index))
+      elements.emplace_back(array, CE->getZExtValue(32));
+    else
+      elements.emplace_back(array, WholeArray);
+  }
+
+  std::sort(elements.begin(), elements.end());
+  elements.erase(std::unique(elements.begin(), elements.end()),
+                 elements.end());
+}
+
+unsigned ConstraintPartitions::find(unsigned node) const {
+  while (const auto *parent = parents.lookup(node))
+    node = parent->second;
+  return node;
+}
+
+unsigned ConstraintPartitions::unite(unsigned a, unsigned b) {
+  a = find(a);
+  b = find(b);
+  if (a == b)
+    return a;
+
+  std::size_t wa = weights.lookup(a)->second, wb = weights.lookup(b)->second;
+  if (wa < wb) {
+    std::swap(a, b);
+    std::swap(wa, wb);
+  }
+
+  // the constraints of the lighter partition move to the heavier one
+  std::vector<std::size_t> moved;
+  for (auto it = members.lower_bound(std::make_pair(b, 0)), ie = members.end();
+       it != ie && it->first == b; ++it)
+    moved.push_back(it->second);
+  for (std::size_t position : moved)
+    members = members.remove(std::make_pair(b, position))
+                  .insert(std::make_pair(a, position));
+
+  weights = weights.remove(b).replace(std::make_pair(a, wa + wb));
+  parents = parents.insert(std::make_pair(b, a));
+  return a;
+}
+
+unsigned ConstraintPartitions::getNode(const Element &element) {
+  if (const auto *node = nodes.lookup(element))
+    return node->second;
+
+  unsigned node = numNodes++;
+  nodes = nodes.insert(std::make_pair(element, node));
+  weights = weights.insert(std::make_pair(node, 1));
+
+  const Array *array = element.first;
+  if (element.second == WholeArray) {
+    // the whole array overlaps with each byte of it seen so far
+    for (auto it = nodes.lower_bound(Element(array, 0)), ie = nodes.end();
+         it != ie && it->first.first == array; ++it) {
+      if (it->first.second != WholeArray)
+        node = unite(node, it->second);
+    }
+  } else if (const auto *whole = nodes.lookup(Element(array, WholeArray))) {
+    node = unite(node, whole->second);
+  }
+  return node;
+}
+
+void ConstraintPartitions::add(std::size_t position,
+                               const ref<Expr> &constraint) {
+  std::vector<Element> elements;
+  getElements(constraint, elements);
+  if (elements.empty())
+    return;
+
+  unsigned root = getNode(elements[0]);
+  for (unsigned i = 1; i < elements.size(); i++)
+    root = unite(root, getNode(elements[i]));
+  root = find(root);
+
+  members = members.insert(std::make_pair(root, position));
+  weights = weights.replace(
+      std::make_pair(root, weights.lookup(root)->second + 1));
+}
+
+void ConstraintPartitions::getPartition(
+    const ref<Expr> &expr, std::vector<std::size_t> &positions) const {
+  std::vector<Element> elements;
+  getElements(expr, elements);
+
+  std::vector<unsigned> roots;
+  for (const auto &element : elements) {
+    const Array *array = element.first;
+    if (element.second == WholeArray) {
+      for (auto it = nodes.lower_bound(Element(array, 0)), ie = nodes.end();
+           it != ie && it->first.first == array; ++it)
+        roots.push_back(find(it->second));
+      continue;
+    }
+
+    if (const auto *node = nodes.lookup(element))
+      roots.push_back(find(node->second));
+    if (const auto *whole = nodes.lookup(Element(array, WholeArray)))
+      roots.push_back(find(whole->second));
+  }
+  std::sort(roots.begin(), roots.end());
+  roots.erase(std::unique(roots.begin(), roots.end()), roots.end());
+
+  std::size_t first = positions.size();
+  for (unsigned root : roots) {
+    for (auto it = members.lower_bound(std::make_pair(root, 0)),
+              ie = members.end();
+         it != ie && it->first == root; ++it)
+      positions.push_back(it->second);
+  }
+  // the partitions are disjoint, but each of them is sorted on its own
+  if (roots.size() > 1)
+    std::sort(positions.begin() + first, positions.end());
+}
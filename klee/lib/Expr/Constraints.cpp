@@ -16,6 +16,7 @@
 #include "llvm/IR/Function.h"
 #include "llvm/Support/CommandLine.h"
 
+#include <algorithm>
 #include <map>
 
 using namespace klee;
@@ -86,6 +87,10 @@ bool ConstraintManager::rewriteConstraints(ExprVisitor &visitor) {
     }
   }
 
+  // keep the shared blocks and the partitions of the unchanged set
+  if (!changed)
+    constraints = old;
+
   return changed;
 }
 
@@ -163,16 +168,91 @@ void ConstraintManager::addConstraint(const ref<Expr> &e) {
 ConstraintManager::ConstraintManager(ConstraintSet &_constraints)
     : constraints(_constraints) {}
 
-bool ConstraintSet::empty() const { return constraints.empty(); }
+ConstraintSet::ConstraintSet(const constraints_ty &cs) {
+  for (auto &e : cs)
+    push_back(e);
+}
+
+bool ConstraintSet::empty() const { return count == 0; }
 
 klee::ConstraintSet::constraint_iterator ConstraintSet::begin() const {
-  return constraints.begin();
+  updateBlocks();
+  return const_iterator(blocks.data(), 0);
 }
 
 klee::ConstraintSet::constraint_iterator ConstraintSet::end() const {
-  return constraints.end();
+  updateBlocks();
+  return const_iterator(blocks.data(), count);
+}
+
+size_t ConstraintSet::size() const noexcept { return count; }
+
+void ConstraintSet::push_back(const ref<Expr> &e) {
+  unsigned used = count % BlockSize;
+  bool inSync = !blocks.empty() && blocks.back() == tail.get();
+
+  if (used == 0) {
+    // tail is full (or there is none yet): start a new block after it
+    tail = new Block(tail);
+    if (inSync || count == 0)
+      blocks.push_back(tail.get());
+  } else if (tail->count != used) {
+    // a copy of this set already appended to the tail
+    if (tail->_refCount.getCount() == 1) {
+      for (unsigned i = used; i < tail->count; i++)
+        tail->exprs[i] = ref<Expr>();
+      tail->count = used;
+    } else {
+      ref<Block> copy(new Block(tail->parent));
+      std::copy(tail->exprs, tail->exprs + used, copy->exprs);
+      copy->count = used;
+      tail = copy;
+      if (inSync)
+        blocks.back() = tail.get();
+    }
+  }
+
+  tail->exprs[tail->count++] = e;
+  count++;
+
+  if (hasPartitions)
+    partitions.add(count - 1, e);
+
+  if (blocks.empty() || blocks.back() != tail.get())
+    blocks.clear();
 }
 
-size_t ConstraintSet::size() const noexcept { return constraints.size(); }
+void ConstraintSet::updateBlocks() const {
+  size_t n = (count + BlockSize - 1) / BlockSize;
+  if (blocks.size() == n)
+    return;
 
-void ConstraintSet::push_back(const ref<Expr> &e) { constraints.push_back(e); }
+  blocks.resize(n);
+  const Block *block = tail.get();
+  for (size_t i = n; i > 0; i--, block = block->parent.get())
+    blocks[i - 1] = block;
+}
+
+void ConstraintSet::getIndependentConstraints(
+    const ref<Expr> &expr, std::vector<ref<Expr>> &result) const {
+  updateBlocks();
+  if (!hasPartitions) {
+    for (size_t i = 0; i < count; i++)
+      partitions.add(i, blocks[i / BlockSize]->exprs[i % BlockSize]);
+    hasPartitions = true;
+  }
+
+  std::vector<size_t> positions;
+  partitions.getPartition(expr, positions);
+  result.reserve(result.size() + positions.size());
+  for (size_t i : positions)
+    result.push_back(blocks[i / BlockSize]->exprs[i % BlockSize]);
+}
+
+bool ConstraintSet::operator==(const ConstraintSet &b) const {
+  if (count != b.count)
+    return false;
+  if (tail.get() == b.tail.get())
+    return true;
+  return std::equal(begin(), end(), b.begin());
+}
@@ -11,6 +11,7 @@
 
 #include "klee/Config/Version.h"
 #include "klee/Expr/ExprPPrinter.h"
+#include "klee/Expr/ExprStats.h"
 #include "klee/Support/OptionCategories.h"
 // FIXME: We shouldn't need this once fast constant support moves into
 // Core. If we need to do arithmetic, we probably want to use APInt.
@@ -193,6 +194,36 @@ unsigned Expr::computeHash() {
   return hashValue;
 }
 
+ConstantExpr *ConstantExpr::getInterned(uint64_t v, Width w) {
+  unsigned index;
+  switch (w) {
+  case Expr::Bool: index = 0; break;
+  case Expr::Int8: index = 1; break;
+  case Expr::Int16: index = 2; break;
+  case Expr::Int32: index = 3; break;
+  case Expr::Int64: index = 4; break;
+  default: return nullptr;
+  }
+
+  // never freed, so that interned constants outlive all other expressions
+  static auto *interned = new ref<ConstantExpr>[5][InternedLimit];
+
+  ref<ConstantExpr> &c = interned[index][v];
+  if (c.isNull()) {
+    c = new ConstantExpr(llvm::APInt(w, v));
+    c->computeHash();
+  }
+  ++stats::internedConstants;
+  return c.get();
+}
+
+ref<ConstantExpr> ConstantExpr::allocNew(const llvm::APInt &v) {
+  ++stats::constantAllocations;
+  ref<ConstantExpr> r(new ConstantExpr(v));
+  r->computeHash();
+  return r;
+}
+
 unsigned ConstantExpr::computeHash() {
   Expr::Width w = getWidth();
   if (w <= 64)
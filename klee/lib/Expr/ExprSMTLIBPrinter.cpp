@@ -654,10 +654,8 @@ void ExprSMTLIBPrinter::printQueryInSingleAssert() {
   ref<Expr> queryAssert = Expr::createIsZero(query->expr);
 
   // Print constraints inside the main query to reuse the Expr bindings
-  for (std::vector<ref<Expr> >::const_iterator i = query->constraints.begin(),
-                                               e = query->constraints.end();
-       i != e; ++i) {
-    queryAssert = AndExpr::create(queryAssert, *i);
+  for (const auto &constraint : query->constraints) {
+    queryAssert = AndExpr::create(queryAssert, constraint);
   }
 
   // print just a single (assert ...) containing entire query
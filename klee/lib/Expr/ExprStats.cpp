@@ -0,0 +1,15 @@
+//===-- ExprStats.cpp -----------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Expr/ExprStats.h"
+
+using namespace klee;
+
+Statistic stats::constantAllocations("ConstantAllocations", "Calloc");
+Statistic stats::internedConstants("InternedConstants", "Cinterned");
@@ -108,7 +108,8 @@ namespace {
     const std::string Filename;
     const MemoryBuffer *TheMemoryBuffer;
     ExprBuilder *Builder;
-    ArrayCache TheArrayCache;
+    ArrayCache OwnArrayCache;
+    ArrayCache &TheArrayCache;
     bool ClearArrayAfterQuery;
 
     Lexer TheLexer;
@@ -322,8 +323,10 @@ namespace {
 
   public:
     ParserImpl(const std::string _Filename, const MemoryBuffer *MB,
-               ExprBuilder *_Builder, bool _ClearArrayAfterQuery)
+               ExprBuilder *_Builder, ArrayCache *_ArrayCache,
+               bool _ClearArrayAfterQuery)
         : Filename(_Filename), TheMemoryBuffer(MB), Builder(_Builder),
+          TheArrayCache(_ArrayCache ? *_ArrayCache : OwnArrayCache),
           ClearArrayAfterQuery(_ClearArrayAfterQuery), TheLexer(MB),
           MaxErrors(~0u), NumErrors(0) {}
 
@@ -1647,7 +1650,14 @@ Parser::~Parser() {
 
 Parser *Parser::Create(const std::string Filename, const MemoryBuffer *MB,
                        ExprBuilder *Builder, bool ClearArrayAfterQuery) {
-  ParserImpl *P = new ParserImpl(Filename, MB, Builder, ClearArrayAfterQuery);
+  return Create(Filename, MB, Builder, nullptr, ClearArrayAfterQuery);
+}
+
+Parser *Parser::Create(const std::string Filename, const MemoryBuffer *MB,
+                       ExprBuilder *Builder, ArrayCache *Cache,
+                       bool ClearArrayAfterQuery) {
+  ParserImpl *P =
+      new ParserImpl(Filename, MB, Builder, Cache, ClearArrayAfterQuery);
   P->Initialize();
   return P;
 }
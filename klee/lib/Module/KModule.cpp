@@ -310,6 +310,13 @@ void KModule::manifest(InterpreterHandler *ih, bool forceSourceOutput) {
     for (unsigned i=0; i<kf->numInstructions; ++i) {
       KInstruction *ki = kf->instructions[i];
       ki->info = &infos->getInfo(*ki->inst);
+
+      ki->opcode = ki->inst->getOpcode();
+      if (auto *ci = dyn_cast<CmpInst>(ki->inst))
+        ki->predicate = ci->getPredicate();
+      Type *type = ki->inst->getType();
+      if (type->isSized())
+        ki->width = targetData->getTypeSizeInBits(type);
     }
 
     functionMap.insert(std::make_pair(&Function, kf.get()));
@@ -35,6 +35,7 @@ public:
   SolverRunStatus getOperationStatusCode();
   char *getConstraintLog(const Query &);
   void setCoreSolverTimeout(time::Span timeout);
+  void speculate(const Query &query) { solver->impl->speculate(query); }
 };
 
 // TODO: use computeInitialValues for all queries for more stress testing
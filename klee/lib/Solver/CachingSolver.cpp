@@ -86,6 +86,7 @@ public:
   SolverRunStatus getOperationStatusCode();
   char *getConstraintLog(const Query&);
   void setCoreSolverTimeout(time::Span timeout);
+  void speculate(const Query& query);
 };
 
 /** @returns the canonical version of the given query.  The reference
@@ -241,6 +242,14 @@ bool CachingSolver::computeTruth(const Query& query,
   return true;
 }
 
+void CachingSolver::speculate(const Query& query) {
+  // as in computeTruth, initial values are not cached here
+  IncompleteSolver::PartialValidity cachedResult;
+  if (query.expr->isFalse() || !cacheLookup(query, cachedResult) ||
+      cachedResult == IncompleteSolver::MayBeTrue)
+    solver->impl->speculate(query);
+}
+
 SolverImpl::SolverRunStatus CachingSolver::getOperationStatusCode() {
   return solver->impl->getOperationStatusCode();
 }
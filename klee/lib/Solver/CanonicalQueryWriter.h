@@ -0,0 +1,141 @@
+//===-- CanonicalQueryWriter.h ----------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_CANONICALQUERYWRITER_H
+#define KLEE_CANONICALQUERYWRITER_H
+
+#include "klee/Expr/Expr.h"
+
+#include "llvm/Support/MD5.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace klee {
+
+typedef std::array<uint8_t, 16> QueryDigest;
+
+/// Writes expressions in a binary form that does not depend on the names of
+/// their arrays: arrays are written by their contents, or numbered by their
+/// first occurrence. Shared subexpressions are written once and referred to
+/// by number, so the output is linear in the size of the expression DAG.
+class CanonicalQueryWriter {
+  std::string &out;
+  /// The numbers of the arrays in the order of their first occurrence, or
+  /// null to write arrays by their contents only
+  std::unordered_map<const Array *, uint32_t> *arrays;
+  std::unordered_map<const Expr *, uint32_t> exprs;
+  std::unordered_map<const UpdateNode *, uint32_t> updates;
+  uint32_t nextId = 0;
+
+  void write(uint32_t v) { out.append((const char *)&v, sizeof(v)); }
+
+  void writeConstant(const ConstantExpr &ce) {
+    const llvm::APInt &value = ce.getAPValue();
+    write(value.getBitWidth());
+    for (unsigned i = 0; i < value.getNumWords(); i++) {
+      uint64_t word = value.getRawData()[i];
+      out.append((const char *)&word, sizeof(word));
+    }
+  }
+
+  uint32_t writeUpdates(const ref<UpdateNode> &un) {
+    if (un.isNull())
+      return ~0u;
+    auto it = updates.find(un.get());
+    if (it != updates.end())
+      return it->second;
+
+    uint32_t next = writeUpdates(un->next);
+    uint32_t index = writeExpr(un->index);
+    uint32_t value = writeExpr(un->value);
+    uint32_t id = nextId++;
+    // updates are told apart from expressions by an invalid kind
+    write(Expr::LastKind + 1);
+    write(next);
+    write(index);
+    write(value);
+    updates.emplace(un.get(), id);
+    return id;
+  }
+
+public:
+  CanonicalQueryWriter(std::string &out,
+                       std::unordered_map<const Array *, uint32_t> *arrays)
+      : out(out), arrays(arrays) {}
+
+  void writeArray(const Array *array) {
+    if (arrays) {
+      auto it = arrays->find(array);
+      if (it != arrays->end()) {
+        write(0);
+        write(it->second);
+        return;
+      }
+      uint32_t id = arrays->size();
+      arrays->emplace(array, id);
+      write(1);
+      write(id);
+    }
+    write(array->size);
+    write(array->domain);
+    write(array->range);
+    write(array->constantValues.size());
+    for (const auto &value : array->constantValues)
+      writeConstant(*value);
+  }
+
+  uint32_t writeExpr(const ref<Expr> &e) {
+    auto it = exprs.find(e.get());
+    if (it != exprs.end())
+      return it->second;
+
+    std::vector<uint32_t> kids;
+    for (unsigned i = 0; i < e->getNumKids(); i++)
+      kids.push_back(writeExpr(e->getKid(i)));
+
+    uint32_t updateId = ~0u;
+    if (const ReadExpr *re = dyn_cast<ReadExpr>(e))
+      updateId = writeUpdates(re->updates.head);
+
+    uint32_t id = nextId++;
+    write(e->getKind());
+    write(e->getWidth());
+    for (uint32_t kid : kids)
+      write(kid);
+
+    if (const ConstantExpr *ce = dyn_cast<ConstantExpr>(e)) {
+      writeConstant(*ce);
+    } else if (const ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+      writeArray(re->updates.root);
+      write(updateId);
+    } else if (const ExtractExpr *ee = dyn_cast<ExtractExpr>(e)) {
+      write(ee->offset);
+    }
+
+    exprs.emplace(e.get(), id);
+    return id;
+  }
+};
+
+/// Returns the MD5 digest of data written by a CanonicalQueryWriter.
+inline QueryDigest computeDigest(const std::string &data) {
+  llvm::MD5 md5;
+  md5.update(llvm::StringRef(data));
+  llvm::MD5::MD5Result result;
+  md5.final(result);
+  return result.Bytes;
+}
+
+} // namespace klee
+
+#endif /* KLEE_CANONICALQUERYWRITER_H */
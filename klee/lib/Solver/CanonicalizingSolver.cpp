@@ -0,0 +1,247 @@
+//===-- CanonicalizingSolver.cpp ------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CanonicalQueryWriter.h"
+
+#include "klee/Solver/Solver.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Expr/ExprVisitor.h"
+#include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+#include "klee/Statistics/TimerStatIncrementer.h"
+
+#include "llvm/ADT/StringExtras.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace klee;
+
+namespace {
+
+class CanonicalizingSolver;
+
+/// Renames the arrays of one query to canonical arrays, numbered by their
+/// first occurrence.
+class ArrayRenamer : public ExprVisitor {
+  CanonicalizingSolver &solver;
+  std::unordered_map<const Array *, const Array *> arrays;
+  std::unordered_map<const UpdateNode *, ref<UpdateNode>> updates;
+  unsigned numSymbolic = 0;
+
+  ref<UpdateNode> renameUpdates(const ref<UpdateNode> &un);
+
+public:
+  explicit ArrayRenamer(CanonicalizingSolver &solver) : solver(solver) {}
+
+  const Array *rename(const Array *array);
+
+  Action visitRead(const ReadExpr &re) override;
+};
+
+class CanonicalizingSolver : public SolverImpl {
+  friend class ArrayRenamer;
+
+  Solver *solver;
+  /// Owns the canonical arrays, which the caches below keep using
+  ArrayCache arrayCache;
+  /// The canonical constant arrays, by their contents
+  std::unordered_map<std::string, const Array *> constantArrays;
+
+  const Array *getSymbolicArray(unsigned n, const Array *array);
+  const Array *getConstantArray(const Array *array);
+
+  /// Sorts the constraints of query by their structure and renames its
+  /// arrays in the order of their first occurrence in the sorted query.
+  ref<Expr> canonicalize(const Query &query, ArrayRenamer &renamer,
+                         std::vector<ref<Expr>> &constraints);
+
+public:
+  explicit CanonicalizingSolver(Solver *solver) : solver(solver) {}
+  ~CanonicalizingSolver() { delete solver; }
+
+  bool computeTruth(const Query &, bool &isValid);
+  bool computeValidity(const Query &, Solver::Validity &result);
+  bool computeValue(const Query &, ref<Expr> &result);
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char>> &values,
+                            bool &hasSolution);
+  SolverRunStatus getOperationStatusCode();
+  char *getConstraintLog(const Query &);
+  void setCoreSolverTimeout(time::Span timeout);
+  void speculate(const Query &query);
+};
+
+} // namespace
+
+const Array *ArrayRenamer::rename(const Array *array) {
+  auto it = arrays.find(array);
+  if (it != arrays.end())
+    return it->second;
+
+  const Array *canonical = array->isSymbolicArray()
+                               ? solver.getSymbolicArray(numSymbolic++, array)
+                               : solver.getConstantArray(array);
+  arrays.emplace(array, canonical);
+  return canonical;
+}
+
+ref<UpdateNode> ArrayRenamer::renameUpdates(const ref<UpdateNode> &un) {
+  if (un.isNull())
+    return un;
+  auto it = updates.find(un.get());
+  if (it != updates.end())
+    return it->second;
+
+  ref<UpdateNode> next = renameUpdates(un->next);
+  ref<Expr> index = visit(un->index), value = visit(un->value);
+  ref<UpdateNode> renamed = un;
+  if (next.get() != un->next.get() || index.get() != un->index.get() ||
+      value.get() != un->value.get())
+    renamed = new UpdateNode(next, index, value);
+  updates.emplace(un.get(), renamed);
+  return renamed;
+}
+
+ExprVisitor::Action ArrayRenamer::visitRead(const ReadExpr &re) {
+  const Array *root = rename(re.updates.root);
+  ref<UpdateNode> head = renameUpdates(re.updates.head);
+  ref<Expr> index = visit(re.index);
+  if (root == re.updates.root && head.get() == re.updates.head.get() &&
+      index.get() == re.index.get())
+    return Action::skipChildren();
+  return Action::changeTo(ReadExpr::create(UpdateList(root, head), index));
+}
+
+const Array *CanonicalizingSolver::getSymbolicArray(unsigned n,
+                                                    const Array *array) {
+  // the array cache returns the same array for the same name and type
+  return arrayCache.CreateArray("canonical_arr" + llvm::utostr(n), array->size,
+                                nullptr, nullptr, array->domain,
+                                array->range);
+}
+
+const Array *CanonicalizingSolver::getConstantArray(const Array *array) {
+  std::string contents;
+  CanonicalQueryWriter(contents, nullptr).writeArray(array);
+  const Array *&canonical = constantArrays[contents];
+  if (!canonical) {
+    std::string name =
+        "canonical_const_arr" + llvm::utostr(constantArrays.size());
+    canonical = arrayCache.CreateArray(
+        name, array->size, array->constantValues.data(),
+        array->constantValues.data() + array->constantValues.size(),
+        array->domain, array->range);
+  }
+  return canonical;
+}
+
+ref<Expr> CanonicalizingSolver::canonicalize(
+    const Query &query, ArrayRenamer &renamer,
+    std::vector<ref<Expr>> &constraints) {
+  TimerStatIncrementer t(stats::canonicalizationTime);
+
+  // writing out the constraints to sort them is most of the work, skip it
+  // when there is nothing to sort
+  if (query.constraints.size() < 2) {
+    for (const auto &constraint : query.constraints)
+      constraints.push_back(renamer.visit(constraint));
+    return renamer.visit(query.expr);
+  }
+
+  std::vector<std::pair<QueryDigest, ref<Expr>>> shapes;
+  for (const auto &constraint : query.constraints) {
+    std::string shape;
+    CanonicalQueryWriter(shape, nullptr).writeExpr(constraint);
+    shapes.emplace_back(computeDigest(shape), constraint);
+  }
+  std::stable_sort(shapes.begin(), shapes.end(),
+                   [](const std::pair<QueryDigest, ref<Expr>> &a,
+                      const std::pair<QueryDigest, ref<Expr>> &b) {
+                     return a.first < b.first;
+                   });
+
+  constraints.reserve(shapes.size());
+  for (const auto &shape : shapes)
+    constraints.push_back(renamer.visit(shape.second));
+  return renamer.visit(query.expr);
+}
+
+bool CanonicalizingSolver::computeValidity(const Query &query,
+                                           Solver::Validity &result) {
+  ArrayRenamer renamer(*this);
+  std::vector<ref<Expr>> constraints;
+  ref<Expr> expr = canonicalize(query, renamer, constraints);
+  ConstraintSet tmp(constraints);
+  return solver->impl->computeValidity(Query(tmp, expr), result);
+}
+
+bool CanonicalizingSolver::computeTruth(const Query &query, bool &isValid) {
+  ArrayRenamer renamer(*this);
+  std::vector<ref<Expr>> constraints;
+  ref<Expr> expr = canonicalize(query, renamer, constraints);
+  ConstraintSet tmp(constraints);
+  return solver->impl->computeTruth(Query(tmp, expr), isValid);
+}
+
+bool CanonicalizingSolver::computeValue(const Query &query,
+                                        ref<Expr> &result) {
+  // the value is a constant and does not refer to any array
+  ArrayRenamer renamer(*this);
+  std::vector<ref<Expr>> constraints;
+  ref<Expr> expr = canonicalize(query, renamer, constraints);
+  ConstraintSet tmp(constraints);
+  return solver->impl->computeValue(Query(tmp, expr), result);
+}
+
+bool CanonicalizingSolver::computeInitialValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char>> &values, bool &hasSolution) {
+  ArrayRenamer renamer(*this);
+  std::vector<ref<Expr>> constraints;
+  ref<Expr> expr = canonicalize(query, renamer, constraints);
+  ConstraintSet tmp(constraints);
+
+  // values are returned in the order of the objects, so the renamed objects
+  // map them back
+  std::vector<const Array *> renamed;
+  renamed.reserve(objects.size());
+  for (const Array *object : objects)
+    renamed.push_back(renamer.rename(object));
+  return solver->impl->computeInitialValues(Query(tmp, expr), renamed, values,
+                                            hasSolution);
+}
+
+void CanonicalizingSolver::speculate(const Query &query) {
+  ArrayRenamer renamer(*this);
+  std::vector<ref<Expr>> constraints;
+  ref<Expr> expr = canonicalize(query, renamer, constraints);
+  ConstraintSet tmp(constraints);
+  solver->impl->speculate(Query(tmp, expr));
+}
+
+SolverImpl::SolverRunStatus CanonicalizingSolver::getOperationStatusCode() {
+  return solver->impl->getOperationStatusCode();
+}
+
+char *CanonicalizingSolver::getConstraintLog(const Query &query) {
+  return solver->impl->getConstraintLog(query);
+}
+
+void CanonicalizingSolver::setCoreSolverTimeout(time::Span timeout) {
+  solver->impl->setCoreSolverTimeout(timeout);
+}
+
+Solver *klee::createCanonicalizingSolver(Solver *s) {
+  return new Solver(new CanonicalizingSolver(s));
+}
@@ -9,10 +9,11 @@
 
 #include "klee/Solver/Solver.h"
 
-#include "klee/ADT/MapOfSets.h"
+#include "klee/ADT/SetIndex.h"
 #include "klee/Expr/Assignment.h"
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
+#include "klee/Expr/ExprHashMap.h"
 #include "klee/Expr/ExprUtil.h"
 #include "klee/Expr/ExprVisitor.h"
 #include "klee/Support/OptionCategories.h"
@@ -20,9 +21,13 @@
 #include "klee/Solver/SolverImpl.h"
 #include "klee/Solver/SolverStats.h"
 #include "klee/Support/ErrorHandling.h"
+#include "klee/Support/Timer.h"
 
 #include "llvm/Support/CommandLine.h"
 
+#include <chrono>
+#include <map>
+
 using namespace klee;
 using namespace llvm;
 
@@ -50,6 +55,13 @@ cl::opt<bool> CexCacheExperimental(
     cl::desc("Optimization for validity queries (default=false)"),
     cl::cat(SolvingCat));
 
+cl::opt<unsigned> CexCacheMaxMemory(
+    "cex-cache-max-memory", cl::init(1024),
+    cl::desc("Maximum memory of the counterexample cache in MB, evicting the "
+             "least recently used entries beyond it (0=unlimited, "
+             "default=1024)"),
+    cl::cat(SolvingCat));
+
 } // namespace
 
 ///
@@ -64,14 +76,18 @@ struct AssignmentLessThan {
 
 
 class CexCachingSolver : public SolverImpl {
-  typedef std::set<Assignment*, AssignmentLessThan> assignmentsTable_ty;
+  /// The assignments and the number of cache entries holding each of them
+  typedef std::map<Assignment *, unsigned, AssignmentLessThan>
+      assignmentsTable_ty;
 
   Solver *solver;
   
-  MapOfSets<ref<Expr>, Assignment*> cache;
+  SetIndex<ref<Expr>, Assignment *, util::ExprHash, util::ExprCmp> cache;
   // memo table
   assignmentsTable_ty assignmentsTable;
 
+  void releaseAssignment(Assignment *a);
+
   bool searchForAssignment(KeyType &key, 
                            Assignment *&result);
   
@@ -85,7 +101,10 @@ class CexCachingSolver : public SolverImpl {
   bool getAssignment(const Query& query, Assignment *&result);
   
 public:
-  CexCachingSolver(Solver *_solver) : solver(_solver) {}
+  CexCachingSolver(Solver *_solver)
+      : solver(_solver),
+        cache((std::size_t)CexCacheMaxMemory << 20,
+              [this](Assignment *a) { releaseAssignment(a); }) {}
   ~CexCachingSolver();
   
   bool computeTruth(const Query&, bool &isValid);
@@ -98,6 +117,7 @@ public:
   SolverRunStatus getOperationStatusCode();
   char *getConstraintLog(const Query& query);
   void setCoreSolverTimeout(time::Span timeout);
+  void speculate(const Query& query);
 };
 
 ///
@@ -128,7 +148,7 @@ struct NullOrSatisfyingAssignment {
 /// unsatisfiable query).
 /// \return - True if a cached result was found.
 bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
-  Assignment * const *lookup = cache.lookup(key);
+  Assignment **lookup = cache.lookup(key);
   if (lookup) {
     result = *lookup;
     return true;
@@ -155,7 +175,7 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
     // of them satisfies the query.
     for (assignmentsTable_ty::iterator it = assignmentsTable.begin(), 
            ie = assignmentsTable.end(); it != ie; ++it) {
-      Assignment *a = *it;
+      Assignment *a = it->first;
       if (a->satisfies(key.begin(), key.end())) {
         result = a;
         return true;
@@ -211,7 +231,12 @@ bool CexCachingSolver::lookupAssignment(const Query &query,
     key.insert(neg);
   }
 
+  WallTimer timer;
   bool found = searchForAssignment(key, result);
+  stats::cexCacheLookupTime.add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          timer.delta().duration)
+          .count());
   if (found)
     ++stats::queryCexCacheHits;
   else ++stats::queryCexCacheMisses;
@@ -234,16 +259,24 @@ bool CexCachingSolver::getAssignment(const Query& query, Assignment *&result) {
     return false;
     
   Assignment *binding;
+  std::size_t bindingBytes = 0;
   if (hasSolution) {
     binding = new Assignment(objects, values);
 
     // Memoize the result.
     std::pair<assignmentsTable_ty::iterator, bool>
-      res = assignmentsTable.insert(binding);
+      res = assignmentsTable.insert(std::make_pair(binding, 0));
     if (!res.second) {
       delete binding;
-      binding = *res.first;
+      binding = res.first->first;
     }
+    ++res.first->second;
+
+    // charged to each entry holding the assignment, which overestimates
+    // shared assignments
+    bindingBytes = sizeof(Assignment);
+    for (const auto &b : binding->bindings)
+      bindingBytes += sizeof(b) + b.second.size() + 4 * sizeof(void *);
     
     if (DebugCexCacheCheckBinding)
       if (!binding->satisfies(key.begin(), key.end())) {
@@ -256,19 +289,30 @@ bool CexCachingSolver::getAssignment(const Query& query, Assignment *&result) {
   }
   
   result = binding;
-  cache.insert(key, binding);
+  std::uint64_t evictions = cache.getNumEvictions();
+  cache.insert(key, binding, bindingBytes);
+  stats::queryCexCacheEvictions += cache.getNumEvictions() - evictions;
 
   return true;
 }
 
 ///
 
+void CexCachingSolver::releaseAssignment(Assignment *a) {
+  if (!a)
+    return;
+  assignmentsTable_ty::iterator it = assignmentsTable.find(a);
+  assert(it != assignmentsTable.end() && "releasing an unknown assignment");
+  if (--it->second)
+    return;
+  assignmentsTable.erase(it);
+  delete a;
+}
+
 CexCachingSolver::~CexCachingSolver() {
   cache.clear();
   delete solver;
-  for (assignmentsTable_ty::iterator it = assignmentsTable.begin(), 
-         ie = assignmentsTable.end(); it != ie; ++it)
-    delete *it;
+  assert(assignmentsTable.empty() && "assignments outlive the cache");
 }
 
 bool CexCachingSolver::computeValidity(const Query& query,
@@ -381,6 +425,23 @@ void CexCachingSolver::setCoreSolverTimeout(time::Span timeout) {
   solver->impl->setCoreSolverTimeout(timeout);
 }
 
+void CexCachingSolver::speculate(const Query& query) {
+  // computeTruth and computeInitialValues ask for an assignment of the query,
+  // look it up as lookupAssignment does but without counting it
+  KeyType key(query.constraints.begin(), query.constraints.end());
+  ref<Expr> neg = Expr::createIsZero(query.expr);
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(neg)) {
+    if (CE->isFalse())
+      return;
+  } else {
+    key.insert(neg);
+  }
+
+  Assignment *a;
+  if (!searchForAssignment(key, a))
+    solver->impl->speculate(query);
+}
+
 ///
 
 Solver *klee::createCexCachingSolver(Solver *_solver) {
@@ -11,8 +11,12 @@
  * This file groups declarations that are common to both KLEE and Kleaver.
  */
 
+#include "STPSolver.h"
+#include "Z3Solver.h"
+
 #include "klee/Solver/Common.h"
 #include "klee/Solver/SolverCmdLine.h"
+#include "klee/Solver/SolverStats.h"
 #include "klee/Support/ErrorHandling.h"
 #include "klee/System/Time.h"
 
@@ -20,6 +24,26 @@
 
 
 namespace klee {
+// The core solver of a speculative worker, created in the worker. Like the
+// backends of the portfolio solver, it already runs in a worker process and
+// does not fork again.
+static Solver *createWorkerCoreSolver() {
+  switch (CoreSolverToUse) {
+#ifdef ENABLE_STP
+  case STP_SOLVER:
+    return new STPSolver(/*useForkedSTP=*/false, CoreSolverOptimizeDivides);
+#endif
+#ifdef ENABLE_Z3
+  case Z3_SOLVER:
+    return new Z3Solver();
+#endif
+  case PORTFOLIO_SOLVER:
+    return createPortfolioSolver(PortfolioSolvers);
+  default:
+    return createCoreSolver(CoreSolverToUse);
+  }
+}
+
 Solver *constructSolverChain(Solver *coreSolver,
                              std::string querySMT2LogPath,
                              std::string baseSolverQuerySMT2LogPath,
@@ -28,50 +52,96 @@ Solver *constructSolverChain(Solver *coreSolver,
   Solver *solver = coreSolver;
   const time::Span minQueryTimeToLog(MinQueryTimeToLog);
 
+  // wraps each layer added to the chain, so that the time of a layer is the
+  // difference to the layer below
+  stats::SolverLayerStats *lastLayer = nullptr;
+  auto instrument = [&](const char *name) {
+    if (!SolverChainStats)
+      return;
+    lastLayer = &stats::addSolverLayer(name, lastLayer);
+    solver = createInstrumentingSolver(solver, *lastLayer);
+  };
+  instrument("core");
+
+  // the workers solve with the core solver, below the loggers
+  if (SpeculativeSolverWorkers) {
+    solver = createSpeculativeSolver(solver, createWorkerCoreSolver,
+                                     SpeculativeSolverWorkers);
+    instrument("speculative");
+  }
+
   if (QueryLoggingOptions.isSet(SOLVER_KQUERY)) {
     solver = createKQueryLoggingSolver(solver, baseSolverQueryKQueryLogPath, minQueryTimeToLog, LogTimedOutQueries);
+    instrument("solver-kquery-log");
     klee_message("Logging queries that reach solver in .kquery format to %s\n",
                  baseSolverQueryKQueryLogPath.c_str());
   }
 
   if (QueryLoggingOptions.isSet(SOLVER_SMTLIB)) {
     solver = createSMTLIBLoggingSolver(solver, baseSolverQuerySMT2LogPath, minQueryTimeToLog, LogTimedOutQueries);
+    instrument("solver-smtlib-log");
     klee_message("Logging queries that reach solver in .smt2 format to %s\n",
                  baseSolverQuerySMT2LogPath.c_str());
   }
 
-  if (UseAssignmentValidatingSolver)
+  if (UseAssignmentValidatingSolver) {
     solver = createAssignmentValidatingSolver(solver);
+    instrument("assignment-validating");
+  }
 
-  if (UseFastCexSolver)
+  if (UseFastCexSolver) {
     solver = createFastCexSolver(solver);
+    instrument("fast-cex");
+  }
 
-  if (UseCexCache)
+  if (!PersistentQueryCache.empty()) {
+    solver = createPersistentCachingSolver(solver, PersistentQueryCache,
+                                           PersistentQueryCacheShared);
+    instrument("persistent-cache");
+  }
+
+  if (UseCexCache) {
     solver = createCexCachingSolver(solver);
+    instrument("cex-cache");
+  }
 
-  if (UseBranchCache)
+  if (UseBranchCache) {
     solver = createCachingSolver(solver);
+    instrument("branch-cache");
+  }
 
-  if (UseIndependentSolver)
+  if (CanonicalizeQueries) {
+    solver = createCanonicalizingSolver(solver);
+    instrument("canonicalizing");
+  }
+
+  if (UseIndependentSolver) {
     solver = createIndependentSolver(solver);
+    instrument("independent");
+  }
 
-  if (DebugValidateSolver)
+  if (DebugValidateSolver) {
     solver = createValidatingSolver(solver, coreSolver);
+    instrument("validating");
+  }
 
   if (QueryLoggingOptions.isSet(ALL_KQUERY)) {
     solver = createKQueryLoggingSolver(solver, queryKQueryLogPath, minQueryTimeToLog, LogTimedOutQueries);
+    instrument("all-kquery-log");
     klee_message("Logging all queries in .kquery format to %s\n",
                  queryKQueryLogPath.c_str());
   }
 
   if (QueryLoggingOptions.isSet(ALL_SMTLIB)) {
     solver = createSMTLIBLoggingSolver(solver, querySMT2LogPath, minQueryTimeToLog, LogTimedOutQueries);
+    instrument("all-smtlib-log");
     klee_message("Logging all queries in .smt2 format to %s\n",
                  querySMT2LogPath.c_str());
   }
   if (DebugCrossCheckCoreSolverWith != NO_SOLVER) {
     Solver *oracleSolver = createCoreSolver(DebugCrossCheckCoreSolverWith);
     solver = createValidatingSolver(solver, oracleSolver, true);
+    instrument("cross-check");
   }
 
   return solver;
@@ -50,6 +50,9 @@ Solver *createCoreSolver(CoreSolverType cst) {
     klee_message("Not compiled with Z3 support");
     return NULL;
 #endif
+  case PORTFOLIO_SOLVER:
+    klee_message("Using portfolio solver backend");
+    return createPortfolioSolver(PortfolioSolvers);
   case NO_SOLVER:
     klee_message("Invalid solver");
     return NULL;
@@ -147,3 +147,7 @@ void StagedSolverImpl::setCoreSolverTimeout(time::Span timeout) {
   secondary->impl->setCoreSolverTimeout(timeout);
 }
 
+void StagedSolverImpl::speculate(const Query& query) {
+  secondary->impl->speculate(query);
+}
+
@@ -0,0 +1,139 @@
+//===-- InstrumentingSolver.cpp -------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Expr/Constraints.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+#include "klee/Support/Timer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+/// The time the instrumenting solvers spent counting expression nodes, in
+/// nanoseconds, which is not accounted to the layers above them
+std::uint64_t instrumentationTime = 0;
+
+std::uint64_t toNanoseconds(const time::Span &span) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(span.duration)
+      .count();
+}
+
+std::uint64_t countExprNodes(const Query &query) {
+  std::unordered_set<const Expr *> visited;
+  std::unordered_set<const UpdateNode *> visitedUpdates;
+  std::vector<const Expr *> stack;
+  auto push = [&](const Expr *e) {
+    if (visited.insert(e).second)
+      stack.push_back(e);
+  };
+
+  for (const auto &constraint : query.constraints)
+    push(constraint.get());
+  push(query.expr.get());
+
+  while (!stack.empty()) {
+    const Expr *e = stack.back();
+    stack.pop_back();
+    for (unsigned i = 0; i < e->getNumKids(); i++)
+      push(e->getKid(i).get());
+
+    // update lists share their tails, which are visited once
+    if (const ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+      for (const UpdateNode *un = re->updates.head.get();
+           un && visitedUpdates.insert(un).second; un = un->next.get()) {
+        push(un->index.get());
+        push(un->value.get());
+      }
+    }
+  }
+  return visited.size();
+}
+
+class InstrumentingSolver : public SolverImpl {
+private:
+  Solver *solver;
+  stats::SolverLayerStats &layer;
+
+  template <typename Solve> bool record(const Query &query, Solve solve);
+
+public:
+  InstrumentingSolver(Solver *solver, stats::SolverLayerStats &layer)
+      : solver(solver), layer(layer) {}
+  ~InstrumentingSolver() { delete solver; }
+
+  bool computeValidity(const Query &query, Solver::Validity &result) {
+    return record(query, [&]() {
+      return solver->impl->computeValidity(query, result);
+    });
+  }
+  bool computeTruth(const Query &query, bool &isValid) {
+    return record(query,
+                  [&]() { return solver->impl->computeTruth(query, isValid); });
+  }
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    return record(query,
+                  [&]() { return solver->impl->computeValue(query, result); });
+  }
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char>> &values,
+                            bool &hasSolution) {
+    return record(query, [&]() {
+      return solver->impl->computeInitialValues(query, objects, values,
+                                                hasSolution);
+    });
+  }
+  SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+  char *getConstraintLog(const Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+  void setCoreSolverTimeout(time::Span timeout) {
+    solver->impl->setCoreSolverTimeout(timeout);
+  }
+  void speculate(const Query &query) { solver->impl->speculate(query); }
+};
+
+template <typename Solve>
+bool InstrumentingSolver::record(const Query &query, Solve solve) {
+  std::uint64_t nextQueries = layer.next ? layer.next->queries : 0;
+  std::uint64_t instrumentationTimeBefore = instrumentationTime;
+  WallTimer timer;
+
+  bool success = solve();
+
+  std::uint64_t elapsed = toNanoseconds(timer.delta());
+  elapsed -=
+      std::min(elapsed, instrumentationTime - instrumentationTimeBefore);
+  ++layer.queries;
+  layer.time += elapsed;
+  layer.latency.add(elapsed);
+  if (layer.next && layer.next->queries == nextQueries)
+    ++layer.hits;
+
+  WallTimer countTimer;
+  layer.exprNodes += countExprNodes(query);
+  instrumentationTime += toNanoseconds(countTimer.delta());
+  return success;
+}
+
+} // namespace
+
+Solver *klee::createInstrumentingSolver(Solver *s,
+                                        stats::SolverLayerStats &layer) {
+  return new Solver(new InstrumentingSolver(s, layer));
+}
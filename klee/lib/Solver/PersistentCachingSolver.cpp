@@ -0,0 +1,452 @@
+//===-- PersistentCachingSolver.cpp ---------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CanonicalQueryWriter.h"
+
+#include "klee/Solver/Solver.h"
+
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+#include "klee/Support/ErrorHandling.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/Errno.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+using namespace klee;
+
+namespace {
+
+/// The kinds of results in the store
+enum ResultKind : uint32_t { Validity = 1, Truth, Value, InitialValues };
+
+/// Computes the key of a query: constraints are ordered by a digest of their
+/// structure without array names, then the whole query is written with the
+/// arrays numbered by their first occurrence.
+QueryDigest computeKey(ResultKind kind, const Query &query,
+                   const std::vector<const Array *> *objects = nullptr) {
+  std::vector<std::pair<QueryDigest, ref<Expr>>> constraints;
+  for (const auto &constraint : query.constraints) {
+    std::string shape;
+    CanonicalQueryWriter(shape, nullptr).writeExpr(constraint);
+    constraints.emplace_back(computeDigest(shape), constraint);
+  }
+  std::stable_sort(constraints.begin(), constraints.end(),
+                   [](const std::pair<QueryDigest, ref<Expr>> &a,
+                      const std::pair<QueryDigest, ref<Expr>> &b) {
+                     return a.first < b.first;
+                   });
+
+  std::string data;
+  std::unordered_map<const Array *, uint32_t> arrays;
+  CanonicalQueryWriter writer(data, &arrays);
+  data.append((const char *)&kind, sizeof(kind));
+  for (const auto &constraint : constraints)
+    writer.writeExpr(constraint.second);
+  writer.writeExpr(query.expr);
+  if (objects) {
+    for (const Array *array : *objects)
+      writer.writeArray(array);
+  }
+  return computeDigest(data);
+}
+
+/// A hash table of query results in a memory-mapped file. The file holds a
+/// header, a fixed number of slots and then the results the slots point to.
+/// Entries are never removed. Processes sharing the file lock it around
+/// every access.
+class QueryStore {
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t numSlots;
+    uint64_t numEntries;
+    /// The end of the results in the file
+    uint64_t dataEnd;
+  };
+
+  struct Slot {
+    QueryDigest key;
+    uint64_t offset;
+    uint32_t length;
+    uint32_t used;
+  };
+
+  static constexpr char Magic[8] = {'K', 'L', 'E', 'E', 'Q', 'C', 'H', 'E'};
+  static constexpr uint32_t Version = 1;
+  static constexpr uint32_t NumSlots = 1 << 20;
+  static constexpr size_t DataStart = sizeof(Header) + NumSlots * sizeof(Slot);
+
+  int fd = -1;
+  bool shared;
+  char *base = nullptr;
+  size_t mappedSize = 0;
+  bool warnedFull = false;
+
+  Header *header() { return reinterpret_cast<Header *>(base); }
+  Slot *slots() { return reinterpret_cast<Slot *>(base + sizeof(Header)); }
+
+  bool map();
+  bool grow(size_t size);
+
+  /// Whether the results end in the mapped file, which a truncated or
+  /// corrupted file need not do.
+  bool validDataEnd() {
+    return header()->dataEnd >= DataStart && header()->dataEnd <= mappedSize;
+  }
+
+  class Lock {
+    int fd;
+
+  public:
+    Lock(int fd, int operation) : fd(fd) {
+      if (fd >= 0)
+        flock(fd, operation);
+    }
+    ~Lock() {
+      if (fd >= 0)
+        flock(fd, LOCK_UN);
+    }
+  };
+
+public:
+  QueryStore(const std::string &path, bool shared);
+  ~QueryStore();
+
+  bool isOpen() const { return base != nullptr; }
+  bool lookup(const QueryDigest &key, std::string &result);
+  void insert(const QueryDigest &key, const std::string &result);
+};
+
+constexpr char QueryStore::Magic[8];
+constexpr size_t QueryStore::DataStart;
+
+QueryStore::QueryStore(const std::string &path, bool shared) : shared(shared) {
+  fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    klee_warning("unable to open persistent query cache %s: %s", path.c_str(),
+                 llvm::sys::StrError(errno).c_str());
+    return;
+  }
+
+  // without sharing, the file belongs to this process until it exits
+  if (!shared && flock(fd, LOCK_EX | LOCK_NB) < 0) {
+    klee_warning("persistent query cache %s is in use by another process",
+                 path.c_str());
+    close(fd);
+    fd = -1;
+    return;
+  }
+
+  Lock lock(shared ? fd : -1, LOCK_EX);
+  struct stat st;
+  if (fstat(fd, &st) < 0)
+    return;
+
+  if (st.st_size == 0) {
+    if (ftruncate(fd, DataStart + (1 << 20)) < 0 || !map())
+      return;
+    memcpy(header()->magic, Magic, sizeof(Magic));
+    header()->version = Version;
+    header()->numSlots = NumSlots;
+    header()->numEntries = 0;
+    header()->dataEnd = DataStart;
+  } else if (!map()) {
+    return;
+  }
+
+  if (mappedSize < DataStart ||
+      memcmp(header()->magic, Magic, sizeof(Magic)) ||
+      header()->version != Version || header()->numSlots != NumSlots) {
+    klee_warning("%s is not a persistent query cache of this version",
+                 path.c_str());
+    munmap(base, mappedSize);
+    base = nullptr;
+    return;
+  }
+
+  klee_message("Using persistent query cache %s with %llu entries",
+               path.c_str(), (unsigned long long)header()->numEntries);
+}
+
+QueryStore::~QueryStore() {
+  if (base)
+    munmap(base, mappedSize);
+  if (fd >= 0)
+    close(fd);
+}
+
+// Maps the whole file, which another process may have grown.
+bool QueryStore::map() {
+  struct stat st;
+  if (fstat(fd, &st) < 0)
+    return false;
+  if (base && (size_t)st.st_size == mappedSize)
+    return true;
+
+  if (base)
+    munmap(base, mappedSize);
+  void *addr =
+      mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    klee_warning("unable to map persistent query cache: %s",
+                 llvm::sys::StrError(errno).c_str());
+    base = nullptr;
+    return false;
+  }
+  base = static_cast<char *>(addr);
+  mappedSize = st.st_size;
+  return true;
+}
+
+bool QueryStore::grow(size_t size) {
+  size_t newSize = mappedSize;
+  while (newSize < size)
+    newSize *= 2;
+  return ftruncate(fd, newSize) == 0 && map();
+}
+
+bool QueryStore::lookup(const QueryDigest &key, std::string &result) {
+  Lock lock(shared ? fd : -1, LOCK_SH);
+  if (shared && !map())
+    return false;
+
+  if (!validDataEnd())
+    return false;
+
+  uint64_t hash;
+  memcpy(&hash, key.data(), sizeof(hash));
+  uint32_t i = hash & (NumSlots - 1);
+  for (uint32_t probes = 0; probes < NumSlots; ++probes) {
+    const Slot &slot = slots()[i];
+    if (!slot.used)
+      return false;
+    if (slot.key == key) {
+      // a slot pointing outside the results is treated as a miss
+      if (slot.offset < DataStart || slot.offset > header()->dataEnd ||
+          slot.length > header()->dataEnd - slot.offset)
+        return false;
+      result.assign(base + slot.offset, slot.length);
+      return true;
+    }
+    i = (i + 1) & (NumSlots - 1);
+  }
+  return false;
+}
+
+void QueryStore::insert(const QueryDigest &key, const std::string &result) {
+  Lock lock(shared ? fd : -1, LOCK_EX);
+  if (shared && !map())
+    return;
+
+  // keep probe sequences short
+  if (header()->numEntries >= NumSlots / 4 * 3) {
+    if (!warnedFull)
+      klee_warning("persistent query cache is full");
+    warnedFull = true;
+    return;
+  }
+
+  if (!validDataEnd())
+    return;
+
+  if (header()->dataEnd + result.size() > mappedSize &&
+      !grow(header()->dataEnd + result.size()))
+    return;
+
+  uint64_t hash;
+  memcpy(&hash, key.data(), sizeof(hash));
+  uint32_t i = hash & (NumSlots - 1);
+  for (; slots()[i].used; i = (i + 1) & (NumSlots - 1)) {
+    if (slots()[i].key == key)
+      return;
+  }
+
+  Slot &slot = slots()[i];
+  memcpy(base + header()->dataEnd, result.data(), result.size());
+  slot.key = key;
+  slot.offset = header()->dataEnd;
+  slot.length = result.size();
+  slot.used = 1;
+  header()->dataEnd += result.size();
+  ++header()->numEntries;
+}
+
+class PersistentCachingSolver : public SolverImpl {
+  Solver *solver;
+  QueryStore store;
+
+public:
+  PersistentCachingSolver(Solver *s, const std::string &path, bool shared)
+      : solver(s), store(path, shared) {}
+  ~PersistentCachingSolver() { delete solver; }
+
+  bool computeValidity(const Query &, Solver::Validity &result);
+  bool computeTruth(const Query &, bool &isValid);
+  bool computeValue(const Query &, ref<Expr> &result);
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char>> &values,
+                            bool &hasSolution);
+  SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+  char *getConstraintLog(const Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+  void setCoreSolverTimeout(time::Span timeout) {
+    solver->impl->setCoreSolverTimeout(timeout);
+  }
+  void speculate(const Query &query);
+};
+
+bool PersistentCachingSolver::computeValidity(const Query &query,
+                                              Solver::Validity &result) {
+  if (!store.isOpen())
+    return solver->impl->computeValidity(query, result);
+
+  QueryDigest key = computeKey(Validity, query);
+  std::string data;
+  if (store.lookup(key, data) && data.size() == 1) {
+    ++stats::persistentCacheHits;
+    result = static_cast<Solver::Validity>(data[0]);
+    return true;
+  }
+  ++stats::persistentCacheMisses;
+
+  if (!solver->impl->computeValidity(query, result))
+    return false;
+  store.insert(key, std::string(1, static_cast<char>(result)));
+  return true;
+}
+
+void PersistentCachingSolver::speculate(const Query &query) {
+  std::string data;
+  if (store.isOpen() && !query.expr->isFalse() &&
+      store.lookup(computeKey(Truth, query), data))
+    return;
+  solver->impl->speculate(query);
+}
+
+bool PersistentCachingSolver::computeTruth(const Query &query, bool &isValid) {
+  if (!store.isOpen())
+    return solver->impl->computeTruth(query, isValid);
+
+  QueryDigest key = computeKey(Truth, query);
+  std::string data;
+  if (store.lookup(key, data) && data.size() == 1) {
+    ++stats::persistentCacheHits;
+    isValid = data[0];
+    return true;
+  }
+  ++stats::persistentCacheMisses;
+
+  if (!solver->impl->computeTruth(query, isValid))
+    return false;
+  store.insert(key, std::string(1, isValid));
+  return true;
+}
+
+bool PersistentCachingSolver::computeValue(const Query &query,
+                                           ref<Expr> &result) {
+  if (!store.isOpen())
+    return solver->impl->computeValue(query, result);
+
+  QueryDigest key = computeKey(Value, query);
+  std::string data;
+  if (store.lookup(key, data) && data.size() >= sizeof(uint32_t)) {
+    uint32_t width;
+    memcpy(&width, data.data(), sizeof(width));
+    std::vector<uint64_t> words((width + 63) / 64);
+    if (data.size() == sizeof(width) + words.size() * sizeof(uint64_t)) {
+      ++stats::persistentCacheHits;
+      memcpy(words.data(), data.data() + sizeof(width),
+             words.size() * sizeof(uint64_t));
+      result = ConstantExpr::alloc(llvm::APInt(width, words));
+      return true;
+    }
+  }
+  ++stats::persistentCacheMisses;
+
+  if (!solver->impl->computeValue(query, result))
+    return false;
+
+  // only constant results can be stored
+  if (const ConstantExpr *ce = dyn_cast<ConstantExpr>(result)) {
+    const llvm::APInt &value = ce->getAPValue();
+    uint32_t width = value.getBitWidth();
+    data.assign((const char *)&width, sizeof(width));
+    data.append((const char *)value.getRawData(),
+                value.getNumWords() * sizeof(uint64_t));
+    store.insert(key, data);
+  }
+  return true;
+}
+
+bool PersistentCachingSolver::computeInitialValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char>> &values, bool &hasSolution) {
+  if (!store.isOpen())
+    return solver->impl->computeInitialValues(query, objects, values,
+                                              hasSolution);
+
+  QueryDigest key = computeKey(InitialValues, query, &objects);
+  std::string data;
+  if (store.lookup(key, data) && !data.empty()) {
+    size_t size = 1;
+    if (data[0]) {
+      for (const Array *array : objects)
+        size += array->size;
+    }
+    if (data.size() == size) {
+      ++stats::persistentCacheHits;
+      hasSolution = data[0];
+      values.clear();
+      if (hasSolution) {
+        const char *pos = data.data() + 1;
+        for (const Array *array : objects) {
+          values.emplace_back(pos, pos + array->size);
+          pos += array->size;
+        }
+      }
+      return true;
+    }
+  }
+  ++stats::persistentCacheMisses;
+
+  if (!solver->impl->computeInitialValues(query, objects, values,
+                                          hasSolution))
+    return false;
+
+  data.assign(1, hasSolution);
+  if (hasSolution) {
+    for (const auto &value : values)
+      data.append(value.begin(), value.end());
+  }
+  store.insert(key, data);
+  return true;
+}
+
+} // namespace
+
+Solver *klee::createPersistentCachingSolver(Solver *s, const std::string &path,
+                                            bool shared) {
+  return new Solver(new PersistentCachingSolver(s, path, shared));
+}
@@ -0,0 +1,378 @@
+//===-- PortfolioSolver.cpp -----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "STPSolver.h"
+#include "SolverWorkerPool.h"
+#include "SolverWorkerQueries.h"
+#include "Z3Solver.h"
+
+#include "klee/Expr/Assignment.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/ExprPPrinter.h"
+#include "klee/Expr/ExprUtil.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverCmdLine.h"
+#include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+#include "klee/Statistics/TimerStatIncrementer.h"
+#include "klee/Support/ErrorHandling.h"
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+using namespace klee;
+
+namespace {
+
+struct PortfolioBackend {
+  std::string name;
+  /// Created in KLEE and used in the worker processes only
+  std::unique_ptr<Solver> solver;
+  /// The statistic counting the queries this backend answered first
+  Statistic *wins;
+  std::uint64_t numWins = 0;
+};
+
+class PortfolioSolverImpl : public SolverImpl {
+  std::vector<PortfolioBackend> backends;
+  SolverWorkerPool workers;
+  time::Span timeout;
+  SolverRunStatus runStatusCode;
+
+  /// The workers still solving a query that another backend already
+  /// answered are left running, instead of being killed and forked again.
+  /// Their answers are dropped when they arrive. Only with a timeout do they
+  /// have a deadline, after which they are killed when a worker is needed.
+  std::vector<bool> stale;
+  std::vector<time::Point> staleDeadline;
+
+  /// Parses the requests in the workers
+  SolverWorkerQueries workerQueries;
+
+  void solveInWorker(const std::string &request, std::string &response);
+  void drainStaleWorkers();
+  bool makeWorkerIdle();
+
+public:
+  explicit PortfolioSolverImpl(const std::vector<std::string> &names);
+  ~PortfolioSolverImpl();
+
+  char *getConstraintLog(const Query &) override;
+  void setCoreSolverTimeout(time::Span timeout) override {
+    this->timeout = timeout;
+  }
+
+  bool computeTruth(const Query &, bool &isValid) override;
+  bool computeValue(const Query &, ref<Expr> &result) override;
+  bool computeInitialValues(const Query &,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char>> &values,
+                            bool &hasSolution) override;
+  SolverRunStatus getOperationStatusCode() override { return runStatusCode; }
+};
+
+Solver *createBackend(const std::string &name, Statistic *&wins) {
+  std::string tactic;
+  if (name.compare(0, 3, "z3:") == 0)
+    tactic = name.substr(3);
+
+  if (name == "stp") {
+#ifdef ENABLE_STP
+    wins = &stats::portfolioWinsSTP;
+    // the backend already runs in a worker process
+    return new STPSolver(/*useForkedSTP=*/false, CoreSolverOptimizeDivides);
+#else
+    klee_error("Not compiled with STP support");
+#endif
+  }
+
+  if (name == "z3" || !tactic.empty()) {
+#ifdef ENABLE_Z3
+    if (tactic.empty()) {
+      wins = &stats::portfolioWinsZ3;
+      return new Z3Solver();
+    }
+    wins = &stats::portfolioWinsZ3Tactic;
+    return new Z3Solver(tactic);
+#else
+    klee_error("Not compiled with Z3 support");
+#endif
+  }
+
+  klee_error("Unknown portfolio solver: %s", name.c_str());
+}
+
+} // namespace
+
+PortfolioSolverImpl::PortfolioSolverImpl(const std::vector<std::string> &names)
+    : backends(names.size()),
+      workers(
+          [this](const std::string &request, std::string &response) {
+            solveInWorker(request, response);
+          },
+          names.size()),
+      runStatusCode(SOLVER_RUN_STATUS_FAILURE), stale(names.size(), false),
+      staleDeadline(names.size()), workerQueries(workers) {
+  for (unsigned i = 0; i < names.size(); i++) {
+    backends[i].name = names[i];
+    backends[i].solver.reset(createBackend(names[i], backends[i].wins));
+  }
+}
+
+PortfolioSolverImpl::~PortfolioSolverImpl() {
+  for (const auto &backend : backends)
+    klee_message("Portfolio solver %s answered first for %llu queries",
+                 backend.name.c_str(), (unsigned long long)backend.numWins);
+}
+
+char *PortfolioSolverImpl::getConstraintLog(const Query &query) {
+  std::string log;
+  llvm::raw_string_ostream os(log);
+  ExprPPrinter::printQuery(os, query.constraints, query.expr);
+  return strdup(os.str().c_str());
+}
+
+bool PortfolioSolverImpl::computeTruth(const Query &query, bool &isValid) {
+  std::vector<const Array *> objects;
+  std::vector<std::vector<unsigned char>> values;
+  bool hasSolution;
+
+  if (!computeInitialValues(query, objects, values, hasSolution))
+    return false;
+
+  isValid = !hasSolution;
+  return true;
+}
+
+bool PortfolioSolverImpl::computeValue(const Query &query, ref<Expr> &result) {
+  std::vector<const Array *> objects;
+  std::vector<std::vector<unsigned char>> values;
+  bool hasSolution;
+
+  // Find the object used in the expression, and compute an assignment
+  // for them.
+  findSymbolicObjects(query.expr, objects);
+  if (!computeInitialValues(query.withFalse(), objects, values, hasSolution))
+    return false;
+  assert(hasSolution && "state has invalid constraint set");
+
+  // Evaluate the expression with the computed assignment.
+  Assignment a(objects, values);
+  result = a.evaluate(query.expr);
+
+  return true;
+}
+
+// Requests are the index of the backend and the timeout in microseconds,
+// followed by the query.
+void PortfolioSolverImpl::solveInWorker(const std::string &request,
+                                        std::string &response) {
+  std::uint32_t backend;
+  std::uint64_t timeoutMicros;
+  memcpy(&backend, request.data(), sizeof(backend));
+  memcpy(&timeoutMicros, request.data() + sizeof(backend),
+         sizeof(timeoutMicros));
+
+  Solver *solver = backends[backend].solver.get();
+  solver->setCoreSolverTimeout(time::microseconds(timeoutMicros));
+  workerQueries.answer(request, sizeof(backend) + sizeof(timeoutMicros),
+                       response, *solver->impl);
+}
+
+// Drops the answers of the stale workers that are ready, and kills the ones
+// that are past the deadline of their query.
+void PortfolioSolverImpl::drainStaleWorkers() {
+  for (unsigned i = 0; i < workers.getNumWorkers(); i++) {
+    if (!stale[i])
+      continue;
+    std::string ignored;
+    if (workers.isReady(i))
+      workers.wait(i, ignored, time::Span());
+    else if (timeout && time::getWallTime() >= staleDeadline[i])
+      workers.cancel(i);
+    else if (workers.isBusy(i))
+      continue;
+    stale[i] = false;
+  }
+}
+
+// Waits for a stale worker to become idle while the deadline of its query
+// has not passed, or for as long as it takes without a timeout. Returns
+// false if all workers are busy with the current query.
+bool PortfolioSolverImpl::makeWorkerIdle() {
+  for (;;) {
+    drainStaleWorkers();
+
+    int oldest = -1;
+    for (unsigned i = 0; i < workers.getNumWorkers(); i++) {
+      if (!workers.isBusy(i))
+        return true;
+      if (stale[i] && (oldest < 0 || staleDeadline[i] < staleDeadline[oldest]))
+        oldest = i;
+    }
+    if (oldest < 0)
+      return false;
+
+    // drainStaleWorkers() kills it once the deadline passed
+    time::Span left;
+    if (timeout)
+      left = std::max(staleDeadline[oldest] - time::getWallTime(),
+                      time::microseconds(1));
+    workers.waitAny(left);
+  }
+}
+
+bool PortfolioSolverImpl::computeInitialValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char>> &values, bool &hasSolution) {
+  TimerStatIncrementer t(stats::queryTime);
+  ++stats::queries;
+  ++stats::queryCounterexamples;
+  runStatusCode = SOLVER_RUN_STATUS_FAILURE;
+
+  std::string query_str;
+  SolverWorkerQueries::appendQuery(query_str, query, objects);
+
+  // The backends that answered first most often go first, in case stale
+  // workers leave too few idle workers for all of them
+  std::vector<unsigned> order(backends.size());
+  for (unsigned i = 0; i < backends.size(); i++)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [this](unsigned a, unsigned b) {
+    return backends[a].numWins > backends[b].numWins;
+  });
+
+  drainStaleWorkers();
+  std::vector<int> backendOf(workers.getNumWorkers(), -1);
+  unsigned pending = 0;
+  for (unsigned i : order) {
+    // the query needs at least one worker, the other backends only run on
+    // workers that are already idle
+    if (!pending && !makeWorkerIdle())
+      break;
+    std::string request(sizeof(std::uint32_t) + sizeof(std::uint64_t), '\0');
+    std::uint32_t backend = i;
+    std::uint64_t timeoutMicros = timeout.toMicroseconds();
+    memcpy(&request[0], &backend, sizeof(backend));
+    memcpy(&request[sizeof(backend)], &timeoutMicros, sizeof(timeoutMicros));
+    request += query_str;
+
+    SolverWorkerPool::Status status;
+    int worker = workers.submit(request, status);
+    if (worker >= 0) {
+      backendOf[worker] = i;
+      ++pending;
+    } else if (status != SolverWorkerPool::Status::Failed || !pending) {
+      klee_warning("Portfolio solver %s could not be started",
+                   backends[i].name.c_str());
+    }
+  }
+
+  // The backends stop at the timeout themselves, the workers get some time
+  // to answer before they are killed or, once another backend answered,
+  // their answer is dropped.
+  time::Point deadline;
+  if (timeout)
+    deadline = time::getWallTime() + timeout + time::seconds(1);
+
+  int winner = -1;
+  std::string response;
+  while (pending) {
+    time::Span left;
+    if (timeout) {
+      left = deadline - time::getWallTime();
+      if (left < time::microseconds(1))
+        left = time::microseconds(1);
+    }
+
+    int worker = workers.waitAny(left);
+    if (worker < 0) {
+      if (timeout && time::getWallTime() >= deadline) {
+        klee_warning("Portfolio solver timed out");
+        runStatusCode = SOLVER_RUN_STATUS_TIMEOUT;
+      }
+      break;
+    }
+
+    if (stale[worker]) {
+      drainStaleWorkers();
+      continue;
+    }
+
+    --pending;
+    SolverWorkerPool::Status status = workers.wait(worker, response, left);
+    if (status == SolverWorkerPool::Status::Success && !response.empty() &&
+        (response[0] == SolverWorkerQueries::Solvable ||
+         response[0] == SolverWorkerQueries::Unsolvable)) {
+      winner = worker;
+      break;
+    }
+
+    if (status == SolverWorkerPool::Status::Timeout ||
+        (status == SolverWorkerPool::Status::Success && response.size() > 1 &&
+         response[0] == SolverWorkerQueries::Failed &&
+         response[1] == SOLVER_RUN_STATUS_TIMEOUT))
+      runStatusCode = SOLVER_RUN_STATUS_TIMEOUT;
+  }
+
+  // the backends that did not answer yet keep their workers busy until
+  // they do
+  for (unsigned i = 0; i < workers.getNumWorkers(); i++) {
+    if (backendOf[i] >= 0 && workers.isBusy(i)) {
+      stale[i] = true;
+      staleDeadline[i] = deadline;
+    }
+  }
+  drainStaleWorkers();
+
+  if (winner < 0)
+    return false;
+
+  PortfolioBackend &backend = backends[backendOf[winner]];
+  ++*backend.wins;
+  ++backend.numWins;
+
+  hasSolution = response[0] == SolverWorkerQueries::Solvable;
+  if (hasSolution) {
+    if (!SolverWorkerQueries::readValues(response, objects, values)) {
+      klee_warning("Portfolio solver %s returned a short counterexample",
+                   backend.name.c_str());
+      runStatusCode = SOLVER_RUN_STATUS_FAILURE;
+      return false;
+    }
+    ++stats::queriesInvalid;
+    runStatusCode = SOLVER_RUN_STATUS_SUCCESS_SOLVABLE;
+  } else {
+    ++stats::queriesValid;
+    runStatusCode = SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE;
+  }
+  return true;
+}
+
+namespace klee {
+Solver *createPortfolioSolver(const std::vector<std::string> &backends) {
+  std::vector<std::string> names(backends);
+  if (names.empty()) {
+#ifdef ENABLE_STP
+    names.push_back("stp");
+#endif
+#ifdef ENABLE_Z3
+    names.push_back("z3");
+    names.push_back("z3:qfbv");
+#endif
+  }
+  if (names.empty())
+    klee_error("No solver for the portfolio solver");
+
+  return new Solver(new PortfolioSolverImpl(names));
+}
+} // namespace klee
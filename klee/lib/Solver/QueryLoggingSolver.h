@@ -72,6 +72,8 @@ public:
   SolverRunStatus getOperationStatusCode();
   char *getConstraintLog(const Query &);
   void setCoreSolverTimeout(time::Span timeout);
+  /// Hints are not logged, the queries are when they are asked for
+  void speculate(const Query &query) { solver->impl->speculate(query); }
 };
 
 #endif /* KLEE_QUERYLOGGINGSOLVER_H */
@@ -12,6 +12,8 @@
 
 #include "STPBuilder.h"
 #include "STPSolver.h"
+#include "SolverWorkerPool.h"
+#include "SolverWorkerQueries.h"
 
 #include "klee/Expr/Assignment.h"
 #include "klee/Expr/Constraints.h"
@@ -40,6 +42,13 @@ llvm::cl::opt<bool> IgnoreSolverFailures(
     "ignore-solver-failures", llvm::cl::init(false),
     llvm::cl::desc("Ignore any STP solver failures (default=false)"),
     llvm::cl::cat(klee::SolvingCat));
+
+llvm::cl::opt<bool> UseSolverWorker(
+    "use-solver-worker", llvm::cl::init(true),
+    llvm::cl::desc("With --use-forked-solver, send queries to a long-lived "
+                   "STP process instead of forking KLEE for every query "
+                   "(default=true)"),
+    llvm::cl::cat(klee::SolvingCat));
 }
 
 #define vc_bvBoolExtract IAMTHESPAWNOFSATAN
@@ -71,6 +80,14 @@ private:
   time::Span timeout;
   bool useForkedSTP;
   SolverRunStatus runStatusCode;
+  std::unique_ptr<SolverWorkerPool> worker;
+  std::unique_ptr<SolverWorkerQueries> workerQueries;
+
+  void solveInWorker(const std::string &request, std::string &response);
+  bool runAndGetCexInWorker(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char>> &values,
+                            bool &hasSolution);
 
 public:
   explicit STPSolverImpl(bool useForkedSTP, bool optimizeDivides = true);
@@ -117,10 +134,23 @@ STPSolverImpl::STPSolverImpl(bool useForkedSTP, bool optimizeDivides)
     if (shared_memory_ptr == (void *)-1)
       llvm::report_fatal_error("unable to attach shared memory region");
     shmctl(shared_memory_id, IPC_RMID, nullptr);
+
+    // the worker is only forked for the first query
+    if (UseSolverWorker) {
+      worker.reset(new SolverWorkerPool(
+          [this](const std::string &request, std::string &response) {
+            solveInWorker(request, response);
+          },
+          1, shared_memory_size));
+      workerQueries.reset(new SolverWorkerQueries(*worker));
+    }
   }
 }
 
 STPSolverImpl::~STPSolverImpl() {
+  workerQueries.reset();
+  worker.reset();
+
   // Detach the memory region.
   shmdt(shared_memory_ptr);
   shared_memory_ptr = nullptr;
@@ -315,12 +345,97 @@ runAndGetCexForked(::VC vc, STPBuilder *builder, ::VCExpr q,
   }
 }
 
+// Runs in the worker process, on a request that is just the query.
+void STPSolverImpl::solveInWorker(const std::string &request,
+                                  std::string &response) {
+  workerQueries->answer(
+      request, 0, response,
+      [this](const Query &query, const std::vector<const Array *> &objects,
+             std::vector<std::vector<unsigned char>> &values,
+             bool &hasSolution, SolverRunStatus &) {
+        // the arrays of the requests stay alive, so the builder can keep
+        // its translations
+        vc_push(vc);
+        for (const auto &constraint : query.constraints)
+          vc_assertFormula(vc, builder->construct(constraint));
+        runAndGetCex(vc, builder, builder->construct(query.expr), objects,
+                     values, hasSolution);
+        vc_pop(vc);
+        return true;
+      });
+}
+
+// Returns false if the query has to be run in a fork of KLEE instead.
+bool STPSolverImpl::runAndGetCexInWorker(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char>> &values, bool &hasSolution) {
+  std::string request, response;
+  SolverWorkerQueries::appendQuery(request, query, objects);
+
+  switch (worker->run(request, response, timeout)) {
+  case SolverWorkerPool::Status::Success:
+    break;
+  case SolverWorkerPool::Status::Timeout:
+    klee_warning("STP timed out");
+    runStatusCode = SOLVER_RUN_STATUS_TIMEOUT;
+    return true;
+  case SolverWorkerPool::Status::Crashed:
+    klee_warning("STP did not return successfully.  Most likely you forgot "
+                 "to run 'ulimit -s unlimited'");
+    if (!IgnoreSolverFailures)
+      exit(1);
+    runStatusCode = SOLVER_RUN_STATUS_INTERRUPTED;
+    return true;
+  case SolverWorkerPool::Status::TooLarge:
+  case SolverWorkerPool::Status::Failed:
+    return false;
+  }
+
+  if (response.empty() || response[0] == SolverWorkerQueries::ParseError) {
+    klee_warning_once(0, "STP worker could not parse a query, forking");
+    return false;
+  }
+
+  hasSolution = response[0] == SolverWorkerQueries::Solvable;
+  if (!hasSolution) {
+    runStatusCode = SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE;
+    return true;
+  }
+
+  if (!SolverWorkerQueries::readValues(response, objects, values)) {
+    klee_warning("STP worker returned a short counterexample");
+    if (!IgnoreSolverFailures)
+      exit(1);
+    runStatusCode = SOLVER_RUN_STATUS_UNEXPECTED_EXIT_CODE;
+    return true;
+  }
+
+  runStatusCode = SOLVER_RUN_STATUS_SUCCESS_SOLVABLE;
+  return true;
+}
+
 bool STPSolverImpl::computeInitialValues(
     const Query &query, const std::vector<const Array *> &objects,
     std::vector<std::vector<unsigned char>> &values, bool &hasSolution) {
   runStatusCode = SOLVER_RUN_STATUS_FAILURE;
   TimerStatIncrementer t(stats::queryTime);
 
+  if (worker && !DebugDumpSTPQueries &&
+      runAndGetCexInWorker(query, objects, values, hasSolution)) {
+    ++stats::queries;
+    ++stats::queryCounterexamples;
+
+    bool success = ((SOLVER_RUN_STATUS_SUCCESS_SOLVABLE == runStatusCode) ||
+                    (SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE == runStatusCode));
+    if (success) {
+      if (hasSolution)
+        ++stats::queriesInvalid;
+      else
+        ++stats::queriesValid;
+    }
+    return success;
+  }
+
   vc_push(vc);
 
   for (const auto &constraint : query.constraints)
@@ -51,11 +51,46 @@ cl::opt<bool> UseBranchCache("use-branch-cache", cl::init(true),
                              cl::desc("Use the branch cache (default=true)"),
                              cl::cat(SolvingCat));
 
+cl::opt<std::string> PersistentQueryCache(
+    "persistent-query-cache",
+    cl::desc("Cache the results of solver queries in the given file, which "
+             "is kept across runs (default=off)"),
+    cl::value_desc("path"), cl::cat(SolvingCat));
+
+cl::opt<bool> PersistentQueryCacheShared(
+    "persistent-query-cache-shared", cl::init(false),
+    cl::desc("Let concurrent KLEE processes use the same "
+             "--persistent-query-cache file, locking it around every "
+             "access (default=false)"),
+    cl::cat(SolvingCat));
+
+cl::opt<bool> CanonicalizeQueries(
+    "canonicalize-queries", cl::init(false),
+    cl::desc("Rename the arrays of queries by their first occurrence and sort "
+             "their constraints before the query caches, so that equivalent "
+             "queries from different states hit the caches (default=false)"),
+    cl::cat(SolvingCat));
+
 cl::opt<bool>
     UseIndependentSolver("use-independent-solver", cl::init(true),
                          cl::desc("Use constraint independence (default=true)"),
                          cl::cat(SolvingCat));
 
+cl::opt<unsigned> SpeculativeSolverWorkers(
+    "speculative-solver-workers", cl::init(0),
+    cl::desc("Number of worker processes that solve queries KLEE will "
+             "probably ask for soon, such as the remaining cases of a switch "
+             "or the test cases of states killed together, while KLEE goes "
+             "on (default=0 (off))"),
+    cl::cat(SolvingCat));
+
+cl::opt<bool> SolverChainStats(
+    "solver-chain-stats", cl::init(false),
+    cl::desc("Record the latency, hit rate and query size of every layer of "
+             "the solver chain, written to the solver_chain table of "
+             "run.stats (default=false)"),
+    cl::cat(SolvingCat));
+
 cl::opt<bool> DebugValidateSolver(
     "debug-validate-solver", cl::init(false),
     cl::desc("Crosscheck the results of the solver chain above the core solver "
@@ -188,7 +223,10 @@ cl::opt<CoreSolverType> CoreSolverToUse(
                clEnumValN(METASMT_SOLVER, "metasmt",
                           "metaSMT" METASMT_IS_DEFAULT_STR),
                clEnumValN(DUMMY_SOLVER, "dummy", "Dummy solver"),
-               clEnumValN(Z3_SOLVER, "z3", "Z3" Z3_IS_DEFAULT_STR)),
+               clEnumValN(Z3_SOLVER, "z3", "Z3" Z3_IS_DEFAULT_STR),
+               clEnumValN(PORTFOLIO_SOLVER, "portfolio",
+                          "Run the solvers of --portfolio-solvers in "
+                          "parallel and take the first answer")),
     cl::init(DEFAULT_CORE_SOLVER), cl::cat(SolvingCat));
 
 cl::opt<CoreSolverType> DebugCrossCheckCoreSolverWith(
@@ -201,6 +239,13 @@ cl::opt<CoreSolverType> DebugCrossCheckCoreSolverWith(
                clEnumValN(Z3_SOLVER, "z3", "Z3"),
                clEnumValN(NO_SOLVER, "none", "Do not crosscheck (default)")),
     cl::init(NO_SOLVER), cl::cat(SolvingCat));
+
+cl::list<std::string> PortfolioSolvers(
+    "portfolio-solvers", cl::CommaSeparated,
+    cl::desc("Comma-separated list of the solvers used by "
+             "--solver-backend=portfolio: stp, z3 or z3:<tactic> "
+             "(default=stp,z3,z3:qfbv, as far as compiled in)"),
+    cl::value_desc("solver"), cl::cat(SolvingCat));
 } // namespace klee
 
 #undef STP_IS_DEFAULT_STR
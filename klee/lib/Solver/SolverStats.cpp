@@ -11,17 +11,42 @@
 
 using namespace klee;
 
+Statistic stats::canonicalizationTime("CanonicalizationTime", "CNtime");
 Statistic stats::cexCacheTime("CexCacheTime", "CCtime");
+Statistic stats::incrementalConstraintsAsserted(
+    "IncrementalConstraintsAsserted", "ICasserted");
+Statistic stats::incrementalConstraintsReused("IncrementalConstraintsReused",
+                                              "ICreused");
+Statistic stats::persistentCacheHits("PersistentCacheHits", "PChits");
+Statistic stats::persistentCacheMisses("PersistentCacheMisses", "PCmisses");
+Statistic stats::portfolioWinsSTP("PortfolioWinsSTP", "PWstp");
+Statistic stats::portfolioWinsZ3("PortfolioWinsZ3", "PWz3");
+Statistic stats::portfolioWinsZ3Tactic("PortfolioWinsZ3Tactic", "PWz3t");
 Statistic stats::queries("Queries", "Q");
 Statistic stats::queriesInvalid("QueriesInvalid", "Qiv");
 Statistic stats::queriesValid("QueriesValid", "Qv");
 Statistic stats::queryCacheHits("QueryCacheHits", "QChits") ;
 Statistic stats::queryCacheMisses("QueryCacheMisses", "QCmisses");
+Statistic stats::queryCexCacheEvictions("QueryCexCacheEvictions",
+                                         "QCexEvict");
 Statistic stats::queryCexCacheHits("QueryCexCacheHits", "QCexHits") ;
 Statistic stats::queryCexCacheMisses("QueryCexCacheMisses", "QCexMisses");
 Statistic stats::queryConstructs("QueryConstructs", "QB");
 Statistic stats::queryCounterexamples("QueriesCEX", "Qcex");
 Statistic stats::queryTime("QueryTime", "Qtime");
+Statistic stats::solverWorkerSpawns("SolverWorkerSpawns", "SWspawns");
+Statistic stats::speculativeHits("SpeculativeHits", "SPhits");
+Statistic stats::speculativeQueries("SpeculativeQueries", "SPq");
+
+LatencyHistogram stats::cexCacheLookupTime;
+
+std::deque<stats::SolverLayerStats> stats::solverLayers;
+
+stats::SolverLayerStats &
+stats::addSolverLayer(const std::string &name, const SolverLayerStats *next) {
+  solverLayers.emplace_back(name, next);
+  return solverLayers.back();
+}
 
 #ifdef KLEE_ARRAY_DEBUG
 Statistic stats::arrayHashTime("ArrayHashTime", "AHtime");
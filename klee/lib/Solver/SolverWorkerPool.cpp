@@ -0,0 +1,313 @@
+//===-- SolverWorkerPool.cpp ----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SolverWorkerPool.h"
+
+#include "klee/Solver/SolverStats.h"
+#include "klee/Support/ErrorHandling.h"
+
+#include "llvm/Support/Errno.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace klee;
+
+static const std::uint64_t TooLargeResponse = ~(std::uint64_t)0;
+
+// The byte a worker sends with a response after which it exits
+static const char ExitingWorker = 1;
+
+SolverWorkerPool::SolverWorkerPool(Handler handler, unsigned numWorkers,
+                                   std::size_t bufferSize)
+    : handler(std::move(handler)), bufferSize(bufferSize),
+      workers(numWorkers) {
+  for (auto &worker : workers) {
+    void *buffer = mmap(nullptr, sizeof(std::uint64_t) + bufferSize,
+                        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                        -1, 0);
+    if (buffer == MAP_FAILED)
+      klee_error("unable to map solver worker buffer: %s",
+                 llvm::sys::StrError(errno).c_str());
+    worker.buffer = static_cast<char *>(buffer);
+  }
+}
+
+SolverWorkerPool::~SolverWorkerPool() {
+  for (auto &worker : workers) {
+    kill(worker);
+    munmap(worker.buffer, sizeof(std::uint64_t) + bufferSize);
+  }
+}
+
+bool SolverWorkerPool::spawn(Worker &worker) {
+  int sockets[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0) {
+    klee_warning("socketpair failed (for solver worker) - %s",
+                 llvm::sys::StrError(errno).c_str());
+    return false;
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+
+  pid_t pid = fork();
+  if (pid == -1) {
+    klee_warning("fork failed (for solver worker) - %s",
+                 llvm::sys::StrError(errno).c_str());
+    close(sockets[0]);
+    close(sockets[1]);
+    return false;
+  }
+
+  if (pid == 0) {
+    close(sockets[0]);
+    // the other workers must see their sockets close when KLEE exits
+    for (auto &other : workers) {
+      if (other.socket >= 0)
+        close(other.socket);
+    }
+    worker.socket = sockets[1];
+    serve(worker);
+  }
+
+  close(sockets[1]);
+  worker.pid = pid;
+  worker.socket = sockets[0];
+  worker.busy = false;
+  ++numSpawns;
+  ++stats::solverWorkerSpawns;
+  return true;
+}
+
+void SolverWorkerPool::kill(Worker &worker) {
+  if (worker.pid < 0)
+    return;
+
+  ::kill(worker.pid, SIGKILL);
+  close(worker.socket);
+  while (waitpid(worker.pid, nullptr, 0) < 0 && errno == EINTR)
+    ;
+
+  worker.pid = -1;
+  worker.socket = -1;
+  worker.busy = false;
+}
+
+void SolverWorkerPool::serve(Worker &worker) {
+  // interrupting KLEE must not kill a query, KLEE closes the socket instead
+  signal(SIGINT, SIG_IGN);
+  signal(SIGALRM, SIG_DFL);
+
+  std::string request, response;
+  for (;;) {
+    char c;
+    ssize_t n;
+    do {
+      n = read(worker.socket, &c, 1);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0)
+      _exit(0);
+
+    std::uint64_t length;
+    memcpy(&length, worker.buffer, sizeof(length));
+    request.assign(worker.buffer + sizeof(length), length);
+    response.clear();
+    handler(request, response);
+
+    if (response.size() > bufferSize) {
+      length = TooLargeResponse;
+    } else {
+      length = response.size();
+      memcpy(worker.buffer + sizeof(length), response.data(), length);
+    }
+    memcpy(worker.buffer, &length, sizeof(length));
+
+    if (exitRequested)
+      c = ExitingWorker;
+    do {
+      n = send(worker.socket, &c, 1, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0 || exitRequested)
+      _exit(0);
+  }
+}
+
+bool SolverWorkerPool::start() {
+  for (auto &worker : workers) {
+    if (worker.pid < 0 && !spawn(worker))
+      return false;
+  }
+  return true;
+}
+
+int SolverWorkerPool::submit(const std::string &request, Status &status) {
+  if (request.size() > bufferSize) {
+    status = Status::TooLarge;
+    return -1;
+  }
+
+  for (unsigned i = 0; i < workers.size(); i++) {
+    Worker &worker = workers[i];
+    if (worker.busy)
+      continue;
+
+    // a worker that died since its last request is replaced once
+    for (unsigned attempt = 0; attempt < 2; attempt++) {
+      if (worker.pid < 0 && !spawn(worker)) {
+        status = Status::Failed;
+        return -1;
+      }
+
+      std::uint64_t length = request.size();
+      memcpy(worker.buffer, &length, sizeof(length));
+      memcpy(worker.buffer + sizeof(length), request.data(), length);
+
+      char c = 0;
+      ssize_t n;
+      do {
+        n = send(worker.socket, &c, 1, MSG_NOSIGNAL);
+      } while (n < 0 && errno == EINTR);
+
+      if (n == 1) {
+        worker.busy = true;
+        status = Status::Success;
+        return i;
+      }
+      kill(worker);
+    }
+
+    status = Status::Crashed;
+    return -1;
+  }
+
+  status = Status::Failed;
+  return -1;
+}
+
+bool SolverWorkerPool::isReady(unsigned i) {
+  Worker &worker = workers[i];
+  if (!worker.busy)
+    return false;
+
+  struct pollfd pfd = {worker.socket, POLLIN, 0};
+  return poll(&pfd, 1, 0) > 0;
+}
+
+void SolverWorkerPool::cancel(unsigned i) {
+  if (workers[i].busy)
+    kill(workers[i]);
+}
+
+// Returns the poll() timeout in milliseconds until deadline, rounded up.
+static int getPollTimeout(std::chrono::steady_clock::time_point deadline) {
+  auto left = std::chrono::duration_cast<std::chrono::microseconds>(
+                  deadline - std::chrono::steady_clock::now())
+                  .count();
+  return left <= 0 ? 0 : (left + 999) / 1000;
+}
+
+int SolverWorkerPool::waitAny(time::Span timeout) {
+  std::vector<struct pollfd> pfds;
+  std::vector<unsigned> busy;
+  for (unsigned i = 0; i < workers.size(); i++) {
+    if (workers[i].busy) {
+      pfds.push_back({workers[i].socket, POLLIN, 0});
+      busy.push_back(i);
+    }
+  }
+  if (busy.empty())
+    return -1;
+
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::microseconds(timeout.toMicroseconds());
+  for (;;) {
+    int res = poll(pfds.data(), pfds.size(),
+                   timeout ? getPollTimeout(deadline) : -1);
+    if (res == 0)
+      return -1;
+    if (res > 0)
+      break;
+    // a failing poll leaves it to wait() to notice the dead worker
+    if (errno != EINTR)
+      return busy[0];
+  }
+
+  for (unsigned i = 0; i < pfds.size(); i++) {
+    if (pfds[i].revents)
+      return busy[i];
+  }
+  return -1;
+}
+
+SolverWorkerPool::Status SolverWorkerPool::wait(unsigned i,
+                                                std::string &response,
+                                                time::Span timeout) {
+  Worker &worker = workers[i];
+  assert(worker.busy && "waiting for an idle worker");
+
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::microseconds(timeout.toMicroseconds());
+  struct pollfd pfd = {worker.socket, POLLIN, 0};
+  for (;;) {
+    int res = poll(&pfd, 1, timeout ? getPollTimeout(deadline) : -1);
+    if (res > 0)
+      break;
+    if (res == 0) {
+      kill(worker);
+      return Status::Timeout;
+    }
+    if (errno != EINTR) {
+      kill(worker);
+      return Status::Crashed;
+    }
+  }
+
+  char c;
+  ssize_t n;
+  do {
+    n = read(worker.socket, &c, 1);
+  } while (n < 0 && errno == EINTR);
+  if (n != 1) {
+    kill(worker);
+    return Status::Crashed;
+  }
+  worker.busy = false;
+  // the worker is gone, its response stays in the buffer
+  if (c == ExitingWorker)
+    kill(worker);
+
+  std::uint64_t length;
+  memcpy(&length, worker.buffer, sizeof(length));
+  if (length == TooLargeResponse)
+    return Status::TooLarge;
+
+  response.assign(worker.buffer + sizeof(length), length);
+  return Status::Success;
+}
+
+SolverWorkerPool::Status SolverWorkerPool::run(const std::string &request,
+                                               std::string &response,
+                                               time::Span timeout) {
+  Status status;
+  int worker = submit(request, status);
+  if (worker < 0)
+    return status;
+  return wait(worker, response, timeout);
+}
@@ -0,0 +1,116 @@
+//===-- SolverWorkerPool.h --------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_SOLVERWORKERPOOL_H
+#define KLEE_SOLVERWORKERPOOL_H
+
+#include "klee/System/Time.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace klee {
+
+/// A pool of long-lived worker processes that answer serialized requests,
+/// so that a solver crash or timeout does not take KLEE down without forking
+/// KLEE for every query. Workers are forked from KLEE when first needed and
+/// again after one of them was killed or crashed.
+///
+/// Each worker has a shared-memory buffer that holds its request and then its
+/// response, and a socket over which the two sides notify each other.
+class SolverWorkerPool {
+public:
+  /// Computes the response to a request, in the worker process
+  typedef std::function<void(const std::string &request,
+                             std::string &response)>
+      Handler;
+
+  enum class Status {
+    Success,
+    /// The worker did not answer in time and was killed
+    Timeout,
+    /// The worker died while handling the request
+    Crashed,
+    /// The request or the response does not fit into the buffer
+    TooLarge,
+    /// No worker could be started
+    Failed
+  };
+
+  SolverWorkerPool(Handler handler, unsigned numWorkers = 1,
+                   std::size_t bufferSize = 1 << 20);
+  SolverWorkerPool(const SolverWorkerPool &) = delete;
+  SolverWorkerPool &operator=(const SolverWorkerPool &) = delete;
+  ~SolverWorkerPool();
+
+  /// Forks the workers that are not running yet, instead of when they are
+  /// first needed. Returns false if one of them could not be started.
+  bool start();
+
+  /// Runs request on an idle worker and waits for its response. A worker
+  /// that does not answer within timeout, if given, is killed.
+  Status run(const std::string &request, std::string &response,
+             time::Span timeout = time::Span());
+
+  /// Sends request to an idle worker without waiting for the response.
+  /// Returns the worker, or -1 with the reason in status.
+  int submit(const std::string &request, Status &status);
+
+  /// Waits up to timeout, or forever if zero, for the response of worker.
+  /// A worker that does not answer in time is killed.
+  Status wait(unsigned worker, std::string &response, time::Span timeout);
+
+  /// Waits up to timeout, or forever if zero, until one of the busy workers
+  /// has its response ready. Returns that worker, or -1 if the timeout
+  /// expired or no worker is busy.
+  int waitAny(time::Span timeout);
+
+  /// Returns true if worker has its response ready.
+  bool isReady(unsigned worker);
+
+  /// Kills worker and drops its request.
+  void cancel(unsigned worker);
+
+  /// Called by the handler: the worker exits once it sent its response, and
+  /// is forked from KLEE again for the next request.
+  void exitAfterResponse() { exitRequested = true; }
+
+  unsigned getNumWorkers() const { return workers.size(); }
+  bool isBusy(unsigned worker) const { return workers[worker].busy; }
+
+  /// Number of worker processes started
+  std::uint64_t getNumSpawns() const { return numSpawns; }
+
+private:
+  struct Worker {
+    pid_t pid = -1;
+    int socket = -1;
+    /// shared with the worker: the length of the message, then the message
+    char *buffer = nullptr;
+    bool busy = false;
+  };
+
+  Handler handler;
+  std::size_t bufferSize;
+  std::vector<Worker> workers;
+  std::uint64_t numSpawns = 0;
+  /// Set in a worker by exitAfterResponse()
+  bool exitRequested = false;
+
+  bool spawn(Worker &worker);
+  void kill(Worker &worker);
+  [[noreturn]] void serve(Worker &worker);
+};
+
+} // namespace klee
+
+#endif /* KLEE_SOLVERWORKERPOOL_H */
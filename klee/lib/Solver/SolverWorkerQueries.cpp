@@ -0,0 +1,105 @@
+//===-- SolverWorkerQueries.cpp -------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SolverWorkerQueries.h"
+
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/ExprBuilder.h"
+#include "klee/Expr/ExprPPrinter.h"
+#include "klee/Expr/Parser/Parser.h"
+
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <memory>
+
+using namespace klee;
+
+void SolverWorkerQueries::appendQuery(
+    std::string &request, const Query &query,
+    const std::vector<const Array *> &objects) {
+  llvm::raw_string_ostream os(request);
+  ExprPPrinter::printQuery(os, query.constraints, query.expr, nullptr, nullptr,
+                           objects.data(), objects.data() + objects.size());
+}
+
+void SolverWorkerQueries::answer(const std::string &request,
+                                 std::size_t headerSize,
+                                 std::string &response, const Solve &solve) {
+  auto mb = llvm::MemoryBuffer::getMemBuffer(
+      llvm::StringRef(request).drop_front(headerSize), "query", false);
+  std::unique_ptr<ExprBuilder> exprBuilder(createDefaultExprBuilder());
+  std::unique_ptr<expr::Parser> parser(expr::Parser::Create(
+      "query", mb.get(), exprBuilder.get(), &arrayCache, false));
+  parser->SetMaxErrors(1);
+
+  std::vector<std::unique_ptr<expr::Decl>> decls;
+  expr::QueryCommand *qc = nullptr;
+  while (expr::Decl *d = parser->ParseTopLevelDecl()) {
+    decls.emplace_back(d);
+    if (isa<expr::ArrayDecl>(d))
+      ++numArrays;
+    if (auto *q = dyn_cast<expr::QueryCommand>(d))
+      qc = q;
+  }
+  if (numArrays >= MaxArrays)
+    pool.exitAfterResponse();
+  if (!qc || parser->GetNumErrors()) {
+    response.push_back(ParseError);
+    return;
+  }
+
+  ConstraintSet constraints(qc->Constraints);
+  std::vector<std::vector<unsigned char>> values;
+  bool hasSolution;
+  SolverImpl::SolverRunStatus status = SolverImpl::SOLVER_RUN_STATUS_FAILURE;
+  if (!solve(Query(constraints, qc->Query), qc->Objects, values, hasSolution,
+             status)) {
+    response.push_back(Failed);
+    response.push_back(status);
+    return;
+  }
+
+  response.push_back(hasSolution ? Solvable : Unsolvable);
+  for (const auto &value : values)
+    response.append(value.begin(), value.end());
+}
+
+void SolverWorkerQueries::answer(const std::string &request,
+                                 std::size_t headerSize,
+                                 std::string &response, SolverImpl &solver) {
+  answer(request, headerSize, response,
+         [&solver](const Query &query,
+                   const std::vector<const Array *> &objects,
+                   std::vector<std::vector<unsigned char>> &values,
+                   bool &hasSolution, SolverImpl::SolverRunStatus &status) {
+           if (solver.computeInitialValues(query, objects, values,
+                                           hasSolution))
+             return true;
+           status = solver.getOperationStatusCode();
+           return false;
+         });
+}
+
+bool SolverWorkerQueries::readValues(
+    const std::string &response, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char>> &values) {
+  const char *pos = response.data() + 1;
+  const char *end = response.data() + response.size();
+  values.reserve(objects.size());
+  for (const Array *object : objects) {
+    if (object->size > (std::size_t)(end - pos)) {
+      values.clear();
+      return false;
+    }
+    values.emplace_back(pos, pos + object->size);
+    pos += object->size;
+  }
+  return true;
+}
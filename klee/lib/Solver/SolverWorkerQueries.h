@@ -0,0 +1,77 @@
+//===-- SolverWorkerQueries.h -----------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_SOLVERWORKERQUERIES_H
+#define KLEE_SOLVERWORKERQUERIES_H
+
+#include "SolverWorkerPool.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Solver/SolverImpl.h"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace klee {
+
+/// The handling of requests that the solvers running queries in a
+/// SolverWorkerPool share. A request is a header of the solver's own,
+/// followed by a query and its objects in the KQuery format. The response
+/// is a Response, followed by the values of the objects for a solvable
+/// query, or by the run status for a failed one.
+///
+/// The solvers cache their translation of arrays by address, so the arrays
+/// of all requests stay alive in the worker. Once it parsed MaxArrays of
+/// them, the worker exits and is forked again, with an empty array cache
+/// and a solver that never saw them.
+class SolverWorkerQueries {
+public:
+  enum Response : char { Unsolvable, Solvable, Failed, ParseError };
+
+  /// Solves query in the worker. Returns false if the solver failed, with
+  /// its run status in status.
+  typedef std::function<bool(const Query &query,
+                             const std::vector<const Array *> &objects,
+                             std::vector<std::vector<unsigned char>> &values,
+                             bool &hasSolution,
+                             SolverImpl::SolverRunStatus &status)>
+      Solve;
+
+  static const std::size_t MaxArrays = 1 << 14;
+
+  explicit SolverWorkerQueries(SolverWorkerPool &pool) : pool(pool) {}
+
+  /// Appends query and objects to the header in request.
+  static void appendQuery(std::string &request, const Query &query,
+                          const std::vector<const Array *> &objects);
+
+  /// Answers the query that follows headerSize bytes of request, in the
+  /// worker.
+  void answer(const std::string &request, std::size_t headerSize,
+              std::string &response, const Solve &solve);
+  void answer(const std::string &request, std::size_t headerSize,
+              std::string &response, SolverImpl &solver);
+
+  /// Reads the values of objects from a Solvable response. Returns false
+  /// if the response is too short.
+  static bool readValues(const std::string &response,
+                         const std::vector<const Array *> &objects,
+                         std::vector<std::vector<unsigned char>> &values);
+
+private:
+  SolverWorkerPool &pool;
+  ArrayCache arrayCache;
+  std::size_t numArrays = 0;
+};
+
+} // namespace klee
+
+#endif /* KLEE_SOLVERWORKERQUERIES_H */
@@ -0,0 +1,324 @@
+//===-- SpeculativeSolver.cpp ---------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SolverWorkerPool.h"
+#include "SolverWorkerQueries.h"
+
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/ExprUtil.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+
+using namespace klee;
+
+namespace {
+
+/// The constraints of a query, followed by its expression
+typedef std::vector<ref<Expr>> SpeculationKey;
+
+struct Speculation {
+  enum State { Queued, Running, Done };
+
+  State state = Queued;
+  /// All symbolic objects of the query, so that any of them can be answered
+  std::vector<const Array *> objects;
+  std::vector<std::vector<unsigned char>> values;
+  bool hasSolution = false;
+};
+
+class SpeculativeSolver : public SolverImpl {
+  typedef std::map<SpeculationKey, Speculation> speculations_ty;
+
+  /// The number of queries kept waiting for a worker, and answered
+  static constexpr std::size_t MaxQueued = 256;
+  static constexpr std::size_t MaxDone = 1024;
+
+  Solver *solver;
+  /// Creates the solver of a worker, in the worker process
+  std::function<Solver *()> createWorkerSolver;
+  /// The solver of this process if it is a worker
+  std::unique_ptr<Solver> workerSolver;
+  SolverWorkerPool workers;
+  time::Span timeout;
+
+  speculations_ty speculations;
+  /// The queries to hand to the next idle workers, oldest first
+  std::deque<SpeculationKey> queued;
+  /// The answered queries, oldest first
+  std::deque<SpeculationKey> done;
+  /// The query of each busy worker
+  std::vector<speculations_ty::iterator> running;
+
+  /// Parses the requests in the workers
+  SolverWorkerQueries workerQueries;
+
+  void solveInWorker(const std::string &request, std::string &response);
+
+  /// Collects the answers of the workers that are done and hands queued
+  /// queries to the idle ones.
+  void poll();
+  void submit(speculations_ty::iterator it);
+  void finish(unsigned worker, time::Span waitTimeout);
+
+  /// Returns the answered speculation for query, waiting for its worker if
+  /// it is running, or null.
+  Speculation *lookup(const Query &query);
+
+public:
+  SpeculativeSolver(Solver *solver,
+                    std::function<Solver *()> createWorkerSolver,
+                    unsigned numWorkers);
+  ~SpeculativeSolver() { delete solver; }
+
+  bool computeTruth(const Query &, bool &isValid);
+  bool computeValidity(const Query &, Solver::Validity &result);
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    return solver->impl->computeValue(query, result);
+  }
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char>> &values,
+                            bool &hasSolution);
+  SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+  char *getConstraintLog(const Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+  void setCoreSolverTimeout(time::Span timeout) {
+    this->timeout = timeout;
+    solver->impl->setCoreSolverTimeout(timeout);
+  }
+  void speculate(const Query &query);
+};
+
+SpeculationKey getKey(const Query &query) {
+  SpeculationKey key(query.constraints.begin(), query.constraints.end());
+  key.push_back(query.expr);
+  return key;
+}
+
+} // namespace
+
+SpeculativeSolver::SpeculativeSolver(
+    Solver *solver, std::function<Solver *()> createWorkerSolver,
+    unsigned numWorkers)
+    : solver(solver), createWorkerSolver(std::move(createWorkerSolver)),
+      workers(
+          [this](const std::string &request, std::string &response) {
+            solveInWorker(request, response);
+          },
+          numWorkers),
+      running(numWorkers), workerQueries(workers) {
+  // while KLEE is small, rather than when states are killed at the memory
+  // limit
+  workers.start();
+}
+
+// Requests are the timeout in microseconds, followed by the query. The
+// solver of KLEE is not used here: a forked or pooled solver shares memory
+// with its processes, which KLEE would then share with the workers.
+void SpeculativeSolver::solveInWorker(const std::string &request,
+                                      std::string &response) {
+  if (!workerSolver)
+    workerSolver.reset(createWorkerSolver());
+  if (!workerSolver)
+    return;
+
+  std::uint64_t timeoutMicros;
+  memcpy(&timeoutMicros, request.data(), sizeof(timeoutMicros));
+  workerSolver->setCoreSolverTimeout(time::microseconds(timeoutMicros));
+  workerQueries.answer(request, sizeof(timeoutMicros), response,
+                       *workerSolver->impl);
+}
+
+void SpeculativeSolver::submit(speculations_ty::iterator it) {
+  const SpeculationKey &key = it->first;
+  Speculation &speculation = it->second;
+
+  std::string request(sizeof(std::uint64_t), '\0');
+  std::uint64_t timeoutMicros = timeout.toMicroseconds();
+  memcpy(&request[0], &timeoutMicros, sizeof(timeoutMicros));
+  ConstraintSet constraints(std::vector<ref<Expr>>(key.begin(), key.end() - 1));
+  SolverWorkerQueries::appendQuery(request, Query(constraints, key.back()),
+                                   speculation.objects);
+
+  SolverWorkerPool::Status status;
+  int worker = workers.submit(request, status);
+  if (worker < 0) {
+    // the query is solved in KLEE when it is asked for
+    speculations.erase(it);
+    return;
+  }
+
+  speculation.state = Speculation::Running;
+  running[worker] = it;
+  ++stats::speculativeQueries;
+}
+
+void SpeculativeSolver::finish(unsigned worker, time::Span waitTimeout) {
+  speculations_ty::iterator it = running[worker];
+  Speculation &speculation = it->second;
+
+  std::string response;
+  SolverWorkerPool::Status status =
+      workers.wait(worker, response, waitTimeout);
+  if (status != SolverWorkerPool::Status::Success || response.empty() ||
+      (response[0] != SolverWorkerQueries::Solvable &&
+       response[0] != SolverWorkerQueries::Unsolvable)) {
+    speculations.erase(it);
+    return;
+  }
+
+  speculation.hasSolution = response[0] == SolverWorkerQueries::Solvable;
+  if (speculation.hasSolution &&
+      !SolverWorkerQueries::readValues(response, speculation.objects,
+                                       speculation.values)) {
+    speculations.erase(it);
+    return;
+  }
+
+  speculation.state = Speculation::Done;
+  done.push_back(it->first);
+  while (done.size() > MaxDone) {
+    auto old = speculations.find(done.front());
+    if (old != speculations.end() && old->second.state == Speculation::Done)
+      speculations.erase(old);
+    done.pop_front();
+  }
+}
+
+void SpeculativeSolver::poll() {
+  for (unsigned i = 0; i < workers.getNumWorkers(); i++) {
+    if (workers.isReady(i))
+      finish(i, time::Span());
+  }
+
+  for (unsigned i = 0; i < workers.getNumWorkers() && !queued.empty(); i++) {
+    if (workers.isBusy(i))
+      continue;
+
+    // skip the queries that were solved in KLEE in the meantime
+    speculations_ty::iterator it;
+    do {
+      it = speculations.find(queued.front());
+      queued.pop_front();
+    } while ((it == speculations.end() ||
+              it->second.state != Speculation::Queued) &&
+             !queued.empty());
+    if (it != speculations.end() && it->second.state == Speculation::Queued)
+      submit(it);
+  }
+}
+
+Speculation *SpeculativeSolver::lookup(const Query &query) {
+  if (speculations.empty())
+    return nullptr;
+  poll();
+
+  SpeculationKey key = getKey(query);
+  speculations_ty::iterator it = speculations.find(key);
+  if (it == speculations.end())
+    return nullptr;
+
+  if (it->second.state == Speculation::Queued) {
+    // solving it here is faster than waiting for a worker to start on it
+    speculations.erase(it);
+    return nullptr;
+  }
+
+  if (it->second.state == Speculation::Running) {
+    // the worker has a head start, it gets some time beyond the timeout
+    // of the solver before it is killed
+    for (unsigned i = 0; i < running.size(); i++) {
+      if (workers.isBusy(i) && running[i] == it) {
+        finish(i, timeout ? timeout + time::seconds(1) : time::Span());
+        break;
+      }
+    }
+    it = speculations.find(key);
+    if (it == speculations.end())
+      return nullptr;
+  }
+
+  ++stats::speculativeHits;
+  return &it->second;
+}
+
+void SpeculativeSolver::speculate(const Query &query) {
+  if (queued.size() >= MaxQueued)
+    return;
+
+  SpeculationKey key = getKey(query);
+  auto res = speculations.emplace(key, Speculation());
+  if (!res.second)
+    return;
+
+  findSymbolicObjects(key.begin(), key.end(), res.first->second.objects);
+  queued.push_back(std::move(key));
+  poll();
+}
+
+bool SpeculativeSolver::computeTruth(const Query &query, bool &isValid) {
+  if (Speculation *speculation = lookup(query)) {
+    isValid = !speculation->hasSolution;
+    return true;
+  }
+  return solver->impl->computeTruth(query, isValid);
+}
+
+bool SpeculativeSolver::computeValidity(const Query &query,
+                                        Solver::Validity &result) {
+  // the default implementation asks computeTruth for both directions
+  if (!speculations.empty() &&
+      (speculations.count(getKey(query)) ||
+       speculations.count(getKey(query.negateExpr()))))
+    return SolverImpl::computeValidity(query, result);
+  return solver->impl->computeValidity(query, result);
+}
+
+bool SpeculativeSolver::computeInitialValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char>> &values, bool &hasSolution) {
+  Speculation *speculation = lookup(query);
+  if (!speculation)
+    return solver->impl->computeInitialValues(query, objects, values,
+                                              hasSolution);
+
+  hasSolution = speculation->hasSolution;
+  if (!hasSolution)
+    return true;
+
+  values.reserve(objects.size());
+  for (const Array *object : objects) {
+    auto it = std::find(speculation->objects.begin(),
+                        speculation->objects.end(), object);
+    if (it == speculation->objects.end())
+      values.emplace_back(object->size, 0);
+    else
+      values.push_back(
+          speculation->values[it - speculation->objects.begin()]);
+  }
+  return true;
+}
+
+Solver *klee::createSpeculativeSolver(
+    Solver *s, std::function<Solver *()> createWorkerSolver,
+    unsigned numWorkers) {
+  return new Solver(
+      new SpeculativeSolver(s, std::move(createWorkerSolver), numWorkers));
+}
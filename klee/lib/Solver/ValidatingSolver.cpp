@@ -40,6 +40,7 @@ public:
   SolverRunStatus getOperationStatusCode();
   char *getConstraintLog(const Query &);
   void setCoreSolverTimeout(time::Span timeout);
+  void speculate(const Query &query) { solver->impl->speculate(query); }
 };
 
 bool ValidatingSolver::computeTruth(const Query &query, bool &isValid) {
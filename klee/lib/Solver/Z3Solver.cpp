@@ -27,6 +27,9 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <list>
+#include <unordered_map>
+
 namespace {
 // NOTE: Very useful for debugging Z3 behaviour. These files can be given to
 // the z3 binary to replay all Z3 API calls using its `-log` option.
@@ -49,6 +52,25 @@ llvm::cl::opt<unsigned>
     Z3VerbosityLevel("debug-z3-verbosity", llvm::cl::init(0),
                      llvm::cl::desc("Z3 verbosity level (default=0)"),
                      llvm::cl::cat(klee::SolvingCat));
+
+llvm::cl::opt<bool> Z3Incremental(
+    "z3-incremental", llvm::cl::init(false),
+    llvm::cl::desc("Keep Z3 solvers alive between queries and only assert "
+                   "the constraints a solver does not hold yet (default=false)"),
+    llvm::cl::cat(klee::SolvingCat));
+
+llvm::cl::opt<unsigned> Z3IncrementalSolvers(
+    "z3-incremental-solvers", llvm::cl::init(8),
+    llvm::cl::desc("Maximum number of Z3 solvers kept alive with "
+                   "--z3-incremental (default=8)"),
+    llvm::cl::cat(klee::SolvingCat));
+
+llvm::cl::opt<unsigned> Z3IncrementalMaxMemory(
+    "z3-incremental-max-memory", llvm::cl::init(1024),
+    llvm::cl::desc("Drop the least recently used Z3 solvers with "
+                   "--z3-incremental while Z3 uses more memory than this, in "
+                   "MB (default=1024, 0=no limit)"),
+    llvm::cl::cat(klee::SolvingCat));
 }
 
 #include "llvm/Support/ErrorHandling.h"
@@ -64,6 +86,27 @@ private:
   ::Z3_params solverParameters;
   // Parameter symbols
   ::Z3_symbol timeoutParamStrSymbol;
+  // Tactic to build the solver from, null for Z3's default solver
+  ::Z3_tactic tactic;
+
+  /// A Z3 solver kept alive between queries, holding the constraints of a
+  /// previous query with one scope per constraint
+  struct IncrementalSolver {
+    ::Z3_solver solver;
+    std::vector<ref<Expr>> constraints;
+    /// The constant arrays whose assertions the solver holds, with the number
+    /// of constraints asserted when they were added
+    std::unordered_map<const Array *, std::size_t> constantArrays;
+  };
+
+  bool incremental;
+  /// Most recently used first
+  std::list<IncrementalSolver> incrementalSolvers;
+
+  IncrementalSolver &getIncrementalSolver(const ConstraintSet &constraints);
+  void assertConstantArrays(IncrementalSolver &solver, const ref<Expr> &e,
+                            bool keep);
+  void evictIncrementalSolvers();
 
   bool internalRunSolver(const Query &,
                          const std::vector<const Array *> *objects,
@@ -72,7 +115,8 @@ private:
   bool validateZ3Model(::Z3_solver &theSolver, ::Z3_model &theModel);
 
 public:
-  Z3SolverImpl();
+  explicit Z3SolverImpl(const std::string &tacticName = "",
+                        bool incremental = false);
   ~Z3SolverImpl();
 
   char *getConstraintLog(const Query &);
@@ -100,19 +144,31 @@ public:
   SolverRunStatus getOperationStatusCode();
 };
 
-Z3SolverImpl::Z3SolverImpl()
+Z3SolverImpl::Z3SolverImpl(const std::string &tacticName, bool incremental)
     : builder(new Z3Builder(
           /*autoClearConstructCache=*/false,
           /*z3LogInteractionFileArg=*/Z3LogInteractionFile.size() > 0
               ? Z3LogInteractionFile.c_str()
               : NULL)),
-      runStatusCode(SOLVER_RUN_STATUS_FAILURE) {
+      runStatusCode(SOLVER_RUN_STATUS_FAILURE), tactic(nullptr),
+      incremental(incremental) {
   assert(builder && "unable to create Z3Builder");
   solverParameters = Z3_mk_params(builder->ctx);
   Z3_params_inc_ref(builder->ctx, solverParameters);
   timeoutParamStrSymbol = Z3_mk_string_symbol(builder->ctx, "timeout");
   setCoreSolverTimeout(timeout);
 
+  if (!tacticName.empty()) {
+    // Z3_mk_tactic() aborts on an unknown name
+    bool known = false;
+    for (unsigned i = 0, e = Z3_get_num_tactics(builder->ctx); i < e; ++i)
+      known |= tacticName == Z3_get_tactic_name(builder->ctx, i);
+    if (!known)
+      klee_error("Unknown Z3 tactic: %s", tacticName.c_str());
+    tactic = Z3_mk_tactic(builder->ctx, tacticName.c_str());
+    Z3_tactic_inc_ref(builder->ctx, tactic);
+  }
+
   if (!Z3QueryDumpFile.empty()) {
     std::string error;
     dumpedQueriesFile = klee_open_output_file(Z3QueryDumpFile, error);
@@ -134,11 +190,21 @@ Z3SolverImpl::Z3SolverImpl()
 }
 
 Z3SolverImpl::~Z3SolverImpl() {
+  for (auto &s : incrementalSolvers)
+    Z3_solver_dec_ref(builder->ctx, s.solver);
+  if (tactic)
+    Z3_tactic_dec_ref(builder->ctx, tactic);
   Z3_params_dec_ref(builder->ctx, solverParameters);
   delete builder;
 }
 
-Z3Solver::Z3Solver() : Solver(new Z3SolverImpl()) {}
+Z3Solver::Z3Solver() : Solver(new Z3SolverImpl("", Z3Incremental)) {}
+
+Z3Solver::Z3Solver(const std::string &tactic)
+    : Solver(new Z3SolverImpl(tactic, Z3Incremental)) {}
+
+Z3Solver::Z3Solver(const std::string &tactic, bool incremental)
+    : Solver(new Z3SolverImpl(tactic, incremental)) {}
 
 char *Z3Solver::getConstraintLog(const Query &query) {
   return impl->getConstraintLog(query);
@@ -251,37 +317,52 @@ bool Z3SolverImpl::internalRunSolver(
     std::vector<std::vector<unsigned char> > *values, bool &hasSolution) {
 
   TimerStatIncrementer t(stats::queryTime);
-  // NOTE: Z3 will switch to using a slower solver internally if push/pop are
-  // used so for now it is likely that creating a new solver each time is the
-  // right way to go until Z3 changes its behaviour.
-  //
-  // TODO: Investigate using a custom tactic as described in
-  // https://github.com/klee/klee/issues/653
-  Z3_solver theSolver = Z3_mk_solver(builder->ctx);
-  Z3_solver_inc_ref(builder->ctx, theSolver);
-  Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
-
   runStatusCode = SOLVER_RUN_STATUS_FAILURE;
-
-  ConstantArrayFinder constant_arrays_in_query;
-  for (auto const &constraint : query.constraints) {
-    Z3_solver_assert(builder->ctx, theSolver, builder->construct(constraint));
-    constant_arrays_in_query.visit(constraint);
-  }
   ++stats::queries;
   if (objects)
     ++stats::queryCounterexamples;
 
-  Z3ASTHandle z3QueryExpr =
-      Z3ASTHandle(builder->construct(query.expr), builder->ctx);
-  constant_arrays_in_query.visit(query.expr);
+  // NOTE: Z3 will switch to using a slower solver internally if push/pop are
+  // used so by default a new solver is created for each query. The
+  // incremental mode instead reuses a solver that already holds a prefix of
+  // the constraints, which pays off when queries share long prefixes.
+  //
+  // A custom tactic, as described in https://github.com/klee/klee/issues/653,
+  // can be selected with Z3Solver(tactic).
+  Z3_solver theSolver;
+  IncrementalSolver *incrementalSolver = nullptr;
+  Z3ASTHandle z3QueryExpr;
+  if (incremental) {
+    incrementalSolver = &getIncrementalSolver(query.constraints);
+    theSolver = incrementalSolver->solver;
+    Z3_solver_inc_ref(builder->ctx, theSolver);
+    Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
+    Z3_solver_push(builder->ctx, theSolver);
+
+    z3QueryExpr = Z3ASTHandle(builder->construct(query.expr), builder->ctx);
+    assertConstantArrays(*incrementalSolver, query.expr, false);
+  } else {
+    theSolver = tactic ? Z3_mk_solver_from_tactic(builder->ctx, tactic)
+                       : Z3_mk_solver(builder->ctx);
+    Z3_solver_inc_ref(builder->ctx, theSolver);
+    Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
+
+    ConstantArrayFinder constant_arrays_in_query;
+    for (auto const &constraint : query.constraints) {
+      Z3_solver_assert(builder->ctx, theSolver, builder->construct(constraint));
+      constant_arrays_in_query.visit(constraint);
+    }
 
-  for (auto const &constant_array : constant_arrays_in_query.results) {
-    assert(builder->constant_array_assertions.count(constant_array) == 1 &&
-           "Constant array found in query, but not handled by Z3Builder");
-    for (auto const &arrayIndexValueExpr :
-         builder->constant_array_assertions[constant_array]) {
-      Z3_solver_assert(builder->ctx, theSolver, arrayIndexValueExpr);
+    z3QueryExpr = Z3ASTHandle(builder->construct(query.expr), builder->ctx);
+    constant_arrays_in_query.visit(query.expr);
+
+    for (auto const &constant_array : constant_arrays_in_query.results) {
+      assert(builder->constant_array_assertions.count(constant_array) == 1 &&
+             "Constant array found in query, but not handled by Z3Builder");
+      for (auto const &arrayIndexValueExpr :
+           builder->constant_array_assertions[constant_array]) {
+        Z3_solver_assert(builder->ctx, theSolver, arrayIndexValueExpr);
+      }
     }
   }
 
@@ -307,13 +388,21 @@ bool Z3SolverImpl::internalRunSolver(
   runStatusCode = handleSolverResponse(theSolver, satisfiable, objects, values,
                                        hasSolution);
 
-  Z3_solver_dec_ref(builder->ctx, theSolver);
-  // Clear the builder's cache to prevent memory usage exploding.
-  // By using ``autoClearConstructCache=false`` and clearning now
-  // we allow Z3_ast expressions to be shared from an entire
-  // ``Query`` rather than only sharing within a single call to
-  // ``builder->construct()``.
-  builder->clearConstructCache();
+  if (incrementalSolver) {
+    Z3_solver_pop(builder->ctx, theSolver, 1);
+    Z3_solver_dec_ref(builder->ctx, theSolver);
+    // The constructed expressions are kept for the next queries, which
+    // mostly share their constraints with this one.
+    evictIncrementalSolvers();
+  } else {
+    Z3_solver_dec_ref(builder->ctx, theSolver);
+    // Clear the builder's cache to prevent memory usage exploding.
+    // By using ``autoClearConstructCache=false`` and clearning now
+    // we allow Z3_ast expressions to be shared from an entire
+    // ``Query`` rather than only sharing within a single call to
+    // ``builder->construct()``.
+    builder->clearConstructCache();
+  }
 
   if (runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE ||
       runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE) {
@@ -330,6 +419,107 @@ bool Z3SolverImpl::internalRunSolver(
   return false; // failed
 }
 
+static unsigned getMaxIncrementalSolvers() {
+  return std::max(1u, (unsigned)Z3IncrementalSolvers);
+}
+
+Z3SolverImpl::IncrementalSolver &
+Z3SolverImpl::getIncrementalSolver(const ConstraintSet &constraints) {
+  // Take the solver that holds the longest prefix of the constraints
+  auto best = incrementalSolvers.end();
+  std::size_t bestPrefix = 0;
+  for (auto it = incrementalSolvers.begin(), ie = incrementalSolvers.end();
+       it != ie; ++it) {
+    std::size_t prefix = 0;
+    for (auto ci = constraints.begin(), ce = constraints.end();
+         ci != ce && prefix < it->constraints.size() &&
+         it->constraints[prefix] == *ci;
+         ++ci)
+      ++prefix;
+    if (prefix > bestPrefix) {
+      best = it;
+      bestPrefix = prefix;
+    }
+  }
+
+  if (best == incrementalSolvers.end()) {
+    if (incrementalSolvers.size() < getMaxIncrementalSolvers()) {
+      IncrementalSolver s;
+      s.solver = tactic ? Z3_mk_solver_from_tactic(builder->ctx, tactic)
+                        : Z3_mk_solver(builder->ctx);
+      Z3_solver_inc_ref(builder->ctx, s.solver);
+      incrementalSolvers.push_front(std::move(s));
+    } else {
+      // nothing in common with any solver, reuse the least recently used
+      incrementalSolvers.splice(incrementalSolvers.begin(), incrementalSolvers,
+                                std::prev(incrementalSolvers.end()));
+    }
+  } else {
+    incrementalSolvers.splice(incrementalSolvers.begin(), incrementalSolvers,
+                              best);
+  }
+  IncrementalSolver &s = incrementalSolvers.front();
+
+  // Drop the constraints of the previous query that differ
+  if (s.constraints.size() > bestPrefix) {
+    Z3_solver_pop(builder->ctx, s.solver, s.constraints.size() - bestPrefix);
+    s.constraints.resize(bestPrefix);
+    for (auto it = s.constantArrays.begin(); it != s.constantArrays.end();) {
+      if (it->second > bestPrefix)
+        it = s.constantArrays.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  stats::incrementalConstraintsReused += bestPrefix;
+  auto ci = constraints.begin();
+  std::advance(ci, bestPrefix);
+  for (auto ce = constraints.end(); ci != ce; ++ci) {
+    ++stats::incrementalConstraintsAsserted;
+    Z3_solver_push(builder->ctx, s.solver);
+    Z3_solver_assert(builder->ctx, s.solver, builder->construct(*ci));
+    s.constraints.push_back(*ci);
+    assertConstantArrays(s, *ci, true);
+  }
+
+  return s;
+}
+
+void Z3SolverImpl::assertConstantArrays(IncrementalSolver &s,
+                                        const ref<Expr> &e, bool keep) {
+  ConstantArrayFinder finder;
+  finder.visit(e);
+  for (auto const &constant_array : finder.results) {
+    if (s.constantArrays.count(constant_array))
+      continue;
+    assert(builder->constant_array_assertions.count(constant_array) == 1 &&
+           "Constant array found in query, but not handled by Z3Builder");
+    for (auto const &arrayIndexValueExpr :
+         builder->constant_array_assertions[constant_array])
+      Z3_solver_assert(builder->ctx, s.solver, arrayIndexValueExpr);
+    if (keep)
+      s.constantArrays[constant_array] = s.constraints.size();
+  }
+}
+
+void Z3SolverImpl::evictIncrementalSolvers() {
+  while (incrementalSolvers.size() > getMaxIncrementalSolvers()) {
+    Z3_solver_dec_ref(builder->ctx, incrementalSolvers.back().solver);
+    incrementalSolvers.pop_back();
+  }
+
+  if (!Z3IncrementalMaxMemory)
+    return;
+  std::uint64_t limit = (std::uint64_t)Z3IncrementalMaxMemory << 20;
+  while (Z3_get_estimated_alloc_size() > limit && !incrementalSolvers.empty()) {
+    Z3_solver_dec_ref(builder->ctx, incrementalSolvers.back().solver);
+    incrementalSolvers.pop_back();
+  }
+  if (incrementalSolvers.empty())
+    builder->clearConstructCache();
+}
+
 SolverImpl::SolverRunStatus Z3SolverImpl::handleSolverResponse(
     ::Z3_solver theSolver, ::Z3_lbool satisfiable,
     const std::vector<const Array *> *objects,
@@ -20,6 +20,15 @@ public:
   /// Z3Solver - Construct a new Z3Solver.
   Z3Solver();
 
+  /// Construct a Z3Solver that solves with the given Z3 tactic, e.g. "qfbv",
+  /// instead of Z3's default solver.
+  explicit Z3Solver(const std::string &tactic);
+
+  /// Construct a Z3Solver with the given tactic, or Z3's default solver for
+  /// an empty tactic. An incremental solver keeps Z3 solvers alive between
+  /// queries and reuses the constraints they hold.
+  Z3Solver(const std::string &tactic, bool incremental);
+
   /// Get the query in SMT-LIBv2 format.
   /// \return A C-style string. The caller is responsible for freeing this.
   virtual char *getConstraintLog(const Query &);
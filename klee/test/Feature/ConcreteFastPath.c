@@ -0,0 +1,41 @@
+// RUN: %clang %s -emit-llvm %O0opt -g -c -o %t.bc
+// RUN: rm -rf %t.klee-out %t.klee-out-slow
+// RUN: %klee --output-dir=%t.klee-out --exit-on-error %t.bc > %t.fast.log
+// RUN: %klee --output-dir=%t.klee-out-slow --exit-on-error --concrete-fast-path=false %t.bc > %t.slow.log
+// RUN: diff %t.fast.log %t.slow.log
+// RUN: FileCheck -input-file=%t.fast.log %s
+
+// Integer operations on concrete operands must give the same results with
+// and without the concrete fast path of the interpreter.
+
+#include <stdint.h>
+#include <stdio.h>
+
+static const int64_t values[] = {0, 1, -1, 2, 7, -8, 63, 64, 127, -128,
+                                 INT32_MAX, INT32_MIN, INT64_MAX, INT64_MIN};
+#define N (sizeof(values) / sizeof(values[0]))
+
+int main() {
+  uint64_t hash = 0;
+  for (unsigned i = 0; i < N; i++) {
+    for (unsigned j = 0; j < N; j++) {
+      int64_t a = values[i], b = values[j];
+      int32_t a32 = (int32_t)a, b32 = (int32_t)b;
+      int8_t a8 = (int8_t)a, b8 = (int8_t)b;
+
+      hash = hash * 31 + (uint64_t)(a + b) + (uint64_t)(a - b) + (uint64_t)(a * b);
+      hash = hash * 31 + (uint32_t)(a32 ^ b32) + (uint8_t)(a8 & b8) + (uint16_t)(a | b);
+      hash = hash * 31 + (a < b) + 2 * ((uint64_t)a < (uint64_t)b) + 4 * (a8 <= b8) + 8 * (a32 == b32);
+      if (b != 0 && !(a == INT64_MIN && b == -1))
+        hash = hash * 31 + (uint64_t)(a / b) + (uint64_t)(a % b) + (uint64_t)a / (uint64_t)b;
+      if (b32 != 0 && !(a32 == INT32_MIN && b32 == -1))
+        hash = hash * 31 + (uint32_t)(a32 / b32) + (uint32_t)(a32 % b32);
+      if ((uint64_t)b < 64)
+        hash = hash * 31 + (uint64_t)(a << b) + (uint64_t)(a >> b) + ((uint64_t)a >> b);
+      hash = hash * 31 + (uint64_t)(int64_t)a8 + (uint64_t)(uint8_t)a32 + (uint64_t)(int64_t)a32;
+    }
+  }
+  printf("%llu\n", (unsigned long long)hash);
+  // CHECK: {{[0-9]+}}
+  return 0;
+}
@@ -0,0 +1,166 @@
+; RUN: %llvmas %s -o %t.bc
+; RUN: rm -rf %t.klee-out %t.klee-out-slow
+; RUN: %klee --output-dir=%t.klee-out --exit-on-error --optimize=false --check-div-zero=false --check-overshift=false %t.bc > %t.fast.log
+; RUN: %klee --output-dir=%t.klee-out-slow --exit-on-error --optimize=false --check-div-zero=false --check-overshift=false --concrete-fast-path=false %t.bc > %t.slow.log
+; RUN: diff %t.fast.log %t.slow.log
+; RUN: FileCheck -input-file=%t.fast.log %s
+
+; Like ConcreteFastPath.c, without needing a C frontend: integer operations
+; on concrete operands of different widths must give the same results with
+; and without the concrete fast path of the interpreter.
+
+@values = private constant [14 x i64] [i64 0, i64 1, i64 -1, i64 2, i64 7, i64 -8, i64 63, i64 64, i64 127, i64 -128, i64 2147483647, i64 -2147483648, i64 9223372036854775807, i64 -9223372036854775808]
+@.fmt = private constant [6 x i8] c"%llu\0A\00"
+
+declare i32 @printf(i8*, ...)
+
+define i64 @mix(i64 %h, i64 %v) {
+  %m = mul i64 %h, 31
+  %r = add i64 %m, %v
+  ret i64 %r
+}
+
+define i64 @ops64(i64 %h0, i64 %a, i64 %b) {
+entry:
+  %add = add i64 %a, %b
+  %h1 = call i64 @mix(i64 %h0, i64 %add)
+  %sub = sub i64 %a, %b
+  %h2 = call i64 @mix(i64 %h1, i64 %sub)
+  %mul = mul i64 %a, %b
+  %h3 = call i64 @mix(i64 %h2, i64 %mul)
+  %xor = xor i64 %a, %b
+  %and = and i64 %xor, %b
+  %or = or i64 %and, %a
+  %h4 = call i64 @mix(i64 %h3, i64 %or)
+  %slt = icmp slt i64 %a, %b
+  %ult = icmp ult i64 %a, %b
+  %sge = icmp sge i64 %a, %b
+  %slt.z = zext i1 %slt to i64
+  %ult.z = zext i1 %ult to i64
+  %sge.z = sext i1 %sge to i64
+  %h5 = call i64 @mix(i64 %h4, i64 %slt.z)
+  %h6 = call i64 @mix(i64 %h5, i64 %ult.z)
+  %h7 = call i64 @mix(i64 %h6, i64 %sge.z)
+  %zero = icmp eq i64 %b, 0
+  br i1 %zero, label %shift, label %div
+
+div:
+  %udiv = udiv i64 %a, %b
+  %urem = urem i64 %a, %b
+  %h8 = call i64 @mix(i64 %h7, i64 %udiv)
+  %h9 = call i64 @mix(i64 %h8, i64 %urem)
+  %minus1 = icmp eq i64 %b, -1
+  br i1 %minus1, label %shift.div, label %sdiv
+
+sdiv:
+  %sdiv.q = sdiv i64 %a, %b
+  %srem = srem i64 %a, %b
+  %h10 = call i64 @mix(i64 %h9, i64 %sdiv.q)
+  %h11 = call i64 @mix(i64 %h10, i64 %srem)
+  br label %shift.div
+
+shift.div:
+  %h.div = phi i64 [%h9, %div], [%h11, %sdiv]
+  br label %shift
+
+shift:
+  %h.s = phi i64 [%h7, %entry], [%h.div, %shift.div]
+  %small = icmp ult i64 %b, 64
+  br i1 %small, label %do.shift, label %done
+
+do.shift:
+  %shl = shl i64 %a, %b
+  %lshr = lshr i64 %a, %b
+  %ashr = ashr i64 %a, %b
+  %h12 = call i64 @mix(i64 %h.s, i64 %shl)
+  %h13 = call i64 @mix(i64 %h12, i64 %lshr)
+  %h14 = call i64 @mix(i64 %h13, i64 %ashr)
+  br label %done
+
+done:
+  %h = phi i64 [%h.s, %shift], [%h14, %do.shift]
+  ret i64 %h
+}
+
+define i64 @ops32(i64 %h0, i32 %a, i32 %b) {
+entry:
+  %add = add i32 %a, %b
+  %mul = mul i32 %add, %b
+  %xor = xor i32 %mul, %a
+  %x = zext i32 %xor to i64
+  %h1 = call i64 @mix(i64 %h0, i64 %x)
+  %sle = icmp sle i32 %a, %b
+  %sle.z = zext i1 %sle to i64
+  %h2 = call i64 @mix(i64 %h1, i64 %sle.z)
+  %a.s = sext i32 %a to i64
+  %h3 = call i64 @mix(i64 %h2, i64 %a.s)
+  %small = icmp ult i32 %b, 32
+  br i1 %small, label %do.shift, label %done
+
+do.shift:
+  %ashr = ashr i32 %a, %b
+  %shl = shl i32 %a, %b
+  %s = or i32 %ashr, %shl
+  %s.z = zext i32 %s to i64
+  %h4 = call i64 @mix(i64 %h3, i64 %s.z)
+  br label %done
+
+done:
+  %h = phi i64 [%h3, %entry], [%h4, %do.shift]
+  ret i64 %h
+}
+
+define i64 @ops8(i64 %h0, i8 %a, i8 %b) {
+  %and = and i8 %a, %b
+  %sub = sub i8 %and, %b
+  %sub.z = zext i8 %sub to i64
+  %h1 = call i64 @mix(i64 %h0, i64 %sub.z)
+  %ugt = icmp ugt i8 %a, %b
+  %ugt.z = zext i1 %ugt to i64
+  %h2 = call i64 @mix(i64 %h1, i64 %ugt.z)
+  %a.s = sext i8 %a to i64
+  %h3 = call i64 @mix(i64 %h2, i64 %a.s)
+  ret i64 %h3
+}
+
+define i32 @main() {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [0, %entry], [%i.next, %outer.latch]
+  %h.o = phi i64 [0, %entry], [%h.inner, %outer.latch]
+  %pa = getelementptr [14 x i64], [14 x i64]* @values, i64 0, i64 %i
+  %a = load i64, i64* %pa
+  br label %inner
+
+inner:
+  %j = phi i64 [0, %outer], [%j.next, %inner]
+  %h = phi i64 [%h.o, %outer], [%h3, %inner]
+  %pb = getelementptr [14 x i64], [14 x i64]* @values, i64 0, i64 %j
+  %b = load i64, i64* %pb
+  %h1 = call i64 @ops64(i64 %h, i64 %a, i64 %b)
+  %a32 = trunc i64 %a to i32
+  %b32 = trunc i64 %b to i32
+  %h2 = call i64 @ops32(i64 %h1, i32 %a32, i32 %b32)
+  %a8 = trunc i64 %a to i8
+  %b8 = trunc i64 %b to i8
+  %h3 = call i64 @ops8(i64 %h2, i8 %a8, i8 %b8)
+  %j.next = add i64 %j, 1
+  %inner.c = icmp ult i64 %j.next, 14
+  br i1 %inner.c, label %inner, label %outer.latch
+
+outer.latch:
+  %h.inner = phi i64 [%h3, %inner]
+  %i.next = add i64 %i, 1
+  %outer.c = icmp ult i64 %i.next, 14
+  br i1 %outer.c, label %outer, label %exit
+
+exit:
+  %fmt = getelementptr [6 x i8], [6 x i8]* @.fmt, i64 0, i64 0
+  call i32 (i8*, ...) @printf(i8* %fmt, i64 %h.inner)
+  ret i32 0
+}
+
+; The value computed by lli
+; CHECK: 9625865004154972023
@@ -0,0 +1,63 @@
+// RUN: %clang -DDYNAMIC_LIBRARY=1 %s -shared -o %t1.so
+// RUN: %clang %s -emit-llvm %O0opt -g -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: export LD_PRELOAD=%t1.so
+// RUN: export DYLD_INSERT_LIBRARIES=%t1.so
+// RUN: %klee --output-dir=%t.klee-out --search=random-state --exit-on-error --external-calls=all %t1.bc 2>&1 | FileCheck %s
+// CHECK: KLEE: done: completed paths = 2
+
+// External calls only copy the objects whose contents changed since they were
+// last synchronised with the host memory. States that interleave with
+// different contents of the same objects must still see their own values.
+
+int sum(const int *buf, int n);
+void increment(int *buf, int n);
+
+#ifdef DYNAMIC_LIBRARY
+
+int sum(const int *buf, int n) {
+  int s = 0;
+  for (int i = 0; i < n; i++)
+    s += buf[i];
+  return s;
+}
+
+void increment(int *buf, int n) {
+  for (int i = 0; i < n; i++)
+    buf[i]++;
+}
+
+#else
+
+#include "klee/klee.h"
+
+#define N 64
+
+int buf[N];
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  int v = 1;
+  if (x > 0)
+    v = 2;
+
+  for (int i = 0; i < N; i++)
+    buf[i] = v;
+
+  // the states interleave between these calls
+  for (int round = 0; round < 3; round++) {
+    klee_assert(sum(buf, N) == N * (v + round));
+    increment(buf, N);
+    klee_assert(buf[0] == v + round + 1);
+  }
+
+  // written by KLEE, not by the host
+  buf[N - 1] = 0;
+  klee_assert(sum(buf, N) == (N - 1) * (v + 3));
+
+  return 0;
+}
+
+#endif
@@ -0,0 +1,52 @@
+// RUN: %clang %s -emit-llvm %O0opt -g -c -o %t.bc
+// RUN: rm -rf %t.klee-out %t.klee-out-slow
+// RUN: %klee --output-dir=%t.klee-out --libc=klee --libc-fast-paths %t.bc > %t.fast.log
+// RUN: %klee --output-dir=%t.klee-out-slow --libc=klee %t.bc > %t.slow.log
+// RUN: sort %t.fast.log > %t.fast.sorted
+// RUN: sort %t.slow.log > %t.slow.sorted
+// RUN: diff %t.fast.sorted %t.slow.sorted
+// RUN: FileCheck -input-file=%t.fast.log %s
+// RUN: FileCheck -check-prefix=CHECK-INFO -input-file=%t.klee-out/info %s
+// RUN: ls %t.klee-out | FileCheck -check-prefix=CHECK-ERR %s
+// RUN: ls %t.klee-out-slow | FileCheck -check-prefix=CHECK-ERR %s
+
+// memcpy, memmove, memset and strlen give the same results with and without
+// the fast paths, fall back to the C library for symbolic bytes and still
+// report out of bounds accesses.
+
+#include "klee/klee.h"
+
+#include <stdio.h>
+#include <string.h>
+
+char buf[256];
+char other[16];
+
+int main() {
+  memset(buf, 'a', 100);
+  buf[100] = 0;
+  printf("%zu\n", strlen(buf));
+  // CHECK: 100
+
+  memcpy(buf + 200, buf + 10, 20);
+  memmove(buf + 5, buf, 50);
+  memset(buf + 7, 'b', 3);
+  printf("%.12s %zu\n", buf, strlen(buf + 5));
+  // CHECK: aaaaaaabbbaa 95
+
+  char c;
+  klee_make_symbolic(&c, sizeof(c), "c");
+  buf[50] = c;
+  memcpy(other, buf + 40, 15);
+  if (strlen(buf) == 50)
+    printf("short\n");
+  else
+    printf("long\n");
+  // CHECK-DAG: short
+  // CHECK-DAG: long
+
+  memcpy(other, buf, 20);
+  // CHECK-ERR: .ptr.err
+  return 0;
+}
+// CHECK-INFO: KLEE: done: libc fast paths = 6
@@ -0,0 +1,23 @@
+// RUN: %clang %s -emit-llvm %O0opt -g -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --libc=klee --libc-fast-paths %t.bc > %t.log
+// RUN: FileCheck -input-file=%t.log %s
+// RUN: not grep "libc fast paths" %t.klee-out/info
+
+// The fast paths do not replace a function the program defines itself.
+
+#include <stddef.h>
+#include <stdio.h>
+
+size_t strlen(const char *s) {
+  size_t n = 0;
+  while (s[n] && s[n] != ' ')
+    n++;
+  return n;
+}
+
+int main() {
+  printf("%zu\n", strlen("two words"));
+  // CHECK: 3
+  return 0;
+}
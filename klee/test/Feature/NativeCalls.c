@@ -0,0 +1,68 @@
+// RUN: %clang %s -emit-llvm %O0opt -g -c -o %t.bc
+// RUN: rm -rf %t.klee-out %t.klee-out-interp
+// RUN: %klee --output-dir=%t.klee-out --exit-on-error --native-calls %t.bc > %t.native.log
+// RUN: %klee --output-dir=%t.klee-out-interp --exit-on-error %t.bc > %t.interp.log
+// RUN: sort %t.native.log > %t.native.sorted
+// RUN: sort %t.interp.log > %t.interp.sorted
+// RUN: diff %t.native.sorted %t.interp.sorted
+// RUN: FileCheck -input-file=%t.native.log %s
+// RUN: FileCheck -check-prefix=CHECK-INFO -input-file=%t.klee-out/info %s
+
+// Concrete calls run natively must give the same results as the
+// interpreter, and calls that can reach symbolic memory must still be
+// interpreted.
+
+#include "klee/klee.h"
+
+#include <stdio.h>
+
+static int table[64];
+
+static unsigned mix(unsigned x) { return x * 2654435761u + (x >> 7); }
+
+static void fill(int *t, unsigned n, unsigned seed) {
+  for (unsigned i = 0; i < n; i++)
+    t[i] = (int)(mix(seed + i) % 1000);
+}
+
+static void sort(int *t, unsigned n) {
+  for (unsigned i = 1; i < n; i++) {
+    int v = t[i];
+    unsigned j = i;
+    for (; j > 0 && t[j - 1] > v; j--)
+      t[j] = t[j - 1];
+    t[j] = v;
+  }
+}
+
+static int sum(const int *t, unsigned n) {
+  int s = 0;
+  for (unsigned i = 0; i < n; i++)
+    s += t[i];
+  return s;
+}
+
+int main() {
+  fill(table, 64, 42);
+  sort(table, 64);
+  printf("%d %d %d\n", table[0], table[63], sum(table, 64));
+  // CHECK: {{[0-9]+}} {{[0-9]+}} {{[0-9]+}}
+
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  klee_assume(x >= 0 & x < 64);
+  // the table is still concrete, native
+  int s = sum(table, 64);
+  // symbolic memory, interpreted
+  if (sum(&x, 1) != x)
+    printf("mismatch\n");
+  // CHECK-NOT: mismatch
+  if (table[x] > 500)
+    printf("high %d\n", s);
+  else
+    printf("low %d\n", s);
+  // CHECK-DAG: high
+  // CHECK-DAG: low
+  return 0;
+}
+// CHECK-INFO: KLEE: done: native calls = 4
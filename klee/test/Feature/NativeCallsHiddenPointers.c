@@ -0,0 +1,41 @@
+// RUN: %clang %s -emit-llvm %O0opt -g -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --exit-on-error --native-calls %t.bc > %t.log
+// RUN: FileCheck -input-file=%t.log %s
+// RUN: FileCheck -check-prefix=CHECK-INFO -input-file=%t.klee-out/info %s
+
+// A function that makes pointers from integers may reach objects the
+// pointer scan does not find. It may only run natively while no object
+// has a symbolic byte, otherwise it must be interpreted.
+
+#include "klee/klee.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define KEY 0x5a5a5a5a
+
+static int secret;
+// the address of secret, hidden from the scan of the closure's globals
+static uintptr_t hidden;
+
+static int readHidden(void) { return *(int *)(hidden ^ KEY); }
+
+int main() {
+  hidden = (uintptr_t)&secret ^ KEY;
+  secret = 7;
+  // all objects are concrete, native
+  printf("concrete %d\n", readHidden());
+  // CHECK: concrete 7
+
+  klee_make_symbolic(&secret, sizeof(secret), "secret");
+  // secret is symbolic, interpreted
+  if (readHidden() == 42)
+    printf("forty-two\n");
+  else
+    printf("other\n");
+  // CHECK-DAG: forty-two
+  // CHECK-DAG: other
+  return 0;
+}
+// CHECK-INFO: KLEE: done: native calls = 1
@@ -0,0 +1,59 @@
+; RUN: %llvmas %s -o %t.bc
+; RUN: rm -rf %t.klee-out
+; RUN: %klee --output-dir=%t.klee-out --exit-on-error --optimize=false --switch-type=internal --speculative-solver-workers=2 %t.bc 2> %t.log
+; RUN: FileCheck -input-file=%t.log %s
+; RUN: FileCheck -check-prefix=CHECK-INFO -input-file=%t.klee-out/info %s
+
+; The cases of a switch are speculated on before they are checked one after
+; another. The first case is running in a worker when it is checked, so its
+; answer is taken from the worker.
+
+@.name = private constant [2 x i8] c"x\00"
+@sink = global i32 0
+
+declare void @klee_make_symbolic(i8*, i64, i8*)
+
+define i32 @main() {
+entry:
+  %x = alloca i32
+  %p = bitcast i32* %x to i8*
+  %n = getelementptr [2 x i8], [2 x i8]* @.name, i64 0, i64 0
+  call void @klee_make_symbolic(i8* %p, i64 4, i8* %n)
+  %v = load i32, i32* %x
+  %m = mul i32 %v, %v
+  switch i32 %m, label %default [
+    i32 1, label %one
+    i32 4, label %four
+    i32 9, label %nine
+    i32 16, label %sixteen
+    i32 25, label %twentyfive
+  ]
+
+one:
+  store volatile i32 1, i32* @sink
+  ret i32 0
+
+four:
+  store volatile i32 4, i32* @sink
+  ret i32 0
+
+nine:
+  store volatile i32 9, i32* @sink
+  ret i32 0
+
+sixteen:
+  store volatile i32 16, i32* @sink
+  ret i32 0
+
+twentyfive:
+  store volatile i32 25, i32* @sink
+  ret i32 0
+
+default:
+  store volatile i32 0, i32* @sink
+  ret i32 0
+}
+
+; CHECK: KLEE: done: completed paths = 6
+; CHECK-INFO: KLEE: done: speculative queries = {{[1-9][0-9]*}}
+; CHECK-INFO: KLEE: done: speculative hits = {{[1-9][0-9]*}}
@@ -13,6 +13,7 @@
 #include "klee/Expr/ExprBuilder.h"
 #include "klee/Expr/ExprPPrinter.h"
 #include "klee/Expr/ExprSMTLIBPrinter.h"
+#include "klee/Expr/ExprStats.h"
 #include "klee/Expr/ExprVisitor.h"
 #include "klee/Expr/Parser/Lexer.h"
 #include "klee/Expr/Parser/Parser.h"
@@ -22,15 +23,25 @@
 #include "klee/Solver/Solver.h"
 #include "klee/Solver/SolverCmdLine.h"
 #include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+#include "klee/Statistics/LatencyHistogram.h"
 #include "klee/Support/PrintVersion.h"
+#include "klee/Support/Timer.h"
 
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 
@@ -45,7 +56,7 @@ llvm::cl::opt<std::string> InputFile(llvm::cl::desc("<input query log>"),
                                      llvm::cl::Positional, llvm::cl::init("-"),
                                      llvm::cl::cat(klee::ExprCat));
 
-enum ToolActions { PrintTokens, PrintAST, PrintSMTLIBv2, Evaluate };
+enum ToolActions { PrintTokens, PrintAST, PrintSMTLIBv2, Evaluate, Benchmark };
 
 static llvm::cl::opt<ToolActions> ToolAction(
     llvm::cl::desc("Tool actions:"), llvm::cl::init(Evaluate),
@@ -56,7 +67,11 @@ static llvm::cl::opt<ToolActions> ToolAction(
                      clEnumValN(PrintAST, "print-ast",
                                 "Print parsed AST nodes from the input file."),
                      clEnumValN(Evaluate, "evaluate",
-                                "Evaluate parsed AST nodes from the input file.")),
+                                "Evaluate parsed AST nodes from the input file."),
+                     clEnumValN(Benchmark, "benchmark",
+                                "Replay the queries of the input file through "
+                                "the solver chain and report the throughput, "
+                                "latencies and cache hits as JSON.")),
     llvm::cl::cat(klee::SolvingCat));
 
 enum BuilderKinds {
@@ -87,6 +102,19 @@ llvm::cl::opt<bool> ClearArrayAfterQuery(
     llvm::cl::desc("Discard the previous array declarations after a query "
                    "is performed (default=false)"),
     llvm::cl::init(false), llvm::cl::cat(klee::ExprCat));
+
+llvm::cl::opt<unsigned> BenchmarkWorkers(
+    "benchmark-workers",
+    llvm::cl::desc("Number of worker processes that replay the queries with "
+                   "-benchmark, each with its own solver chain and every "
+                   "n-th query (default=0 (replay in kleaver))"),
+    llvm::cl::init(0), llvm::cl::cat(klee::SolvingCat));
+
+llvm::cl::opt<unsigned> BenchmarkRepetitions(
+    "benchmark-repetitions",
+    llvm::cl::desc("Number of times the queries are replayed with -benchmark, "
+                   "through the same solver chain (default=1)"),
+    llvm::cl::init(1), llvm::cl::cat(klee::SolvingCat));
 } // namespace
 
 static std::string getQueryLogPath(const char filename[])
@@ -181,6 +209,23 @@ static bool PrintInputAST(const char *Filename,
   return success;
 }
 
+static Solver *createSolverChain() {
+  Solver *coreSolver = klee::createCoreSolver(CoreSolverToUse);
+
+  if (CoreSolverToUse != DUMMY_SOLVER) {
+    const time::Span maxCoreSolverTime(MaxCoreSolverTime);
+    if (maxCoreSolverTime) {
+      coreSolver->setCoreSolverTimeout(maxCoreSolverTime);
+    }
+  }
+
+  return constructSolverChain(coreSolver,
+                              getQueryLogPath(ALL_QUERIES_SMT2_FILE_NAME),
+                              getQueryLogPath(SOLVER_QUERIES_SMT2_FILE_NAME),
+                              getQueryLogPath(ALL_QUERIES_KQUERY_FILE_NAME),
+                              getQueryLogPath(SOLVER_QUERIES_KQUERY_FILE_NAME));
+}
+
 static bool EvaluateInputAST(const char *Filename,
                              const MemoryBuffer *MB,
                              ExprBuilder *Builder) {
@@ -200,20 +245,7 @@ static bool EvaluateInputAST(const char *Filename,
   if (!success)
     return false;
 
-  Solver *coreSolver = klee::createCoreSolver(CoreSolverToUse);
-
-  if (CoreSolverToUse != DUMMY_SOLVER) {
-    const time::Span maxCoreSolverTime(MaxCoreSolverTime);
-    if (maxCoreSolverTime) {
-      coreSolver->setCoreSolverTimeout(maxCoreSolverTime);
-    }
-  }
-
-  Solver *S = constructSolverChain(coreSolver,
-                                   getQueryLogPath(ALL_QUERIES_SMT2_FILE_NAME),
-                                   getQueryLogPath(SOLVER_QUERIES_SMT2_FILE_NAME),
-                                   getQueryLogPath(ALL_QUERIES_KQUERY_FILE_NAME),
-                                   getQueryLogPath(SOLVER_QUERIES_KQUERY_FILE_NAME));
+  Solver *S = createSolverChain();
 
   unsigned Index = 0;
   for (std::vector<Decl*>::iterator it = Decls.begin(),
@@ -384,6 +416,397 @@ static bool printInputAsSMTLIBv2(const char *Filename,
 	return true;
 }
 
+namespace {
+/// The statistics of the solver chain that are reported by -benchmark
+struct BenchmarkStatistic {
+  const char *name;
+  Statistic &statistic;
+};
+
+const BenchmarkStatistic BenchmarkStatistics[] = {
+    {"solver_queries", stats::queries},
+    {"branch_cache_hits", stats::queryCacheHits},
+    {"branch_cache_misses", stats::queryCacheMisses},
+    {"cex_cache_hits", stats::queryCexCacheHits},
+    {"cex_cache_misses", stats::queryCexCacheMisses},
+    {"persistent_cache_hits", stats::persistentCacheHits},
+    {"persistent_cache_misses", stats::persistentCacheMisses},
+    {"incremental_constraints_asserted", stats::incrementalConstraintsAsserted},
+    {"incremental_constraints_reused", stats::incrementalConstraintsReused},
+    {"constant_allocations", stats::constantAllocations},
+    {"interned_constants", stats::internedConstants},
+};
+
+/// The results of replaying (a share of) the queries, which the workers
+/// send to kleaver
+struct BenchmarkResult {
+  std::uint64_t queries = 0;
+  std::uint64_t failures = 0;
+  /// The queries for objects whose constraints have no solution
+  std::uint64_t noSolution = 0;
+  /// The time spent solving, in nanoseconds
+  std::uint64_t time = 0;
+  std::uint64_t maxLatency = 0;
+  LatencyHistogram latency;
+  std::vector<std::uint64_t> statistics;
+  /// The layers of the chain with -solver-chain-stats, innermost first
+  std::vector<stats::SolverLayerStats> layers;
+
+  void merge(const BenchmarkResult &other);
+  void serialize(std::string &out) const;
+  bool deserialize(const std::string &in);
+};
+
+void BenchmarkResult::merge(const BenchmarkResult &other) {
+  queries += other.queries;
+  failures += other.failures;
+  noSolution += other.noSolution;
+  time += other.time;
+  maxLatency = std::max(maxLatency, other.maxLatency);
+  latency.merge(other.latency);
+
+  statistics.resize(other.statistics.size());
+  for (unsigned i = 0; i < other.statistics.size(); i++)
+    statistics[i] += other.statistics[i];
+
+  // all workers build the same chain
+  if (layers.empty()) {
+    layers = other.layers;
+    return;
+  }
+  for (unsigned i = 0; i < layers.size() && i < other.layers.size(); i++) {
+    layers[i].queries += other.layers[i].queries;
+    layers[i].hits += other.layers[i].hits;
+    layers[i].time += other.layers[i].time;
+    layers[i].exprNodes += other.layers[i].exprNodes;
+  }
+}
+
+void BenchmarkResult::serialize(std::string &out) const {
+  auto put = [&out](std::uint64_t value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+  };
+  put(queries);
+  put(failures);
+  put(noSolution);
+  put(time);
+  put(maxLatency);
+  for (unsigned b = 0; b < LatencyHistogram::NumBuckets; b++)
+    put(latency.getBucketCount(b));
+  put(statistics.size());
+  for (std::uint64_t value : statistics)
+    put(value);
+  put(layers.size());
+  for (const auto &layer : layers) {
+    put(layer.name.size());
+    out += layer.name;
+    put(layer.queries);
+    put(layer.hits);
+    put(layer.time);
+    put(layer.exprNodes);
+  }
+}
+
+bool BenchmarkResult::deserialize(const std::string &in) {
+  std::size_t pos = 0;
+  auto get = [&in, &pos](std::uint64_t &value) {
+    if (pos + sizeof(value) > in.size())
+      return false;
+    memcpy(&value, in.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+  };
+
+  if (!get(queries) || !get(failures) || !get(noSolution) || !get(time) ||
+      !get(maxLatency))
+    return false;
+  for (unsigned b = 0; b < LatencyHistogram::NumBuckets; b++) {
+    std::uint64_t count;
+    if (!get(count))
+      return false;
+    if (count)
+      latency.add(LatencyHistogram::getBucketLowerBound(b), count);
+  }
+
+  std::uint64_t n;
+  if (!get(n))
+    return false;
+  statistics.resize(n);
+  for (auto &value : statistics)
+    if (!get(value))
+      return false;
+
+  if (!get(n))
+    return false;
+  for (std::uint64_t i = 0; i < n; i++) {
+    std::uint64_t length;
+    if (!get(length) || pos + length > in.size())
+      return false;
+    layers.emplace_back(in.substr(pos, length), nullptr);
+    pos += length;
+    stats::SolverLayerStats &layer = layers.back();
+    if (!get(layer.queries) || !get(layer.hits) || !get(layer.time) ||
+        !get(layer.exprNodes))
+      return false;
+  }
+  return true;
+}
+
+/// Asks S for the query of QC, as -evaluate does. \p hasSolution is false if
+/// the command asks for objects and its constraints have no solution.
+bool solveQueryCommand(Solver *S, const QueryCommand *QC, bool &hasSolution) {
+  hasSolution = true;
+  ConstraintSet constraints(QC->Constraints);
+  if (QC->Values.empty() && QC->Objects.empty()) {
+    bool result;
+    return S->mustBeTrue(Query(constraints, QC->Query), result);
+  }
+  if (!QC->Values.empty()) {
+    ref<ConstantExpr> result;
+    return S->getValue(Query(constraints, QC->Values[0]), result);
+  }
+  std::vector<std::vector<unsigned char>> result;
+  return S->impl->computeInitialValues(Query(constraints, QC->Query),
+                                       QC->Objects, result, hasSolution);
+}
+
+/// Replays the queries with index % numShares == share through a new
+/// solver chain.
+void replayQueries(const std::vector<const QueryCommand *> &queries,
+                   unsigned share, unsigned numShares,
+                   BenchmarkResult &result) {
+  Solver *S = createSolverChain();
+
+  for (unsigned r = 0; r < BenchmarkRepetitions; r++) {
+    for (unsigned i = share; i < queries.size(); i += numShares) {
+      WallTimer timer;
+      bool hasSolution;
+      bool success = solveQueryCommand(S, queries[i], hasSolution);
+      std::uint64_t elapsed =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              timer.delta().duration)
+              .count();
+
+      ++result.queries;
+      if (!success)
+        ++result.failures;
+      else if (!hasSolution)
+        ++result.noSolution;
+      result.time += elapsed;
+      result.maxLatency = std::max(result.maxLatency, elapsed);
+      result.latency.add(elapsed);
+    }
+  }
+
+  // flushes the persistent cache and the query logs
+  delete S;
+
+  for (const auto &s : BenchmarkStatistics)
+    result.statistics.push_back(s.statistic.getValue());
+  for (const auto &layer : stats::solverLayers) {
+    result.layers.emplace_back(layer.name, nullptr);
+    stats::SolverLayerStats &copy = result.layers.back();
+    copy.queries = layer.queries;
+    copy.hits = layer.hits;
+    copy.time = layer.time;
+    copy.exprNodes = layer.exprNodes;
+  }
+}
+
+/// Forks a worker per share and collects their results.
+bool replayQueriesInWorkers(const std::vector<const QueryCommand *> &queries,
+                            BenchmarkResult &result) {
+  struct Worker {
+    pid_t pid;
+    int fd;
+  };
+  std::vector<Worker> workers;
+  bool success = true;
+
+  llvm::outs().flush();
+  llvm::errs().flush();
+  for (unsigned i = 0; i < BenchmarkWorkers; i++) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      llvm::errs() << "kleaver: error: cannot create pipe: "
+                   << strerror(errno) << "\n";
+      success = false;
+      break;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+      llvm::errs() << "kleaver: error: cannot fork worker: "
+                   << strerror(errno) << "\n";
+      close(fds[0]);
+      close(fds[1]);
+      success = false;
+      break;
+    }
+
+    if (pid == 0) {
+      close(fds[0]);
+      BenchmarkResult share;
+      replayQueries(queries, i, BenchmarkWorkers, share);
+      std::string out;
+      share.serialize(out);
+      for (std::size_t pos = 0; pos < out.size();) {
+        ssize_t n = write(fds[1], out.data() + pos, out.size() - pos);
+        if (n < 0 && errno == EINTR)
+          continue;
+        if (n <= 0)
+          _exit(1);
+        pos += n;
+      }
+      _exit(0);
+    }
+
+    close(fds[1]);
+    workers.push_back({pid, fds[0]});
+  }
+
+  // the workers that were started are waited for in any case
+  for (unsigned i = 0; i < workers.size(); i++) {
+    std::string in;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(workers[i].fd, buffer, sizeof(buffer))) != 0) {
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0)
+        break;
+      in.append(buffer, n);
+    }
+    close(workers[i].fd);
+
+    int status;
+    while (waitpid(workers[i].pid, &status, 0) < 0 && errno == EINTR)
+      ;
+
+    BenchmarkResult share;
+    if (!share.deserialize(in)) {
+      llvm::errs() << "kleaver: error: worker " << i << " failed\n";
+      success = false;
+      continue;
+    }
+    result.merge(share);
+  }
+  return success;
+}
+
+void printBenchmarkResult(const BenchmarkResult &result, time::Span wallTime) {
+  auto rate = [](std::uint64_t part, std::uint64_t total) {
+    return total ? static_cast<double>(part) / total : 0.0;
+  };
+  auto micros = [](std::uint64_t nanos) { return nanos / 1000.0; };
+  auto statistic = [&result](const char *name) -> std::uint64_t {
+    for (unsigned i = 0; i < result.statistics.size(); i++)
+      if (!strcmp(BenchmarkStatistics[i].name, name))
+        return result.statistics[i];
+    return 0;
+  };
+
+  llvm::raw_ostream &os = llvm::outs();
+  double seconds = wallTime.toSeconds();
+  os << "{\n"
+     << "  \"queries\": " << result.queries << ",\n"
+     << "  \"failures\": " << result.failures << ",\n"
+     << "  \"no_solution\": " << result.noSolution << ",\n"
+     << "  \"workers\": " << BenchmarkWorkers << ",\n"
+     << "  \"repetitions\": " << BenchmarkRepetitions << ",\n"
+     << "  \"wall_time_s\": " << format("%.6f", seconds) << ",\n"
+     << "  \"throughput_qps\": "
+     << format("%.2f", seconds > 0 ? result.queries / seconds : 0.0) << ",\n"
+     << "  \"latency_us\": {\n"
+     << "    \"mean\": "
+     << format("%.3f", micros(result.queries ? result.time / result.queries
+                                             : 0))
+     << ",\n";
+  // the percentiles are the upper bounds of the histogram buckets
+  for (unsigned p : {50, 90, 99})
+    os << "    \"p" << p << "\": "
+       << format("%.3f", micros(std::min(result.latency.getPercentile(p),
+                                         result.maxLatency)))
+       << ",\n";
+  os << "    \"max\": " << format("%.3f", micros(result.maxLatency)) << "\n"
+     << "  },\n";
+
+  os << "  \"statistics\": {\n";
+  for (unsigned i = 0; i < result.statistics.size(); i++)
+    os << "    \"" << BenchmarkStatistics[i].name
+       << "\": " << result.statistics[i]
+       << (i + 1 < result.statistics.size() ? ",\n" : "\n");
+  os << "  },\n";
+
+  os << "  \"cache_hit_rates\": {\n";
+  const char *caches[] = {"branch_cache", "cex_cache", "persistent_cache"};
+  for (unsigned i = 0; i < 3; i++) {
+    std::string name(caches[i]);
+    std::uint64_t hits = statistic((name + "_hits").c_str());
+    std::uint64_t misses = statistic((name + "_misses").c_str());
+    os << "    \"" << name << "\": " << format("%.4f", rate(hits, hits + misses))
+       << (i + 1 < 3 ? ",\n" : "\n");
+  }
+  os << "  },\n";
+
+  // outermost first, as klee-stats --print-solver-chain
+  os << "  \"layers\": [";
+  for (unsigned i = result.layers.size(); i-- > 0;) {
+    const stats::SolverLayerStats &layer = result.layers[i];
+    std::uint64_t selfTime = layer.time;
+    if (i > 0)
+      selfTime -= std::min(selfTime, result.layers[i - 1].time);
+    os << (i + 1 < result.layers.size() ? ",\n" : "\n")
+       << "    {\"name\": \"" << layer.name << "\", \"queries\": "
+       << layer.queries << ", \"hit_rate\": "
+       << format("%.4f", rate(layer.hits, layer.queries))
+       << ", \"time_s\": " << format("%.6f", layer.time / 1e9)
+       << ", \"self_time_s\": " << format("%.6f", selfTime / 1e9)
+       << ", \"expr_nodes\": " << layer.exprNodes << "}";
+  }
+  os << (result.layers.empty() ? "]\n" : "\n  ]\n") << "}\n";
+}
+} // namespace
+
+static bool benchmarkInputAST(const char *Filename, const MemoryBuffer *MB,
+                              ExprBuilder *Builder) {
+  // the queries are parsed once, the workers inherit them
+  std::vector<Decl *> Decls;
+  Parser *P = Parser::Create(Filename, MB, Builder, ClearArrayAfterQuery);
+  P->SetMaxErrors(20);
+  while (Decl *D = P->ParseTopLevelDecl()) {
+    Decls.push_back(D);
+  }
+
+  bool success = true;
+  if (unsigned N = P->GetNumErrors()) {
+    llvm::errs() << Filename << ": parse failure: " << N << " errors.\n";
+    success = false;
+  }
+
+  std::vector<const QueryCommand *> queries;
+  for (Decl *D : Decls)
+    if (const QueryCommand *QC = dyn_cast<QueryCommand>(D))
+      queries.push_back(QC);
+
+  if (success) {
+    BenchmarkResult result;
+    WallTimer timer;
+    if (BenchmarkWorkers)
+      success = replayQueriesInWorkers(queries, result);
+    else
+      replayQueries(queries, 0, 1, result);
+    time::Span wallTime = timer.delta();
+    if (success)
+      printBenchmarkResult(result, wallTime);
+  }
+
+  for (Decl *D : Decls)
+    delete D;
+  delete P;
+
+  return success;
+}
+
 int main(int argc, char **argv) {
 #if LLVM_VERSION_CODE >= LLVM_VERSION(13, 0)
   KCommandLine::HideOptions(llvm::cl::getGeneralCategory());
@@ -435,6 +858,10 @@ int main(int argc, char **argv) {
     success = EvaluateInputAST(InputFile=="-" ? "<stdin>" : InputFile.c_str(),
                                MB.get(), Builder);
     break;
+  case Benchmark:
+    success = benchmarkInputAST(InputFile=="-" ? "<stdin>" : InputFile.c_str(),
+                                MB.get(), Builder);
+    break;
   case PrintSMTLIBv2:
     success = printInputAsSMTLIBv2(InputFile=="-"? "<stdin>" : InputFile.c_str(), MB.get(),Builder);
     break;
@@ -263,6 +263,13 @@ namespace {
                        cl::init(0),
                        cl::cat(DebugCat));
 
+  cl::opt<bool>
+  DebugPrintAllocations("debug-print-allocations",
+                        cl::desc("Write the number of register file and constant expression allocations, "
+                                 "and how many of them were reused, to info (default=false)"),
+                        cl::init(false),
+                        cl::cat(DebugCat));
+
   cl::opt<unsigned>
   MaxTests("max-tests",
            cl::desc("Stop execution after generating the given number of tests. Extra tests corresponding to partially explored paths will also be dumped.  Set to 0 to disable (default=0)"),
@@ -1544,6 +1551,22 @@ int main(int argc, char **argv, char **envp) {
     *theStatisticManager->getStatisticByName("Instructions");
   uint64_t forks =
     *theStatisticManager->getStatisticByName("Forks");
+  uint64_t nativeCalls =
+    *theStatisticManager->getStatisticByName("NativeCalls");
+  uint64_t registerAllocations =
+    *theStatisticManager->getStatisticByName("RegisterAllocations");
+  uint64_t reusedRegisterAllocations =
+    *theStatisticManager->getStatisticByName("ReusedRegisterAllocations");
+  uint64_t libcFastPaths =
+    *theStatisticManager->getStatisticByName("LibcFastPaths");
+  uint64_t constantAllocations =
+    *theStatisticManager->getStatisticByName("ConstantAllocations");
+  uint64_t internedConstants =
+    *theStatisticManager->getStatisticByName("InternedConstants");
+  uint64_t speculativeQueries =
+    *theStatisticManager->getStatisticByName("SpeculativeQueries");
+  uint64_t speculativeHits =
+    *theStatisticManager->getStatisticByName("SpeculativeHits");
 
   handler->getInfoStream()
     << "KLEE: done: explored paths = " << 1 + forks << "\n";
@@ -1559,6 +1582,23 @@ int main(int argc, char **argv, char **envp) {
     << "KLEE: done: valid queries = " << queriesValid << "\n"
     << "KLEE: done: invalid queries = " << queriesInvalid << "\n"
     << "KLEE: done: query cex = " << queryCounterexamples << "\n";
+  if (nativeCalls)
+    handler->getInfoStream()
+      << "KLEE: done: native calls = " << nativeCalls << "\n";
+  if (DebugPrintAllocations)
+    handler->getInfoStream()
+      << "KLEE: done: register allocations = " << registerAllocations << "\n"
+      << "KLEE: done: reused register allocations = "
+      << reusedRegisterAllocations << "\n"
+      << "KLEE: done: constant allocations = " << constantAllocations << "\n"
+      << "KLEE: done: interned constants = " << internedConstants << "\n";
+  if (libcFastPaths)
+    handler->getInfoStream()
+      << "KLEE: done: libc fast paths = " << libcFastPaths << "\n";
+  if (speculativeQueries)
+    handler->getInfoStream()
+      << "KLEE: done: speculative queries = " << speculativeQueries << "\n"
+      << "KLEE: done: speculative hits = " << speculativeHits << "\n";
 
   std::stringstream stats;
   stats << '\n'
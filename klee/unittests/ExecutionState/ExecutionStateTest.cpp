@@ -0,0 +1,192 @@
+//===-- ExecutionStateTest.cpp ----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "Core/CoreStats.h"
+#include "Core/ExecutionState.h"
+#include "klee/Module/KModule.h"
+
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include <memory>
+
+using namespace klee;
+
+namespace {
+
+class ExecutionStateTest : public ::testing::Test {
+protected:
+  llvm::LLVMContext ctx;
+  std::unique_ptr<llvm::Module> module{new llvm::Module("test", ctx)};
+  std::unique_ptr<KFunction> kf;
+
+  // A function with one argument and the given number of instructions, each
+  // of which takes a register.
+  void createFunction(unsigned instructions) {
+    llvm::Type *i32 = llvm::Type::getInt32Ty(ctx);
+    auto *type = llvm::FunctionType::get(llvm::Type::getVoidTy(ctx), {i32},
+                                         false);
+    auto *f = llvm::Function::Create(type, llvm::Function::ExternalLinkage,
+                                     "f", module.get());
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(ctx, "entry", f));
+    llvm::Value *v = f->arg_begin();
+    for (unsigned i = 1; i < instructions; i++)
+      v = builder.CreateAdd(v, v);
+    builder.CreateRetVoid();
+
+    kf.reset(new KFunction(f, nullptr));
+  }
+
+  // A state with the given number of frames of kf, with all registers set.
+  std::unique_ptr<ExecutionState> createState(unsigned frames) {
+    std::unique_ptr<ExecutionState> state(new ExecutionState(kf.get()));
+    for (unsigned i = 1; i < frames; i++)
+      state->pushFrame(state->pc, kf.get());
+    for (auto &sf : state->stack) {
+      for (unsigned r = 0; r < kf->numRegisters; r++)
+        sf.getWriteableLocal(r).value = ConstantExpr::create(r, Expr::Int32);
+    }
+    return state;
+  }
+};
+
+TEST_F(ExecutionStateTest, BranchSharesRegisters) {
+  createFunction(16);
+  auto parent = createState(4);
+  std::unique_ptr<ExecutionState> child(parent->branch());
+
+  for (unsigned i = 0; i < 4; i++)
+    EXPECT_EQ(child->stack[i].locals.get(), parent->stack[i].locals.get());
+
+  // writing to the top frame of the child copies only its registers
+  child->stack.back().getWriteableLocal(3).value =
+      ConstantExpr::create(42, Expr::Int32);
+  EXPECT_NE(child->stack[3].locals.get(), parent->stack[3].locals.get());
+  for (unsigned i = 0; i < 3; i++)
+    EXPECT_EQ(child->stack[i].locals.get(), parent->stack[i].locals.get());
+
+  EXPECT_EQ(parent->stack[3].getLocal(3).value,
+            ConstantExpr::create(3, Expr::Int32));
+  EXPECT_EQ(child->stack[3].getLocal(3).value,
+            ConstantExpr::create(42, Expr::Int32));
+  EXPECT_EQ(child->stack[3].getLocal(4).value,
+            ConstantExpr::create(4, Expr::Int32));
+
+  // once the parent is gone, the child writes in place
+  parent.reset();
+  RegisterFile *registers = child->stack[0].locals.get();
+  child->stack[0].getWriteableLocal(0).value =
+      ConstantExpr::create(7, Expr::Int32);
+  EXPECT_EQ(child->stack[0].locals.get(), registers);
+}
+
+TEST_F(ExecutionStateTest, BranchDoesNotCopyCoveredLines) {
+  createFunction(4);
+  auto parent = createState(1);
+  std::string file = "test.c";
+  parent->coveredLines[&file].insert(1);
+  parent->arrayNames = parent->arrayNames.insert("arr");
+
+  std::unique_ptr<ExecutionState> child(parent->branch());
+  EXPECT_TRUE(child->coveredLines.empty());
+  EXPECT_EQ(parent->coveredLines[&file].count(1), 1u);
+
+  child->arrayNames = child->arrayNames.insert("arr_1");
+  EXPECT_EQ(child->arrayNames.count("arr"), 1u);
+  EXPECT_EQ(parent->arrayNames.count("arr_1"), 0u);
+}
+
+TEST_F(ExecutionStateTest, RegisterFilesAreReused) {
+  createFunction(16);
+  auto state = createState(1);
+
+  state->pushFrame(state->pc, kf.get());
+  RegisterFile *registers = state->stack.back().locals.get();
+  state->popFrame();
+
+  // the next frame of the same size class takes the freed storage
+  std::uint64_t reused = stats::reusedRegisterAllocations.getValue();
+  state->pushFrame(state->pc, kf.get());
+  EXPECT_EQ(state->stack.back().locals.get(), registers);
+  EXPECT_EQ(stats::reusedRegisterAllocations.getValue() - reused, 2u);
+  for (unsigned r = 0; r < kf->numRegisters; r++)
+    EXPECT_TRUE(state->stack.back().getLocal(r).value.isNull());
+
+  // copies made on write are pooled as well
+  std::unique_ptr<ExecutionState> child(state->branch());
+  child->stack.back().getWriteableLocal(0).value =
+      ConstantExpr::create(1, Expr::Int32);
+  EXPECT_TRUE(state->stack.back().getLocal(0).value.isNull());
+  EXPECT_TRUE(child->stack.back().getLocal(1).value.isNull());
+}
+
+// Once the free lists hold a frame's storage, calls and returns take all
+// their register files from them, and frames of other functions of the same
+// size class take the freed cells.
+TEST_F(ExecutionStateTest, CallAndReturnReuseFreedStorage) {
+  createFunction(40);
+  std::unique_ptr<KFunction> small(std::move(kf));
+  createFunction(60);
+  ASSERT_NE(small->numRegisters, kf->numRegisters);
+  auto state = createState(1);
+
+  state->pushFrame(state->pc, small.get());
+  Cell *cells = state->stack.back().locals->cells;
+  state->popFrame();
+  state->pushFrame(state->pc, kf.get());
+  EXPECT_EQ(state->stack.back().locals->cells, cells);
+  state->popFrame();
+
+  std::uint64_t allocations = stats::registerAllocations.getValue();
+  std::uint64_t reused = stats::reusedRegisterAllocations.getValue();
+  for (unsigned i = 0; i < 1000; i++) {
+    state->pushFrame(state->pc, i % 2 ? kf.get() : small.get());
+    state->stack.back().getWriteableLocal(0).value =
+        ConstantExpr::create(i, Expr::Int32);
+    state->popFrame();
+  }
+  allocations = stats::registerAllocations.getValue() - allocations;
+  reused = stats::reusedRegisterAllocations.getValue() - reused;
+  EXPECT_EQ(allocations, 2000u);
+  EXPECT_EQ(reused, allocations);
+}
+
+// Branching a state and writing one register of the top frame of the child
+// copies the registers of that frame only, however deep the stack is.
+TEST_F(ExecutionStateTest, ForkCopiesWrittenFrameOnly) {
+  createFunction(256);
+
+  for (unsigned frames : {1u, 10u, 100u}) {
+    auto state = createState(frames);
+
+    for (unsigned i = 0; i < 10; i++) {
+      std::uint64_t allocations = stats::registerAllocations.getValue();
+      std::unique_ptr<ExecutionState> child(state->branch());
+      EXPECT_EQ(stats::registerAllocations.getValue(), allocations);
+      for (auto &sf : state->stack)
+        EXPECT_EQ(sf.locals->_refCount.getCount(), 2u);
+
+      child->stack.back().getWriteableLocal(i % kf->numRegisters).value =
+          ConstantExpr::create(0, Expr::Int32);
+      // the register file and its cells
+      EXPECT_EQ(stats::registerAllocations.getValue() - allocations, 2u);
+      EXPECT_EQ(state->stack.back().locals->_refCount.getCount(), 1u);
+      for (unsigned f = 0; f + 1 < frames; f++)
+        EXPECT_EQ(child->stack[f].locals.get(), state->stack[f].locals.get());
+    }
+
+    for (auto &sf : state->stack)
+      EXPECT_EQ(sf.locals->_refCount.getCount(), 1u);
+  }
+}
+
+} // namespace
@@ -0,0 +1,268 @@
+//===-- ConstraintsTest.cpp -----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+class ConstraintsTest : public ::testing::Test {
+protected:
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 256);
+
+  // A distinct constraint for each n: arr[n] <= n
+  ref<Expr> constraint(unsigned n) {
+    ref<Expr> read = ReadExpr::create(
+        UpdateList(array, nullptr), ConstantExpr::create(n % 256, Expr::Int32));
+    return UleExpr::create(ZExtExpr::create(read, Expr::Int32),
+                           ConstantExpr::create(n, Expr::Int32));
+  }
+
+  std::vector<ref<Expr>> toVector(const ConstraintSet &cs) {
+    return std::vector<ref<Expr>>(cs.begin(), cs.end());
+  }
+
+  // Reads the byte index of a, or a byte at a symbolic index given by a
+  // byte of b
+  static ref<Expr> read(const Array *a, unsigned index,
+                        const Array *b = nullptr) {
+    ref<Expr> idx = ConstantExpr::create(index, Expr::Int32);
+    if (b)
+      idx = ZExtExpr::create(
+          ReadExpr::create(UpdateList(b, nullptr), idx), Expr::Int32);
+    return ReadExpr::create(UpdateList(a, nullptr), idx);
+  }
+
+  // The constraints expr depends on, computed by closing its elements over
+  // the constraints until a fixpoint is reached
+  static std::vector<ref<Expr>> getDependencies(const ConstraintSet &cs,
+                                                const ref<Expr> &expr) {
+    typedef ConstraintPartitions::Element Element;
+    auto overlaps = [](const std::vector<Element> &a,
+                       const std::vector<Element> &b) {
+      for (const auto &x : a)
+        for (const auto &y : b)
+          if (x.first == y.first &&
+              (x.second == y.second ||
+               x.second == ConstraintPartitions::WholeArray ||
+               y.second == ConstraintPartitions::WholeArray))
+            return true;
+      return false;
+    };
+
+    std::vector<Element> closure;
+    ConstraintPartitions::getElements(expr, closure);
+    std::vector<ref<Expr>> constraints = std::vector<ref<Expr>>(cs.begin(),
+                                                                cs.end());
+    std::vector<bool> required(constraints.size());
+    for (bool changed = true; changed;) {
+      changed = false;
+      for (unsigned i = 0; i < constraints.size(); i++) {
+        std::vector<Element> elements;
+        ConstraintPartitions::getElements(constraints[i], elements);
+        if (!required[i] && overlaps(closure, elements)) {
+          required[i] = changed = true;
+          closure.insert(closure.end(), elements.begin(), elements.end());
+        }
+      }
+    }
+
+    std::vector<ref<Expr>> result;
+    for (unsigned i = 0; i < constraints.size(); i++)
+      if (required[i])
+        result.push_back(constraints[i]);
+    return result;
+  }
+};
+
+TEST_F(ConstraintsTest, IterationOrder) {
+  ConstraintSet cs;
+  std::vector<ref<Expr>> expected;
+  EXPECT_TRUE(cs.empty());
+  EXPECT_EQ(cs.begin(), cs.end());
+
+  for (unsigned i = 0; i < 100; i++) {
+    cs.push_back(constraint(i));
+    expected.push_back(constraint(i));
+    ASSERT_EQ(cs.size(), expected.size());
+    ASSERT_EQ(toVector(cs), expected);
+  }
+
+  EXPECT_EQ(ConstraintSet(expected), cs);
+}
+
+TEST_F(ConstraintsTest, SiblingsShareTheirPrefix) {
+  ConstraintSet parent;
+  for (unsigned i = 0; i < 40; i++)
+    parent.push_back(constraint(i));
+  std::vector<ref<Expr>> prefix = toVector(parent);
+
+  // both children append to the partially filled block shared with parent
+  ConstraintSet left(parent), right(parent);
+  left.push_back(constraint(100));
+  right.push_back(constraint(200));
+  right.push_back(constraint(201));
+
+  std::vector<ref<Expr>> expected = prefix;
+  EXPECT_EQ(toVector(parent), expected);
+  expected.push_back(constraint(100));
+  EXPECT_EQ(toVector(left), expected);
+  expected.back() = constraint(200);
+  expected.push_back(constraint(201));
+  EXPECT_EQ(toVector(right), expected);
+
+  // the parent does not see what its children appended
+  parent.push_back(constraint(300));
+  prefix.push_back(constraint(300));
+  EXPECT_EQ(toVector(parent), prefix);
+  EXPECT_EQ(left.size(), 41u);
+  EXPECT_FALSE(left == parent);
+}
+
+TEST_F(ConstraintsTest, ForkAtBlockBoundary) {
+  ConstraintSet parent;
+  for (unsigned i = 0; i < 64; i++)
+    parent.push_back(constraint(i));
+
+  std::vector<ConstraintSet> children(10, parent);
+  for (unsigned c = 0; c < children.size(); c++) {
+    for (unsigned i = 0; i <= c; i++)
+      children[c].push_back(constraint(1000 + 10 * c + i));
+  }
+
+  for (unsigned c = 0; c < children.size(); c++) {
+    std::vector<ref<Expr>> expected = toVector(parent);
+    for (unsigned i = 0; i <= c; i++)
+      expected.push_back(constraint(1000 + 10 * c + i));
+    EXPECT_EQ(toVector(children[c]), expected);
+  }
+}
+
+TEST_F(ConstraintsTest, AssignmentAndManager) {
+  ConstraintSet a, b;
+  for (unsigned i = 0; i < 50; i++)
+    a.push_back(constraint(i));
+  // iterate b once so that it caches its blocks before being overwritten
+  b.push_back(constraint(500));
+  EXPECT_EQ(toVector(b).size(), 1u);
+  b = a;
+  EXPECT_EQ(toVector(b), toVector(a));
+
+  ConstraintManager m(b);
+  m.addConstraint(constraint(60));
+  EXPECT_EQ(b.size(), 51u);
+  EXPECT_EQ(a.size(), 50u);
+  EXPECT_EQ(*std::next(b.begin(), 50), constraint(60));
+}
+
+TEST_F(ConstraintsTest, IndependentConstraints) {
+  const Array *x = ac.CreateArray("x", 8), *y = ac.CreateArray("y", 8);
+  const Array *z = ac.CreateArray("z", 8);
+  ConstraintSet cs;
+  std::vector<ref<Expr>> result;
+
+  cs.getIndependentConstraints(read(x, 0), result);
+  EXPECT_TRUE(result.empty());
+
+  ref<Expr> c0 = UltExpr::create(read(x, 0), read(y, 0));
+  ref<Expr> c1 = UltExpr::create(read(y, 1), read(z, 1));
+  ref<Expr> c2 = UltExpr::create(read(z, 2), read(x, 3));
+  cs.push_back(c0);
+  cs.push_back(c1);
+  cs.push_back(c2);
+
+  // x[0] - y[0] and z[2] - x[3] are independent of y[1] - z[1]
+  cs.getIndependentConstraints(read(x, 0), result);
+  EXPECT_EQ(result, std::vector<ref<Expr>>({c0}));
+  result.clear();
+  cs.getIndependentConstraints(read(x, 1), result);
+  EXPECT_TRUE(result.empty());
+
+  // y[z[1]] reads every byte of y, which joins the partitions of c0 and c1
+  ref<Expr> c3 =
+      UltExpr::create(read(y, 1, z), ConstantExpr::create(5, Expr::Int8));
+  ConstraintSet child(cs);
+  child.push_back(c3);
+  result.clear();
+  child.getIndependentConstraints(read(x, 0), result);
+  EXPECT_EQ(result, std::vector<ref<Expr>>({c0, c1, c3}));
+  result.clear();
+  child.getIndependentConstraints(read(z, 0, x), result);
+  EXPECT_EQ(result, std::vector<ref<Expr>>({c0, c1, c2, c3}));
+
+  // the parent does not see the constraint of its child
+  result.clear();
+  cs.getIndependentConstraints(read(x, 0), result);
+  EXPECT_EQ(result, std::vector<ref<Expr>>({c0}));
+}
+
+TEST_F(ConstraintsTest, IndependentConstraintsMatchFixpoint) {
+  std::vector<const Array *> arrays;
+  for (unsigned i = 0; i < 4; i++)
+    arrays.push_back(ac.CreateArray("a" + std::to_string(i), 16));
+
+  std::mt19937 rng(0);
+  auto randomRead = [&]() {
+    const Array *a = arrays[rng() % arrays.size()];
+    // mostly reads at constant indices, sometimes at symbolic ones
+    if (rng() % 8 == 0)
+      return read(a, rng() % 16, arrays[rng() % arrays.size()]);
+    return read(a, rng() % 16);
+  };
+
+  std::vector<ConstraintSet> states(1);
+  for (unsigned step = 0; step < 300; step++) {
+    // fork now and then, so that states share their partitions
+    if (step % 20 == 0)
+      states.push_back(states[rng() % states.size()]);
+
+    ConstraintSet &cs = states[rng() % states.size()];
+    cs.push_back(UltExpr::create(randomRead(), randomRead()));
+
+    ref<Expr> query = EqExpr::create(randomRead(), randomRead());
+    std::vector<ref<Expr>> result;
+    cs.getIndependentConstraints(query, result);
+    ASSERT_EQ(result, getDependencies(cs, query)) << "step " << step;
+  }
+}
+
+TEST_F(ConstraintsTest, UnchangedRewriteKeepsSet) {
+  const Array *x = ac.CreateArray("x", 8), *y = ac.CreateArray("y", 8);
+  ConstraintSet cs;
+  ConstraintManager m(cs);
+  ref<Expr> c0 = UltExpr::create(read(x, 0), read(y, 0));
+  m.addConstraint(c0);
+  std::vector<ref<Expr>> result;
+  cs.getIndependentConstraints(read(y, 0), result);
+
+  // x[1] == 3 does not occur in c0, which stays as it is
+  ConstraintSet copy(cs);
+  ref<Expr> c1 = EqExpr::create(ConstantExpr::create(3, Expr::Int8),
+                                read(x, 1));
+  m.addConstraint(c1);
+  EXPECT_EQ(toVector(cs), std::vector<ref<Expr>>({c0, c1}));
+  EXPECT_EQ(toVector(copy), std::vector<ref<Expr>>({c0}));
+
+  result.clear();
+  cs.getIndependentConstraints(read(x, 1), result);
+  EXPECT_EQ(result, std::vector<ref<Expr>>({c1}));
+}
+
+} // namespace
@@ -12,6 +12,7 @@
 
 #include "klee/Expr/ArrayCache.h"
 #include "klee/Expr/Expr.h"
+#include "klee/Expr/ExprStats.h"
 
 using namespace klee;
 
@@ -264,4 +265,33 @@ TEST(ExprTest, ReadExprFoldingSymbolicIndexUpdate) {
     EXPECT_EQ(Expr::Read, read.get()->getKind());
   }
 }
+
+TEST(ExprTest, InternedConstants) {
+  // small constants of the common widths are shared
+  EXPECT_EQ(ConstantExpr::create(7, Expr::Int32).get(),
+            ConstantExpr::create(7, Expr::Int32).get());
+  EXPECT_EQ(ConstantExpr::alloc(llvm::APInt(8, 255)).get(),
+            ConstantExpr::create(255, Expr::Int8).get());
+  EXPECT_NE(ConstantExpr::create(7, Expr::Int32).get(),
+            ConstantExpr::create(7, Expr::Int64).get());
+  EXPECT_NE(ConstantExpr::create(256, Expr::Int32).get(),
+            ConstantExpr::create(256, Expr::Int32).get());
+
+  // concrete arithmetic on small values does not allocate
+  uint64_t allocs = stats::constantAllocations;
+  uint64_t interned = stats::internedConstants;
+  ref<Expr> sum = ConstantExpr::create(0, Expr::Int8);
+  for (unsigned i = 0; i < 1000; i++)
+    sum = AddExpr::create(sum, ConstantExpr::create(i % 3, Expr::Int8));
+  EXPECT_EQ(cast<ConstantExpr>(sum)->getZExtValue(), 999u % 256);
+  EXPECT_EQ(stats::constantAllocations, allocs);
+  EXPECT_GE(stats::internedConstants - interned, 1000u);
+
+  // interned constants keep their value and hash
+  ref<ConstantExpr> c = ConstantExpr::create(42, Expr::Int16);
+  EXPECT_EQ(c->getWidth(), (Expr::Width)Expr::Int16);
+  EXPECT_EQ(c->getZExtValue(), 42u);
+  EXPECT_EQ(c->hash(), ConstantExpr::create(42, Expr::Int16)->hash());
+  EXPECT_EQ(c->compare(*ConstantExpr::create(42, Expr::Int16)), 0);
+}
 }
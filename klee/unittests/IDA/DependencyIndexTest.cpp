@@ -0,0 +1,87 @@
+#include "DependencyIndex.h"
+#include "InterproceduralDependencyAnalysis.h"
+
+#include "gtest/gtest.h"
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Support/SourceMgr.h"
+
+using namespace llvm;
+
+namespace {
+
+// a branch on a global whose constant does not fit into 32 bits
+const char *WideConstantModule = R"(
+@g = global i64 0
+
+define void @set() {
+entry:
+  store i64 5000000000, i64* @g
+  ret void
+}
+
+define i32 @main() {
+entry:
+  call void @set()
+  %v = load i64, i64* @g
+  %c = icmp ugt i64 %v, 4000000000
+  br i1 %c, label %then, label %else
+
+then:
+  ret i32 1
+
+else:
+  ret i32 0
+}
+)";
+
+TEST(DependencyIndexTest, ConditionAboveInt32Max) {
+  // 3000000000 > INT32_MAX, it is negative as a signed i32
+  EXPECT_TRUE(ida::isConditionTrue(CmpInst::ICMP_UGT, 64, 3000000000, 2500000000));
+  EXPECT_TRUE(ida::isConditionTrue(CmpInst::ICMP_SGT, 64, 3000000000, 2500000000));
+  EXPECT_TRUE(ida::isConditionTrue(CmpInst::ICMP_UGT, 32, 3000000000, 1));
+  EXPECT_FALSE(ida::isConditionTrue(CmpInst::ICMP_SGT, 32, 3000000000, 1));
+  EXPECT_TRUE(ida::isConditionTrue(CmpInst::ICMP_SLT, 32, 3000000000, 0));
+  EXPECT_FALSE(ida::isConditionTrue(CmpInst::ICMP_ULT, 32, 3000000000, 0));
+
+  // no truncation of wide values
+  EXPECT_FALSE(ida::isConditionTrue(CmpInst::ICMP_EQ, 64, 0x100000001, 1));
+  EXPECT_TRUE(ida::isConditionTrue(CmpInst::ICMP_EQ, 8, 0xff, 0xff));
+  EXPECT_TRUE(ida::isConditionTrue(CmpInst::ICMP_SLT, 8, 0xff, 0));
+}
+
+TEST(DependencyIndexTest, WideBranchConstant) {
+  PassRegistry &registry = *PassRegistry::getPassRegistry();
+  initializeCore(registry);
+  initializeAnalysis(registry);
+
+  LLVMContext ctx;
+  SMDiagnostic err;
+  std::unique_ptr<Module> M = parseAssemblyString(WideConstantModule, err, ctx);
+  ASSERT_TRUE(M);
+
+  legacy::PassManager pm;
+  auto *analysis = ida::InterproceduralDependencyAnalysis::addInProcess(pm, "/dev/null");
+  pm.run(*M);
+
+  const ida::DependencyIndex &index = analysis->getDependencyIndex();
+  ASSERT_EQ(index.branches.size(), 1u);
+  const ida::BranchIndex &branch = index.branches[0];
+  EXPECT_EQ(branch.pred, (unsigned)CmpInst::ICMP_UGT);
+  EXPECT_EQ(branch.constant, 4000000000u);
+
+  // 5000000000 > 4000000000 leads to the true side
+  ASSERT_EQ(branch.vars.size(), 1u);
+  ASSERT_EQ(branch.vars[0].sides.size(), 1u);
+  EXPECT_EQ(branch.vars[0].sides[0], (unsigned)ida::ss_true);
+
+  // the constant survives the metadata of an annotated module
+  ida::writeDependencyMetaData(index);
+  ida::DependencyIndex read;
+  ida::readDependencyMetaData(*M, read);
+  ASSERT_EQ(read.branches.size(), 1u);
+  EXPECT_EQ(read.branches[0].constant, 4000000000u);
+}
+
+} // namespace
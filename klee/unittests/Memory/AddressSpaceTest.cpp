@@ -0,0 +1,124 @@
+//===-- AddressSpaceTest.cpp ------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "Core/AddressSpace.h"
+#include "Core/CoreStats.h"
+#include "Core/Memory.h"
+#include "klee/Expr/ArrayCache.h"
+
+using namespace klee;
+
+namespace {
+
+ObjectPair resolve(const AddressSpace &as, uint64_t address) {
+  ObjectPair op(nullptr, nullptr);
+  as.resolveOne(ConstantExpr::create(address, Expr::Int64), op);
+  return op;
+}
+
+TEST(AddressSpaceTest, ResolutionCache) {
+  AddressSpace as;
+  auto *mo = new MemoryObject(0x1000, 256, false, true, false, nullptr,
+                              nullptr);
+  auto *os = new ObjectState(mo);
+  as.bindObject(mo, os);
+
+  uint64_t hits = stats::resolutionCacheHits;
+  EXPECT_EQ(resolve(as, 0x1010), ObjectPair(mo, os));
+  EXPECT_EQ(resolve(as, 0x1018), ObjectPair(mo, os));
+  EXPECT_EQ(stats::resolutionCacheHits - hits, 1u);
+
+  // addresses outside of the object are not found through the entry
+  EXPECT_EQ(resolve(as, 0x1000 + 256).first, nullptr);
+
+  // a copy-on-write copy replaces the cached state
+  AddressSpace child(as);
+  const ObjectState *wos = child.getWriteable(mo, os);
+  EXPECT_NE(wos, os);
+  EXPECT_EQ(resolve(child, 0x1010), ObjectPair(mo, wos));
+  EXPECT_EQ(resolve(as, 0x1010), ObjectPair(mo, os));
+
+  child.unbindObject(mo);
+  EXPECT_EQ(resolve(child, 0x1010).first, nullptr);
+  EXPECT_EQ(resolve(as, 0x1010), ObjectPair(mo, os));
+}
+
+TEST(AddressSpaceTest, ResolutionCacheAlternatingBuffers) {
+  AddressSpace as;
+  // a copy loop: the buffers are accessed at the same offsets and are a
+  // power of two apart
+  auto *src = new MemoryObject(0x100000, 4096, false, true, false, nullptr,
+                               nullptr);
+  auto *dst = new MemoryObject(0x200000, 4096, false, true, false, nullptr,
+                               nullptr);
+  auto *srcState = new ObjectState(src);
+  auto *dstState = new ObjectState(dst);
+  as.bindObject(src, srcState);
+  as.bindObject(dst, dstState);
+
+  uint64_t misses = stats::resolutionCacheMisses;
+  for (uint64_t offset = 0; offset < 4096; offset += 8) {
+    EXPECT_EQ(resolve(as, src->address + offset), ObjectPair(src, srcState));
+    EXPECT_EQ(resolve(as, dst->address + offset), ObjectPair(dst, dstState));
+  }
+  // at most one miss per line and buffer
+  EXPECT_LE(stats::resolutionCacheMisses - misses, 2 * 4096u / 64);
+}
+
+TEST(AddressSpaceTest, ReachableObjects) {
+  AddressSpace as;
+  ArrayCache ac;
+  std::vector<ObjectState *> states;
+  // concrete objects of 64 bytes at 0x1000, 0x2000 and 0x3000, and a
+  // symbolic one at 0x4000
+  for (uint64_t address = 0x1000; address <= 0x4000; address += 0x1000) {
+    auto *mo = new MemoryObject(address, 64, false, true, false, nullptr,
+                                nullptr);
+    ObjectState *os;
+    if (address < 0x4000) {
+      os = new ObjectState(mo);
+      os->initializeToZero();
+    } else {
+      os = new ObjectState(mo, ac.CreateArray("reachable_sym", 64));
+    }
+    as.bindObject(mo, os);
+    states.push_back(os);
+  }
+  auto writePointer = [](ObjectState *os, unsigned offset, uintptr_t p) {
+    os->writeConcrete(offset, reinterpret_cast<uint8_t *>(&p), sizeof(p));
+  };
+  writePointer(states[0], 0, 0x2000);
+  // a pointer just past the end of the third object
+  writePointer(states[1], 8, 0x3000 + 64);
+
+  ResolutionList rl;
+  ASSERT_TRUE(as.getReachableObjects({0x1010}, rl));
+  ASSERT_EQ(rl.size(), 3u);
+  EXPECT_EQ(rl[0].first->address, 0x1000u);
+  EXPECT_EQ(rl[1].first->address, 0x2000u);
+  EXPECT_EQ(rl[2].first->address, 0x3000u);
+
+  // unaligned words are not pointers, and unallocated addresses reach nothing
+  writePointer(states[2], 1, 0x1000);
+  rl.clear();
+  ASSERT_TRUE(as.getReachableObjects({0x3000, 0x100}, rl));
+  EXPECT_EQ(rl.size(), 1u);
+
+  // a reachable symbolic object fails
+  EXPECT_FALSE(states[3]->isAllConcrete());
+  rl.clear();
+  EXPECT_FALSE(as.getReachableObjects({0x4000}, rl));
+  writePointer(states[2], 16, 0x4008);
+  rl.clear();
+  EXPECT_FALSE(as.getReachableObjects({0x1000}, rl));
+}
+
+} // namespace
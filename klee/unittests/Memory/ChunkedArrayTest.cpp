@@ -0,0 +1,155 @@
+//===-- ChunkedArrayTest.cpp ------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/ADT/ChunkedArray.h"
+#include "klee/Expr/Expr.h"
+
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+TEST(ChunkedArrayTest, FillValue) {
+  ChunkedArray<uint8_t, 16> a(40, 0xAB);
+  EXPECT_EQ(a.getSize(), 40u);
+  EXPECT_EQ(a.get(0), 0xAB);
+  EXPECT_EQ(a.get(39), 0xAB);
+  EXPECT_EQ(a.getAllocatedChunkCount(), 0u);
+
+  // writing the fill value does not allocate
+  a.set(3, 0xAB);
+  EXPECT_EQ(a.getAllocatedChunkCount(), 0u);
+
+  a.set(35, 1);
+  EXPECT_EQ(a.get(35), 1);
+  EXPECT_EQ(a.get(34), 0xAB);
+  EXPECT_EQ(a.getAllocatedChunkCount(), 1u);
+
+  a.fill(0);
+  EXPECT_EQ(a.get(35), 0);
+  EXPECT_EQ(a.getAllocatedChunkCount(), 0u);
+}
+
+TEST(ChunkedArrayTest, RangeAcrossChunks) {
+  ChunkedArray<uint8_t, 16> a(40, 0xAB);
+  std::vector<uint8_t> src(30);
+  for (unsigned i = 0; i < src.size(); i++)
+    src[i] = i;
+
+  a.write(5, src.data(), src.size());
+  EXPECT_EQ(a.get(4), 0xAB);
+  EXPECT_EQ(a.get(5), 0);
+  EXPECT_EQ(a.get(34), 29);
+  EXPECT_EQ(a.get(35), 0xAB);
+
+  std::vector<uint8_t> dst(40);
+  a.read(0, dst.data(), dst.size());
+  for (unsigned i = 0; i < 40; i++)
+    EXPECT_EQ(dst[i], (i >= 5 && i < 35) ? i - 5 : 0xAB);
+
+  // filling with the fill value does not allocate unused chunks
+  ChunkedArray<uint8_t, 16> b(40, 0);
+  b.fill(10, 4, 0);
+  EXPECT_EQ(b.getAllocatedChunkCount(), 0u);
+  b.fill(14, 20, 7);
+  EXPECT_EQ(b.getAllocatedChunkCount(), 3u);
+  EXPECT_EQ(b.get(13), 0);
+  EXPECT_EQ(b.get(14), 7);
+  EXPECT_EQ(b.get(33), 7);
+  EXPECT_EQ(b.get(34), 0);
+
+  // a range write only unshares the chunks it touches
+  ChunkedArray<uint8_t, 16> c(b);
+  c.write(16, src.data(), 16);
+  EXPECT_EQ(b.getSharedChunkCount(), 2u);
+  EXPECT_EQ(b.get(16), 7);
+  EXPECT_EQ(c.get(16), 0);
+}
+
+TEST(ChunkedArrayTest, CopyOnWritePerChunk) {
+  ChunkedArray<uint8_t, 16> a(64);
+  for (unsigned i = 0; i < 64; i++)
+    a.set(i, i);
+  EXPECT_EQ(a.getAllocatedChunkCount(), 4u);
+  EXPECT_EQ(a.getSharedChunkCount(), 0u);
+
+  ChunkedArray<uint8_t, 16> b(a);
+  EXPECT_EQ(a.getSharedChunkCount(), 4u);
+  EXPECT_EQ(b.getSharedChunkCount(), 4u);
+
+  b.set(20, 0xFF);
+  EXPECT_EQ(a.getSharedChunkCount(), 3u);
+  EXPECT_EQ(b.getSharedChunkCount(), 3u);
+  EXPECT_EQ(a.get(20), 20);
+  EXPECT_EQ(b.get(20), 0xFF);
+  EXPECT_EQ(b.get(21), 21);
+
+  // the writer owns the chunk now
+  b.set(21, 0xFE);
+  EXPECT_EQ(b.getSharedChunkCount(), 3u);
+  EXPECT_EQ(a.get(21), 21);
+}
+
+TEST(ChunkedArrayTest, CopyFromKeepsEqualChunksShared) {
+  ChunkedArray<uint8_t, 16> a(40);
+  for (unsigned i = 0; i < 40; i++)
+    a.set(i, i);
+  ChunkedArray<uint8_t, 16> b(a);
+
+  std::vector<uint8_t> buf(40);
+  b.copyTo(buf.data());
+  EXPECT_TRUE(b.equals(buf.data()));
+  for (unsigned i = 0; i < 40; i++)
+    EXPECT_EQ(buf[i], i);
+
+  buf[39] = 0xFF;
+  EXPECT_FALSE(b.equals(buf.data()));
+  b.copyFrom(buf.data());
+  EXPECT_TRUE(b.equals(buf.data()));
+  EXPECT_EQ(b.get(39), 0xFF);
+  EXPECT_EQ(a.get(39), 39);
+
+  // only the last (partial) chunk was copied
+  EXPECT_EQ(b.getSharedChunkCount(), 2u);
+}
+
+TEST(ChunkedArrayTest, NullReferences) {
+  ChunkedArray<ref<Expr>, 16> a(32);
+  EXPECT_TRUE(a.get(5).isNull());
+
+  a.set(5, ref<Expr>());
+  EXPECT_EQ(a.getAllocatedChunkCount(), 0u);
+
+  ref<Expr> e = ConstantExpr::create(1, Expr::Int8);
+  a.set(5, e);
+  EXPECT_EQ(a.get(5).get(), e.get());
+  EXPECT_TRUE(a.get(4).isNull());
+  EXPECT_TRUE(a.get(16).isNull());
+  EXPECT_EQ(a.getAllocatedChunkCount(), 1u);
+}
+
+TEST(ChunkedArrayTest, BitArray) {
+  ChunkedBitArray<64> bits(200, true);
+  EXPECT_TRUE(bits.get(0));
+  EXPECT_TRUE(bits.get(199));
+
+  ChunkedBitArray<64> copy(bits);
+  copy.unset(130);
+  EXPECT_FALSE(copy.get(130));
+  EXPECT_TRUE(copy.get(131));
+  EXPECT_TRUE(bits.get(130));
+
+  copy.set(130, true);
+  EXPECT_TRUE(copy.get(130));
+}
+
+} // namespace
@@ -0,0 +1,184 @@
+//===-- ObjectStateTest.cpp -------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "Core/AddressSpace.h"
+#include "Core/Context.h"
+#include "Core/Memory.h"
+#include "klee/Expr/ArrayCache.h"
+
+using namespace klee;
+
+namespace {
+
+class ObjectStateTest : public ::testing::Test {
+protected:
+  static void SetUpTestCase() { Context::initialize(true, Expr::Int64); }
+};
+
+// A concrete object of the given size with every byte written, bound in as.
+const MemoryObject *createObject(AddressSpace &as, unsigned size) {
+  auto *mo = new MemoryObject(0x10000, size, false, true, false, nullptr,
+                              nullptr);
+  auto *os = new ObjectState(mo);
+  for (unsigned i = 0; i < size; i++)
+    os->write8(i, (uint8_t)i);
+  as.bindObject(mo, os);
+  return mo;
+}
+
+unsigned readByte(const ObjectState *os, unsigned offset) {
+  return cast<ConstantExpr>(os->read8(offset))->getZExtValue();
+}
+
+TEST_F(ObjectStateTest, ForkThenWriteCopiesOneChunk) {
+  AddressSpace parent;
+  const MemoryObject *mo = createObject(parent, 64 * 1024);
+  const ObjectState *os = parent.findObject(mo);
+  EXPECT_EQ(os->getSharedChunkCount(), 0u);
+
+  AddressSpace child(parent);
+  ObjectState *wos = child.getWriteable(mo, child.findObject(mo));
+  EXPECT_NE(wos, os);
+  EXPECT_EQ(os->getSharedChunkCount(), 16u);
+
+  wos->write8(100, 7);
+  EXPECT_EQ(os->getSharedChunkCount(), 15u);
+  EXPECT_EQ(wos->getSharedChunkCount(), 15u);
+  EXPECT_EQ(readByte(os, 100), 100u);
+  EXPECT_EQ(readByte(wos, 100), 7u);
+  EXPECT_EQ(readByte(wos, 5000), 5000u % 256);
+}
+
+TEST_F(ObjectStateTest, SymbolicWriteCopiesOneChunk) {
+  AddressSpace parent;
+  const MemoryObject *mo = createObject(parent, 16 * 1024);
+  ObjectState *pos = parent.getWriteable(mo, parent.findObject(mo));
+  ArrayCache ac;
+  ref<Expr> sym =
+      ReadExpr::create(UpdateList(ac.CreateArray("sym", 1), nullptr),
+                       ConstantExpr::create(0, Expr::Int32));
+  pos->write(0, sym);
+
+  AddressSpace child(parent);
+  ObjectState *wos = child.getWriteable(mo, child.findObject(mo));
+  wos->write(8192, sym);
+
+  EXPECT_EQ(pos->read8(0), sym);
+  EXPECT_EQ(wos->read8(0), sym);
+  EXPECT_EQ(wos->read8(8192), sym);
+  EXPECT_EQ(readByte(pos, 8192), 0u);
+}
+
+TEST_F(ObjectStateTest, ConcreteRanges) {
+  AddressSpace as;
+  const MemoryObject *mo = createObject(as, 8192);
+  ObjectState *os = as.getWriteable(mo, as.findObject(mo));
+
+  std::vector<uint8_t> bytes(5000);
+  ASSERT_TRUE(os->readConcrete(3000, bytes.data(), bytes.size()));
+  EXPECT_EQ(bytes[0], 3000u % 256);
+  EXPECT_EQ(bytes[4999], 7999u % 256);
+
+  os->fillConcrete(4000, 0xCD, 200);
+  EXPECT_EQ(readByte(os, 3999), 3999u % 256);
+  EXPECT_EQ(readByte(os, 4000), 0xCDu);
+  EXPECT_EQ(readByte(os, 4199), 0xCDu);
+  EXPECT_EQ(readByte(os, 4200), 4200u % 256);
+
+  // ranges with a symbolic byte are not read
+  ArrayCache ac;
+  ref<Expr> sym =
+      ReadExpr::create(UpdateList(ac.CreateArray("sym", 1), nullptr),
+                       ConstantExpr::create(0, Expr::Int32));
+  os->write(100, sym);
+  EXPECT_FALSE(os->readConcrete(0, bytes.data(), 101));
+  EXPECT_TRUE(os->readConcrete(101, bytes.data(), 100));
+  EXPECT_FALSE(os->isAllConcrete());
+
+  // and overwriting it makes the object concrete again
+  os->writeConcrete(50, bytes.data(), 100);
+  EXPECT_TRUE(os->readConcrete(0, bytes.data(), 200));
+  EXPECT_EQ(readByte(os, 100), 151u);
+  EXPECT_TRUE(os->isAllConcrete());
+}
+
+// The symbolic bytes are counted as they are written, each byte once.
+TEST_F(ObjectStateTest, CountsSymbolicBytes) {
+  AddressSpace as;
+  const MemoryObject *mo = createObject(as, 64);
+  ObjectState *os = as.getWriteable(mo, as.findObject(mo));
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("sym", 4);
+  ref<Expr> sym = ReadExpr::create(UpdateList(array, nullptr),
+                                   ConstantExpr::create(0, Expr::Int32));
+
+  os->write(8, sym);
+  os->write(8, sym);
+  os->write(9, sym);
+  EXPECT_FALSE(os->isAllConcrete());
+
+  // copies keep the symbolic bytes
+  AddressSpace child(as);
+  ObjectState *wos = child.getWriteable(mo, child.findObject(mo));
+  os->write8(8, 0);
+  EXPECT_FALSE(os->isAllConcrete());
+  os->write8(9, 0);
+  EXPECT_TRUE(os->isAllConcrete());
+  EXPECT_FALSE(wos->isAllConcrete());
+
+  // a write at a symbolic offset may change any byte
+  wos->initializeToZero();
+  EXPECT_TRUE(wos->isAllConcrete());
+  wos->write(ZExtExpr::create(sym, Expr::Int32),
+             ConstantExpr::create(1, Expr::Int8));
+  EXPECT_FALSE(wos->isAllConcrete());
+  uint8_t bytes[64] = {};
+  wos->writeConcrete(0, bytes, 64);
+  EXPECT_TRUE(wos->isAllConcrete());
+
+  ObjectState fresh(mo, array);
+  EXPECT_FALSE(fresh.isAllConcrete());
+}
+
+// Forks of objects of growing size that each write one byte copy only the
+// chunk holding it, and share the others with the parent until they are gone.
+TEST_F(ObjectStateTest, ForksShareUnmodifiedChunks) {
+  for (unsigned size : {64u, 4096u, 64u * 1024, 1024u * 1024}) {
+    AddressSpace parent;
+    const MemoryObject *mo = createObject(parent, size);
+    const ObjectState *os = parent.findObject(mo);
+    // the object is stored in chunks of 4096 bytes
+    unsigned chunks = (size + 4095) / 4096;
+
+    for (unsigned i = 0; i < 10; i++) {
+      unsigned offset = (i * 4099) % size;
+      AddressSpace child(parent);
+      ObjectState *wos = child.getWriteable(mo, child.findObject(mo));
+      wos->write8(offset, (uint8_t)~offset);
+      EXPECT_EQ(os->getSharedChunkCount(), chunks - 1) << size;
+      EXPECT_EQ(wos->getSharedChunkCount(), chunks - 1) << size;
+      EXPECT_EQ(readByte(os, offset), offset % 256);
+
+      // a fork of the fork shares its written chunk as well
+      AddressSpace grandchild(child);
+      const ObjectState *gos = grandchild.findObject(mo);
+      EXPECT_EQ(gos, wos);
+      ObjectState *wgos = grandchild.getWriteable(mo, gos);
+      EXPECT_EQ(wgos->getSharedChunkCount(), chunks);
+      EXPECT_EQ(readByte(wgos, offset), (uint8_t)~offset);
+    }
+
+    // after the last child is gone, nothing stays shared
+    EXPECT_EQ(os->getSharedChunkCount(), 0u) << size;
+  }
+}
+
+} // namespace
@@ -0,0 +1,181 @@
+#include "klee/ADT/SetIndex.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+typedef std::set<int> Set;
+
+struct Any {
+  bool operator()(int) const { return true; }
+};
+
+TEST(SetIndexTest, Lookup) {
+  SetIndex<int, int> index;
+  index.insert(Set{1, 2, 3}, 10);
+  index.insert(Set{}, 20);
+
+  ASSERT_NE(index.lookup(Set{1, 2, 3}), nullptr);
+  EXPECT_EQ(*index.lookup(Set{1, 2, 3}), 10);
+  ASSERT_NE(index.lookup(Set{}), nullptr);
+  EXPECT_EQ(*index.lookup(Set{}), 20);
+  EXPECT_EQ(index.lookup(Set{1, 2}), nullptr);
+  EXPECT_EQ(index.lookup(Set{1, 2, 3, 4}), nullptr);
+
+  // replacing a set evicts its old value
+  std::vector<int> evicted;
+  SetIndex<int, int> replacing(0, [&](int v) { evicted.push_back(v); });
+  replacing.insert(Set{1}, 1);
+  replacing.insert(Set{1}, 2);
+  EXPECT_EQ(*replacing.lookup(Set{1}), 2);
+  EXPECT_EQ(evicted, std::vector<int>{1});
+  EXPECT_EQ(replacing.size(), 1u);
+}
+
+TEST(SetIndexTest, SubsetAndSuperset) {
+  SetIndex<int, int> index;
+  index.insert(Set{1, 2}, 12);
+  index.insert(Set{2, 3, 4}, 234);
+
+  int *v = index.findSubset(Set{1, 2, 5}, Any());
+  ASSERT_NE(v, nullptr);
+  EXPECT_EQ(*v, 12);
+  EXPECT_EQ(index.findSubset(Set{1, 3, 4}, Any()), nullptr);
+  EXPECT_EQ(index.findSubset(Set{2, 3, 4, 5}, [](int v) { return v != 234; }),
+            nullptr);
+
+  v = index.findSuperset(Set{3, 4}, Any());
+  ASSERT_NE(v, nullptr);
+  EXPECT_EQ(*v, 234);
+  EXPECT_EQ(index.findSuperset(Set{1, 3}, Any()), nullptr);
+  // a key no set holds
+  EXPECT_EQ(index.findSuperset(Set{2, 7}, Any()), nullptr);
+  EXPECT_NE(index.findSuperset(Set{}, Any()), nullptr);
+}
+
+TEST(SetIndexTest, EvictsLeastRecentlyUsed) {
+  std::vector<int> evicted;
+  SetIndex<int, int> index(0, [&](int v) { evicted.push_back(v); });
+  index.insert(Set{1}, 1);
+  std::size_t oneSet = index.getMemoryUsage();
+
+  SetIndex<int, int> bounded(3 * oneSet,
+                             [&](int v) { evicted.push_back(v); });
+  bounded.insert(Set{1}, 1);
+  bounded.insert(Set{2}, 2);
+  bounded.insert(Set{3}, 3);
+  EXPECT_TRUE(evicted.empty());
+
+  // using set 1 makes set 2 the least recently used one
+  ASSERT_NE(bounded.lookup(Set{1}), nullptr);
+  bounded.insert(Set{4}, 4);
+  EXPECT_EQ(evicted, std::vector<int>{2});
+  EXPECT_EQ(bounded.getNumEvictions(), 1u);
+  EXPECT_EQ(bounded.lookup(Set{2}), nullptr);
+  EXPECT_EQ(bounded.findSuperset(Set{2}, Any()), nullptr);
+  EXPECT_NE(bounded.lookup(Set{1}), nullptr);
+  EXPECT_LE(bounded.getMemoryUsage(), 3 * oneSet);
+
+  // a value too large for the limit on its own still stays
+  bounded.insert(Set{5}, 5, 10 * oneSet);
+  EXPECT_EQ(bounded.size(), 1u);
+  EXPECT_NE(bounded.lookup(Set{5}), nullptr);
+
+  evicted.clear();
+  bounded.clear();
+  EXPECT_EQ(evicted, std::vector<int>{5});
+  EXPECT_EQ(bounded.size(), 0u);
+  EXPECT_EQ(bounded.getMemoryUsage(), 0u);
+}
+
+// Compares ints unless the keys are marked as gone
+bool keysGone = false;
+struct CheckedEqual {
+  bool operator()(int a, int b) const {
+    EXPECT_FALSE(keysGone) << "comparing keys that are gone";
+    return a == b;
+  }
+};
+
+TEST(SetIndexTest, ClearDoesNotCompareKeys) {
+  std::vector<int> evicted;
+  SetIndex<int, int, std::hash<int>, CheckedEqual> index(
+      0, [&](int v) { evicted.push_back(v); });
+  index.insert(Set{1, 2}, 1);
+  index.insert(Set{2, 3}, 2);
+  ASSERT_NE(index.lookup(Set{1, 2}), nullptr);
+
+  keysGone = true;
+  index.clear();
+  keysGone = false;
+  // least recently used first, as when evicted one by one
+  EXPECT_EQ(evicted, (std::vector<int>{2, 1}));
+  EXPECT_EQ(index.size(), 0u);
+  EXPECT_EQ(index.getMemoryUsage(), 0u);
+
+  index.insert(Set{1}, 3);
+  ASSERT_NE(index.lookup(Set{1}), nullptr);
+  EXPECT_EQ(*index.lookup(Set{1}), 3);
+}
+
+TEST(SetIndexTest, MatchesBruteForce) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> key(0, 99);
+  std::uniform_int_distribution<int> length(0, 6);
+
+  auto randomSet = [&]() {
+    Set s;
+    for (int n = length(rng); n > 0; n--)
+      s.insert(key(rng));
+    return s;
+  };
+
+  SetIndex<int, int> index;
+  std::vector<Set> sets;
+  for (int i = 0; i < 500; i++) {
+    Set s = randomSet();
+    if (index.lookup(s))
+      continue;
+    index.insert(s, sets.size());
+    sets.push_back(s);
+  }
+
+  for (int i = 0; i < 500; i++) {
+    Set query = randomSet();
+    // odd values only, so that the predicate matters
+    auto odd = [](int v) { return v % 2; };
+
+    bool hasSubset = false, hasSuperset = false;
+    for (std::size_t j = 0; j < sets.size(); j++) {
+      if (!odd(j))
+        continue;
+      hasSubset |= std::includes(query.begin(), query.end(), sets[j].begin(),
+                                 sets[j].end());
+      hasSuperset |= std::includes(sets[j].begin(), sets[j].end(),
+                                   query.begin(), query.end());
+    }
+
+    int *subset = index.findSubset(query, odd);
+    ASSERT_EQ(subset != nullptr, hasSubset);
+    if (subset) {
+      EXPECT_TRUE(std::includes(query.begin(), query.end(),
+                                sets[*subset].begin(), sets[*subset].end()));
+    }
+
+    int *superset = index.findSuperset(query, odd);
+    ASSERT_EQ(superset != nullptr, hasSuperset);
+    if (superset) {
+      EXPECT_TRUE(std::includes(sets[*superset].begin(),
+                                sets[*superset].end(), query.begin(),
+                                query.end()));
+    }
+  }
+}
+
+} // namespace
@@ -0,0 +1,170 @@
+//===-- CanonicalizingSolverTest.cpp --------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
+
+#include <memory>
+
+using namespace klee;
+
+namespace {
+ArrayCache AC;
+
+/// Answers every query the same way, counts the queries and records the
+/// arrays of the last one
+class CountingSolver : public SolverImpl {
+public:
+  unsigned &count;
+  std::vector<const Array *> &objects;
+
+  CountingSolver(unsigned &count, std::vector<const Array *> &objects)
+      : count(count), objects(objects) {}
+
+  bool computeTruth(const Query &, bool &isValid) override {
+    ++count;
+    isValid = false;
+    return true;
+  }
+  bool computeValue(const Query &query, ref<Expr> &result) override {
+    ++count;
+    result = ConstantExpr::alloc(42, query.expr->getWidth());
+    return true;
+  }
+  bool computeInitialValues(const Query &,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char>> &values,
+                            bool &hasSolution) override {
+    ++count;
+    this->objects = objects;
+    for (const Array *array : objects)
+      values.emplace_back(array->size, 7);
+    hasSolution = true;
+    return true;
+  }
+  SolverRunStatus getOperationStatusCode() override {
+    return SOLVER_RUN_STATUS_SUCCESS_SOLVABLE;
+  }
+};
+
+class CanonicalizingSolverTest : public ::testing::Test {
+protected:
+  unsigned count = 0;
+  std::vector<const Array *> objects;
+
+  Solver *createCore() {
+    return new Solver(new CountingSolver(count, objects));
+  }
+
+  static ref<Expr> read(const Array *array, unsigned index) {
+    return ReadExpr::create(UpdateList(array, nullptr),
+                            ConstantExpr::alloc(index, Expr::Int32));
+  }
+
+  /// x > 5 && y < x with the given arrays, in the given order
+  static ConstraintSet makeConstraints(const Array *x, const Array *y,
+                                       bool reversed) {
+    ref<Expr> c1 = UltExpr::create(ConstantExpr::alloc(5, Expr::Int8),
+                                   read(x, 0));
+    ref<Expr> c2 = UltExpr::create(read(y, 0), read(x, 0));
+
+    ConstraintSet constraints;
+    ConstraintManager cm(constraints);
+    cm.addConstraint(reversed ? c2 : c1);
+    cm.addConstraint(reversed ? c1 : c2);
+    return constraints;
+  }
+};
+
+TEST_F(CanonicalizingSolverTest, RenamedQueriesHitBranchCache) {
+  std::unique_ptr<Solver> solver(
+      createCanonicalizingSolver(createCachingSolver(createCore())));
+
+  const Array *x = AC.CreateArray("x", 4), *y = AC.CreateArray("y", 4);
+  const Array *a = AC.CreateArray("a", 4), *b = AC.CreateArray("b", 4);
+
+  bool result;
+  ConstraintSet c1 = makeConstraints(x, y, false);
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(c1, EqExpr::create(read(y, 1), read(x, 1))), result));
+  ConstraintSet c2 = makeConstraints(a, b, true);
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(c2, EqExpr::create(read(b, 1), read(a, 1))), result));
+  EXPECT_EQ(1u, count);
+
+  // a query of another structure still reaches the solver
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(c2, EqExpr::create(read(a, 1), read(a, 2))), result));
+  EXPECT_EQ(2u, count);
+}
+
+TEST_F(CanonicalizingSolverTest, InitialValuesMapBack) {
+  std::unique_ptr<Solver> solver(
+      createCanonicalizingSolver(createCexCachingSolver(createCore())));
+
+  const Array *x = AC.CreateArray("x", 4), *y = AC.CreateArray("y", 2);
+  const Array *a = AC.CreateArray("a", 4), *b = AC.CreateArray("b", 2);
+
+  std::vector<std::vector<unsigned char>> values;
+  ConstraintSet c1 = makeConstraints(x, y, false);
+  ASSERT_TRUE(solver->getInitialValues(Query(c1, read(x, 1)), {y, x}, values));
+  ASSERT_EQ(2u, values.size());
+  EXPECT_EQ(2u, values[0].size());
+  EXPECT_EQ(4u, values[1].size());
+
+  // the solver below sees canonical arrays, not the arrays of the state
+  ASSERT_FALSE(objects.empty());
+  for (const Array *object : objects) {
+    EXPECT_NE(x, object);
+    EXPECT_NE(y, object);
+  }
+
+  unsigned queries = count;
+  ConstraintSet c2 = makeConstraints(a, b, true);
+  values.clear();
+  ASSERT_TRUE(solver->getInitialValues(Query(c2, read(a, 1)), {b, a}, values));
+  EXPECT_EQ(queries, count);
+  ASSERT_EQ(2u, values.size());
+  EXPECT_EQ(2u, values[0].size());
+  EXPECT_EQ(4u, values[1].size());
+}
+
+TEST_F(CanonicalizingSolverTest, RenamesUpdateLists) {
+  std::unique_ptr<Solver> solver(
+      createCanonicalizingSolver(createCachingSolver(createCore())));
+
+  // writes of a symbolic value of another array into the read array
+  auto makeQuery = [](const Array *array, const Array *other,
+                      ConstraintSet &constraints) {
+    UpdateList ul(array, nullptr);
+    ul.extend(ConstantExpr::alloc(0, Expr::Int32), read(other, 0));
+    ref<Expr> r =
+        ReadExpr::create(ul, ZExtExpr::create(read(other, 1), Expr::Int32));
+    ConstraintManager(constraints)
+        .addConstraint(UltExpr::create(ConstantExpr::alloc(3, Expr::Int8),
+                                       read(other, 1)));
+    return EqExpr::create(r, ConstantExpr::alloc(1, Expr::Int8));
+  };
+
+  bool result;
+  ConstraintSet c1, c2;
+  ref<Expr> e1 =
+      makeQuery(AC.CreateArray("m", 8), AC.CreateArray("n", 4), c1);
+  ASSERT_TRUE(solver->mustBeTrue(Query(c1, e1), result));
+  ref<Expr> e2 =
+      makeQuery(AC.CreateArray("p", 8), AC.CreateArray("q", 4), c2);
+  ASSERT_TRUE(solver->mustBeTrue(Query(c2, e2), result));
+  EXPECT_EQ(1u, count);
+}
+} // namespace
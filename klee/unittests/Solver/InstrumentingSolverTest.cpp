@@ -0,0 +1,109 @@
+//===-- InstrumentingSolverTest.cpp ---------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+
+#include <memory>
+
+using namespace klee;
+
+namespace {
+ArrayCache AC;
+
+/// Answers every query as not valid
+class InvalidSolver : public SolverImpl {
+public:
+  bool computeTruth(const Query &, bool &isValid) override {
+    isValid = false;
+    return true;
+  }
+  bool computeValue(const Query &query, ref<Expr> &result) override {
+    result = ConstantExpr::alloc(0, query.expr->getWidth());
+    return true;
+  }
+  bool computeInitialValues(const Query &,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char>> &values,
+                            bool &hasSolution) override {
+    for (const Array *array : objects)
+      values.emplace_back(array->size, 0);
+    hasSolution = true;
+    return true;
+  }
+  SolverRunStatus getOperationStatusCode() override {
+    return SOLVER_RUN_STATUS_SUCCESS_SOLVABLE;
+  }
+};
+
+ref<Expr> read(const Array *array, unsigned index) {
+  return ReadExpr::create(UpdateList(array, nullptr),
+                          ConstantExpr::alloc(index, Expr::Int32));
+}
+
+TEST(InstrumentingSolverTest, AttributesQueriesToLayers) {
+  stats::SolverLayerStats &core = stats::addSolverLayer("core", nullptr);
+  Solver *solver =
+      createInstrumentingSolver(new Solver(new InvalidSolver()), core);
+  stats::SolverLayerStats &cache = stats::addSolverLayer("cache", &core);
+  std::unique_ptr<Solver> chain(
+      createInstrumentingSolver(createCachingSolver(solver), cache));
+  EXPECT_EQ(0u, core.depth);
+  EXPECT_EQ(1u, cache.depth);
+
+  const Array *array = AC.CreateArray("instrumenting_x", 2);
+  ref<Expr> x0 = read(array, 0), x1 = read(array, 1);
+  ConstraintSet constraints;
+  ConstraintManager cm(constraints);
+  cm.addConstraint(UltExpr::create(x0, x1));
+  // x[0] + x[1] == 3, shares the reads with the constraint
+  Query query(constraints,
+              EqExpr::create(AddExpr::create(x0, x1),
+                             ConstantExpr::alloc(3, Expr::Int8)));
+
+  bool result;
+  ASSERT_TRUE(chain->mustBeTrue(query, result));
+  EXPECT_FALSE(result);
+  // answered by the branch cache
+  ASSERT_TRUE(chain->mustBeTrue(query, result));
+  EXPECT_FALSE(result);
+
+  EXPECT_EQ(2u, cache.queries);
+  EXPECT_EQ(1u, cache.hits);
+  EXPECT_EQ(1u, core.queries);
+  EXPECT_EQ(0u, core.hits);
+  EXPECT_EQ(2u, cache.latency.getCount());
+  EXPECT_EQ(1u, core.latency.getCount());
+  EXPECT_GE(cache.time, core.time);
+
+  // the constraint has 5 nodes (the comparison, the reads and their indices),
+  // the expression 3 more (the comparison, the constant and the sum)
+  EXPECT_EQ(8u, core.exprNodes);
+  EXPECT_EQ(2 * core.exprNodes, cache.exprNodes);
+}
+
+TEST(InstrumentingSolverTest, SpeculationsAreNotCounted) {
+  stats::SolverLayerStats &core = stats::addSolverLayer("core", nullptr);
+  std::unique_ptr<Solver> solver(
+      createInstrumentingSolver(new Solver(new InvalidSolver()), core));
+
+  const Array *array = AC.CreateArray("instrumenting_y", 1);
+  ConstraintSet constraints;
+  solver->speculate(Query(
+      constraints,
+      EqExpr::create(read(array, 0), ConstantExpr::alloc(1, Expr::Int8))));
+  EXPECT_EQ(0u, core.queries);
+}
+} // namespace
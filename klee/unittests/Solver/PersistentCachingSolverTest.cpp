@@ -0,0 +1,213 @@
+//===-- PersistentCachingSolverTest.cpp -----------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+
+#include "llvm/Support/FileSystem.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+
+using namespace klee;
+
+namespace {
+ArrayCache AC;
+
+/// Answers every query the same way and counts the queries
+class CountingSolver : public SolverImpl {
+public:
+  unsigned &count;
+
+  explicit CountingSolver(unsigned &count) : count(count) {}
+
+  bool computeTruth(const Query &, bool &isValid) override {
+    ++count;
+    isValid = true;
+    return true;
+  }
+  bool computeValue(const Query &query, ref<Expr> &result) override {
+    ++count;
+    result = ConstantExpr::alloc(42, query.expr->getWidth());
+    return true;
+  }
+  bool computeInitialValues(const Query &,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char>> &values,
+                            bool &hasSolution) override {
+    ++count;
+    for (const Array *array : objects)
+      values.emplace_back(array->size, 7);
+    hasSolution = true;
+    return true;
+  }
+  SolverRunStatus getOperationStatusCode() override {
+    return SOLVER_RUN_STATUS_SUCCESS_SOLVABLE;
+  }
+};
+
+class PersistentCachingSolverTest : public ::testing::Test {
+protected:
+  llvm::SmallString<128> path;
+  unsigned count = 0;
+
+  PersistentCachingSolverTest() {
+    llvm::sys::fs::createTemporaryFile("query-cache", "bin", path);
+    llvm::sys::fs::remove(path);
+  }
+  ~PersistentCachingSolverTest() { llvm::sys::fs::remove(path); }
+
+  std::unique_ptr<Solver> open(bool shared = false) {
+    return std::unique_ptr<Solver>(createPersistentCachingSolver(
+        new Solver(new CountingSolver(count)), path.str().str(), shared));
+  }
+
+  /// x > 5 && y < x with the given array names, in the given order
+  static ConstraintSet makeConstraints(const Array *x, const Array *y,
+                                       bool reversed) {
+    ref<Expr> rx = ReadExpr::create(UpdateList(x, nullptr),
+                                    ConstantExpr::alloc(0, Expr::Int32));
+    ref<Expr> ry = ReadExpr::create(UpdateList(y, nullptr),
+                                    ConstantExpr::alloc(0, Expr::Int32));
+    ref<Expr> c1 = UltExpr::create(ConstantExpr::alloc(5, Expr::Int8), rx);
+    ref<Expr> c2 = UltExpr::create(ry, rx);
+
+    ConstraintSet constraints;
+    ConstraintManager cm(constraints);
+    cm.addConstraint(reversed ? c2 : c1);
+    cm.addConstraint(reversed ? c1 : c2);
+    return constraints;
+  }
+
+  /// x == value
+  static ref<Expr> makeQuery(const Array *x, uint64_t value) {
+    return EqExpr::create(ReadExpr::create(UpdateList(x, nullptr),
+                                           ConstantExpr::alloc(0, Expr::Int32)),
+                          ConstantExpr::alloc(value, Expr::Int8));
+  }
+};
+
+TEST_F(PersistentCachingSolverTest, HitsAcrossRuns) {
+  const Array *x = AC.CreateArray("pc_x", 1), *y = AC.CreateArray("pc_y", 1);
+  ConstraintSet constraints = makeConstraints(x, y, false);
+  ref<Expr> rx = ReadExpr::create(UpdateList(x, nullptr),
+                                  ConstantExpr::alloc(0, Expr::Int32));
+  ref<Expr> query = EqExpr::create(rx, ConstantExpr::alloc(9, Expr::Int8));
+  std::vector<const Array *> objects{x, y};
+
+  auto ask = [&](Solver &solver) {
+    bool result;
+    ASSERT_TRUE(solver.mustBeTrue(Query(constraints, query), result));
+    EXPECT_TRUE(result);
+    ref<ConstantExpr> value;
+    ASSERT_TRUE(solver.getValue(Query(constraints, rx), value));
+    EXPECT_EQ(42u, value->getZExtValue());
+    std::vector<std::vector<unsigned char>> values;
+    ASSERT_TRUE(solver.getInitialValues(
+        Query(constraints, ConstantExpr::alloc(0, Expr::Bool)), objects,
+        values));
+    ASSERT_EQ(2u, values.size());
+    EXPECT_EQ(std::vector<unsigned char>(1, 7), values[1]);
+  };
+
+  {
+    auto solver = open();
+    ask(*solver);
+    EXPECT_EQ(3u, count);
+    ask(*solver);
+    EXPECT_EQ(3u, count);
+  }
+
+  // a new run finds the results in the file
+  uint64_t hits = stats::persistentCacheHits.getValue();
+  auto solver = open();
+  ask(*solver);
+  EXPECT_EQ(3u, count);
+  EXPECT_EQ(hits + 3, stats::persistentCacheHits.getValue());
+}
+
+TEST_F(PersistentCachingSolverTest, IgnoresNamesAndOrder) {
+  const Array *x = AC.CreateArray("pc_a", 1), *y = AC.CreateArray("pc_b", 1);
+  const Array *x2 = AC.CreateArray("pc_c", 1), *y2 = AC.CreateArray("pc_d", 1);
+  auto solver = open();
+
+  bool result;
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(makeConstraints(x, y, false), makeQuery(x, 9)), result));
+  EXPECT_EQ(1u, count);
+
+  // the same query with other arrays and the constraints reversed
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(makeConstraints(x2, y2, true), makeQuery(x2, 9)), result));
+  EXPECT_EQ(1u, count);
+
+  // asking about the other array or value changes the query
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(makeConstraints(x, y, false), makeQuery(y, 9)), result));
+  EXPECT_EQ(2u, count);
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(makeConstraints(x, y, false), makeQuery(x, 10)), result));
+  EXPECT_EQ(3u, count);
+}
+
+TEST_F(PersistentCachingSolverTest, Shared) {
+  const Array *x = AC.CreateArray("pc_s", 1), *y = AC.CreateArray("pc_t", 1);
+  auto first = open(true), second = open(true);
+
+  bool result;
+  ASSERT_TRUE(first->mustBeTrue(
+      Query(makeConstraints(x, y, false), makeQuery(x, 9)), result));
+  ASSERT_TRUE(second->mustBeTrue(
+      Query(makeConstraints(x, y, false), makeQuery(x, 9)), result));
+  EXPECT_EQ(1u, count);
+}
+
+TEST_F(PersistentCachingSolverTest, CorruptedSlotIsMiss) {
+  const Array *x = AC.CreateArray("pc_u", 1), *y = AC.CreateArray("pc_v", 1);
+  ConstraintSet constraints = makeConstraints(x, y, false);
+  Query query(constraints, makeQuery(x, 9));
+  bool result;
+  ASSERT_TRUE(open()->mustBeTrue(query, result));
+  EXPECT_EQ(1u, count);
+
+  // The file starts out with 1MiB for results, and the only slot in use
+  // points to the start of them. Point it past the end of the file.
+  std::string file;
+  {
+    std::ifstream in(path.str().str(), std::ios::binary);
+    file.assign(std::istreambuf_iterator<char>(in),
+                std::istreambuf_iterator<char>());
+  }
+  uint64_t dataStart = file.size() - (1 << 20), corrupted = 1ull << 40;
+  unsigned slotsFound = 0;
+  for (size_t i = 0; i + sizeof(uint64_t) <= dataStart; i += sizeof(uint64_t)) {
+    if (!memcmp(&file[i], &dataStart, sizeof(uint64_t))) {
+      memcpy(&file[i], &corrupted, sizeof(uint64_t));
+      ++slotsFound;
+    }
+  }
+  ASSERT_EQ(1u, slotsFound);
+  {
+    std::ofstream out(path.str().str(), std::ios::binary);
+    out.write(file.data(), file.size());
+  }
+
+  ASSERT_TRUE(open()->mustBeTrue(query, result));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(2u, count);
+}
+} // namespace
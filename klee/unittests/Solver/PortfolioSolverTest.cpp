@@ -0,0 +1,125 @@
+//===-- PortfolioSolverTest.cpp -------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverStats.h"
+
+#include <memory>
+
+using namespace klee;
+
+namespace {
+ArrayCache AC;
+
+class PortfolioSolverTest : public ::testing::Test {
+protected:
+  PortfolioSolverTest()
+      : solver(createPortfolioSolver({"z3", "z3:qfbv"})) {
+    solver->setCoreSolverTimeout(time::Span("10s"));
+  }
+
+  std::unique_ptr<Solver> solver;
+
+  /// Asks whether z != i given z > i, for 20 values of i
+  void askDisequalities(const std::string &prefix) {
+    for (unsigned i = 0; i < 20; i++) {
+      const Array *array = AC.CreateArray(prefix + std::to_string(i), 4);
+      ref<Expr> z = ReadExpr::create(UpdateList(array, nullptr),
+                                     ConstantExpr::alloc(0, Expr::Int32));
+      ConstraintSet constraints;
+      ConstraintManager cm(constraints);
+      cm.addConstraint(UltExpr::create(ConstantExpr::alloc(i, Expr::Int8), z));
+
+      bool result;
+      ASSERT_TRUE(solver->mustBeTrue(
+          Query(constraints,
+                NeExpr::create(z, ConstantExpr::alloc(i, Expr::Int8))),
+          result));
+      EXPECT_TRUE(result);
+    }
+  }
+};
+
+TEST_F(PortfolioSolverTest, Answers) {
+  const Array *array = AC.CreateArray("portfolio_x", 1);
+  ref<Expr> x = ReadExpr::create(UpdateList(array, nullptr),
+                                 ConstantExpr::alloc(0, Expr::Int32));
+  ref<Expr> five = ConstantExpr::alloc(5, Expr::Int8);
+
+  uint64_t winsBefore = stats::portfolioWinsZ3.getValue() +
+                        stats::portfolioWinsZ3Tactic.getValue();
+
+  ConstraintSet constraints;
+  ConstraintManager cm(constraints);
+  cm.addConstraint(UltExpr::create(five, x));
+
+  // x > 5 implies x != 5, but not x > 6
+  bool result;
+  ASSERT_TRUE(
+      solver->mustBeTrue(Query(constraints, NeExpr::create(x, five)), result));
+  EXPECT_TRUE(result);
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(constraints,
+            UltExpr::create(ConstantExpr::alloc(6, Expr::Int8), x)),
+      result));
+  EXPECT_FALSE(result);
+
+  ref<ConstantExpr> value;
+  ASSERT_TRUE(solver->getValue(Query(constraints, x), value));
+  EXPECT_GT(value->getZExtValue(), 5u);
+
+  std::vector<const Array *> objects{array};
+  std::vector<std::vector<unsigned char>> values;
+  ASSERT_TRUE(solver->getInitialValues(
+      Query(constraints, ConstantExpr::alloc(0, Expr::Bool)), objects,
+      values));
+  ASSERT_EQ(1u, values.size());
+  ASSERT_EQ(1u, values[0].size());
+  EXPECT_GT(values[0][0], 5);
+
+  // every query was answered by one of the backends
+  EXPECT_EQ(winsBefore + 4, stats::portfolioWinsZ3.getValue() +
+                                stats::portfolioWinsZ3Tactic.getValue());
+}
+
+TEST_F(PortfolioSolverTest, ArraysOfManyQueries) {
+  // the workers must not confuse arrays of earlier queries with new ones
+  for (unsigned i = 0; i < 20; i++) {
+    const Array *array = AC.CreateArray("portfolio_y" + std::to_string(i), 1);
+    ref<Expr> y = ReadExpr::create(UpdateList(array, nullptr),
+                                   ConstantExpr::alloc(0, Expr::Int32));
+    ConstraintSet constraints;
+    ConstraintManager cm(constraints);
+    cm.addConstraint(EqExpr::create(ConstantExpr::alloc(i, Expr::Int8), y));
+
+    ref<ConstantExpr> value;
+    ASSERT_TRUE(solver->getValue(Query(constraints, y), value));
+    EXPECT_EQ(i, value->getZExtValue());
+  }
+}
+
+TEST_F(PortfolioSolverTest, LosingWorkersAreKeptAlive) {
+  uint64_t spawnsBefore = stats::solverWorkerSpawns.getValue();
+  askDisequalities("portfolio_z");
+  // one worker per backend, none of them is killed and forked again
+  EXPECT_LE(stats::solverWorkerSpawns.getValue(), spawnsBefore + 2);
+}
+
+TEST_F(PortfolioSolverTest, LosingWorkersAreKeptAliveWithoutTimeout) {
+  solver->setCoreSolverTimeout(time::Span());
+  uint64_t spawnsBefore = stats::solverWorkerSpawns.getValue();
+  askDisequalities("portfolio_w");
+  EXPECT_LE(stats::solverWorkerSpawns.getValue(), spawnsBefore + 2);
+}
+} // namespace
@@ -0,0 +1,131 @@
+//===-- SolverWorkerPoolTest.cpp ------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "Solver/SolverWorkerPool.h"
+
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+// Echoes the request, sleeps on "sleep", crashes on "crash" and answers
+// "large" with a response that does not fit into the buffer.
+void handle(const std::string &request, std::string &response) {
+  if (request == "sleep")
+    sleep(10);
+  if (request == "crash")
+    abort();
+  if (request == "large")
+    response.assign(1024, 'x');
+  else
+    response = request;
+}
+
+TEST(SolverWorkerPoolTest, WorkerIsReused) {
+  SolverWorkerPool pool(handle, 1, 256);
+  for (unsigned i = 0; i < 10; i++) {
+    std::string request = "query " + std::to_string(i), response;
+    ASSERT_EQ(SolverWorkerPool::Status::Success,
+              pool.run(request, response, time::seconds(10)));
+    EXPECT_EQ(request, response);
+  }
+  EXPECT_EQ(1u, pool.getNumSpawns());
+}
+
+TEST(SolverWorkerPoolTest, ExitAfterResponse) {
+  SolverWorkerPool *pool = nullptr;
+  SolverWorkerPool exiting(
+      [&pool](const std::string &request, std::string &response) {
+        if (request == "exit")
+          pool->exitAfterResponse();
+        response = request;
+      },
+      1, 256);
+  pool = &exiting;
+
+  for (const char *request : {"first", "exit", "second"}) {
+    std::string response;
+    ASSERT_EQ(SolverWorkerPool::Status::Success,
+              exiting.run(request, response, time::seconds(10)));
+    EXPECT_EQ(request, response);
+  }
+  EXPECT_EQ(2u, exiting.getNumSpawns());
+}
+
+TEST(SolverWorkerPoolTest, TimeoutAndCrash) {
+  SolverWorkerPool pool(handle, 1, 256);
+  std::string response;
+
+  EXPECT_EQ(SolverWorkerPool::Status::Timeout,
+            pool.run("sleep", response, time::Span("100ms")));
+  EXPECT_EQ(SolverWorkerPool::Status::Crashed,
+            pool.run("crash", response, time::seconds(10)));
+
+  // a new worker is started for the next request
+  ASSERT_EQ(SolverWorkerPool::Status::Success,
+            pool.run("ok", response, time::seconds(10)));
+  EXPECT_EQ("ok", response);
+  EXPECT_EQ(3u, pool.getNumSpawns());
+}
+
+TEST(SolverWorkerPoolTest, TooLarge) {
+  SolverWorkerPool pool(handle, 1, 256);
+  std::string response;
+
+  EXPECT_EQ(SolverWorkerPool::Status::TooLarge,
+            pool.run(std::string(1024, 'x'), response));
+  EXPECT_EQ(SolverWorkerPool::Status::TooLarge,
+            pool.run("large", response));
+
+  // the worker survives a response that is too large
+  ASSERT_EQ(SolverWorkerPool::Status::Success, pool.run("ok", response));
+  EXPECT_EQ("ok", response);
+  EXPECT_EQ(1u, pool.getNumSpawns());
+}
+
+TEST(SolverWorkerPoolTest, SubmitAndWait) {
+  SolverWorkerPool pool(handle, 2, 256);
+  SolverWorkerPool::Status status;
+
+  int first = pool.submit("first", status);
+  int second = pool.submit("second", status);
+  ASSERT_GE(first, 0);
+  ASSERT_GE(second, 0);
+  EXPECT_NE(first, second);
+
+  // both workers are busy
+  EXPECT_EQ(-1, pool.submit("third", status));
+  EXPECT_EQ(SolverWorkerPool::Status::Failed, status);
+
+  int ready = pool.waitAny(time::seconds(10));
+  EXPECT_TRUE(ready == first || ready == second);
+  EXPECT_TRUE(pool.isReady(ready));
+
+  std::string response;
+  ASSERT_EQ(SolverWorkerPool::Status::Success,
+            pool.wait(second, response, time::seconds(10)));
+  EXPECT_EQ("second", response);
+  ASSERT_EQ(SolverWorkerPool::Status::Success,
+            pool.wait(first, response, time::seconds(10)));
+  EXPECT_EQ("first", response);
+
+  int sleeping = pool.submit("sleep", status);
+  ASSERT_GE(sleeping, 0);
+  EXPECT_FALSE(pool.isReady(sleeping));
+  EXPECT_EQ(-1, pool.waitAny(time::Span("10ms")));
+  pool.cancel(sleeping);
+  EXPECT_FALSE(pool.isBusy(sleeping));
+  EXPECT_EQ(-1, pool.waitAny(time::Span("10ms")));
+}
+
+} // namespace
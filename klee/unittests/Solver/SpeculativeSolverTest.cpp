@@ -0,0 +1,196 @@
+//===-- SpeculativeSolverTest.cpp -----------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr/ArrayCache.h"
+#include "klee/Expr/Constraints.h"
+#include "klee/Expr/Expr.h"
+#include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverImpl.h"
+#include "klee/Solver/SolverStats.h"
+
+#include <memory>
+
+using namespace klee;
+
+namespace {
+ArrayCache AC;
+
+class SpeculativeSolverTest : public ::testing::Test {
+protected:
+  SpeculativeSolverTest()
+      : solver(createSpeculativeSolver(
+            createCoreSolver(CoreSolverType::Z3_SOLVER),
+            [] { return createCoreSolver(CoreSolverType::Z3_SOLVER); }, 2)) {
+    solver->setCoreSolverTimeout(time::Span("10s"));
+  }
+
+  std::unique_ptr<Solver> solver;
+};
+
+TEST_F(SpeculativeSolverTest, AnswersSpeculatedQueries) {
+  const Array *array = AC.CreateArray("speculative_x", 1);
+  ref<Expr> x = ReadExpr::create(UpdateList(array, nullptr),
+                                 ConstantExpr::alloc(0, Expr::Int32));
+  ref<Expr> five = ConstantExpr::alloc(5, Expr::Int8);
+  ref<Expr> six = ConstantExpr::alloc(6, Expr::Int8);
+
+  ConstraintSet constraints;
+  ConstraintManager cm(constraints);
+  cm.addConstraint(UltExpr::create(five, x));
+
+  Query valid(constraints, NeExpr::create(x, five));
+  Query invalid(constraints, UltExpr::create(six, x));
+  Query initial(constraints, ConstantExpr::alloc(0, Expr::Bool));
+
+  uint64_t hitsBefore = stats::speculativeHits.getValue();
+  solver->speculate(valid);
+  solver->speculate(invalid);
+  solver->speculate(initial);
+
+  // x > 5 implies x != 5, but not x > 6
+  bool result;
+  ASSERT_TRUE(solver->mustBeTrue(valid, result));
+  EXPECT_TRUE(result);
+  ASSERT_TRUE(solver->mustBeTrue(invalid, result));
+  EXPECT_FALSE(result);
+
+  std::vector<const Array *> objects{array};
+  std::vector<std::vector<unsigned char>> values;
+  ASSERT_TRUE(solver->getInitialValues(initial, objects, values));
+  ASSERT_EQ(1u, values.size());
+  ASSERT_EQ(1u, values[0].size());
+  EXPECT_GT(values[0][0], 5);
+
+  // queries that were still queued are solved directly, the others are hits
+  EXPECT_GE(stats::speculativeHits.getValue(), hitsBefore + 1);
+  EXPECT_LE(stats::speculativeHits.getValue(), hitsBefore + 3);
+}
+
+TEST_F(SpeculativeSolverTest, WorkersStartWithTheSolver) {
+  uint64_t spawnsBefore = stats::solverWorkerSpawns.getValue();
+  std::unique_ptr<Solver> other(createSpeculativeSolver(
+      createCoreSolver(CoreSolverType::Z3_SOLVER),
+      [] { return createCoreSolver(CoreSolverType::Z3_SOLVER); }, 2));
+  EXPECT_EQ(spawnsBefore + 2, stats::solverWorkerSpawns.getValue());
+}
+
+TEST_F(SpeculativeSolverTest, AnswersUnspeculatedQueries) {
+  const Array *array = AC.CreateArray("speculative_y", 1);
+  ref<Expr> y = ReadExpr::create(UpdateList(array, nullptr),
+                                 ConstantExpr::alloc(0, Expr::Int32));
+  ConstraintSet constraints;
+  ConstraintManager cm(constraints);
+  cm.addConstraint(EqExpr::create(y, ConstantExpr::alloc(42, Expr::Int8)));
+
+  // a speculation on another query must not answer this one
+  solver->speculate(
+      Query(constraints, EqExpr::create(y, ConstantExpr::alloc(7, Expr::Int8))));
+
+  uint64_t hitsBefore = stats::speculativeHits.getValue();
+  ref<ConstantExpr> value;
+  ASSERT_TRUE(solver->getValue(Query(constraints, y), value));
+  EXPECT_EQ(42u, value->getZExtValue());
+
+  Solver::Validity validity;
+  ASSERT_TRUE(solver->evaluate(
+      Query(constraints, EqExpr::create(y, ConstantExpr::alloc(42, Expr::Int8))),
+      validity));
+  EXPECT_EQ(Solver::True, validity);
+  EXPECT_EQ(hitsBefore, stats::speculativeHits.getValue());
+}
+
+TEST_F(SpeculativeSolverTest, ManySpeculations) {
+  // more speculations than workers, asked for in reverse order
+  std::vector<Query> queries;
+  std::vector<const Array *> arrays;
+  std::vector<ConstraintSet> constraintSets(20);
+  for (unsigned i = 0; i < 20; i++) {
+    const Array *array = AC.CreateArray("speculative_z" + std::to_string(i), 1);
+    ref<Expr> z = ReadExpr::create(UpdateList(array, nullptr),
+                                   ConstantExpr::alloc(0, Expr::Int32));
+    ConstraintManager cm(constraintSets[i]);
+    // z <= i, and z > i for every fifth query, which has no solution
+    ref<Expr> i8 = ConstantExpr::alloc(i, Expr::Int8);
+    cm.addConstraint(UleExpr::create(z, i8));
+    if (i % 5 == 0)
+      cm.addConstraint(UltExpr::create(i8, z));
+    arrays.push_back(array);
+    queries.emplace_back(constraintSets[i], ConstantExpr::alloc(0, Expr::Bool));
+  }
+  for (const Query &query : queries)
+    solver->speculate(query);
+
+  for (unsigned i = 20; i-- > 0;) {
+    std::vector<const Array *> objects{arrays[i]};
+    std::vector<std::vector<unsigned char>> values;
+    bool hasSolution;
+    ASSERT_TRUE(solver->impl->computeInitialValues(queries[i], objects, values,
+                                                   hasSolution));
+    EXPECT_EQ(i % 5 != 0, hasSolution);
+    if (hasSolution) {
+      EXPECT_LE(values[0][0], i);
+    }
+  }
+}
+
+TEST(SpeculativeSolverPortfolioTest, SolvesAlongsideKLEE) {
+  // The portfolio solver forks workers that share buffers with the process
+  // they are forked from. KLEE and the workers of the speculative solver
+  // solve at the same time, each with its own portfolio solver.
+  std::unique_ptr<Solver> solver(createSpeculativeSolver(
+      createPortfolioSolver({"z3", "z3:qfbv"}),
+      [] { return createPortfolioSolver({"z3", "z3:qfbv"}); }, 2));
+  solver->setCoreSolverTimeout(time::Span("10s"));
+
+  std::vector<Query> speculated;
+  std::vector<const Array *> arrays;
+  std::vector<ConstraintSet> constraintSets(10);
+  for (unsigned i = 0; i < 10; i++) {
+    const Array *array =
+        AC.CreateArray("speculative_p" + std::to_string(i), 1);
+    ref<Expr> p = ReadExpr::create(UpdateList(array, nullptr),
+                                   ConstantExpr::alloc(0, Expr::Int32));
+    ConstraintManager cm(constraintSets[i]);
+    cm.addConstraint(EqExpr::create(p, ConstantExpr::alloc(i, Expr::Int8)));
+    arrays.push_back(array);
+    speculated.emplace_back(constraintSets[i],
+                            ConstantExpr::alloc(0, Expr::Bool));
+  }
+
+  uint64_t hitsBefore = stats::speculativeHits.getValue();
+  for (const Query &query : speculated)
+    solver->speculate(query);
+
+  for (unsigned i = 0; i < 10; i++) {
+    // asked in KLEE while the workers are solving
+    const Array *array =
+        AC.CreateArray("speculative_k" + std::to_string(i), 1);
+    ref<Expr> k = ReadExpr::create(UpdateList(array, nullptr),
+                                   ConstantExpr::alloc(0, Expr::Int32));
+    ConstraintSet constraints;
+    ConstraintManager cm(constraints);
+    cm.addConstraint(
+        EqExpr::create(k, ConstantExpr::alloc(100 + i, Expr::Int8)));
+    ref<ConstantExpr> value;
+    ASSERT_TRUE(solver->getValue(Query(constraints, k), value));
+    EXPECT_EQ(100 + i, value->getZExtValue());
+
+    std::vector<const Array *> objects{arrays[i]};
+    std::vector<std::vector<unsigned char>> values;
+    bool hasSolution;
+    ASSERT_TRUE(solver->impl->computeInitialValues(speculated[i], objects,
+                                                   values, hasSolution));
+    ASSERT_TRUE(hasSolution);
+    EXPECT_EQ(i, values[0][0]);
+  }
+  EXPECT_LT(hitsBefore, stats::speculativeHits.getValue());
+}
+} // namespace
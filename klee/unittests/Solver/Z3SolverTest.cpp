@@ -18,6 +18,9 @@
 #include "klee/Expr/Constraints.h"
 #include "klee/Expr/Expr.h"
 #include "klee/Solver/Solver.h"
+#include "klee/Solver/SolverStats.h"
+
+#include "Solver/Z3Solver.h"
 
 using namespace klee;
 
@@ -69,3 +72,75 @@ TEST_F(Z3SolverTest, GetConstraintLog) {
   ASSERT_STRNE(Occurence, nullptr);
   free(ConstraintsString);
 }
+
+namespace {
+// Builds the queries of a path: each query adds a branch condition on a new
+// byte to the constraints of the previous one.
+void runPath(Solver &solver, const Array *array, unsigned length,
+             std::vector<bool> &results) {
+  ConstraintSet constraints;
+  ConstraintManager cm(constraints);
+  for (unsigned i = 0; i < length; i++) {
+    ref<Expr> byte = ReadExpr::create(UpdateList(array, nullptr),
+                                      ConstantExpr::alloc(i, Expr::Int32));
+    ref<Expr> prev = ReadExpr::create(
+        UpdateList(array, nullptr),
+        ConstantExpr::alloc(i ? i - 1 : 0, Expr::Int32));
+    ref<Expr> cond = UltExpr::create(AddExpr::create(prev, byte),
+                                     ConstantExpr::alloc(100 + i, Expr::Int8));
+
+    bool result;
+    ASSERT_TRUE(solver.mayBeTrue(Query(constraints, cond), result));
+    results.push_back(result);
+    // also ask a query that is unsatisfiable under the constraints
+    ASSERT_TRUE(solver.mustBeTrue(
+        Query(constraints, OrExpr::create(cond, Expr::createIsZero(cond))),
+        result));
+    results.push_back(result);
+    cm.addConstraint(cond);
+  }
+}
+} // namespace
+
+TEST(Z3SolverIncrementalTest, AgreesWithFreshSolvers) {
+  const Array *array = AC.CreateArray("incremental_path", 64);
+  Z3Solver fresh("", false), incremental("", true);
+  fresh.setCoreSolverTimeout(time::Span("10s"));
+  incremental.setCoreSolverTimeout(time::Span("10s"));
+
+  std::vector<bool> expected, results;
+  runPath(fresh, array, 16, expected);
+  runPath(incremental, array, 16, results);
+  // a second path sharing no prefix with the first one
+  const Array *other = AC.CreateArray("incremental_other", 64);
+  runPath(fresh, other, 8, expected);
+  runPath(incremental, other, 8, results);
+  // and the first path again
+  runPath(fresh, array, 16, expected);
+  runPath(incremental, array, 16, results);
+
+  EXPECT_EQ(expected, results);
+}
+
+// Every constraint of a path is asserted once, later queries push only their
+// new constraints on top of the scopes held for the previous one.
+TEST(Z3SolverIncrementalTest, ReusesPathPrefix) {
+  const Array *array = AC.CreateArray("incremental_reuse", 64);
+  std::vector<bool> results;
+  uint64_t asserted = stats::incrementalConstraintsAsserted.getValue();
+  uint64_t reused = stats::incrementalConstraintsReused.getValue();
+
+  Z3Solver fresh("", false);
+  fresh.setCoreSolverTimeout(time::Span("10s"));
+  runPath(fresh, array, 16, results);
+  EXPECT_EQ(asserted, stats::incrementalConstraintsAsserted.getValue());
+  EXPECT_EQ(reused, stats::incrementalConstraintsReused.getValue());
+
+  Z3Solver incremental("", true);
+  incremental.setCoreSolverTimeout(time::Span("10s"));
+  runPath(incremental, array, 16, results);
+  // the queries at depth i hold i constraints, the first one reuses i - 1
+  // and the second one all of them
+  EXPECT_EQ(asserted + 15, stats::incrementalConstraintsAsserted.getValue());
+  EXPECT_EQ(reused + 15 * 15, stats::incrementalConstraintsReused.getValue());
+}
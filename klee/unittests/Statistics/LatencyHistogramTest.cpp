@@ -0,0 +1,65 @@
+#include "klee/Statistics/LatencyHistogram.h"
+#include "gtest/gtest.h"
+
+#include <cstdint>
+
+using namespace klee;
+
+namespace {
+
+TEST(LatencyHistogramTest, Buckets) {
+  // the buckets are contiguous and cover all values
+  EXPECT_EQ(LatencyHistogram::getBucketLowerBound(0), 0u);
+  for (unsigned b = 0; b + 1 < LatencyHistogram::NumBuckets; b++) {
+    std::uint64_t lower = LatencyHistogram::getBucketLowerBound(b);
+    std::uint64_t upper = LatencyHistogram::getBucketUpperBound(b);
+    ASSERT_LE(lower, upper);
+    ASSERT_EQ(upper + 1, LatencyHistogram::getBucketLowerBound(b + 1));
+    ASSERT_EQ(LatencyHistogram::getBucket(lower), b);
+    ASSERT_EQ(LatencyHistogram::getBucket(upper), b);
+    // each bucket is at most an eighth of its values wide
+    ASSERT_LE((upper - lower) * LatencyHistogram::SubBuckets, lower);
+  }
+  EXPECT_EQ(LatencyHistogram::getBucket(UINT64_MAX),
+            LatencyHistogram::NumBuckets - 1);
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+  LatencyHistogram h;
+  EXPECT_EQ(h.getPercentile(50), 0u);
+
+  for (std::uint64_t v = 1; v <= 1000; v++)
+    h.add(v);
+  EXPECT_EQ(h.getCount(), 1000u);
+
+  // the results are the upper bounds of the buckets, within 1/8 of the value
+  std::uint64_t p50 = h.getPercentile(50);
+  EXPECT_GE(p50, 500u);
+  EXPECT_LE(p50, 500u + 500u / 8);
+  std::uint64_t p99 = h.getPercentile(99);
+  EXPECT_GE(p99, 990u);
+  EXPECT_LE(p99, 990u + 990u / 8);
+  EXPECT_EQ(h.getPercentile(100),
+            LatencyHistogram::getBucketUpperBound(
+                LatencyHistogram::getBucket(1000)));
+
+  h.clear();
+  EXPECT_EQ(h.getCount(), 0u);
+  h.add(7);
+  EXPECT_EQ(h.getPercentile(0), 7u);
+  EXPECT_EQ(h.getPercentile(99), 7u);
+}
+
+TEST(LatencyHistogramTest, Merge) {
+  LatencyHistogram a, b;
+  a.add(10, 9);
+  b.add(1000);
+  b.merge(a);
+  EXPECT_EQ(b.getCount(), 10u);
+  EXPECT_EQ(b.getPercentile(90), 10u);
+  EXPECT_EQ(b.getPercentile(100),
+            LatencyHistogram::getBucketUpperBound(
+                LatencyHistogram::getBucket(1000)));
+}
+
+} // namespace
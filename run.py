@@ -18,6 +18,14 @@ MAX_TIME = 3600 * 2
 OPTIMIZE = False
 
 
+# run IDA inside KLEE on the loaded module (no need for gen), or read its results
+# from the bitcode written by gen
+IDA_IN_KLEE = True
+
+# reuse per-function IDA summaries of unchanged functions across runs (ida_cache/)
+IDA_CACHE = False
+
+
 # set COV_STATS to True to get the coverage for symbolic/concrete branch.
 COV_STATS = False
 
@@ -65,6 +73,9 @@ def gen(pgm_cfg):
 					"-ida",
 					pgm_cfg["llvm_bc"]])
 
+	if IDA_CACHE:
+		cmd = " ".join([cmd, "-ida-cache-dir", SOURCE_DIR + "/ida_cache"])
+
 	os.system(cmd)
 
 
@@ -80,7 +91,7 @@ def run(pgm_cfg, searcher):
 	os.system("mkdir -p " + OUTPUT_DIR + "/" + searcher)
 
 	# llvm bitcode file
-	if searcher == "cgs":
+	if searcher == "cgs" and not IDA_IN_KLEE:
 		BC_PATH = SOURCE_DIR + "/new_benchmark/" + pgm_cfg["name"] + ".bc"
 	else:
 		BC_PATH = pgm_cfg["llvm_bc"]
@@ -132,6 +143,11 @@ def run(pgm_cfg, searcher):
 	 						"--target-branch-update-insts=" + str(TARGET_BRANCH_UPDATE_INSTS)
 	 						])
 
+	 	if not IDA_IN_KLEE:
+	 		basic_cmd = " ".join([basic_cmd, "--cgs-run-ida=false"])
+	 	elif IDA_CACHE:
+	 		basic_cmd = " ".join([basic_cmd, "--ida-cache-dir=" + SOURCE_DIR + "/ida_cache"])
+
 	# add program and symbolic inputs
 	basic_cmd = " ".join([basic_cmd, 
 						BC_PATH, 